@@ -46,18 +46,22 @@ class StreamAudioProcessor extends AudioWorkletProcessor {
         super();
         this.sampleRate = 48000;
         this.rb = new RingBuffer(2, this.sampleRate / 2);
-        this.target = Math.floor(this.sampleRate * 0.06);
-        this.max = Math.floor(this.sampleRate * 0.12);
-        this.prebufThreshold = Math.floor(this.sampleRate * 0.04);
-        this.minTarget = Math.floor(this.sampleRate * 0.03);
         this.maxTarget = Math.floor(this.sampleRate * 0.14);
+        this.lowLatency = false;
+        this.applyProfile();
         this.prebuffering = true; this.volume = 1; this.muted = false;
+        // Host is in DTX: an empty buffer is silence, not an underrun.
+        this.idle = false;
         this.samplesProcessed = 0; this.underruns = 0; this.overflows = 0;
         this.lastReport = 0; this.consecutiveUnderruns = 0;
         this.lastHealthAdjust = 0;
         this.port.onmessage = e => {
             const { type, data } = e.data;
             if (type === 'audio') {
+                if (this.idle) {
+                    this.idle = false;
+                    if (this.rb.length === 0) this.prebuffering = true;
+                }
                 const bufLen = this.rb.length;
                 if (bufLen > this.max) {
                     const toSkip = bufLen - this.target;
@@ -69,19 +73,28 @@ class StreamAudioProcessor extends AudioWorkletProcessor {
                 if (this.prebuffering && this.rb.length >= this.prebufThreshold) this.prebuffering = false;
             } else if (type === 'volume') this.volume = Math.max(0, Math.min(1, data));
             else if (type === 'mute') this.muted = data;
+            else if (type === 'idle') this.idle = true;
+            else if (type === 'profile') { this.lowLatency = !!data; this.applyProfile(); }
             else if (type === 'clear') {
                 this.rb.clear();
                 this.underruns = 0;
                 this.overflows = 0;
                 this.consecutiveUnderruns = 0;
-                this.target = Math.floor(this.sampleRate * 0.06);
-                this.max = Math.floor(this.sampleRate * 0.12);
-                this.prebufThreshold = Math.floor(this.sampleRate * 0.04);
+                this.applyProfile();
                 this.prebuffering = true;
+                this.idle = false;
             }
         };
         this.port.postMessage({ type: 'ready' });
     }
+    // Buffer targets in ms; the low-latency profile goes with 2.5 and 5 ms host frames.
+    applyProfile() {
+        const ms = v => Math.floor(this.sampleRate * v / 1000);
+        const [target, max, prebuf, minTarget, minPrebuf, health] = this.lowLatency
+            ? [25, 60, 15, 15, 10, 45] : [60, 120, 40, 30, 25, 90];
+        this.target = ms(target); this.max = ms(max); this.prebufThreshold = ms(prebuf);
+        this.minTarget = ms(minTarget); this.minPrebuf = ms(minPrebuf); this.healthMs = health;
+    }
     process(inputs, outputs) {
         const out = outputs[0];
         if (!out || !out.length) return true;
@@ -97,7 +110,9 @@ class StreamAudioProcessor extends AudioWorkletProcessor {
         if (this.muted || this.prebuffering) { for (let c = 0; c < out.length; c++) out[c].fill(0); this.samplesProcessed += frames; return true; }
         const read = this.rb.read(out, frames);
         if (this.volume !== 1) for (let c = 0; c < out.length; c++) for (let i = 0; i < frames; i++) out[c][i] *= this.volume;
-        if (read < frames) {
+        if (read < frames && this.idle) {
+            this.consecutiveUnderruns = 0;
+        } else if (read < frames) {
             this.underruns++; this.consecutiveUnderruns++;
             this.port.postMessage({ type: 'drop', reason: 'Underrun' });
             if (read > 0) {
@@ -117,9 +132,9 @@ class StreamAudioProcessor extends AudioWorkletProcessor {
         this.samplesProcessed += frames;
         if (this.samplesProcessed - this.lastHealthAdjust >= this.sampleRate * 2) {
             this.lastHealthAdjust = this.samplesProcessed;
-            if (bufferMs > 90) {
+            if (bufferMs > this.healthMs) {
                 this.target = Math.max(this.minTarget, this.target - Math.floor(this.sampleRate * 0.005));
-                this.prebufThreshold = Math.max(Math.floor(this.target * 0.7), Math.floor(this.sampleRate * 0.025));
+                this.prebufThreshold = Math.max(Math.floor(this.target * 0.7), this.minPrebuf);
                 this.max = Math.max(this.target + Math.floor(this.sampleRate * 0.03), this.max);
             }
         }
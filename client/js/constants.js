@@ -6,25 +6,40 @@ export const MSG = {
     CODEC_CAPS: 0x434F4350, MOUSE_MOVE_REL: 0x4D4F5652, CLIPBOARD_DATA: 0x434C4950,
     CLIPBOARD_GET: 0x434C4754, KICKED: 0x4B49434B, CURSOR_CAPTURE: 0x43555243,
     CURSOR_SHAPE: 0x43555253, AUDIO_ENABLE: 0x41554445, MIC_DATA: 0x4D494344, MIC_ENABLE: 0x4D494345,
-    ENCODER_INFO: 0x49434E45, VERSION: 0x56455253, STREAM_TARGET: 0x56505254
+    ENCODER_INFO: 0x49434E45, VERSION: 0x56455253, STREAM_TARGET: 0x56505254, ENCODE_ADJUST: 0x47434E45,
+    CURSOR_IMAGE: 0x43555249, CURSOR_POS: 0x43555250, STREAMS_SET: 0x53545253, STREAMS_INFO: 0x53545249,
+    STREAM_FOCUS: 0x53545246, AUDIO_FEEDBACK: 0x41554446
 };
 
+// MSG.AUDIO_FEEDBACK: what this client's audio path handles.
+export const AUDIO_CAPS = { REDUNDANCY: 0x01, DTX: 0x02 };
+
 export const CURSOR_TYPES = ['default', 'text', 'pointer', 'wait', 'progress', 'crosshair', 'move',
     'ew-resize', 'ns-resize', 'nwse-resize', 'nesw-resize', 'not-allowed', 'help', 'none'];
 
+// formats: decoder codec strings indexed by FORMATS id (4:2:0, 4:4:4, 4:2:0 10-bit).
 export const CODECS = {
-    AV1: { id: 0, name: 'AV1', codec: 'av01.0.05M.08' },
-    H265: { id: 1, name: 'H.265', codec: 'hev1.1.6.L93.B0' },
-    H264: { id: 2, name: 'H.264', codec: 'avc1.42001f' }
+    AV1: { id: 0, name: 'AV1', codec: 'av01.0.05M.08', formats: ['av01.0.05M.08', 'av01.1.05M.08', 'av01.0.05M.10'] },
+    H265: { id: 1, name: 'H.265', codec: 'hev1.1.6.L93.B0', formats: ['hev1.1.6.L93.B0', 'hev1.4.10.L93.B0', 'hev1.2.4.L93.B0'] },
+    H264: { id: 2, name: 'H.264', codec: 'avc1.42001f', formats: ['avc1.42001f', 'avc1.f4001f', 'avc1.6e001f'] }
 };
 
+export const FORMATS = [
+    { id: 0, name: '4:2:0' },
+    { id: 1, name: '4:4:4' },
+    { id: 2, name: '4:2:0 10-bit' }
+];
+
 export const CODEC_KEYS = ['av1', 'h265', 'h264'];
 
 export const C = {
-    HEADER: 55, AUDIO_HEADER: 24, PING_MS: 200, MAX_FRAMES: 64, FRAME_TIMEOUT_MS: 900,
+    HEADER: 56, AUDIO_HEADER: 24, PING_MS: 200, MAX_FRAMES: 64, FRAME_TIMEOUT_MS: 900,
     KEY_REQ_MIN_INTERVAL_MS: 350, KEY_RETRY_INTERVAL_MS: 700,
-    FEC_GROUP_SIZE: 10,
+    FEC_GROUP_SIZE: 10, AUDIO_FEEDBACK_MS: 1000,
     AUDIO_RATE: 48000, AUDIO_CH: 2,
+    // Opus frame duration sent with AUDIO_ENABLE, in 0.5 ms units (5, 10, 20 or 40);
+    // 5 ms and below also shrinks the playback buffer.
+    AUDIO_FRAME_UNITS: 20, AUDIO_LOW_LATENCY_UNITS: 10,
     MIC_HEADER: 24, MIC_RATE: 48000, MIC_CH: 1, MIC_FRAME_MS: 10,
     DC_CONTROL: { ordered: 1, maxRetransmits: 3 },
     DC_VIDEO: { ordered: 0, maxRetransmits: 0 },
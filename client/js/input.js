@@ -2,7 +2,7 @@
 import { MSG } from './constants.js';
 import { S, mkBuf, log, safe } from './state.js';
 import { canvas, canvasW, canvasH, calcVp, resetCursorStyle } from './renderer.js';
-import { requestClipboard, pushClipboardToHost, sendCursorCapture } from './protocol.js';
+import { requestClipboard, pushClipboardToHost } from './protocol.js';
 const BUTTON_MAP = { 0: 0, 2: 1, 1: 2, 3: 3, 4: 4 };
 const mAbsBuf = new ArrayBuffer(12), mAbsView = new DataView(mAbsBuf);
 const mRelBuf = new ArrayBuffer(8), mRelView = new DataView(mRelBuf);
@@ -415,7 +415,6 @@ const toggleControl = enable => {
 };
 export const setRelativeMouseMode = enable => {
     S.relativeMouseMode = enable;
-    sendCursorCapture(enable, { suppressIfClosed: true });
 
     if (enable) {
         resetCursorStyle();
@@ -9,6 +9,8 @@ let kfRetryInterval = null;
 let lastCaptureTs = 0;
 let workletNode = null;
 let workletReady = false;
+// The host sent a DTX frame: silence follows until the next packet, not loss.
+let audioIdlePending = false;
 let lastWaitingKeyLogAt = 0;
 let decodeQueuePressureCount = 0;
 let lastDecodeQueuePressureAt = 0;
@@ -69,7 +71,7 @@ const tryReinitDecoder = () => {
         }, 100);
     }
 };
-const CODEC_MAP = Object.fromEntries(Object.values(CODECS).map(c => [c.id, c.codec]));
+const CODEC_MAP = Object.fromEntries(Object.values(CODECS).map(c => [c.id, c]));
 
 export const initDecoder = async (force = false) => {
     if (!window.VideoDecoder) {
@@ -91,8 +93,9 @@ export const initDecoder = async (force = false) => {
         safe(() => S.decoder.close(), undefined, 'MEDIA');
     }
 
-    const codec = CODEC_MAP[S.currentCodec] || CODEC_MAP[2];
-    log.info('MEDIA', 'Initializing decoder', { codec, codecId: S.currentCodec });
+    const info = CODEC_MAP[S.currentCodec] || CODEC_MAP[2];
+    const codec = info.formats[S.currentFormat] || info.codec;
+    log.info('MEDIA', 'Initializing decoder', { codec, codecId: S.currentCodec, format: S.currentFormat });
 
     const decoder = S.decoder = new VideoDecoder({
         output: frame => {
@@ -117,6 +120,12 @@ export const initDecoder = async (force = false) => {
                 queueSize: S.decoder?.decodeQueueSize || 0
             });
             if (meta) meta.decodeOutputMs = now;
+            // Another monitor's stream is on screen; this decoder keeps up in the background.
+            if (S.focusedStream !== 0) {
+                S.frameMeta.delete(frame.timestamp);
+                frame.close();
+                return;
+            }
 
             queueFrameForPresentation({
                 frame,
@@ -350,6 +359,7 @@ export const initAudio = async () => {
             }
         };
 
+        workletNode.port.postMessage({ type: 'profile', data: S.audioFrameUnits <= C.AUDIO_LOW_LATENCY_UNITS });
         workletNode.connect(gain);
         if (window.AudioDecoder) {
             const decoder = S.audioDecoder = new AudioDecoder({
@@ -357,6 +367,10 @@ export const initAudio = async () => {
                     if (S.audioEnabled && workletReady) {
                         recordAudioDecoded();
                         sendToWorklet(audioData);
+                        if (audioIdlePending && !S.audioDecoder?.decodeQueueSize) {
+                            audioIdlePending = false;
+                            workletNode?.port.postMessage({ type: 'idle' });
+                        }
                     } else {
                         logAudioDrop('Discarded (disabled)');
                         audioData.close();
@@ -464,6 +478,17 @@ export const handleAudioPacket = data => {
         return;
     }
 
+    // Opus DTX frames are one or two bytes; nothing to decode, playback just runs dry.
+    if (payloadLength <= 2) {
+        audioIdlePending = true;
+        if (!S.audioDecoder?.decodeQueueSize) {
+            audioIdlePending = false;
+            workletNode?.port.postMessage({ type: 'idle' });
+        }
+        return;
+    }
+    audioIdlePending = false;
+
     if (S.audioDecoder?.state !== 'configured') {
         logAudioDrop('Decoder not configured', {
             state: S.audioDecoder?.state,
@@ -503,7 +528,7 @@ export const toggleAudio = async () => {
                 S.audioEnabled = 1;
                 btn.classList.add('on');
                 txt.textContent = 'Mute';
-                sendAudioEnable(1, { suppressIfClosed: true });
+                sendAudioEnable(1, S.audioFrameUnits, { suppressIfClosed: true });
                 log.info('MEDIA', 'Audio enabled');
             } else {
                 log.error('MEDIA', 'Failed to enable audio');
@@ -516,11 +541,17 @@ export const toggleAudio = async () => {
         btn.classList.remove('on');
         txt.textContent = 'Enable';
         resetAudioState();
-        sendAudioEnable(0, { suppressIfClosed: true });
+        sendAudioEnable(0, S.audioFrameUnits, { suppressIfClosed: true });
         log.info('MEDIA', 'Audio disabled');
     }
 };
 
+export const setAudioFrame = units => {
+    S.audioFrameUnits = units;
+    workletNode?.port.postMessage({ type: 'profile', data: units <= C.AUDIO_LOW_LATENCY_UNITS });
+    if (S.audioEnabled) sendAudioEnable(1, units, { suppressIfClosed: true });
+};
+
 export const closeAudio = () => {
     if (workletNode) {
         safe(() => workletNode.disconnect(), undefined, 'AUDIO');
@@ -1,6 +1,6 @@
 
 import { enableControl, disableControl } from './input.js';
-import { MSG, C } from './constants.js';
+import { MSG, C, AUDIO_CAPS } from './constants.js';
 import { S, $, safe, updateClockOffset, resetClockSync,
     startMetricsLogger, stopMetricsLogger, resetSessionStats, recordPacket,
     clientTimeUs, logVideoDrop, logAudioDrop, logNetworkDrop, log, bus } from './state.js';
@@ -8,13 +8,14 @@ import { handleAudioPacket, closeAudio, initDecoder, decodeFrame, stopKeyframeRe
 import { updateMonOpts, updateCodecOpts, updateCodecDropdown, setHostCodecs,
     updateLoadingStage, showLoading, hideLoading, getStoredCodec, initCodecDetection,
     getStoredFps, updateFpsDropdown, closeTabbedMode } from './ui.js';
-import { resetRenderer, setCursorStyle } from './renderer.js';
+import { resetRenderer, setCursorStyle, setCursorPosition, addCursorImage, resetHostCursor } from './renderer.js';
 import { stopMic } from './mic.js';
 import { showAuth, clearSession, validateSession } from './auth.js';
 import { sendPing, requestKeyframe, requestRecoveryKeyframe, clearPendingKeyReq,
     applyCodec, applyFps, getMaxInFlightFrames, expectedChunkSize,
-    resendStreamTarget,
+    resendStreamTarget, sendAudioFeedback,
     tryRecoverFrameGroup, resetProtocolState } from './protocol.js';
+import { handleStreamPacket, applyStreamsInfo, setFocusedStream, syncMonitorStreams, resetStreams } from './streams.js';
 
 const BASE_URL = location.origin;
 let hasConnection = false;
@@ -37,6 +38,10 @@ const AUDIO_PKT_FEC = 1;
 const audioFecGroups = new Map();
 const seenAudioPacketIds = new Set();
 let lastAudioFecCleanupAt = 0;
+// Redundant copy of the previous packet after the payload: [int64 ts][uint16 samples][data].
+const AUDIO_REDUNDANT_HEADER = 10;
+// Audio loss before recovery, reported to the host every C.AUDIO_FEEDBACK_MS.
+const audioLoss = { windowStart: -1, highest: -1, received: 0, lastReportAt: 0 };
 const pendingVideoFec = new Map();
 
 const hasPublicIceCandidate = sdp => sdp.includes(' typ srflx') || sdp.includes(' typ relay');
@@ -167,6 +172,48 @@ const cleanupAudioFecGroups = now => {
     }
 };
 
+const resetAudioLoss = () => {
+    audioLoss.windowStart = audioLoss.highest = -1;
+    audioLoss.received = audioLoss.lastReportAt = 0;
+};
+
+const trackAudioArrival = packetId => {
+    if (audioLoss.windowStart < 0) audioLoss.windowStart = packetId;
+    audioLoss.highest = Math.max(audioLoss.highest, packetId);
+    audioLoss.received++;
+};
+
+const reportAudioLoss = now => {
+    if (!S.audioEnabled) { resetAudioLoss(); return; }
+    if (now - audioLoss.lastReportAt < C.AUDIO_FEEDBACK_MS) return;
+    audioLoss.lastReportAt = now;
+    const expected = audioLoss.windowStart < 0 ? 0 : audioLoss.highest - audioLoss.windowStart + 1;
+    const lossPercent = expected > 0 ? Math.min(100, Math.round(Math.max(0, expected - audioLoss.received) * 100 / expected)) : 0;
+    sendAudioFeedback(AUDIO_CAPS.REDUNDANCY | AUDIO_CAPS.DTX, lossPercent, audioLoss.received);
+    if (lossPercent > 0) log.debug('NET', 'Audio loss reported', { lossPercent, expected, received: audioLoss.received });
+    if (audioLoss.highest >= 0) audioLoss.windowStart = audioLoss.highest + 1;
+    audioLoss.received = 0;
+};
+
+// Rebuilds the previous packet from the copy the host appends while redundancy is on.
+const deliverRedundantAudio = (data, packetId, dataLen, extraLen) => {
+    const offset = C.AUDIO_HEADER + dataLen;
+    const payloadLen = extraLen - AUDIO_REDUNDANT_HEADER;
+    if (packetId === 0 || payloadLen <= 0 || seenAudioPacketIds.has(packetId - 1)) return;
+    const src = new DataView(data, offset, AUDIO_REDUNDANT_HEADER);
+    const packet = new Uint8Array(C.AUDIO_HEADER + payloadLen);
+    const view = new DataView(packet.buffer);
+    view.setUint32(0, MSG.AUDIO_DATA, true);
+    view.setBigInt64(4, src.getBigInt64(0, true), true);
+    view.setUint32(12, packetId - 1, true);
+    view.setUint16(16, src.getUint16(8, true), true);
+    view.setUint16(18, payloadLen, true);
+    packet.set(new Uint8Array(data, offset + AUDIO_REDUNDANT_HEADER, payloadLen), C.AUDIO_HEADER);
+    if (rememberAndDeliverAudioPacket(packetId - 1, packet.buffer)) {
+        log.debug('NET', 'Audio redundancy recovered packet', { packetId: packetId - 1 });
+    }
+};
+
 const deliverAudioPacket = packet => {
     const buffer = packet instanceof ArrayBuffer ? packet : packet.buffer.slice(packet.byteOffset, packet.byteOffset + packet.byteLength);
     recordPacket(buffer.byteLength, 'audio');
@@ -267,9 +314,27 @@ const parseMonitorList = data => {
     }
     log.info('NET', 'Monitor list received', { count, current: S.currentMon });
     updateMonOpts();
+    syncMonitorStreams();
 };
 
 // --- Frame processing ---
+// Gives up on an enhancement layer frame without a keyframe: the base layer never
+// references it, so decoding continues once a lower layer frame arrives.
+const skipLayerFrame = (frameId, layer, reason) => {
+    if (S.skippedLayerFrames.has(frameId)) return;
+    S.skippedLayerFrames.set(frameId, layer);
+    S.layerFloor = Math.min(S.layerFloor, layer);
+    S.chunks.delete(frameId);
+    S.stats.framesLayerSkipped++;
+    log.debug('VIDEO', 'Skipped enhancement layer frame', { frameId, layer, reason });
+    if (S.skippedLayerFrames.size > 256) {
+        for (const id of S.skippedLayerFrames.keys()) {
+            if (S.skippedLayerFrames.size <= 128) break;
+            S.skippedLayerFrames.delete(id);
+        }
+    }
+};
+
 const processFrame = (frameId, frame) => {
     if (!frame.parts.every(p => p)) {
         const missingChunks = frame.parts.map((p, i) => p ? null : i).filter(i => i !== null);
@@ -282,6 +347,7 @@ const processFrame = (frameId, frame) => {
             fecPartsReceived: frame.fecParts.size
         });
         S.chunks.delete(frameId);
+        if (frame.layer > 0 && !frame.isKey) skipLayerFrame(frameId, frame.layer, 'incomplete');
         return;
     }
     const buffer = frame.total === 1
@@ -330,9 +396,21 @@ const processFrame = (frameId, frame) => {
         }
     }
 
-    // Frame gap detection
+    // A frame that was already given up as a skipped enhancement layer frame stays skipped.
+    if (S.skippedLayerFrames.has(frameId)) {
+        S.chunks.delete(frameId);
+        return;
+    }
+
+    // Frame gap detection. Missing enhancement layer frames (known from a host drop
+    // marker or a partial arrival) are skipped instead of counted as losses.
     if (S.lastFrameId > 0 && frameId > S.lastFrameId + 1) {
-        const gapSize = frameId - S.lastFrameId - 1;
+        let gapSize = 0;
+        for (let id = S.lastFrameId + 1; id < frameId; id++) {
+            const missingLayer = S.skippedLayerFrames.get(id) ?? S.chunks.get(id)?.layer ?? 0;
+            if (missingLayer > 0) skipLayerFrame(id, missingLayer, 'gap');
+            else gapSize++;
+        }
         if (gapSize > 0) {
             log.warn('VIDEO', `Frame gap detected: ${gapSize} frames missing`, {
                 prevId: S.lastFrameId, currentId: frameId, isKey: frame.isKey ? 1 : 0
@@ -349,6 +427,14 @@ const processFrame = (frameId, frame) => {
         }
     }
 
+    // Frames at or above a skipped layer may reference the skipped frame; a lower layer frame restarts them.
+    if (!frame.isKey && frame.layer >= S.layerFloor) {
+        skipLayerFrame(frameId, frame.layer, 'dependent');
+        if (frameId > S.lastFrameId) S.lastFrameId = frameId;
+        return;
+    }
+    if (frame.isKey || frame.layer < S.layerFloor) S.layerFloor = Infinity;
+
     S.stats.framesComplete++;
     if (frame.isKey) S.stats.keyframesReceived++;
     if (frameId > S.lastFrameId) S.lastFrameId = frameId;
@@ -419,20 +505,33 @@ const handleControl = async e => {
         }
         return recordPacket(length, 'control');
     }
-    if (msgType === MSG.CODEC_CAPS && length === 5) {
-        setHostCodecs(view.getUint8(4));
+    if (msgType === MSG.ENCODE_ADJUST && length === 18) {
+        // limits: 1 = encode time, 2 = bandwidth, 4 = faster preset; fps 0 = not capped.
+        const limit = {
+            limits: view.getUint8(4), action: view.getUint8(5), scale: view.getUint8(6),
+            fps: view.getUint16(8, true), p95Ms: view.getUint32(10, true) / 1000, budgetMs: view.getUint32(14, true) / 1000
+        };
+        S.encodeLimit = limit.limits ? limit : null;
+        log.info('NET', 'Encode adjust', limit);
+        return recordPacket(length, 'control');
+    }
+    if (msgType === MSG.CODEC_CAPS && length >= 5) {
+        // Hosts before format negotiation send the codec mask only.
+        const formats = length >= 8 ? [view.getUint8(5), view.getUint8(6), view.getUint8(7)] : [1, 1, 1];
+        setHostCodecs(view.getUint8(4), formats);
         await updateCodecOpts();
         if (!S.codecSent) applyCodec(S.currentCodec);
-        log.info('NET', 'Codec caps', { caps: view.getUint8(4).toString(2) });
+        log.info('NET', 'Codec caps', { caps: view.getUint8(4).toString(2), formats });
         return recordPacket(length, 'control');
     }
-    if (msgType === MSG.CODEC_ACK && length === 5) {
+    if (msgType === MSG.CODEC_ACK && length >= 5) {
         S.currentCodec = view.getUint8(4);
-        updateCodecDropdown(S.currentCodec);
+        S.currentFormat = length >= 6 ? view.getUint8(5) : 0;
+        updateCodecDropdown(S.currentCodec, S.currentFormat);
         await initDecoder(true);
         resendStreamTarget();
         if (!S.fpsSent) applyFps(getStoredFps() ?? 60);
-        log.info('NET', 'Codec ack', { codec: S.currentCodec });
+        log.info('NET', 'Codec ack', { codec: S.currentCodec, format: S.currentFormat });
         return recordPacket(length, 'control');
     }
     if (msgType === MSG.FPS_ACK && length === 7) {
@@ -446,6 +545,24 @@ const handleControl = async e => {
         const count = view.getUint8(4);
         if (count >= 1 && count <= 16) { recordPacket(length, 'control'); return parseMonitorList(e.data); }
     }
+    // Stream 0 is the primary one handled above; the rest are extra monitors.
+    if (msgType === MSG.STREAMS_INFO && length >= 5 && length === 5 + view.getUint8(4) * 8) {
+        const list = [];
+        for (let i = 0, offset = 5; i < view.getUint8(4); i++, offset += 8) {
+            list.push({
+                id: view.getUint8(offset), monitor: view.getUint8(offset + 1),
+                codec: view.getUint8(offset + 2), format: view.getUint8(offset + 3),
+                width: view.getUint16(offset + 4, true), height: view.getUint16(offset + 6, true)
+            });
+        }
+        applyStreamsInfo(list.filter(s => s.id !== 0));
+        return recordPacket(length, 'control');
+    }
+    if (msgType === MSG.STREAM_FOCUS && length === 5) {
+        setFocusedStream(view.getUint8(4));
+        log.info('NET', 'Stream focus', { id: view.getUint8(4) });
+        return recordPacket(length, 'control');
+    }
     if (msgType === MSG.CLIPBOARD_DATA && length >= 8) {
         const textLen = view.getUint32(4, true);
         if (textLen > 0 && length >= 8 + textLen && textLen <= 1048576) {
@@ -455,7 +572,19 @@ const handleControl = async e => {
         }
         return recordPacket(length, 'control');
     }
-    if (msgType === MSG.CURSOR_SHAPE && length === 5) { setCursorStyle(view.getUint8(4)); return recordPacket(length, 'control'); }
+    if (msgType === MSG.CURSOR_IMAGE && length >= 16) {
+        const id = view.getUint32(4, true);
+        const width = view.getUint16(8, true), height = view.getUint16(10, true);
+        if (width > 0 && height > 0 && width <= 256 && height <= 256 && length === 16 + width * height * 4) {
+            addCursorImage(id, width, height, view.getUint16(12, true), view.getUint16(14, true), new Uint8ClampedArray(e.data.slice(16)));
+        }
+        return recordPacket(length, 'control');
+    }
+    // 9 bytes: the shape's bitmap id follows the type.
+    if (msgType === MSG.CURSOR_SHAPE && (length === 5 || length === 9)) {
+        setCursorStyle(view.getUint8(4), length === 9 ? view.getUint32(5, true) : 0);
+        return recordPacket(length, 'control');
+    }
     if (msgType === MSG.KICKED && length === 4) {
         logNetworkDrop('Kicked by server');
         cleanup();
@@ -478,6 +607,9 @@ const handleControl = async e => {
 
 // --- Video packet handler ---
 const VIDEO_PKT_DATA = 0, VIDEO_PKT_FEC = 1;
+const VIDEO_FRAME_KEY = 1, VIDEO_FRAME_REPEAT = 2, VIDEO_FRAME_DROPPED = 3;
+const VIDEO_FLAG_LAYER_MASK = 0x06, VIDEO_FLAG_LAYER_SHIFT = 1;
+const VIDEO_FLAG_STREAM_MASK = 0xF8, VIDEO_FLAG_STREAM_SHIFT = 3;
 
 const handleVideo = e => {
     const arrivalMs = performance.now();
@@ -498,6 +630,36 @@ const handleVideo = e => {
     const frameType = view.getUint8(52);
     const packetType = view.getUint8(53);
     const fecGroupSize = view.getUint8(54) || C.FEC_GROUP_SIZE;
+    const flags = view.getUint8(55);
+    const layer = (flags & VIDEO_FLAG_LAYER_MASK) >> VIDEO_FLAG_LAYER_SHIFT;
+    const stream = (flags & VIDEO_FLAG_STREAM_MASK) >> VIDEO_FLAG_STREAM_SHIFT;
+
+    if (stream !== 0) {
+        recordPacket(length, 'video');
+        S.stats.bytes += length;
+        const marker = frameType === VIDEO_FRAME_REPEAT || frameType === VIDEO_FRAME_DROPPED;
+        if (!marker && (chunkBytes !== length - C.HEADER || totalChunks === 0 ||
+            (packetType === VIDEO_PKT_DATA && chunkIndex >= totalChunks))) { logVideoDrop('Invalid stream packet', { stream, frameId }); return; }
+        handleStreamPacket(stream, {
+            frameId, frameType, packetType, chunkIndex, totalChunks, frameSize, capTs: captureTs, layer, arrivalMs
+        }, new Uint8Array(e.data, C.HEADER, chunkBytes));
+        return;
+    }
+
+    // Host skipped an unchanged frame; the last decoded frame stays on screen.
+    if (frameType === VIDEO_FRAME_REPEAT) {
+        recordPacket(length, 'video');
+        S.stats.bytes += length;
+        S.stats.framesRepeated++;
+        return;
+    }
+    // Host discarded this queued enhancement layer frame under congestion.
+    if (frameType === VIDEO_FRAME_DROPPED) {
+        recordPacket(length, 'video');
+        S.stats.bytes += length;
+        skipLayerFrame(frameId, Math.max(1, layer), 'host-dropped');
+        return;
+    }
 
     if (totalChunks === 0 || captureTs <= 0 || sourceTs <= 0 || frameSize === 0 || dataChunkSize === 0) { logVideoDrop('Invalid packet data'); return; }
     if (packetType === VIDEO_PKT_DATA && chunkIndex >= totalChunks) { logVideoDrop('Invalid data chunk index', { frameId, chunkIndex, totalChunks }); return; }
@@ -526,6 +688,7 @@ const handleVideo = e => {
                 }, { countDropped: false });
                 S.chunks.delete(id);
                 S.stats.framesTimeout++;
+                if (frame.layer > 0 && !frame.isKey) skipLayerFrame(id, frame.layer, 'timeout');
                 if (frame.isKey && frame.received > 0) {
                     log.error('VIDEO', 'Timed-out keyframe is unrecoverable - requesting new keyframe', {
                         frameId: id, received: frame.received, total: frame.total
@@ -547,7 +710,7 @@ const handleVideo = e => {
                 sourceTs,
                 encodeEndTs,
                 enqueueTs,
-                isKey: frameType === 1,
+                isKey: frameType === VIDEO_FRAME_KEY,
                 fecGroupSize: Math.max(1, fecGroupSize)
             }, chunkIndex, chunkData, arrivalMs);
             return;
@@ -559,7 +722,7 @@ const handleVideo = e => {
             sourceTs,
             encodeEndTs,
             enqueueTs,
-            encMs: view.getUint32(32, true) / 1000, arrivalMs, lastPacketMs: arrivalMs, isKey: frameType === 1,
+            encMs: view.getUint32(32, true) / 1000, arrivalMs, lastPacketMs: arrivalMs, isKey: frameType === VIDEO_FRAME_KEY, layer,
             frameSize, dataChunkSize, fecGroupSize: Math.max(1, fecGroupSize),
             fecParts: new Map(), fecRecovered: 0
         });
@@ -568,7 +731,8 @@ const handleVideo = e => {
         const maxInFlight = getMaxInFlightFrames();
         if (S.chunks.size > maxInFlight) {
             const sorted = [...S.chunks.entries()].sort((a, b) => a[0] - b[0]);
-            const candidate = sorted.find(([id, f]) => id !== frameId && f.received < f.total && !f.isKey)
+            const candidate = sorted.find(([id, f]) => id !== frameId && f.received < f.total && f.layer > 0 && !f.isKey)
+                || sorted.find(([id, f]) => id !== frameId && f.received < f.total && !f.isKey)
                 || sorted.find(([id, f]) => id !== frameId && f.received < f.total)
                 || sorted.find(([id]) => id !== frameId);
 
@@ -579,6 +743,7 @@ const handleVideo = e => {
                     inFlight: sorted.length, limit: maxInFlight, droppedFrameId: victimId,
                     droppedReceived: victim.received, droppedTotal: victim.total, droppedIsKey: victim.isKey ? 1 : 0
                 });
+                if (victim.layer > 0 && !victim.isKey) skipLayerFrame(victimId, victim.layer, 'evicted');
                 const now = performance.now();
                 const stalled = now - lastFrameCompletedAt > Math.max(700, C.FRAME_TIMEOUT_MS / 2);
                 if (victim.isKey || stalled) requestRecoveryKeyframe(victim.isKey ? 'evicted-keyframe-unrecoverable' : 'reassembly-stalled');
@@ -622,7 +787,8 @@ const handleAudio = e => {
     const dataLen = view.getUint16(18, true);
     const packetType = view.getUint8(20);
     const groupSize = Math.max(1, view.getUint8(21) || C.FEC_GROUP_SIZE || 4);
-    const expectedLen = C.AUDIO_HEADER + dataLen;
+    const extraLen = view.getUint16(22, true);
+    const expectedLen = C.AUDIO_HEADER + dataLen + extraLen;
 
     if (dataLen === 0 || expectedLen !== length) {
         logAudioDrop('Size mismatch', { packetId, expected: expectedLen, got: length, packetType });
@@ -637,14 +803,17 @@ const handleAudio = e => {
     cleanupAudioFecGroups(now);
 
     if (packetType === AUDIO_PKT_DATA) {
-        if (!rememberAndDeliverAudioPacket(packetId, e.data)) {
+        trackAudioArrival(packetId);
+        if (extraLen > 0) deliverRedundantAudio(e.data, packetId, dataLen, extraLen);
+        const packet = extraLen > 0 ? e.data.slice(0, C.AUDIO_HEADER + dataLen) : e.data;
+        if (!rememberAndDeliverAudioPacket(packetId, packet)) {
             log.debug('NET', 'Duplicate audio packet', { packetId });
             return;
         }
 
         const groupStart = getAudioGroupStart(packetId, groupSize);
         const group = ensureAudioFecGroup(groupStart, groupSize, now);
-        group.dataPackets.set(packetId, new Uint8Array(e.data));
+        group.dataPackets.set(packetId, new Uint8Array(packet));
         finalizeAudioFecGroup(groupStart);
         return;
     }
@@ -658,11 +827,20 @@ const handleAudio = e => {
 
 // --- Channel lifecycle ---
 const DC_KEYS = ['dcControl', 'dcVideo', 'dcAudio', 'dcInput', 'dcMic'];
+// --- Host cursor position (host -> client on the input channel) ---
+const CURSOR_POS_VISIBLE = 0x01;
+const handleHostInput = e => {
+    if (!(e.data instanceof ArrayBuffer) || e.data.byteLength !== 9) return;
+    const view = new DataView(e.data);
+    if (view.getUint32(0, true) !== MSG.CURSOR_POS) return;
+    setCursorPosition(view.getUint16(4, true) / 65535, view.getUint16(6, true) / 65535, (view.getUint8(8) & CURSOR_POS_VISIBLE) !== 0);
+};
+
 const DC_CONFIG = [
     ['dcControl', 'control', C.DC_CONTROL, handleControl],
     ['dcVideo', 'video', C.DC_VIDEO, handleVideo],
     ['dcAudio', 'audio', C.DC_AUDIO, handleAudio],
-    ['dcInput', 'input', C.DC_INPUT, () => {}],
+    ['dcInput', 'input', C.DC_INPUT, handleHostInput],
     ['dcMic', 'mic', C.DC_MIC, () => {}]
 ];
 
@@ -685,7 +863,10 @@ const onAllChannelsOpen = async connectSeq => {
     resendStreamTarget();
     clearPing();
     startMetricsLogger();
-    pingInterval = setInterval(sendPing, C.PING_MS);
+    pingInterval = setInterval(() => {
+        sendPing();
+        reportAudioLoss(performance.now());
+    }, C.PING_MS);
 };
 
 const onChannelClose = (connectSeq, label) => {
@@ -728,8 +909,11 @@ const cleanup = () => {
     clearPendingKeyReq();
     resetClockSync();
     closeDataChannels();
+    resetHostCursor();
+    resetStreams();
     audioFecGroups.clear();
     seenAudioPacketIds.clear();
+    resetAudioLoss();
     pendingVideoFec.clear();
 };
 
@@ -739,12 +923,14 @@ const resetState = () => {
     DC_KEYS.forEach(k => S[k] = null);
     S.pc = S.decoder = null;
     S.ready = S.fpsSent = S.codecSent = waitingFirstFrame = 0;
-    S.hostEncoderName = null;
+    S.hostEncoderName = S.encodeLimit = null;
     hasConnection = false;
     lastFrameCompletedAt = 0;
     resetProtocolState();
     S.chunks.clear();
     S.lastFrameId = 0;
+    S.layerFloor = Infinity;
+    S.skippedLayerFrames.clear();
     S.frameMeta.clear();
     lastChunkCleanupAt = 0;
     lastAudioFecCleanupAt = 0;
@@ -14,11 +14,27 @@ const mkCtrlMsg = (type, size, fn, options) => sendControl(mkBuf(size, v => { v.
 const sendByteControl = (type, value, options) => mkCtrlMsg(type, 5, v => v.setUint8(4, value), options);
 const sendBoolControl = (type, enabled, options) => sendByteControl(type, enabled ? 1 : 0, options);
 
-export const sendAudioEnable = (en, options) => sendBoolControl(MSG.AUDIO_ENABLE, en, options);
+export const sendAudioEnable = (en, frameUnits, options) => mkCtrlMsg(MSG.AUDIO_ENABLE, 6, v => {
+    v.setUint8(4, en ? 1 : 0);
+    v.setUint8(5, frameUnits);
+}, options);
 export const sendMicEnable = (en, options) => sendBoolControl(MSG.MIC_ENABLE, en, options);
 export const sendMonitor = idx => sendByteControl(MSG.MONITOR_SET, idx);
+export const sendStreamFocus = id => sendByteControl(MSG.STREAM_FOCUS, id);
+export const sendStreamsSet = monitors => mkCtrlMsg(MSG.STREAMS_SET, 5 + monitors.length, v => {
+    v.setUint8(4, monitors.length);
+    monitors.forEach((m, i) => v.setUint8(5 + i, m));
+});
+// Streams other than the primary one name themselves in a fifth byte; they are throttled by the caller.
+export const requestStreamKeyframe = id => mkCtrlMsg(MSG.REQUEST_KEY, 5, v => v.setUint8(4, id), { suppressIfClosed: true });
+// lossPercent: audio packets missing before any recovery since the last report.
+export const sendAudioFeedback = (caps, lossPercent, received) => mkCtrlMsg(MSG.AUDIO_FEEDBACK, 8, v => {
+    v.setUint8(4, caps);
+    v.setUint8(5, lossPercent);
+    v.setUint16(6, Math.min(65535, received), true);
+}, { suppressIfClosed: true });
 export const sendCursorCapture = (en, options) => sendBoolControl(MSG.CURSOR_CAPTURE, en, options);
-const sendCodec = id => sendByteControl(MSG.CODEC_SET, id);
+const sendCodec = (id, format) => mkCtrlMsg(MSG.CODEC_SET, 6, v => { v.setUint8(4, id); v.setUint8(5, format); });
 const sendFps = (fps, mode) => mkCtrlMsg(MSG.FPS_SET, 7, v => { v.setUint16(4, fps, true); v.setUint8(6, mode); });
 const sendStreamTarget = (width, height, options) => mkCtrlMsg(MSG.STREAM_TARGET, 8, v => {
     v.setUint16(4, width, true);
@@ -84,8 +100,11 @@ export const pushClipboardToHost = async () => {
 };
 
 // --- Apply settings ---
-export const applyCodec = id => {
-    if (sendCodec(id)) { S.currentCodec = id; S.codecSent = 1; log.info('NET', 'Codec set', { id }); }
+export const applyCodec = (id, format = S.currentFormat) => {
+    if (sendCodec(id, format)) {
+        S.currentCodec = id; S.currentFormat = format; S.codecSent = 1;
+        log.info('NET', 'Codec set', { id, format });
+    }
 };
 
 export const applyFps = val => {
@@ -166,7 +185,7 @@ export const handleDecodePressure = ({ queueSize } = {}) => {
         const fb = getFallbackCodec();
         if (fb !== null && fb !== S.currentCodec) {
             log.warn('NET', 'Adaptive: codec fallback', { from: S.currentCodec, to: fb, queueSize });
-            applyCodec(fb);
+            applyCodec(fb, 0);
             codecFallbackApplied = true;
             lastAdaptiveQualityAt = now;
         }
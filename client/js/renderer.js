@@ -1,6 +1,6 @@
 
 import { C, CURSOR_TYPES } from './constants.js';
-import { S, syncedServerTimestampAgeMs, recordRenderTime, recordVideoLatencySample, logVideoDrop, log, safe } from './state.js';
+import { S, syncedServerTimestampAgeMs, recordRenderTime, recordVideoLatencySample, logVideoDrop, log, safe, focusedMonitor } from './state.js';
 import { updateStreamTarget } from './protocol.js';
 
 export const canvas = document.querySelector('#c');
@@ -198,19 +198,85 @@ const renderFrame = (frame, meta) => {
         S.frameMeta.delete(meta.capTs);
     }
 
+    updateCursorOverlay();
     recordRenderTime(performance.now() - startTime);
     frame.close();
 };
-export const setCursorStyle = type => {
-    const cursor = S.pointerLocked ? '' : (CURSOR_TYPES[type] || 'default');
+// --- Host cursor ---
+// Bitmaps arrive once per id and shapes refer to them. Without pointer lock the browser
+// draws the shape at the local mouse; with it, an overlay follows the host position.
+const CURSOR_NONE = 13, CURSOR_CUSTOM = 255;
+const cursorOverlay = document.querySelector('#cursorOverlay');
+const cursorImages = new Map();
+const hostCursor = { type: 0, id: 0, x: 0, y: 0, visible: false };
+
+const hostMonitorWidth = () => S.monitors?.find(m => m.index === focusedMonitor())?.width || S.W || 1;
+
+const updateCursorOverlay = () => {
+    if (!cursorOverlay) return;
+    const image = cursorImages.get(hostCursor.id);
+    const vp = S.lastVp;
+    if (document.pointerLockElement !== canvas || !hostCursor.visible || hostCursor.type === CURSOR_NONE || !image || !vp) {
+        cursorOverlay.style.display = 'none';
+        return;
+    }
+    // The viewport is centred, so its offset reads the same from the top as from the bottom.
+    const dpr = devicePixelRatio || 1;
+    const rect = canvas.getBoundingClientRect();
+    const scale = vp.w / dpr / hostMonitorWidth();
+    if (cursorOverlay.dataset.id !== String(hostCursor.id)) {
+        cursorOverlay.dataset.id = String(hostCursor.id);
+        cursorOverlay.src = image.url;
+    }
+    const x = rect.left + (vp.x + hostCursor.x * vp.w) / dpr - image.hotX * scale;
+    const y = rect.top + (vp.y + hostCursor.y * vp.h) / dpr - image.hotY * scale;
+    cursorOverlay.style.width = `${image.width * scale}px`;
+    cursorOverlay.style.height = `${image.height * scale}px`;
+    cursorOverlay.style.transform = `translate(${x}px, ${y}px)`;
+    cursorOverlay.style.display = 'block';
+};
+
+export const addCursorImage = (id, width, height, hotX, hotY, rgba) => {
+    const bitmap = document.createElement('canvas');
+    bitmap.width = width;
+    bitmap.height = height;
+    bitmap.getContext('2d').putImageData(new ImageData(rgba, width, height), 0, 0);
+    cursorImages.set(id, { url: bitmap.toDataURL(), width, height, hotX, hotY });
+    log.debug('RENDER', 'Cursor image', { id, width, height });
+};
+
+export const setCursorStyle = (type, id = 0) => {
+    hostCursor.type = type;
+    hostCursor.id = id;
+    const image = type === CURSOR_CUSTOM ? cursorImages.get(id) : null;
+    const cursor = document.pointerLockElement === canvas ? ''
+        : image ? `url(${image.url}) ${image.hotX} ${image.hotY}, default` : (CURSOR_TYPES[type] || 'default');
     canvas.style.cursor = cursor;
-    log.debug('RENDER', 'Cursor set', { type, cursor });
+    updateCursorOverlay();
+    log.debug('RENDER', 'Cursor set', { type, id, cursor: image ? 'image' : cursor });
+};
+
+export const setCursorPosition = (x, y, visible) => {
+    hostCursor.x = x;
+    hostCursor.y = y;
+    hostCursor.visible = visible;
+    updateCursorOverlay();
 };
 
 export const resetCursorStyle = () => {
     canvas.style.cursor = 'default';
 };
 
+// Ids are only meaningful within one connection.
+export const resetHostCursor = () => {
+    cursorImages.clear();
+    if (cursorOverlay) delete cursorOverlay.dataset.id;
+    Object.assign(hostCursor, { type: 0, id: 0, x: 0, y: 0, visible: false });
+    updateCursorOverlay();
+};
+
+document.addEventListener('pointerlockchange', () => setCursorStyle(hostCursor.type, hostCursor.id));
+
 const closePresentationEntry = entry => {
     if (!entry) return;
     if (entry.meta?.frameKey) {
@@ -309,6 +375,7 @@ const redraw = () => {
             gl.drawArrays(gl.TRIANGLE_STRIP, 0, 4);
         }
     }
+    updateCursorOverlay();
 };
 let resizeTimeout;
 const onResize = () => {
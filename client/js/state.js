@@ -73,7 +73,7 @@ let codecCache = null;
 export const detectCodecs = async () => {
     if (codecCache) return codecCache;
 
-    const sup = { av1: 0, h265: 0, h264: 0, av1Hw: 0, h265Hw: 0, h264Hw: 0 };
+    const sup = { av1: 0, h265: 0, h264: 0, av1Hw: 0, h265Hw: 0, h264Hw: 0, av1Formats: 0, h265Formats: 0, h264Formats: 0 };
 
     if (!window.VideoDecoder) {
         log.warn('CODEC', 'VideoDecoder API not available');
@@ -100,6 +100,17 @@ export const detectCodecs = async () => {
                 log.debug('CODEC', `${info.name} supported`, { hw: hw ? 'HW' : 'SW' });
             }
         }
+        if (!sup[k]) continue;
+        // Bit per FORMATS id; 4:4:4 and 10-bit are only requested when the decoder takes them.
+        sup[k + 'Formats'] = 1;
+        for (let f = 1; f < info.formats.length; f++) {
+            const result = await safeAsync(
+                () => VideoDecoder.isConfigSupported({ codec: info.formats[f], optimizeForLatency: 1 }),
+                null,
+                'CODEC'
+            );
+            if (result?.supported) sup[k + 'Formats'] |= 1 << f;
+        }
     }
 
     const best = sup.av1Hw  ? { codecId: 0, hardwareAccel: 1, codecName: 'AV1' }
@@ -118,7 +129,7 @@ const mkJitter = () => {
     for (const [prefix, avgKey] of JITTER_STAGE_FIELDS) Object.assign(metric, zeroMetric(`${prefix}Sum`, `${prefix}Samples`, avgKey));
     return metric;
 };
-const mkStats = () => ({ ...zeroMetric('bytes', 'moves', 'clicks', 'keys', 'framesComplete', 'framesDropped', 'framesTimeout', 'keyframesReceived', 'decodeErrors', 'renderErrors'), lastUpdate: performance.now() });
+const mkStats = () => ({ ...zeroMetric('bytes', 'moves', 'clicks', 'keys', 'framesComplete', 'framesRepeated', 'framesDropped', 'framesTimeout', 'framesLayerSkipped', 'keyframesReceived', 'decodeErrors', 'renderErrors'), lastUpdate: performance.now() });
 const mkAudio = () => zeroMetric('packetsReceived', 'packetsDecoded', 'packetsDropped', 'bufferUnderruns', 'bufferOverflows', 'bufferHealthSum', 'bufferHealthSamples');
 const mkNetwork = () => zeroMetric('packetsReceived', 'videoPackets', 'controlPackets', 'audioPackets', 'micPackets', 'bytesReceived');
 const mkDecode = () => zeroMetric('decodeCount', 'decodeTimeSum', 'maxQueueSize');
@@ -129,20 +140,26 @@ export const S = {
     decoder: null, ready: 0, needKey: 1, reinit: 0, hwAccel: 'unknown',
     W: 0, H: 0, hostFps: 60, currentFps: 60, currentFpsMode: 0, fpsSent: 0,
     authenticated: 0, monitors: [], currentMon: 0, tabbedMode: 0, username: null,
-    audioCtx: null, audioEnabled: 0, audioDecoder: null, audioGain: null,
+    // Video streams from MSG_STREAMS_INFO (stream 0 is currentMon) and the one on screen.
+    streams: [], focusedStream: 0,
+    audioCtx: null, audioEnabled: 0, audioDecoder: null, audioGain: null, audioFrameUnits: C.AUDIO_FRAME_UNITS,
     controlEnabled: 0, lastVp: { x: 0, y: 0, w: 0, h: 0 },
     relativeMouseMode: 0, pointerLocked: 0, keyboardLockActive: 0,
     isReconnecting: 0, firstFrameReceived: 0,
-    currentCodec: 1, codecSent: 0, hostCodecs: 0x07,
-    hostEncoderName: null,
+    currentCodec: 1, codecSent: 0, hostCodecs: 0x07, currentFormat: 0, hostFormats: [1, 1, 1],
+    hostEncoderName: null, encodeLimit: null,
     clipboardSyncEnabled: 0,
     chunks: new Map(), frameMeta: new Map(), lastFrameId: 0,
+    // Temporal layers: lowest layer being skipped (Infinity = none) and skipped frame ids with their layer.
+    layerFloor: Infinity, skippedLayerFrames: new Map(),
     stats: mkStats(), clockSync: mkClockSync(), jitterMetrics: mkJitter(),
     networkMetrics: mkNetwork(), decodeMetrics: mkDecode(),
     renderMetrics: mkRender(), audioMetrics: mkAudio(),
     micMetrics: mkMic(), micEnabled: 0, micStream: null,
     hostVersion: null
 };
+export const focusedMonitor = () =>
+    S.focusedStream ? S.streams.find(s => s.id === S.focusedStream)?.monitor ?? S.currentMon : S.currentMon;
 export const $ = id => document.querySelector(`#${id}`);
 export const mkBuf = (sz, fn) => { const b = new ArrayBuffer(sz); fn(new DataView(b)); return b; };
 export const clientTimeUs = () => Math.floor(performance.now() * 1000);
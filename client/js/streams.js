@@ -0,0 +1,189 @@
+// Extra monitor streams (ids 1..7). Each keeps its own decoder running so focusing one
+// shows it without waiting for a keyframe; only the focused stream reaches the renderer.
+import { C, CODECS } from './constants.js';
+import { S, log, logVideoDrop, bus } from './state.js';
+import { queueFrameForPresentation } from './renderer.js';
+import { sendStreamFocus, sendStreamsSet, requestStreamKeyframe } from './protocol.js';
+
+const PKT_DATA = 0;
+const FRAME_KEY = 1, FRAME_REPEAT = 2, FRAME_DROPPED = 3;
+
+const streams = new Map();
+let lastSentMonitors = null;
+
+const codecString = info => {
+    const codec = Object.values(CODECS).find(c => c.id === info.codec);
+    return codec ? (codec.formats[info.format] || codec.codec) : null;
+};
+
+const requestKey = (stream, reason) => {
+    stream.needKey = true;
+    const now = performance.now();
+    if (now - stream.lastKeyReqAt < C.KEY_RETRY_INTERVAL_MS) return;
+    stream.lastKeyReqAt = now;
+    log.debug('STREAM', 'Requesting keyframe', { id: stream.id, reason });
+    requestStreamKeyframe(stream.id);
+};
+
+const closeStream = stream => {
+    stream.frames.clear();
+    if (stream.decoder?.state !== 'closed') {
+        try { stream.decoder?.close(); } catch {}
+    }
+    stream.decoder = null;
+};
+
+const openDecoder = async stream => {
+    const codec = codecString(stream.info);
+    if (!codec) return;
+    const decoder = new VideoDecoder({
+        output: frame => {
+            if (S.focusedStream !== stream.id || streams.get(stream.id) !== stream) { frame.close(); return; }
+            const now = performance.now();
+            queueFrameForPresentation({ frame, meta: null, queuedAt: now, timestamp: frame.timestamp, sourceTs: frame.timestamp });
+        },
+        error: e => {
+            log.error('STREAM', 'Decoder error', { id: stream.id, error: e.message });
+            if (streams.get(stream.id) !== stream) return;
+            closeStream(stream);
+            openDecoder(stream);
+        }
+    });
+    stream.decoder = decoder;
+    for (const preferHw of [true, false]) {
+        const config = {
+            codec, optimizeForLatency: true, latencyMode: 'realtime',
+            hardwareAcceleration: preferHw ? 'prefer-hardware' : 'prefer-software'
+        };
+        const supported = await VideoDecoder.isConfigSupported(config).catch(() => null);
+        if (stream.decoder !== decoder || decoder.state === 'closed') return;
+        if (supported?.supported) {
+            decoder.configure(supported.config);
+            log.info('STREAM', 'Decoder configured', { id: stream.id, monitor: stream.info.monitor, codec, hw: preferHw });
+            requestKey(stream, 'decoder-init');
+            return;
+        }
+    }
+    log.error('STREAM', 'Decoder configuration failed', { id: stream.id, codec });
+};
+
+const decodeStream = (stream, frameId, frame) => {
+    stream.frames.delete(frameId);
+    if (frameId <= stream.lastFrameId && !frame.isKey) return;
+    if (frameId !== stream.lastFrameId + 1 && !frame.isKey) stream.needKey = true;
+    stream.lastFrameId = frameId;
+    if (stream.needKey && !frame.isKey) { requestKey(stream, 'waiting-key'); return; }
+    if (stream.decoder?.state !== 'configured') return;
+
+    const buf = new Uint8Array(frame.frameSize);
+    let offset = 0;
+    for (const part of frame.parts) { buf.set(part, offset); offset += part.byteLength; }
+    try {
+        stream.decoder.decode(new EncodedVideoChunk({ type: frame.isKey ? 'key' : 'delta', timestamp: frame.capTs, data: buf }));
+        if (frame.isKey) stream.needKey = false;
+    } catch (e) {
+        log.warn('STREAM', 'Decode failed', { id: stream.id, error: e.message });
+        requestKey(stream, 'decode-failed');
+    }
+};
+
+const expireStreamFrames = (stream, now) => {
+    for (const [id, frame] of stream.frames) {
+        if (now - frame.arrivalMs <= C.FRAME_TIMEOUT_MS) continue;
+        stream.frames.delete(id);
+        if (frame.layer === 0 || frame.isKey) requestKey(stream, 'timeout');
+    }
+};
+
+// Data packets only: FEC recovery is left to the primary stream, and a lost chunk here
+// costs a keyframe on a stream that is usually not being watched.
+export const handleStreamPacket = (id, fields, chunk) => {
+    const stream = streams.get(id);
+    if (!stream) return;
+    const { frameId, frameType, packetType, chunkIndex, totalChunks, frameSize, capTs, layer, arrivalMs } = fields;
+    if (frameType === FRAME_REPEAT) return;
+    if (frameType === FRAME_DROPPED) {
+        if (layer === 0) requestKey(stream, 'host-dropped');
+        return;
+    }
+    if (packetType !== PKT_DATA) return;
+
+    expireStreamFrames(stream, arrivalMs);
+    if (frameId <= stream.lastFrameId && frameType !== FRAME_KEY) return;
+
+    let frame = stream.frames.get(frameId);
+    if (!frame) {
+        frame = { parts: Array(totalChunks).fill(null), total: totalChunks, received: 0, frameSize, capTs,
+            isKey: frameType === FRAME_KEY, layer, arrivalMs };
+        stream.frames.set(frameId, frame);
+        if (stream.frames.size > C.MAX_FRAMES) {
+            const oldest = Math.min(...stream.frames.keys());
+            stream.frames.delete(oldest);
+            requestKey(stream, 'evicted');
+        }
+    }
+    if (frame.total !== totalChunks || frame.frameSize !== frameSize) { logVideoDrop('Stream frame mismatch', { id, frameId }); return; }
+    if (frame.parts[chunkIndex]) return;
+    frame.parts[chunkIndex] = chunk.slice();
+    if (++frame.received === frame.total) decodeStream(stream, frameId, frame);
+};
+
+// list: [{ id, monitor, codec, format, width, height }], stream 0 excluded.
+export const applyStreamsInfo = list => {
+    const ids = new Set(list.map(s => s.id));
+    for (const [id, stream] of streams) {
+        if (!ids.has(id)) { closeStream(stream); streams.delete(id); }
+    }
+    for (const info of list) {
+        const existing = streams.get(info.id);
+        if (existing && existing.info.monitor === info.monitor && existing.info.codec === info.codec &&
+            existing.info.format === info.format) {
+            existing.info = info;
+            continue;
+        }
+        if (existing) closeStream(existing);
+        const stream = { id: info.id, info, decoder: null, needKey: true, lastFrameId: 0, frames: new Map(), lastKeyReqAt: 0 };
+        streams.set(info.id, stream);
+        openDecoder(stream);
+    }
+    S.streams = list;
+    if (S.focusedStream && !ids.has(S.focusedStream)) S.focusedStream = 0;
+    log.info('STREAM', 'Streams updated', { count: list.length, focused: S.focusedStream });
+    bus.emit('streams:changed');
+};
+
+export const streamForMonitor = monitor => S.streams.find(s => s.monitor === monitor)?.id;
+
+export const focusStream = id => {
+    if (id === S.focusedStream) return;
+    sendStreamFocus(id);
+};
+
+// Host acknowledged a focus change.
+export const setFocusedStream = id => {
+    if (id && !streams.has(id)) return;
+    S.focusedStream = id;
+    const stream = streams.get(id);
+    if (stream?.needKey) requestKey(stream, 'focus');
+    bus.emit('streams:changed');
+};
+
+// Tabbed view streams every monitor at once; otherwise only the primary one runs.
+export const syncMonitorStreams = () => {
+    const want = S.tabbedMode && S.monitors.length > 1 && S.dcControl?.readyState === 'open'
+        ? S.monitors.map(m => m.index).filter(i => i !== S.currentMon)
+        : [];
+    const key = want.join(',');
+    if (key === lastSentMonitors) return;
+    if (!want.length && lastSentMonitors === null) return;
+    lastSentMonitors = key;
+    sendStreamsSet(want);
+};
+
+export const resetStreams = () => {
+    for (const stream of streams.values()) closeStream(stream);
+    streams.clear();
+    lastSentMonitors = null;
+    S.streams = [];
+    S.focusedStream = 0;
+};
@@ -1,10 +1,11 @@
 
-import { CODECS, CODEC_KEYS } from './constants.js';
-import { S, $, detectCodecs, subscribeToMetrics, safe, log, bus } from './state.js';
-import { toggleAudio } from './media.js';
+import { C, CODECS, CODEC_KEYS, FORMATS } from './constants.js';
+import { S, $, detectCodecs, subscribeToMetrics, safe, log, bus, focusedMonitor } from './state.js';
+import { toggleAudio, setAudioFrame } from './media.js';
 import { setRelativeMouseMode } from './input.js';
 import { toggleMic, isMicSupported } from './mic.js';
 import { applyFps, sendMonitor, applyCodec } from './protocol.js';
+import { focusStream, streamForMonitor, syncMonitorStreams } from './streams.js';
 const loadEl = $('loadingOverlay');
 const statusEl = $('loadingStatus');
 const subStatusEl = $('loadingSubstatus');
@@ -33,16 +34,20 @@ bus.on('fps:applied', fps => updateFpsDropdown(fps));
 const fpsSel = $('fpsSel');
 const monSel = $('monSel');
 const codecSel = $('codecSel');
+const fmtSel = $('fmtSel');
+const audioFrameSel = $('audioFrameSel');
 const customFpsRow = $('customFpsRow');
 const customFpsInput = $('customFpsInput');
 const customFpsApply = $('customFpsApply');
 const STORAGE_KEYS = {
     FPS: 'slipstream_fps',
     CODEC: 'slipstream_codec',
+    FORMAT: 'slipstream_format',
     TABBED: 'slipstream_tabbed_mode',
     STATS: 'slipstream_stats_overlay',
     CLIPBOARD: 'slipstream_clipboard_sync',
-    MON_NAMES: 'slipstream_monitor_names'
+    MON_NAMES: 'slipstream_monitor_names',
+    AUDIO_FRAME: 'slipstream_audio_frame'
 };
 const loadPref = (key, validator, defaultVal = null) => {
     try {
@@ -138,9 +143,34 @@ customFpsApply.onclick = () => {
 customFpsInput.onkeydown = e => {
     if (e.key === 'Enter') { e.preventDefault(); customFpsApply.click(); }
 };
-export const updateCodecDropdown = codecId => { if (codecSel.value !== codecId.toString()) codecSel.value = codecId.toString(); };
+let clientFormats = [1, 1, 1];
 
-export const setHostCodecs = caps => { S.hostCodecs = caps; updateCodecOpts(); log.debug('UI', 'Host codecs set', { caps: caps.toString(2) }); };
+// Formats both the host encoder and the local decoder support for codecId.
+const usableFormats = codecId => ((S.hostFormats[codecId] ?? 1) & (clientFormats[codecId] ?? 1)) | 1;
+
+const updateFormatOpts = codecId => {
+    const usable = usableFormats(codecId);
+    fmtSel.innerHTML = FORMATS.filter(f => usable & (1 << f.id))
+        .map(f => `<option value="${f.id}">${f.name}</option>`).join('');
+    const stored = loadPref(STORAGE_KEYS.FORMAT, v => v >= 0 && v < FORMATS.length, 0);
+    fmtSel.value = usable & (1 << stored) ? stored : 0;
+    fmtSel.disabled = usable === 1;
+    S.currentFormat = +fmtSel.value;
+};
+
+export const updateCodecDropdown = (codecId, formatId = 0) => {
+    if (codecSel.value !== codecId.toString()) codecSel.value = codecId.toString();
+    updateFormatOpts(codecId);
+    if (fmtSel.value !== formatId.toString()) fmtSel.value = formatId.toString();
+    S.currentFormat = formatId;
+};
+
+export const setHostCodecs = (caps, formats = [1, 1, 1]) => {
+    S.hostCodecs = caps;
+    S.hostFormats = formats;
+    updateCodecOpts();
+    log.debug('UI', 'Host codecs set', { caps: caps.toString(2), formats });
+};
 
 let defaultCodec = null;
 
@@ -183,11 +213,17 @@ export const updateCodecOpts = async () => {
     }
 
     S.currentCodec = +codecSel.value;
+    clientFormats = CODEC_KEYS.map(key => support[key + 'Formats'] || 1);
+    updateFormatOpts(S.currentCodec);
 };
 
-bindNumericSelect(codecSel, applyCodec, 'Codec changed', STORAGE_KEYS.CODEC, 'codec');
+bindNumericSelect(codecSel, id => { updateFormatOpts(id); applyCodec(id, S.currentFormat); }, 'Codec changed', STORAGE_KEYS.CODEC, 'codec');
+bindNumericSelect(fmtSel, format => applyCodec(S.currentCodec, format), 'Format changed', STORAGE_KEYS.FORMAT, 'format');
 bindNumericSelect(monSel, sendMonitor, 'Monitor changed', null, 'index');
 $('aBtn').onclick = toggleAudio;
+S.audioFrameUnits = loadPref(STORAGE_KEYS.AUDIO_FRAME, v => [5, 10, 20, 40].includes(v), C.AUDIO_FRAME_UNITS);
+audioFrameSel.value = S.audioFrameUnits.toString();
+bindNumericSelect(audioFrameSel, setAudioFrame, 'Audio frame changed', STORAGE_KEYS.AUDIO_FRAME, 'halfMs');
 const micBtn = $('micBtn');
 const micTxt = $('micTxt');
 const micHint = $('micHint');
@@ -305,8 +341,9 @@ const renderTabs = () => {
         return;
     }
 
+    const active = focusedMonitor();
     tabContainer.innerHTML = S.monitors.map(m => `
-        <button class="tab-item${m.index === S.currentMon ? ' active' : ''}" data-index="${m.index}">
+        <button class="tab-item${m.index === active ? ' active' : ''}" data-index="${m.index}">
             ${MONITOR_ICON}
             <div class="tab-item-info">
                 <span class="tab-item-name">${getMonitorDisplayName(m)}${m.isPrimary ? STAR_ICON : ''}</span>
@@ -317,14 +354,16 @@ const renderTabs = () => {
     tabContainer.querySelectorAll('.tab-item').forEach(tab => {
         const idx = +tab.dataset.index;
 
+        // Monitors already streamed switch by focus; others fall back to a capture switch.
         tab.onclick = () => {
-            if (idx !== S.currentMon) {
-                sendMonitor(idx);
-            }
+            if (idx === focusedMonitor()) return;
+            const stream = idx === S.currentMon ? 0 : streamForMonitor(idx);
+            if (stream !== undefined) focusStream(stream);
+            else sendMonitor(idx);
         };
 
         tab.ondblclick = e => {
-            if (idx !== S.currentMon) return;
+            if (idx !== focusedMonitor()) return;
             e.preventDefault();
 
             const nameSpan = tab.querySelector('.tab-item-name');
@@ -385,6 +424,7 @@ const setTabbedMode = enabled => {
     S.tabbedMode = enabled;
     savePref(STORAGE_KEYS.TABBED, enabled);
     updateTabbedUI();
+    syncMonitorStreams();
     return true;
 };
 
@@ -397,6 +437,7 @@ tabbedModeBtn.onclick = () => {
 };
 
 tabBack.onclick = closeTabbedMode;
+bus.on('streams:changed', () => { if (S.tabbedMode) renderTabs(); });
 
 updateTabbedUI();
 
@@ -411,14 +452,14 @@ export const updateMonOpts = () => {
     log.debug('UI', 'Monitor options updated', { count: S.monitors.length });
 };
 const STATS_SCHEMA = [
-    { label: 'THROUGHPUT', rows: [['FPS', 'statsFps'], ['Bitrate', 'statsBitrate'], ['Resolution', 'statsResolution'], ['Codec', 'statsCodec'], ['Encode', 'statsEncode']] },
+    { label: 'THROUGHPUT', rows: [['FPS', 'statsFps'], ['Bitrate', 'statsBitrate'], ['Resolution', 'statsResolution'], ['Codec', 'statsCodec'], ['Encode', 'statsEncode'], ['Limit', 'statsEncodeLimit']] },
     { label: 'LATENCY', rows: [['RTT', 'statsRtt'], ['Video E2E', 'statsE2e'], ['Sync +/-', 'statsSync']] },
     { label: 'E2E STAGES', rows: [['Src->Cap', 'statsStageSourceCapture'], ['Cap->Enc', 'statsStageCaptureEncode'], ['Enc->Send', 'statsStageEncodeSend'], ['Send->Recv', 'statsStageSendReceive'], ['Rx->Asm', 'statsStageReceiveAssemble'], ['Asm->Dec', 'statsStageAssembleDecode'], ['Dec->Present', 'statsStageDecodePresent']] },
     { label: 'JITTER', rows: [['Interval', 'statsInterval'], ['Std Dev', 'statsStdDev']] },
     { label: 'DECODE', rows: [['Time', 'statsDecodeTime'], ['Queue', 'statsDecodeQueue'], ['HW Accel', 'statsHwAccel']] },
     { label: 'RENDER', rows: [['Time', 'statsRenderTime'], ['Frames', 'statsRenderFrames']] },
     { label: 'NETWORK', rows: [['Packets', 'statsPackets'], ['Avg Size', 'statsPacketSize']] },
-    { id: 'statsDropsSection', label: 'DROPS', warn: true, rows: [['Dropped', 'statsDropsDropped'], ['Timeout', 'statsDropsTimeout'], ['Late', 'statsDropsLate'], ['Decode Err', 'statsDecodeErrors']] },
+    { id: 'statsDropsSection', label: 'DROPS', warn: true, rows: [['Dropped', 'statsDropsDropped'], ['Timeout', 'statsDropsTimeout'], ['Late', 'statsDropsLate'], ['Decode Err', 'statsDecodeErrors'], ['Layer Skip', 'statsDropsLayer']] },
     { label: 'AUDIO', rows: [['Packets', 'statsAudioPackets'], ['Decoded', 'statsAudioDecoded'], ['Buffer', 'statsAudioBuffer']] },
     { id: 'statsAudioDropsSection', label: 'AUDIO DROPS', warn: true, rows: [['Dropped', 'statsAudioDropped'], ['Underruns', 'statsAudioUnderruns'], ['Overflows', 'statsAudioOverflows']] },
     { label: 'INPUT', rows: [['Mouse', 'statsInputMouse'], ['Keys', 'statsInputKeys']] },
@@ -465,6 +506,16 @@ const formatUptime = totalSeconds => {
 
 const CODEC_NAMES = ['AV1', 'H.265', 'H.264'];
 const getHostEncoderDisplay = () => S.hostEncoderName || '--';
+const getEncodeLimitDisplay = () => {
+    const l = S.encodeLimit;
+    if (!l) return 'none';
+    const parts = [];
+    if (l.fps) parts.push(`${l.fps} fps`);
+    if (l.scale < 100) parts.push(`${l.scale}%${l.limits & 2 ? ' (bw)' : ''}`);
+    if (l.limits & 4) parts.push('fast preset');
+    if (l.limits & 1 && l.budgetMs > 0) parts.push(`p95 ${l.p95Ms.toFixed(1)}/${l.budgetMs.toFixed(1)} ms`);
+    return parts.join(', ') || 'none';
+};
 
 const updateStats = data => {
     if (!statsEnabled) return;
@@ -475,8 +526,9 @@ const updateStats = data => {
         statsFps: `${computed.fps}/${computed.targetFps} (${computed.fpsEff.toFixed(0)}%)`,
         statsBitrate: `${computed.mbps} Mbps`,
         statsResolution: S.W > 0 ? `${S.W}x${S.H}` : '--x--',
-        statsCodec: `${CODEC_NAMES[S.currentCodec] || 'H.264'}`,
+        statsCodec: `${CODEC_NAMES[S.currentCodec] || 'H.264'}${S.currentFormat ? ` ${FORMATS[S.currentFormat]?.name}` : ''}`,
         statsEncode: getHostEncoderDisplay(),
+        statsEncodeLimit: getEncodeLimitDisplay(),
         statsRtt: clock.valid ? formatValue(clock.rttMs, 1, ' ms') : '-- ms',
         statsE2e: formatValue(jitter.avgE2eLatencyMs, 1, ' ms'),
         statsSync: clock.valid ? formatValue(clock.uncertaintyMs, 1, ' ms') : '-- ms',
@@ -525,11 +577,12 @@ const updateStats = data => {
         statsAudioOverflows: audio.bufferOverflows
     });
     const totalDrops = stats.framesDropped + stats.framesTimeout + jitter.framesDroppedLate + stats.decodeErrors;
-    updateDropSection('statsDropsSection', totalDrops > 0, {
+    updateDropSection('statsDropsSection', totalDrops + stats.framesLayerSkipped > 0, {
         statsDropsDropped: stats.framesDropped,
         statsDropsTimeout: stats.framesTimeout,
         statsDropsLate: jitter.framesDroppedLate,
-        statsDecodeErrors: stats.decodeErrors
+        statsDecodeErrors: stats.decodeErrors,
+        statsDropsLayer: stats.framesLayerSkipped
     });
 };
 
@@ -1,57 +1,78 @@
 #pragma once
 
+#include "host/core/sample_ring.hpp"
+
 #include <speex/speex_resampler.h>
 
+#include <algorithm>
+#include <memory>
 #include <stdexcept>
-#include <vector>
 
+// Resamples straight into ring, which the consumer drains in place. The ring has
+// outCh channels: ch for Process, or the mono input fanned out by ProcessMono.
 class SpeexResampler {
+    static constexpr size_t kMonoScratchFrames = 1024;
+
     SpeexResamplerState* st = nullptr;
     int srcRate_, dstRate_, channels_;
+    std::unique_ptr<float[]> monoScratch;
 public:
-    std::vector<float> buf;
+    SampleRing ring;
 
-    SpeexResampler(int src, int dst, int ch, int quality = 4)
-        : srcRate_(src), dstRate_(dst), channels_(ch) {
+    SpeexResampler(int src, int dst, int ch, int outCh, size_t ringFrames, int quality = 4)
+        : srcRate_(src), dstRate_(dst), channels_(ch), ring(outCh, ringFrames) {
+        if (ch != outCh && ch != 1) throw std::invalid_argument("Speex resampler can only fan out mono");
         int err;
         st = speex_resampler_init(ch, src, dst, quality, &err);
         if (!st) throw std::runtime_error("Speex resampler init failed");
-        buf.reserve(480 * ch * 8);
+        if (ch != outCh) monoScratch = std::make_unique<float[]>(kMonoScratchFrames);
     }
 
     ~SpeexResampler() { if (st) speex_resampler_destroy(st); }
     SpeexResampler(const SpeexResampler&) = delete;
     SpeexResampler& operator=(const SpeexResampler&) = delete;
 
+    // Owner thread only: clears the ring from the reader's side.
     void Reset() {
         if (st) speex_resampler_reset_mem(st);
-        buf.clear();
+        ring.Clear();
     }
 
-    void Process(const float* in, size_t frames) {
-        if (!frames || !st) return;
-        spx_uint32_t inLen = static_cast<spx_uint32_t>(frames);
-        spx_uint32_t outLen = static_cast<spx_uint32_t>(frames * dstRate_ / srcRate_ + 64);
-        size_t pos = buf.size();
-        buf.resize(pos + outLen * channels_);
-        speex_resampler_process_interleaved_float(st, in, &inLen, buf.data() + pos, &outLen);
-        buf.resize(pos + outLen * channels_);
+    // Returns the input frames that found no room in the ring.
+    size_t Process(const float* in, size_t frames) {
+        while (frames > 0 && st) {
+            const SampleRing::Span out = ring.Writable().first;
+            if (out.frames == 0) break;
+            spx_uint32_t inLen = static_cast<spx_uint32_t>(frames);
+            spx_uint32_t outLen = static_cast<spx_uint32_t>(out.frames);
+            speex_resampler_process_interleaved_float(st, in, &inLen, out.data, &outLen);
+            ring.Commit(outLen);
+            in += static_cast<size_t>(inLen) * channels_;
+            frames -= inLen;
+            if (inLen == 0 && outLen == 0) break;
+        }
+        return frames;
     }
 
-    void ProcessMono(const float* in, size_t frames, int outCh) {
-        if (!frames || !st) return;
-        spx_uint32_t inLen = static_cast<spx_uint32_t>(frames);
-        spx_uint32_t outLen = static_cast<spx_uint32_t>(frames * dstRate_ / srcRate_ + 64);
-        size_t oldSz = buf.size();
-        buf.resize(oldSz + outLen);
-        speex_resampler_process_float(st, 0, in, &inLen, buf.data() + oldSz, &outLen);
-        buf.resize(oldSz + outLen);
-        if (outCh > 1) {
-            size_t monoCount = outLen;
-            buf.resize(oldSz + monoCount * outCh);
-            for (size_t i = monoCount; i-- > 0;)
-                for (int c = outCh - 1; c >= 0; c--)
-                    buf[oldSz + i * outCh + c] = buf[oldSz + i];
+    size_t ProcessMono(const float* in, size_t frames) {
+        if (!monoScratch) return Process(in, frames);
+        const int outCh = ring.Channels();
+        while (frames > 0 && st) {
+            spx_uint32_t inLen = static_cast<spx_uint32_t>(frames);
+            spx_uint32_t outLen = static_cast<spx_uint32_t>(std::min(ring.Free(), kMonoScratchFrames));
+            if (outLen == 0) break;
+            speex_resampler_process_float(st, 0, in, &inLen, monoScratch.get(), &outLen);
+            const float* src = monoScratch.get();
+            const SampleRing::Spans spans = ring.Writable(outLen);
+            for (const SampleRing::Span& span : {spans.first, spans.second}) {
+                for (size_t i = 0; i < span.frames; i++, src++)
+                    std::fill_n(span.data + i * outCh, outCh, *src);
+            }
+            ring.Commit(outLen);
+            in += inLen;
+            frames -= inLen;
+            if (inLen == 0 && outLen == 0) break;
         }
+        return frames;
     }
 };
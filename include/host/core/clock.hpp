@@ -0,0 +1,48 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Monotonic microsecond time for every timing decision in the pipeline: frame
+// timestamps, pacing deadlines, encode durations, rate and congestion windows.
+// GetTimestamp reads the system clock unless a Clock is installed with SetClock,
+// so the schedulers can be driven by a VirtualClock in simulations and replays.
+class Clock {
+public:
+    virtual ~Clock() = default;
+    [[nodiscard]] virtual int64_t NowUs() const = 0;
+};
+
+// QueryPerformanceCounter scaled with a cached 64-bit multiply on Windows,
+// clock_gettime(CLOCK_MONOTONIC_RAW) elsewhere. Never touches the override.
+[[nodiscard]] int64_t ReadSystemClockUs();
+// Converts a raw system clock reading (QPC ticks on Windows, nanoseconds
+// elsewhere) to the microseconds ReadSystemClockUs returns.
+[[nodiscard]] int64_t SystemTicksToUs(int64_t ticks);
+
+class SystemClock final : public Clock {
+public:
+    [[nodiscard]] int64_t NowUs() const override { return ReadSystemClockUs(); }
+};
+
+// Time only moves when told to. Safe to read from any thread while one thread advances it.
+class VirtualClock final : public Clock {
+    std::atomic<int64_t> nowUs;
+
+public:
+    explicit VirtualClock(int64_t startUs = 1'000'000) : nowUs(startUs) {}
+    [[nodiscard]] int64_t NowUs() const override { return nowUs.load(std::memory_order_acquire); }
+    void Set(int64_t us) { nowUs.store(us, std::memory_order_release); }
+    void Advance(int64_t us) { nowUs.fetch_add(us, std::memory_order_acq_rel); }
+};
+
+inline std::atomic<const Clock*> g_clockOverride{nullptr};
+
+// Installs clock for every GetTimestamp caller; nullptr restores the system clock.
+// clock must outlive its installation.
+inline void SetClock(const Clock* clock) { g_clockOverride.store(clock, std::memory_order_release); }
+
+inline int64_t GetTimestamp() {
+    if (const Clock* clock = g_clockOverride.load(std::memory_order_acquire)) return clock->NowUs();
+    return ReadSystemClockUs();
+}
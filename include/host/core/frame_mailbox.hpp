@@ -0,0 +1,105 @@
+#pragma once
+
+#include "host/core/wait_word.hpp"
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <utility>
+
+// Latest-wins mailbox between the capture callback and the encoder thread. Publish
+// replaces the waiting value and hands the replaced one back to its caller; Take
+// moves the waiting value out. Ownership changes hands with one exchange of the
+// published slot index, so publishers and takers never lock and never see the same
+// value. Slots covers the publisher's slot, the published one and one per concurrent
+// taker. Pop is the blocking Take for the single consuming thread.
+template <typename T, uint32_t Slots = 4>
+class FrameMailbox {
+    static_assert(Slots >= 3 && Slots < 32, "FrameMailbox needs 3-31 slots");
+    // published holds slot index + 1.
+    static constexpr uint32_t kEmpty = 0;
+
+    std::array<T, Slots> slots{};
+    std::atomic<uint32_t> freeMask{(1u << Slots) - 1};
+    std::atomic<uint32_t> published{kEmpty};
+    // Publish and Wake add 2; bit 0 is set while Pop sleeps, so a signal only enters
+    // the kernel when there is someone to wake.
+    std::atomic<uint32_t> seq{0};
+    // Pop's thread only.
+    uint32_t observed = 0;
+
+    void Reclaim(uint32_t entry, T& out) {
+        const uint32_t index = entry - 1;
+        out = std::move(slots[index]);
+        slots[index] = T{};
+        freeMask.fetch_or(1u << index, std::memory_order_release);
+    }
+
+    void Signal() {
+        if (seq.fetch_add(2, std::memory_order_acq_rel) & 1u) {
+            seq.fetch_and(~1u, std::memory_order_release);
+            WakeWord(seq);
+        }
+    }
+
+public:
+    FrameMailbox() = default;
+    FrameMailbox(const FrameMailbox&) = delete;
+    FrameMailbox& operator=(const FrameMailbox&) = delete;
+
+    // Moves value in. Returns true when replaced now holds a value the caller must
+    // dispose of: the one that was waiting, or value itself if every slot is held.
+    bool Publish(T& value, T& replaced) {
+        uint32_t mask = freeMask.load(std::memory_order_acquire);
+        uint32_t index = Slots;
+        while (mask != 0) {
+            const uint32_t candidate = static_cast<uint32_t>(std::countr_zero(mask));
+            if (freeMask.compare_exchange_weak(mask, mask & ~(1u << candidate),
+                    std::memory_order_acquire, std::memory_order_acquire)) {
+                index = candidate;
+                break;
+            }
+        }
+        if (index == Slots) {
+            replaced = std::move(value);
+            value = T{};
+            return true;
+        }
+
+        slots[index] = std::move(value);
+        value = T{};
+        const uint32_t previous = published.exchange(index + 1, std::memory_order_acq_rel);
+        Signal();
+        if (previous == kEmpty) return false;
+        Reclaim(previous, replaced);
+        return true;
+    }
+
+    // Moves the waiting value into out without blocking.
+    bool Take(T& out) {
+        const uint32_t entry = published.exchange(kEmpty, std::memory_order_acq_rel);
+        if (entry == kEmpty) return false;
+        Reclaim(entry, out);
+        return true;
+    }
+
+    // Returns at once if anything was published or Wake was called since the last
+    // Pop, otherwise blocks until one of those happens; then Takes. False means
+    // woken with nothing waiting.
+    bool Pop(T& out) {
+        uint32_t value = seq.load(std::memory_order_acquire);
+        while ((value & ~1u) == observed) {
+            if ((value & 1u) || seq.compare_exchange_weak(value, value | 1u, std::memory_order_acq_rel, std::memory_order_acquire)) {
+                WaitWord(seq, value | 1u);
+                value = seq.load(std::memory_order_acquire);
+            }
+        }
+        observed = value & ~1u;
+        return Take(out);
+    }
+
+    void Wake() { Signal(); }
+
+    [[nodiscard]] bool HasValue() const { return published.load(std::memory_order_acquire) != kEmpty; }
+};
@@ -11,17 +11,36 @@ enum MsgType : uint32_t {
     MSG_CLIPBOARD_GET=0x434C4754, MSG_KICKED=0x4B49434B, MSG_CURSOR_CAPTURE=0x43555243,
     MSG_CURSOR_SHAPE=0x43555253, MSG_AUDIO_ENABLE=0x41554445, MSG_MIC_DATA=0x4D494344,
     MSG_MIC_ENABLE=0x4D494345, MSG_ENCODER_INFO=0x49434E45, MSG_VERSION=0x56455253,
-    MSG_STREAM_TARGET=0x56505254
+    MSG_STREAM_TARGET=0x56505254, MSG_ENCODE_ADJUST=0x47434E45, MSG_CURSOR_IMAGE=0x43555249,
+    MSG_CURSOR_POS=0x43555250, MSG_STREAMS_SET=0x53545253, MSG_STREAMS_INFO=0x53545249,
+    MSG_STREAM_FOCUS=0x53545246, MSG_AUDIO_FEEDBACK=0x41554446
 };
 
 enum CodecType : uint8_t { CODEC_AV1=0, CODEC_H265=1, CODEC_H264=2 };
+// Chroma layout and bit depth of the stream; MSG_CODEC_CAPS advertises one bit per format and codec.
+enum EncodeFormat : uint8_t { FORMAT_YUV420=0, FORMAT_YUV444=1, FORMAT_YUV420_10=2 };
 enum PacketType : uint8_t { PKT_DATA=0, PKT_FEC=1 };
+// FRAME_DROPPED: header-only marker for a queued enhancement layer frame the host discarded.
+enum FrameType : uint8_t { FRAME_DELTA=0, FRAME_KEY=1, FRAME_REPEAT=2, FRAME_DROPPED=3 };
+// Bits 1-2 hold the frame's temporal layer (0 = base); higher layers may be dropped without a keyframe.
+// Bits 3-7 hold the video stream id: 0 is the primary monitor, others come from MSG_STREAMS_SET.
+enum PacketFlags : uint8_t { PKT_FLAG_LAYER_MASK=0x06, PKT_FLAG_STREAM_MASK=0xF8 };
+constexpr int PKT_FLAG_LAYER_SHIFT = 1;
+constexpr int PKT_FLAG_STREAM_SHIFT = 3;
+constexpr int MAX_VIDEO_STREAMS = 8;
+// MSG_AUDIO_FEEDBACK: what the client's audio path handles. Without either the host
+// sends every packet plainly and adds XOR parity groups.
+enum AudioCaps : uint8_t { AUDIO_CAP_REDUNDANCY=0x01, AUDIO_CAP_DTX=0x02 };
+// MSG_ENCODE_ADJUST: why the host encodes below the client's request.
+enum EncodeLimitFlags : uint8_t { LIMIT_ENCODE_TIME=0x01, LIMIT_BANDWIDTH=0x02, LIMIT_FAST_PRESET=0x04 };
 
 enum CursorType : uint8_t {
     CURSOR_DEFAULT=0, CURSOR_TEXT, CURSOR_POINTER, CURSOR_WAIT, CURSOR_PROGRESS, CURSOR_CROSSHAIR,
     CURSOR_MOVE, CURSOR_EW_RESIZE, CURSOR_NS_RESIZE, CURSOR_NWSE_RESIZE, CURSOR_NESW_RESIZE,
     CURSOR_NOT_ALLOWED, CURSOR_HELP, CURSOR_NONE, CURSOR_CUSTOM=255
 };
+// MSG_CURSOR_POS flags.
+enum CursorPosFlags : uint8_t { CURSOR_POS_VISIBLE=0x01 };
 
 #pragma pack(push,1)
 struct MediaPacketHeader {
@@ -32,7 +51,8 @@ struct MediaPacketHeader {
     uint16_t dataLength;
     uint8_t packetType;
     uint8_t fecGroupSize;
-    uint16_t reserved;
+    // Audio: bytes after the payload holding the previous packet as [int64 ts][uint16 samples][data].
+    uint16_t extraLength;
 };
 using AudioPacketHeader = MediaPacketHeader;
 using MicPacketHeader = MediaPacketHeader;
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+
+// Fixed-capacity ring of interleaved float frames between one writer (the resampler)
+// and one reader (the Opus encoder or the WASAPI render copy). Capacity is a power of
+// two frames, so positions are free-running counters masked into the buffer. Both
+// sides work on contiguous spans in place; a range that crosses the end of the buffer
+// comes back as two spans. Nothing allocates after construction.
+class SampleRing {
+public:
+    struct Span {
+        float* data = nullptr;
+        size_t frames = 0;
+    };
+    // second is the part that wrapped to the start of the buffer.
+    struct Spans {
+        Span first, second;
+        [[nodiscard]] size_t Frames() const { return first.frames + second.frames; }
+    };
+
+private:
+    std::unique_ptr<float[]> storage;
+    size_t capacity = 0;
+    size_t mask = 0;
+    int channels = 1;
+    // head is advanced by the writer, tail by the reader; each in its own cache line.
+    alignas(64) std::atomic<size_t> head{0};
+    alignas(64) std::atomic<size_t> tail{0};
+
+    [[nodiscard]] Spans Runs(size_t pos, size_t frames) const {
+        const size_t index = pos & mask;
+        const size_t first = std::min(frames, capacity - index);
+        Spans spans;
+        spans.first = {storage.get() + index * channels, first};
+        if (frames > first) spans.second = {storage.get(), frames - first};
+        return spans;
+    }
+
+public:
+    SampleRing(int channelCount, size_t minFrames)
+        : capacity(std::bit_ceil(std::max<size_t>(minFrames, 2))), mask(capacity - 1), channels(channelCount) {
+        if (channelCount < 1) throw std::invalid_argument("SampleRing needs at least one channel");
+        storage = std::make_unique<float[]>(capacity * static_cast<size_t>(channels));
+    }
+    SampleRing(const SampleRing&) = delete;
+    SampleRing& operator=(const SampleRing&) = delete;
+
+    [[nodiscard]] int Channels() const { return channels; }
+    [[nodiscard]] size_t Capacity() const { return capacity; }
+
+    // Reader side.
+    [[nodiscard]] size_t Size() const {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_relaxed);
+    }
+    [[nodiscard]] Spans Readable(size_t maxFrames = SIZE_MAX) const {
+        const size_t start = tail.load(std::memory_order_relaxed);
+        return Runs(start, std::min(maxFrames, head.load(std::memory_order_acquire) - start));
+    }
+    void Consume(size_t frames) {
+        const size_t start = tail.load(std::memory_order_relaxed);
+        tail.store(start + std::min(frames, head.load(std::memory_order_acquire) - start), std::memory_order_release);
+    }
+    // Drops all but the newest keepFrames and returns how many went.
+    size_t DropOldest(size_t keepFrames) {
+        const size_t size = Size();
+        if (size <= keepFrames) return 0;
+        Consume(size - keepFrames);
+        return size - keepFrames;
+    }
+    void Clear() { Consume(SIZE_MAX); }
+
+    // Writer side.
+    [[nodiscard]] size_t Free() const {
+        return capacity - (head.load(std::memory_order_relaxed) - tail.load(std::memory_order_acquire));
+    }
+    [[nodiscard]] Spans Writable(size_t maxFrames = SIZE_MAX) const {
+        return Runs(head.load(std::memory_order_relaxed), std::min(maxFrames, Free()));
+    }
+    void Commit(size_t frames) {
+        head.store(head.load(std::memory_order_relaxed) + std::min(frames, Free()), std::memory_order_release);
+    }
+};
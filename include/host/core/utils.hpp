@@ -1,5 +1,7 @@
 #pragma once
 
+#include "host/core/clock.hpp"
+
 #include <cstddef>
 #include <cstring>
 #include <cstdint>
@@ -43,14 +45,3 @@ template<typename T>
     out = ReadPod<T>(data);
     return true;
 }
-
-inline int64_t GetTimestamp() {
-    static const int64_t frequency = [] {
-        LARGE_INTEGER f{};
-        QueryPerformanceFrequency(&f);
-        return static_cast<int64_t>(f.QuadPart > 0 ? f.QuadPart : 1);
-    }();
-    LARGE_INTEGER counter{};
-    QueryPerformanceCounter(&counter);
-    return static_cast<int64_t>((counter.QuadPart * 1000000LL) / frequency);
-}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Blocks until word no longer holds expected, timeoutMs passes (< 0 = forever) or a
+// spurious wake. Returns false only on timeout. Maps to WaitOnAddress on Windows and
+// futex on Linux, so a waiter costs no kernel object and a wake with no waiter is a
+// single atomic read-modify-write.
+bool WaitWord(std::atomic<uint32_t>& word, uint32_t expected, int timeoutMs = -1);
+
+// Wakes every thread blocked in WaitWord on word. Change word first.
+void WakeWord(std::atomic<uint32_t>& word);
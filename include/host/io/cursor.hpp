@@ -0,0 +1,45 @@
+#pragma once
+#include "host/io/input.hpp"
+
+// A cursor bitmap as the client draws it: RGBA with straight alpha. id names the
+// bitmap for the whole process; equal pixels and hotspot always get the same id.
+struct CursorImage {
+    uint32_t id = 0;
+    uint16_t width = 0, height = 0, hotX = 0, hotY = 0;
+    std::vector<uint8_t> rgba;
+};
+
+struct CursorSample {
+    CursorType type = CURSOR_NONE;
+    // Bitmap of the shape, for standard shapes too; nullptr when it could not be read.
+    const CursorImage* image = nullptr;
+    // Showing and on the captured monitor; x, y are 0..1 on that monitor.
+    bool visible = false;
+    float x = 0.0f, y = 0.0f;
+};
+
+// Follows the host cursor for client-side drawing. A bitmap is read and hashed only
+// when the cursor handle changes, so polling at input rate costs one GetCursorInfo.
+class CursorTracker {
+    static constexpr int kMaxSize = 128;
+    static constexpr size_t kMaxImages = 64;
+
+    HCURSOR lastHandle = nullptr;
+    CursorType handleType = CURSOR_NONE;
+    const CursorImage* handleImage = nullptr;
+    // Keyed by pixel hash: a shape recreated under a new handle keeps its id.
+    std::unordered_map<uint64_t, CursorImage> images;
+    uint32_t nextId = 1;
+
+    bool reported = false;
+    CursorType reportedType = CURSOR_NONE;
+    uint32_t reportedId = 0;
+
+    const CursorImage* Lookup(HCURSOR cursor);
+
+public:
+    // Reads the cursor now. Returns true when the shape changed since the last Poll.
+    bool Poll(const InputHandler& input, CursorSample& out);
+    // The next Poll reports the shape as changed, e.g. for a new client.
+    void Invalidate() { reported = false; }
+};
@@ -16,7 +16,6 @@ class InputHandler {
     std::atomic<bool> enabled{false}, ctrlDown{false}, altDown{false};
     std::atomic<int64_t> rateStart{0};
     std::atomic<int> moveCnt{0}, clickCnt{0}, keyCnt{0};
-    std::atomic<CursorType> lastCur{CURSOR_DEFAULT};
     std::atomic<uint64_t> totalMoves{0}, totalClicks{0}, totalKeys{0};
     std::atomic<uint64_t> droppedMoves{0}, droppedClicks{0}, droppedKeys{0}, blockedKeys{0};
 
@@ -31,7 +30,9 @@ public:
     void UpdateFromMonitorInfo(const MonitorInfo& info);
     void Enable() { enabled = true; LOG("InputHandler: Enabled"); }
 
-    [[nodiscard]] bool GetCurrentCursor(CursorType& out);
+    [[nodiscard]] bool GetCursorPosition(float& nx, float& ny) const;
+    // Screen point to 0..1 on the captured monitor; false when it is off the monitor.
+    [[nodiscard]] bool ToMonitorNormalized(POINT pt, float& nx, float& ny) const;
     void WiggleCenter();
     void MouseMove(float nx, float ny);
     void MouseMoveRel(int16_t dx, int16_t dy);
@@ -1,5 +1,6 @@
 #pragma once
 #include "host/core/common.hpp"
+#include "host/media/audio_protection.hpp"
 #include <atomic>
 #include <condition_variable>
 #include <cstdint>
@@ -26,22 +27,51 @@ struct AudioPacket {
 
 class AudioCapture {
     static constexpr int kSampleRate = 48000;
-    static constexpr int kFrameSamples = kSampleRate / 100;
+    static constexpr int kDefaultFrameSamples = kSampleRate / 100;
+    static constexpr int kMaxFrameSamples = kSampleRate / 50;
+    // Frames encoded from one capture buffer go out as a single Opus packet of up to
+    // this many samples, so short frames don't multiply the packet rate.
+    static constexpr int kMaxPacketSamples = kSampleRate / 100;
     static constexpr size_t kMaxQueueSize = 4;
+    // About 170 ms at 48 kHz; the overflow limit keeps it under 60 ms.
+    static constexpr size_t kResamplerRingFrames = 8192;
 
     IMMDeviceEnumerator* deviceEnumerator = nullptr;
     IMMDevice* audioDevice = nullptr;
     IAudioClient* audioClient = nullptr;
     IAudioCaptureClient* captureClient = nullptr;
     OpusEncoder* opusEncoder = nullptr;
+    OpusRepacketizer* repacketizer = nullptr;
     WAVEFORMATEX* waveFormat = nullptr;
+    // Signalled by WASAPI when a capture buffer is ready; null if the client polls.
+    HANDLE captureEvent = nullptr;
 
     int systemSampleRate = 48000;
     int channelCount = 2;
     std::unique_ptr<SpeexResampler> resampler;
     std::vector<int16_t> encodeBuffer;
     std::vector<uint8_t> opusBuffer;
-    size_t resamplerReadPos = 0;
+    // Encoded frames waiting to be joined into one packet; they must stay in place
+    // until the repacketizer writes the packet out.
+    std::vector<uint8_t> batchBuffer, packetBuffer;
+    size_t batchBytes = 0;
+    int batchSamples = 0;
+    // Set off-thread; the resampler is reset by the thread that owns it.
+    std::atomic<bool> resamplerResetPending{false};
+
+    // 2.5, 5, 10 or 20 ms; set by the client, applied on the capture thread.
+    std::atomic<int> requestedFrameSamples{kDefaultFrameSamples};
+    int frameSamples = kDefaultFrameSamples;
+
+    // Set from the network thread, applied to the encoder on the capture thread.
+    std::mutex protectionMutex;
+    AudioProtection pendingProtection;
+    std::atomic<bool> protectionDirty{false};
+    AudioProtection protection;
+    bool dredWarned = false;
+    // The first DTX frame of a silence is sent so the client knows the gap is intended.
+    bool inDtx = false;
+    uint64_t dtxFrames = 0;
 
     std::atomic<bool> running{false};
     std::atomic<bool> captureActive{false};
@@ -54,6 +84,9 @@ class AudioCapture {
 
     void Loop();
     void Process(const float* data, UINT32 frames, int64_t ts);
+    void ApplyProtection();
+    void FlushBatch(int64_t ts);
+    void QueuePacket(const uint8_t* data, size_t bytes, int64_t ts, int samples);
 
 public:
     AudioCapture();
@@ -61,7 +94,11 @@ public:
     void Start();
     void Stop();
     void SetStreaming(bool s);
-    [[nodiscard]] bool PopPacket(AudioPacket& out, int ms = 5);
+    void SetProtection(const AudioProtection& p);
+    // samples: 120, 240, 480 or 960 at 48 kHz; anything else is rejected.
+    bool SetFrameSamples(int samples);
+    void ResetFrameSamples() { requestedFrameSamples.store(kDefaultFrameSamples, std::memory_order_release); }
+    [[nodiscard]] bool PopPacket(AudioPacket& out, int ms = 50);
 };
 
 // --- Mic playback (Opus decode → resample → WASAPI render) ---
@@ -76,13 +113,16 @@ class MicPlayback {
 
     static constexpr int kSampleRate = 48000;
     static constexpr int kFrameSamples = kSampleRate / 100;
+    // Largest Opus packet (120 ms), whatever frame size the client encodes with.
+    static constexpr int kMaxPacketSamples = kSampleRate * 120 / 1000;
     static constexpr size_t kMaxQueueSize = 20;
 
     int deviceSampleRate = 48000;
     int channelCount = 1;
     std::unique_ptr<SpeexResampler> resampler;
     std::vector<int16_t> decodeBuffer;
-    size_t resamplerReadPos = 0;
+    // Set off-thread; the resampler is reset by the thread that owns it.
+    std::atomic<bool> resamplerResetPending{false};
     std::atomic<bool> running{false};
     std::atomic<bool> streaming{false};
     std::atomic<bool> init{false};
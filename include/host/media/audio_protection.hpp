@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+
+// Opus and transport settings for the audio stream, derived from the loss the client
+// reports in MSG_AUDIO_FEEDBACK. Until a client reports, the stream uses the base
+// bitrate without protection and the transport keeps its XOR parity groups.
+struct AudioProtection {
+    int bitrate = 96000;
+    // OPUS_SET_PACKET_LOSS_PERC: makes CELT frames lean less on the previous one and
+    // sizes the in-band FEC when that is on.
+    int lossPercent = 0;
+    bool inbandFec = false;
+    // 10 ms units of deep redundancy (libopus 1.5 DRED); 0 = off.
+    int dredFrames = 0;
+    bool dtx = false;
+    // Each packet also carries the previous one (AUDIO_CAP_REDUNDANCY).
+    bool redundancy = false;
+
+    bool operator==(const AudioProtection&) const = default;
+};
+
+struct AudioProtectionConfig {
+    int bitrate = 96000;
+    // Floor for the primary stream under heavy loss.
+    int minBitrate = 48000;
+    // LBRR and DRED can only be used by a decoder with FEC decoding; the browser's
+    // WebCodecs decoder has none, so both are opt-in.
+    bool inbandFec = false;
+    int dredMs = 0;
+    bool dtx = true;
+    int maxLossPercent = 25;
+    // Smoothed loss that turns redundancy on, and the level it must fall under to turn off.
+    double redundancyOnPercent = 1.0;
+    double redundancyOffPercent = 0.25;
+    // Smoothed loss from which the primary runs at minBitrate.
+    double heavyLossPercent = 10.0;
+};
+
+class AudioLossController {
+    AudioProtectionConfig cfg;
+    AudioProtection current;
+    double smoothedLoss = 0.0;
+    uint8_t caps = 0;
+
+    [[nodiscard]] AudioProtection Derive() const;
+
+public:
+    explicit AudioLossController(const AudioProtectionConfig& config = {});
+
+    // Back to the unprotected base stream, e.g. for a new client.
+    void Reset();
+    // caps: AUDIO_CAP_* from the client. lossPercent: packets missing before any
+    // recovery during the report window. Returns true if Current() changed.
+    bool Report(uint8_t clientCaps, int lossPercent);
+
+    [[nodiscard]] const AudioProtection& Current() const { return current; }
+    [[nodiscard]] double SmoothedLoss() const { return smoothedLoss; }
+};
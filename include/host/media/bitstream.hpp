@@ -0,0 +1,25 @@
+#pragma once
+
+#include "host/core/protocol.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+// Temporal layer of the access unit in data, 0 for the base layer: the HEVC
+// TemporalId, the AV1 OBU extension temporal_id, or for H.264 the SVC prefix
+// temporal_id (1 for a non-reference picture without one). -1 when the access
+// unit carries no layer id, e.g. AV1 frames without an OBU extension header.
+[[nodiscard]] int FindTemporalLayer(CodecType codec, const uint8_t* data, size_t size);
+
+// Layer of each encoded frame in the order the encoder returns them: the id the
+// bitstream signals, or else the frame's place in the dyadic L1T2/L1T3 pattern
+// that restarts at every keyframe. SVT-AV1 builds that pattern from
+// hierarchical-levels but writes no OBU extension headers.
+class TemporalLayerTracker {
+    int layers = 1;
+    uint64_t position = 0;
+
+public:
+    void Reset(int layerCount);
+    int Next(CodecType codec, const uint8_t* data, size_t size, bool key);
+};
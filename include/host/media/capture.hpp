@@ -1,5 +1,6 @@
 #pragma once
 #include "host/core/common.hpp"
+#include "host/core/frame_mailbox.hpp"
 
 struct FrameData {
     ID3D11Texture2D* tex = nullptr;
@@ -12,25 +13,33 @@ struct FrameData {
     void Release() { SafeRelease(tex); ts = sourceTs = 0; poolIdx = -1; needsSync = false; generation = 0; }
 };
 
+// Capture -> encoder handoff: the latest frame wins, and a bit per capture pool
+// texture stays set from Push until the encoder calls MarkReleased (or the frame is
+// replaced or reset away), so FindTex never reuses a texture the encoder holds.
 class FrameSlot {
-    static constexpr int N = 4;
-    FrameData fr[N];
-    CRITICAL_SECTION cs;
-    HANDLE evt;
-    int head = 0, tail = 0, cnt = 0;
-    uint32_t inFlight = 0;
+    FrameMailbox<FrameData> box;
+    std::atomic<uint32_t> inFlight{0};
     std::atomic<uint64_t> curGen{0};
+    std::function<void()> onPush;
+
+    void Drop(FrameData& frame) { MarkReleased(frame.poolIdx); frame.Release(); }
 
 public:
-    FrameSlot();
-    ~FrameSlot();
+    FrameSlot() = default;
+    ~FrameSlot() { Reset(); }
     void SetGeneration(uint64_t g) { curGen.store(g, std::memory_order_release); }
     [[nodiscard]] uint64_t GetGeneration() const { return curGen.load(std::memory_order_acquire); }
     void Push(ID3D11Texture2D* tex, int64_t ts, int64_t sourceTs, uint64_t fence, bool sync, int idx = -1);
-    bool Pop(FrameData& out);
-    void Wake() { if (evt) SetEvent(evt); }
-    void MarkReleased(int i);
-    [[nodiscard]] bool IsInFlight(int i);
+    // Encoder thread only. False when woken by Wake with no new frame.
+    bool Pop(FrameData& out) { return box.Pop(out); }
+    // Non-blocking Pop for consumers without a thread of their own.
+    bool Take(FrameData& out) { return box.Take(out); }
+    // Runs on the capture thread after each Push; set before capture starts.
+    void SetPushCallback(std::function<void()> cb) { onPush = std::move(cb); }
+    void Wake() { box.Wake(); }
+    void MarkReleased(int i) { if (i >= 0) inFlight.fetch_and(~(1u << i), std::memory_order_release); }
+    [[nodiscard]] bool IsInFlight(int i) const { return i >= 0 && (inFlight.load(std::memory_order_acquire) & (1u << i)) != 0; }
+    // Drops the waiting frame; frames the encoder already popped stay in flight until released.
     void Reset();
 };
 
@@ -68,7 +77,8 @@ class ScreenCapture {
     void InitMon(HMONITOR mon, bool keepFps = false);
 
 public:
-    explicit ScreenCapture(FrameSlot* s);
+    // monitor indexes g_monitors; -1 captures the primary monitor.
+    explicit ScreenCapture(FrameSlot* s, int monitor = -1);
     ~ScreenCapture();
 
     void SetResolutionChangeCallback(std::function<void(int, int, int)> cb) { onResChange = cb; }
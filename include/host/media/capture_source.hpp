@@ -0,0 +1,113 @@
+#pragma once
+
+#include "host/core/frame_mailbox.hpp"
+#include "host/media/frame_analysis.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Produces BGRA frames (stride = width * 4), the same layout the host hands to
+// the software encode path after mapping its staging texture. The CPU-side
+// counterpart of ScreenCapture: no display, GPU or Windows needed.
+class CaptureSource {
+protected:
+    int w = 0, h = 0, fps = 0;
+    int64_t frameTimeUs = 0;
+
+public:
+    virtual ~CaptureSource() = default;
+
+    // Fills bgra with the next frame; file sources loop at end of file.
+    virtual bool Read(std::vector<uint8_t>& bgra) = 0;
+    [[nodiscard]] virtual std::string Describe() const = 0;
+
+    [[nodiscard]] int Width() const { return w; }
+    [[nodiscard]] int Height() const { return h; }
+    // Frame rate declared by the input, or 0 if it has none.
+    [[nodiscard]] int Fps() const { return fps; }
+    // Presentation time of the frame the last Read returned: 0 for the first frame,
+    // increasing across loops. Recorded timestamps for replays that carry them,
+    // otherwise frame index / frame rate.
+    [[nodiscard]] int64_t FrameTimeUs() const { return frameTimeUs; }
+
+    // Live sources read the screen as it is now, so SourceCapture waits for the
+    // frame time before Read instead of after.
+    [[nodiscard]] virtual bool Live() const { return false; }
+    // What changed since the previous Read, for sources that track it; nullptr or
+    // not valid means anything may have changed.
+    [[nodiscard]] virtual const FrameChangeInfo* Changes() const { return nullptr; }
+};
+
+// pattern: static, idle (static plus a blinking caret), scroll, gradient or noise. rateFps only sets the frame times.
+[[nodiscard]] std::unique_ptr<CaptureSource> CreateSyntheticSource(const std::string& pattern, int width, int height, int rateFps = 60);
+// Frame times come from XTS=<microseconds> FRAME parameters when present, otherwise the header rate.
+[[nodiscard]] std::unique_ptr<CaptureSource> OpenY4MSource(const std::string& path);
+// Frame times come from path + ".ts" (one microsecond timestamp per line) when present, otherwise rateFps.
+[[nodiscard]] std::unique_ptr<CaptureSource> OpenRawBGRASource(const std::string& path, int width, int height, int rateFps = 60);
+
+// A frame handed from SourceCapture to the encoder thread.
+struct CpuFrame {
+    std::vector<uint8_t> bgra;
+    int width = 0, height = 0;
+    uint64_t index = 0;
+    int64_t ts = 0;        // GetTimestamp() at capture (live) or delivery (replay), like a captured frame's ts
+    int64_t sourceTs = 0;  // when the source's frame time said it was due
+    // Changes since the previous frame taken from SourceCapture, including those
+    // of frames replaced before they were taken.
+    FrameChangeInfo changes;
+};
+
+// Folds the changes of a frame that was skipped into the next one's. Not valid
+// (unknown) wins; rectangles are concatenated, not merged.
+void MergeFrameChanges(FrameChangeInfo& into, const FrameChangeInfo& skipped);
+
+struct SourceCaptureStats {
+    uint64_t delivered = 0;
+    // Frames replaced in the mailbox before the consumer took them.
+    uint64_t replaced = 0;
+    // Frames delivered more than one frame period after their frame time.
+    uint64_t late = 0;
+};
+
+// Plays a CaptureSource in real time on GetTimestamp(): a thread reads each frame,
+// waits until its frame time and publishes it into the same latest-wins mailbox
+// FrameSlot uses, so a slow consumer sees drops rather than a backlog.
+class SourceCapture {
+    std::unique_ptr<CaptureSource> source;
+    FrameMailbox<CpuFrame> mailbox;
+    FrameMailbox<std::vector<uint8_t>> spares;
+    std::thread worker;
+    std::atomic<bool> running{false};
+    std::atomic<uint64_t> delivered{0}, replaced{0}, late{0};
+
+    void Run();
+
+public:
+    explicit SourceCapture(std::unique_ptr<CaptureSource> src);
+    ~SourceCapture();
+    SourceCapture(const SourceCapture&) = delete;
+    SourceCapture& operator=(const SourceCapture&) = delete;
+
+    bool Start();
+    void Stop();
+
+    // Encoder thread: blocks until a frame is published or Stop is called. False
+    // means woken with nothing waiting; check Running().
+    bool Pop(CpuFrame& out) { return mailbox.Pop(out); }
+    // Encoder thread: hands back a frame's pixels, unmodified, once done with them.
+    // The next Read fills that buffer, and sources that patch the frame they filled
+    // last (X11 damage) only fetch what changed since.
+    void Recycle(std::vector<uint8_t>& bgra) {
+        if (bgra.empty()) return;
+        std::vector<uint8_t> dropped;
+        spares.Publish(bgra, dropped);
+    }
+
+    [[nodiscard]] bool Running() const { return running.load(std::memory_order_acquire); }
+    [[nodiscard]] const CaptureSource& Source() const { return *source; }
+    [[nodiscard]] SourceCaptureStats Stats() const;
+};
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+extern "C" {
+#include <libavutil/frame.h>
+#include <libavutil/pixfmt.h>
+}
+
+// Single-pass BGRA to YUV for the layouts swscale only reaches through its
+// generic two-pass scaler: YUV444P and the 10-bit 4:2:0 formats. BT.709 full
+// range, matching ApplyRealtimeEncoderDefaults. 4:2:0 chroma is the 2x2 average.
+
+[[nodiscard]] bool HasDirectBgraConversion(AVPixelFormat format);
+// dst must be allocated with its format, width and height set. Returns false
+// for formats HasDirectBgraConversion rejects.
+bool ConvertBgraToFrame(const uint8_t* bgra, size_t stride, AVFrame* dst);
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "host/media/resolution_controller.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Holds encode time under the frame period. Tracks the p95 of EncodedFrame::encUs
+// over one-second windows and, when it exceeds the budget, steps down the
+// cheapest lever first: a faster encoder preset, then the coded resolution, then
+// the frame rate. Levers are restored in reverse order once the projected p95
+// leaves headroom for a hold that doubles after every restore that did not last.
+enum class GovernorAction : uint8_t {
+    None = 0,
+    FasterPreset,
+    LowerResolution,
+    LowerFps,
+    RestoreFps,
+    RestoreResolution,
+    RestorePreset
+};
+
+struct GovernorConfig {
+    // Frame rate the client asked for; the fps lever never goes above it.
+    int requestedFps = 60;
+    int minFps = 30;
+    int minScalePercent = 50;
+    // The active encoder has a faster speed setting (VideoEncoder::HasFasterPreset).
+    bool presetAvailable = false;
+};
+
+class EncodeGovernor {
+    static constexpr size_t kSamples = 128;
+
+    GovernorConfig cfg;
+    std::array<int64_t, kSamples> samples{};
+    size_t sampleCount = 0;
+    size_t sampleNext = 0;
+    int64_t windowStartUs = 0;
+    int64_t p95Us = -1;
+    int64_t budgetUs = 0;
+
+    bool fastPreset = false;
+    int scalePercent = 100;
+    int fpsCap = 0;
+
+    int overWindows = 0;
+    int headroomWindows = 0;
+    UpStepHold restoreHold;  // in windows
+    uint64_t changes = 0;
+
+    void ClearSamples();
+    [[nodiscard]] int64_t Percentile95();
+    [[nodiscard]] GovernorAction StepDown();
+    [[nodiscard]] GovernorAction StepUp(int64_t framePeriodUs) const;
+
+public:
+    void Reset(const GovernorConfig& config);
+    void SetPresetAvailable(bool available) { cfg.presetAvailable = available; }
+    // A new client frame rate; drops the fps cap if it is no longer below it.
+    void SetRequestedFps(int fps);
+
+    // encUs < 0 for frames that were not encoded (repeats, keyframes). framePeriodUs
+    // is the current pacing period, so it already reflects FpsCap().
+    GovernorAction OnFrame(int64_t nowUs, int64_t encUs, int64_t framePeriodUs);
+
+    [[nodiscard]] bool FastPreset() const { return fastPreset; }
+    [[nodiscard]] int ScalePercent() const { return scalePercent; }
+    // 0 = no cap; otherwise the encode frame rate.
+    [[nodiscard]] int FpsCap() const { return fpsCap; }
+    [[nodiscard]] int64_t P95Us() const { return p95Us; }
+    [[nodiscard]] int64_t BudgetUs() const { return budgetUs; }
+    [[nodiscard]] uint64_t ChangeCount() const { return changes; }
+    [[nodiscard]] bool IsLimiting() const { return fastPreset || scalePercent < 100 || fpsCap > 0; }
+};
+
+[[nodiscard]] const char* GovernorActionName(GovernorAction action);
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Shared encode threads for streams that do not own one. Each stream registers a job
+// that encodes its latest frame; Notify marks a frame waiting. A stream runs at most
+// once per period and on one worker at a time. When several are due, focused streams
+// go first and then the one furthest past its deadline, so a busy pool slows the
+// background streams before the focused one.
+class EncodeWorkerPool {
+public:
+    using Job = std::function<void()>;
+
+    explicit EncodeWorkerPool(int workers);
+    ~EncodeWorkerPool();
+
+    EncodeWorkerPool(const EncodeWorkerPool&) = delete;
+    EncodeWorkerPool& operator=(const EncodeWorkerPool&) = delete;
+
+    // Returns a handle for the other calls; the stream starts unfocused at fps.
+    int Add(Job job, int fps);
+    // Blocks while the job runs, so its captures may be destroyed afterwards.
+    void Remove(int handle);
+    void SetRate(int handle, int fps, bool focused);
+    // A frame is waiting; the job runs at its next deadline.
+    void Notify(int handle);
+
+    [[nodiscard]] int WorkerCount() const { return static_cast<int>(workers_.size()); }
+
+private:
+    struct Entry {
+        int handle = 0;
+        Job job;
+        int64_t periodUs = 0;
+        int64_t dueUs = 0;
+        bool focused = false;
+        bool ready = false;
+        bool busy = false;
+    };
+
+    std::vector<Entry> entries_;
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable wake_, idle_;
+    int nextHandle_ = 1;
+    bool stopping_ = false;
+
+    Entry* Find(int handle);
+    // Due entry to run next, or nullptr with waitUs set to the time until one is due (-1 = none waiting).
+    Entry* Pick(int64_t nowUs, int64_t& waitUs);
+    void Run();
+};
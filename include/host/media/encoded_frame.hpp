@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+}
+
+// Encoded access unit held as references to the encoder's packet buffers, so the
+// packetizer can chunk straight from encoder-owned memory without flattening.
+struct EncodedFrame {
+    std::vector<AVPacket*> packets;
+    size_t size=0;
+    int qp=-1;  // average frame QP from AV_PKT_DATA_QUALITY_STATS, -1 if not reported
+    int layer=0;  // temporal layer, 0 = base; frames above 0 can be dropped without a keyframe
+    int64_t ts=0, sourceTs=0, encodeEndTs=0, enqueueTs=0, encUs=0;
+    bool isKey=false, isRepeat=false;
+
+    EncodedFrame() = default;
+    EncodedFrame(const EncodedFrame&) = delete;
+    EncodedFrame& operator=(const EncodedFrame&) = delete;
+    ~EncodedFrame();
+
+    bool Append(AVPacket* src);
+    size_t CopyRange(size_t offset, uint8_t* dst, size_t len) const;
+    void Clear();
+
+private:
+    std::vector<AVPacket*> spare;
+};
+
+class EncodedFramePool;
+
+struct EncodedFrameRecycler {
+    std::shared_ptr<EncodedFramePool> pool;
+    void operator()(EncodedFrame* frame) const;
+};
+
+using EncodedFrameRef = std::unique_ptr<EncodedFrame, EncodedFrameRecycler>;
+
+class EncodedFramePool : public std::enable_shared_from_this<EncodedFramePool> {
+    std::mutex mtx;
+    std::vector<std::unique_ptr<EncodedFrame>> freeFrames;
+
+public:
+    static constexpr size_t kMaxPooledFrames = 4;
+
+    [[nodiscard]] EncodedFrameRef Acquire();
+    void Recycle(EncodedFrame* frame);
+};
+
+inline const char* AvErr(int err) {
+    static thread_local char buf[AV_ERROR_MAX_STRING_SIZE];
+    return av_strerror(err, buf, sizeof(buf)), buf;
+}
+
+// Moves every packet the encoder has ready into out. Returns the number received.
+int DrainEncoderPackets(AVCodecContext* cctx, AVPacket* pkt, EncodedFrame& out, bool& gotKey);
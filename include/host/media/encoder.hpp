@@ -1,21 +1,26 @@
 #pragma once
 #include "host/core/common.hpp"
+#include "host/media/bitstream.hpp"
+#include "host/media/color_convert.hpp"
+#include "host/media/encoded_frame.hpp"
+#include "host/media/encoder_calibration.hpp"
+#include "host/media/encoder_settings.hpp"
+#include "host/media/frame_analysis.hpp"
+#include "host/media/rate_controller.hpp"
 
 #include <unordered_map>
 
 enum class GPUVendor : uint8_t { NVIDIA=0, INTEL=1, AMD=2, UNKNOWN=255 };
 
-struct EncodedFrame {
-    std::vector<uint8_t> data;
-    int64_t ts=0, sourceTs=0, encodeEndTs=0, enqueueTs=0, encUs=0;
-    bool isKey=false;
-    void Clear() { data.clear(); ts = sourceTs = encodeEndTs = enqueueTs = encUs = 0; isKey = false; }
-};
+// QP offsets are in hundredths of AVRegionOfInterest::qoffset (-100..100, negative = better quality).
+struct RoiConfig {
+    bool enabled = true;
+    int cursorQOffset = -20;
+    int changedQOffset = -10;
+    int cursorRadius = 160;
 
-inline const char* AvErr(int err) {
-    static thread_local char buf[AV_ERROR_MAX_STRING_SIZE];
-    return av_strerror(err, buf, sizeof(buf)), buf;
-}
+    [[nodiscard]] static RoiConfig FromEnv();
+};
 
 class VideoEncoder {
     AVCodecContext* cctx=nullptr;
@@ -37,17 +42,45 @@ class VideoEncoder {
     D3D11FenceSync sync;
     int w, h, frameNum=0, curFps;
     CodecType codec;
+    EncodeFormat format;
     GPUVendor vendor=GPUVendor::UNKNOWN;
     AVPixelFormat swPixFmt=AV_PIX_FMT_NONE;
     bool usingHardware=false;
     std::string activeEncoderName;
-    std::chrono::steady_clock::time_point lastKey;
-    EncodedFrame out;
-    std::atomic<uint64_t> totalFrames{0}, failedFrames{0};
+    int64_t lastKeyUs = 0;
+    std::shared_ptr<EncodedFramePool> framePool = std::make_shared<EncodedFramePool>();
+    std::atomic<uint64_t> totalFrames{0}, failedFrames{0}, staticFrames{0};
+    TileChangeDetector changeDetector;
+    bool staticDetection=true;
+    RoiConfig roi;
+    // roi.enabled and the active encoder reads the side data (SupportsRegionsOfInterest).
+    bool roiApplied=false;
+    ContentClassifier contentClassifier;
+    ContentProfile contentProfile=ContentProfile::Default;
+    int contentProfileMode=-1;
+    int framesSinceClassify=0;
+    int sliceCount=0;
+    int temporalLayers=1;
+    TemporalLayerTracker layerTracker;
+    int coreBudget=0;
+    bool pinThreads=false;
+    int rateControlMode=1;
+    int targetQpOverride=0;
+    bool cappedQuality=false;
+    bool dynamicRate=false;
+    RateController rateControl;
+    bool contentProfileSwitchPending=false;
+    int64_t lastProfileSwitchUs=0;
+    bool fastPreset=false;
+    bool presetSwitchPending=false;
+    std::atomic<bool> cursorVisible{false};
+    std::atomic<float> cursorX{0.0f}, cursorY{0.0f};
+    std::vector<AVRegionOfInterest> roiScratch;
     std::unordered_map<ID3D11Texture2D*, ID3D11ShaderResourceView*> scaleSourceViews;
     int scaleSrcW=0, scaleSrcH=0;
 
-    static constexpr auto KEY_INT = std::chrono::milliseconds{2000};
+    static constexpr int64_t KEY_INT_US = 2000000;
+    static constexpr int64_t kProfileSwitchHoldUs = 20000000;
 
     struct ScaleConstants {
         float sourceWidth;
@@ -58,31 +91,66 @@ class VideoEncoder {
 
     bool InitHwCtx();
     bool InitSwFrame(const AVCodec* enc);
-    bool UploadSoftwareFrame(ID3D11Texture2D* tex, AVFrame* frame);
+    bool UploadSoftwareFrame(ID3D11Texture2D* tex, AVFrame* frame, bool allowSkip, bool& unchanged);
+    void AttachRegionsOfInterest(AVFrame* frame, const FrameChangeInfo* changes);
     bool InitScaler();
     ID3D11ShaderResourceView* GetScaleSourceView(ID3D11Texture2D* tex);
     ID3D11Texture2D* PrepareInputTexture(ID3D11Texture2D* tex, const D3D11_TEXTURE2D_DESC& desc);
-    void Configure();
+    bool Configure();
     bool TryInitHardware(GPUVendor v, CodecType cc);
     bool TryInitSoftware(CodecType cc);
-    bool DrainPackets(bool& gotKey);
+    void ReleaseSoftwareEncoder();
+    bool ReopenSoftwareEncoder(ContentProfile profile);
+    bool DrainPackets(EncodedFrame& out, bool& gotKey);
+    [[nodiscard]] int RateControlTargetQp() const;
+    void ResetRateControl();
+    void ApplyBitrate(int64_t bitrate);
 
 public:
+    // Measures (or loads cached) encoder throughput at the stream size; later
+    // ProbeSupport calls and encoder selection use the result. Call once at startup.
+    static bool Calibrate(ID3D11Device* d, int w, int h, int fps);
+    [[nodiscard]] static std::string AdapterIdentity(ID3D11Device* d);
     [[nodiscard]] static uint8_t ProbeSupport(ID3D11Device* d);
     [[nodiscard]] static uint8_t ProbeHardwareSupport(ID3D11Device* d);
+    // Bit per EncodeFormat that an encoder for codec can produce (bit 0 always set).
+    // hardwareCodec: the codec is hardware encoded, so only hardware formats count.
+    [[nodiscard]] static uint8_t ProbeFormatSupport(ID3D11Device* d, CodecType c, bool hardwareCodec);
     [[nodiscard]] static GPUVendor DetectGPU(ID3D11Device* d);
     [[nodiscard]] static const char* VendorName(GPUVendor v);
     [[nodiscard]] static const char* CodecName(CodecType c);
+    [[nodiscard]] static const char* ContentProfileName(ContentProfile p);
 
     VideoEncoder(int w, int h, int fps, ID3D11Device* d, ID3D11DeviceContext* c,
-                 ID3D11Multithread* m, CodecType cc=CODEC_AV1);
+                 ID3D11Multithread* m, CodecType cc=CODEC_AV1, EncodeFormat fmt=FORMAT_YUV420);
     ~VideoEncoder();
 
     [[nodiscard]] GPUVendor GetVendor() const { return vendor; }
+    [[nodiscard]] int GetWidth() const { return w; }
+    [[nodiscard]] int GetHeight() const { return h; }
+    // Software encoders with a FasterSoftwarePreset reopen one speed step faster (or back
+    // to the default) before the next frame, which starts with a keyframe. Returns false
+    // when the active encoder has no faster setting.
+    bool SetFastPreset(bool fast);
+    [[nodiscard]] bool HasFasterPreset() const { return !usingHardware && FasterSoftwarePreset(activeEncoderName); }
+    [[nodiscard]] bool IsFastPreset() const { return fastPreset; }
     [[nodiscard]] bool IsUsingHardware() const { return usingHardware; }
+    // May differ from the requested format when no encoder supports it (falls back to 4:2:0).
+    [[nodiscard]] EncodeFormat GetFormat() const { return format; }
+    // Temporal layers the active encoder was configured with (1 = no enhancement layers).
+    [[nodiscard]] int GetTemporalLayers() const { return SupportsTemporalLayers(activeEncoderName) ? temporalLayers : 1; }
+    [[nodiscard]] uint64_t GetStaticFrameCount() const { return staticFrames.load(); }
+    [[nodiscard]] ContentProfile GetContentProfile() const { return contentProfile; }
+    void SetCursorHint(bool visible, float nx, float ny);
     [[nodiscard]] const std::string& GetActiveEncoderName() const { return activeEncoderName; }
     bool UpdateFPS(int fps);
     void Flush();
+    // The frame Encode last returned did not reach the client, so the next frame is
+    // encoded even when it matches that one.
+    void OnSendFailed() { changeDetector.Reset(); }
+    // A software reopen (profile or preset switch) failed twice and left no codec
+    // context; every Encode fails until the owner builds a new encoder.
+    [[nodiscard]] bool NeedsRebuild() const { return !cctx; }
     [[nodiscard]] bool IsEncodeComplete() const { return !usingHardware || sync.IsLastComplete(); }
-    [[nodiscard]] EncodedFrame* Encode(ID3D11Texture2D* tex, int64_t ts, int64_t sourceTs, bool forceKey=false);
+    [[nodiscard]] EncodedFrameRef Encode(ID3D11Texture2D* tex, int64_t ts, int64_t sourceTs, bool forceKey=false);
 };
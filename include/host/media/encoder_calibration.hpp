@@ -0,0 +1,65 @@
+#pragma once
+
+#include "host/core/protocol.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Startup encoder calibration: every available encoder is opened at the stream
+// size and fed synthetic frames, so codec selection is based on what actually
+// opens and keeps up rather than on avcodec_find_encoder_by_name. Portable;
+// hardware encoders are driven with system-memory NV12 frames.
+
+struct EncoderCandidate {
+    std::string name;
+    CodecType codec = CODEC_H264;
+    bool hardware = false;
+};
+
+struct EncoderMeasurement {
+    std::string name;
+    CodecType codec = CODEC_H264;
+    bool hardware = false;
+    bool opened = false;
+    int frames = 0;
+    double fps = 0.0;
+    double latencyP50Ms = 0.0;
+    double latencyP95Ms = 0.0;
+};
+
+struct CalibrationSettings {
+    int width = 1920, height = 1080, fps = 60;
+    int maxFrames = 60;
+    int maxMillis = 1500;   // per encoder; slow encoders stop early
+    double headroom = 1.1;  // measured fps must exceed fps * headroom
+    int coreBudget = 0;     // software encoders, as SoftwareEncoderOptions
+    bool pin = false;
+};
+
+struct CalibrationResult {
+    std::string key;
+    int width = 0, height = 0, fps = 0;
+    double headroom = 1.1;
+    std::vector<EncoderMeasurement> encoders;
+
+    [[nodiscard]] bool Sustains(const EncoderMeasurement& m) const;
+    // Bit per CodecType of codecs with at least one sustaining encoder.
+    [[nodiscard]] uint8_t SustainableCodecs(bool hardwareOnly = false) const;
+    [[nodiscard]] const EncoderMeasurement* Find(const std::string& name) const;
+    // Sustaining encoders in candidate order, then the rest by measured fps.
+    [[nodiscard]] std::vector<std::string> Ranked(CodecType codec, bool hardware) const;
+};
+
+// CPU brand, FFmpeg version and the caller's GPU/driver description.
+[[nodiscard]] std::string MakeCalibrationKey(const std::string& gpuIdentity, int width, int height, int fps);
+
+[[nodiscard]] EncoderMeasurement MeasureEncoder(const EncoderCandidate& candidate, const CalibrationSettings& settings);
+// Hardware candidates run concurrently with each other and with the software
+// candidates; software candidates run one at a time so they do not share cores.
+[[nodiscard]] CalibrationResult CalibrateEncoders(const std::vector<EncoderCandidate>& candidates,
+                                                  const CalibrationSettings& settings, const std::string& key);
+
+// The cache holds the most recent results for several keys (monitors, drivers).
+bool LoadCalibration(const std::string& path, const std::string& key, CalibrationResult& out);
+bool SaveCalibration(const std::string& path, const CalibrationResult& result);
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "host/core/protocol.hpp"
+#include "host/media/encoder_tuning.hpp"
+#include "host/media/frame_analysis.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+}
+
+// Rate-control model and software encoder setup shared by VideoEncoder and the
+// offline tools. Nothing here touches D3D11, so it builds on any platform.
+
+// Fitted bits-per-pixel-per-effective-frame factors for one codec, ordered by
+// pixel count and interpolated in log space. Written by slipstream_quality.
+struct BitrateModelPoint {
+    int64_t pixels = 0;
+    double factor = 0.0;
+};
+
+// Replaces the built-in per-codec factors with the curves in a bitrate_model.json.
+// Call before any encoder is created; returns false (and keeps the defaults) when
+// the file is missing or invalid.
+bool LoadBitrateModel(const std::string& path);
+void SetBitrateModel(CodecType codec, std::vector<BitrateModelPoint> points);
+[[nodiscard]] double CalcModelBitrateFactor(CodecType codec, int64_t pixels);
+
+[[nodiscard]] int CalcEffectiveFps(int fps);
+[[nodiscard]] double CalcCodecBitrateFactor(CodecType codec);
+[[nodiscard]] int64_t CalcBitrate(CodecType codec, int w, int h, int fps);
+[[nodiscard]] int64_t CalcMaxRate(int64_t bitrate);
+[[nodiscard]] int CalcBufferSize(int64_t bitrate);
+[[nodiscard]] int CalcQualityValue(CodecType codec, int w, int h, int fps);
+[[nodiscard]] int TileRowsLog2(int slices);
+
+[[nodiscard]] AVCodecID GetCodecId(CodecType codec);
+[[nodiscard]] const char* const* GetSoftwareEncoderNames(CodecType codec, size_t& count);
+// Names FindSoftwareEncoder tries first, e.g. ranked by calibration. Empty restores
+// the static order (SVT-AV1, libaom, rav1e for AV1).
+void SetSoftwareEncoderPreference(CodecType codec, std::vector<std::string> names);
+// Only encoders that accept a pixel format for the requested EncodeFormat qualify.
+[[nodiscard]] const AVCodec* FindSoftwareEncoder(CodecType codec, std::string& encoderName,
+                                                 EncodeFormat format = FORMAT_YUV420);
+// YUV420P/NV12, YUV444P, or YUV420P10/P010 as the format asks; AV_PIX_FMT_NONE if the encoder has none.
+[[nodiscard]] AVPixelFormat SelectSoftwarePixelFormat(const AVCodec* enc, EncodeFormat format = FORMAT_YUV420);
+[[nodiscard]] const char* EncodeFormatName(EncodeFormat format);
+// NVENC converts the BGRA frames-context input itself: 4:4:4 for H.264/HEVC
+// (rgb_mode) and 10-bit for HEVC/AV1 (highbitdepth), when this FFmpeg has the
+// options. QSV and AMF are limited to 4:2:0 from BGRA.
+[[nodiscard]] bool HardwareEncoderSupportsFormat(const AVCodec* enc, CodecType codec, EncodeFormat format);
+
+struct SoftwareEncoderOptions {
+    ContentProfile profile = ContentProfile::Default;
+    int slices = 0;
+    // Overrides the realtime speed setting: x264/x265 preset name, SVT-AV1 preset,
+    // libaom cpu-used or rav1e speed. Empty keeps the streaming default.
+    std::string preset;
+    // Logical cores the encoder may use; 0 = all but a reserve (ResolveCoreBudget).
+    int coreBudget = 0;
+    // SVT-AV1 only: pin worker threads to the first coreBudget cores.
+    bool pin = false;
+    // > 0 switches encoders that support it to capped CRF: this CRF, with the
+    // configured rc_max_rate as the ceiling and bit_rate cleared.
+    int crf = 0;
+    // 2 or 3 requests an L1T2/L1T3 temporal structure where SupportsTemporalLayers.
+    int temporalLayers = 1;
+    // Frames will carry ROI side data: turns on the adaptive quantization that
+    // x264 and x265 need to apply it (their ultrafast presets switch it off).
+    bool roi = false;
+};
+
+// Size, timing, rate-control and colour fields common to every low-latency encoder.
+void ApplyRealtimeEncoderDefaults(AVCodecContext* cctx, CodecType codec, int w, int h, int fps);
+// x264, x265 and SVT-AV1 accept CRF together with a VBV/max-bitrate ceiling.
+[[nodiscard]] bool SupportsCappedCrf(const std::string& encoderName);
+// Only SVT-AV1 (low-delay hierarchical levels) builds a temporal structure with
+// the realtime settings here. x265's temporal-layers only moves non-reference
+// B-frames, and zerolatency has none; libaom, rav1e and the hardware wrappers
+// have no control for it through FFmpeg.
+[[nodiscard]] bool SupportsTemporalLayers(const std::string& encoderName);
+// libx264 and libx265 (configured with SoftwareEncoderOptions::roi) and H.264/HEVC
+// QSV apply AV_FRAME_DATA_REGIONS_OF_INTEREST. SVT-AV1, libaom, rav1e, NVENC and
+// AMF drop it without a warning.
+[[nodiscard]] bool SupportsRegionsOfInterest(const std::string& encoderName);
+// Replaces the frame's ROI side data with regions; none removes it.
+bool SetFrameRegionsOfInterest(AVFrame* frame, const std::vector<AVRegionOfInterest>& regions);
+// One step faster than the streaming default speed setting, for SoftwareEncoderOptions::preset.
+// nullptr when the default is already the fastest (x264/x265 ultrafast, rav1e speed 10).
+[[nodiscard]] const char* FasterSoftwarePreset(const std::string& encoderName);
+// Private options and thread/tile layout for the software encoders. Expects
+// ApplyRealtimeEncoderDefaults to have run; call before avcodec_open2.
+SoftwareThreadingPlan ConfigureSoftwareEncoder(AVCodecContext* cctx, const std::string& encoderName,
+                                               const SoftwareEncoderOptions& opts);
+// Low-latency private options for NVENC, QSV and AMF, chosen by encoder name suffix.
+// Expects ApplyRealtimeEncoderDefaults to have run. Call before avcodec_open2.
+// Returns false when the encoder cannot produce format.
+bool ConfigureHardwareEncoder(AVCodecContext* cctx, const std::string& encoderName, CodecType codec, int slices,
+                              EncodeFormat format = FORMAT_YUV420);
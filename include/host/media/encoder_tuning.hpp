@@ -0,0 +1,34 @@
+#pragma once
+
+#include <string>
+
+// Sizes software encoder parallelism (threads, tiles, row-MT, SVT-AV1 lp/pin)
+// to the CPU and the stream instead of letting every encoder take all cores.
+// Portable; topology comes from the OS where available.
+
+struct CpuTopology {
+    int logicalCores = 1;
+    int physicalCores = 1;
+};
+
+[[nodiscard]] const CpuTopology& GetCpuTopology();
+
+// requested > 0 caps the encoder at that many logical cores. 0 keeps all but a
+// reserve for capture, audio and network threads: 1 core up to 4 logical cores,
+// otherwise logical/8 clamped to 2-4.
+[[nodiscard]] int ResolveCoreBudget(int requested);
+
+struct SoftwareThreadingPlan {
+    int threads = 0;            // AVCodecContext::thread_count
+    int tileColumnsLog2 = 0;    // AV1 encoders
+    int tileRowsLog2 = 0;
+    int x265Pools = 0;
+    bool rowMt = false;
+    bool pin = false;           // SVT-AV1 pin to the first `threads` cores
+};
+
+// Threads follow the stream's pixel rate (width x height x fps), capped by coreBudget;
+// SVT-AV1 is further held to the budget's share of physical cores.
+// slices > 1 fixes tile rows/slices to the requested count (SLIPSTREAM_SLICES).
+[[nodiscard]] SoftwareThreadingPlan PlanSoftwareThreading(const std::string& encoderName, int width, int height,
+                                                          int fps, int coreBudget, int slices, bool pin);
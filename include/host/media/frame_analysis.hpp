@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct TileRect {
+    int x = 0, y = 0, width = 0, height = 0;
+};
+
+struct FrameChangeInfo {
+    std::vector<TileRect> rects;
+    int changedTiles = 0, totalTiles = 0;
+    bool valid = false;
+
+    [[nodiscard]] bool IsStatic() const { return valid && changedTiles == 0; }
+    [[nodiscard]] double ChangedFraction() const {
+        return valid && totalTiles > 0 ? static_cast<double>(changedTiles) / totalTiles : 1.0;
+    }
+};
+
+[[nodiscard]] uint64_t HashTileBGRA(const uint8_t* bgra, size_t stride, int width, int height);
+
+// Compares 64x64 tiles of consecutive BGRA frames by hash. The first frame after
+// a Reset (or a size change) is reported as not valid, i.e. fully changed.
+class TileChangeDetector {
+    std::vector<uint64_t> hashes;
+    std::vector<uint8_t> changed;
+    FrameChangeInfo info;
+    int w = 0, h = 0, cols = 0, rows = 0;
+
+    void BuildRects();
+
+public:
+    static constexpr int kTileSize = 64;
+
+    const FrameChangeInfo& Analyze(const uint8_t* bgra, size_t stride, int width, int height);
+    void Reset();
+    [[nodiscard]] const FrameChangeInfo& GetLast() const { return info; }
+};
+
+enum class ContentProfile : uint8_t { Default = 0, Screen = 1 };
+
+// Fraction of sampled non-flat 8x8 blocks that use at most eight distinct colours.
+// Text and UI score high; camera and game content rarely has exact repeats.
+[[nodiscard]] double MeasureSyntheticContent(const uint8_t* bgra, size_t stride, int width, int height);
+
+class ContentClassifier {
+    double score = 0.0;
+    int confirm = 0;
+    bool primed = false;
+    ContentProfile profile = ContentProfile::Default;
+
+public:
+    static constexpr double kEnterScreen = 0.55;
+    static constexpr double kExitScreen = 0.30;
+    static constexpr int kConfirmSamples = 3;
+
+    // Returns true when the selected profile changed.
+    bool Update(double sample);
+    void Reset() { *this = {}; }
+    [[nodiscard]] ContentProfile GetProfile() const { return profile; }
+    [[nodiscard]] double GetScore() const { return score; }
+};
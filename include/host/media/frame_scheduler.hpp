@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdint>
+
+// Encoder-thread frame pacing. Captured frames are offered as they arrive; the
+// scheduler holds the one closest to the next deadline and says when to encode it.
+// Deadlines advance by exactly the frame period (so the encode rate does not drift),
+// but each is snapped to the capture cadence, a quarter vsync early, when frames
+// arrive on a regular grid. A frame presented on the vsync nearest the deadline is
+// then encoded on arrival instead of waiting out compositor jitter. Time is always
+// passed in, so the scheduler can be driven by a simulated clock.
+enum class FrameOffer : uint8_t {
+    Held,        // the new frame is now held
+    Replaced,    // the new frame is now held; release the one held before
+    Superseded,  // release the new frame; the held one is closer to the deadline
+    Dropped      // release the new frame and skip Due this round (too old, congestion skip)
+};
+
+enum class FrameDue : uint8_t {
+    Wait,    // keep the held frame
+    Encode,  // encode the held frame now
+    Stale    // release the held frame; it is too old to send
+};
+
+struct FrameSchedulerStats {
+    uint64_t offered = 0;
+    uint64_t encoded = 0;
+    uint64_t superseded = 0;
+    uint64_t tooOld = 0;
+    uint64_t congestionSkips = 0;
+    uint64_t stale = 0;
+    // Encodes forced by the late branch plus stale drops.
+    uint64_t deadlineMisses = 0;
+    // EWMA of |encoded frame interval - period| and of (encoded frame ts - ideal deadline).
+    double jitterUs = 0.0;
+    double driftUs = 0.0;
+    // Capture cadence: vsync interval in use (0 = unknown) and whether deadlines snap to it.
+    int64_t vsyncUs = 0;
+    bool aligned = false;
+};
+
+class FrameScheduler {
+    int64_t periodUs = 16667;
+    int64_t vsyncUs = 0;
+
+    // idealUs advances by periodUs; targetUs is it snapped to the capture grid, and a
+    // held frame at or after deadlineUs is on time.
+    int64_t idealUs = 0;
+    int64_t targetUs = 0;
+    int64_t deadlineUs = 0;
+
+    bool hasHeld = false;
+    int64_t heldTs = 0;
+
+    int64_t lastFrameTs = 0;
+    double cadenceErrUs = -1.0;
+
+    int congestionSkipCount = 0;
+    int congestedLayerFrames = 0;
+    int64_t congestionStartUs = 0;
+
+    int64_t lastEncodedTs = 0;
+    FrameSchedulerStats stats;
+
+    [[nodiscard]] bool Aligned() const;
+    void Retarget();
+    void TrackCadence(int64_t frameTs);
+
+public:
+    // Forgets the held frame and the deadline (streaming start, capture generation change).
+    void Reset();
+    void SetPeriod(int64_t framePeriodUs);
+    // Display refresh rate; 0 = unknown, deadlines are not snapped.
+    void SetRefreshHint(int hz);
+
+    // The caller released the held frame on its own (keyframe path, generation change).
+    void DropHeld() { hasHeld = false; }
+    // A frame was encoded outside Offer/Due (forced keyframe); the next deadline follows it.
+    void OnForcedEncode(int64_t frameTs);
+
+    // congested is the send queue state; layerPeriod is the temporal-layer cycle the
+    // encoder can shed under congestion (0 = none), encoded for that many frames
+    // before input is skipped.
+    FrameOffer Offer(int64_t frameTs, int64_t nowUs, bool congested, int layerPeriod);
+    FrameDue Due(int64_t nowUs);
+
+    [[nodiscard]] bool HasHeld() const { return hasHeld; }
+    [[nodiscard]] int64_t PeriodUs() const { return periodUs; }
+    [[nodiscard]] int64_t DeadlineUs() const { return deadlineUs; }
+    [[nodiscard]] const FrameSchedulerStats& Stats() const { return stats; }
+};
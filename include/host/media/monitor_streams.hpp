@@ -0,0 +1,69 @@
+#pragma once
+#include "host/media/capture.hpp"
+#include "host/media/encode_pool.hpp"
+#include "host/media/encoder.hpp"
+
+#include <memory>
+#include <vector>
+
+// MSG_STREAMS_INFO entry.
+struct VideoStreamInfo {
+    uint8_t id = 0;
+    uint8_t monitor = 0;
+    CodecType codec = CODEC_AV1;
+    EncodeFormat format = FORMAT_YUV420;
+    uint16_t width = 0, height = 0;
+};
+
+struct MonitorStreamCallbacks {
+    std::function<bool(uint8_t, const EncodedFrame&)> send;
+    std::function<bool(uint8_t)> needsKey;
+    std::function<void(uint8_t)> onKeySent;
+};
+
+// Monitors streamed next to the primary one, as video streams 1..MAX_VIDEO_STREAMS-1.
+// Each has its own capture session, frame slot and encoder, so switching between them
+// needs no rebuild; encoding runs on a shared EncodeWorkerPool at the focused or the
+// background rate. Stream 0 stays with the host's encoder thread.
+class MonitorStreams {
+    struct Session;
+
+    MonitorStreamCallbacks callbacks_;
+    EncodeWorkerPool pool_;
+    int maxStreams_;
+    mutable std::mutex mutex_;
+    std::vector<std::unique_ptr<Session>> sessions_;
+    CodecType codec_ = CODEC_AV1;
+    EncodeFormat format_ = FORMAT_YUV420;
+    uint8_t focused_ = 0;
+    int focusedFps_ = 60, backgroundFps_ = 10;
+    bool cursorCapture_ = false;
+
+    std::unique_ptr<Session> Open(uint8_t id, int monitor);
+    void Close(Session& session);
+    void Encode(Session& session);
+    bool BuildEncoder(Session& session);
+    [[nodiscard]] int RateOf(const Session& session) const;
+
+public:
+    // maxStreams counts stream 0.
+    MonitorStreams(MonitorStreamCallbacks callbacks, int workers, int maxStreams);
+    ~MonitorStreams();
+
+    // Streams exactly these monitors, keeping the sessions already running for any of
+    // them. Returns how many streams run.
+    size_t Set(const std::vector<int>& monitors, CodecType codec, EncodeFormat format);
+    void Clear();
+    // Drops the stream of monitor, e.g. when it becomes the primary one.
+    void RemoveMonitor(int monitor);
+    // Rebuilds the encoders; captures keep running.
+    void SetCodec(CodecType codec, EncodeFormat format);
+    // focused may be 0, in which case every stream here runs at the background rate.
+    void SetRates(uint8_t focused, int focusedFps, int backgroundFps);
+    void SetCursorCapture(bool enabled);
+    // Encodes the stream's last frame if nothing newer arrives, for a key request on a static screen.
+    void Kick(uint8_t id);
+
+    [[nodiscard]] int MonitorOf(uint8_t id) const;
+    [[nodiscard]] std::vector<VideoStreamInfo> List() const;
+};
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Quality-targeted bitrate control for encoders that accept bit_rate changes
+// between frames (NVENC, QSV, AMF). The ceiling is the
+// CalcBitrate value; the controller lowers the working bitrate while the encoder
+// reaches the target QP with bits to spare (static or simple content) and
+// returns to the ceiling as soon as QP or frame size shows motion.
+struct RateControlConfig {
+    int64_t ceilingBps = 0;
+    int64_t floorBps = 0;
+    int targetQp = 28;
+    int fps = 60;
+};
+
+class RateController {
+    RateControlConfig cfg;
+    double targetBps = 0.0;
+    int64_t appliedBps = 0;
+    double qpAvg = -1.0;
+    double bytesAvg = 0.0;
+    int framesSinceApply = 0;
+    uint64_t updates = 0;
+    double targetSum = 0.0;
+    uint64_t frames = 0;
+
+public:
+    void Reset(const RateControlConfig& config);
+
+    // qp < 0 when the encoder reports none. Returns true when the caller should
+    // apply TargetBitrate() to the encoder before the next frame.
+    bool OnFrame(size_t bytes, bool key, int qp);
+
+    [[nodiscard]] int64_t TargetBitrate() const { return appliedBps; }
+    [[nodiscard]] const RateControlConfig& Config() const { return cfg; }
+    [[nodiscard]] uint64_t UpdateCount() const { return updates; }
+    [[nodiscard]] double AverageTargetBps() const { return frames ? targetSum / static_cast<double>(frames) : 0.0; }
+};
+
+// Hardware encoders whose FFmpeg wrapper reconfigures rate control when bit_rate
+// changes. Software encoders use capped CRF instead (SupportsCappedCrf).
+[[nodiscard]] bool SupportsDynamicBitrate(const std::string& encoderName);
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <utility>
+
+// Linear encode scale steps shared with EncodeGovernor; 50% is a quarter of the pixels.
+inline constexpr int kScaleLevels[] = {100, 85, 75, 60, 50};
+inline constexpr int kMinScalePercent = 50;
+
+// Hold before the next up-step. Doubles up to its cap when a down-step follows an
+// up-step within kFailedUpStepUs, and falls back to the base once an up-step has
+// lasted kStableUpStepUs. The unit (microseconds or windows) is the caller's.
+class UpStepHold {
+    int64_t base = 0, cap = 0, hold = 0;
+    int64_t lastUpUs = 0;
+
+public:
+    static constexpr int64_t kFailedUpStepUs = 10'000'000;
+    static constexpr int64_t kStableUpStepUs = 60'000'000;
+
+    void Reset(int64_t baseHold, int64_t maxHold);
+    void OnStepDown(int64_t nowUs);
+    void OnStepUp(int64_t nowUs) { lastUpUs = nowUs; }
+    // Called while no step is wanted.
+    void OnSteady(int64_t nowUs);
+
+    [[nodiscard]] int64_t Value() const { return hold; }
+};
+
+// Picks an encode scale (percent of the resolved target, 100 down to minPercent)
+// from the bits per pixel the transport can actually deliver. Steps down after a
+// short confirmation; steps up one level at a time after a longer hold that doubles
+// whenever an up-step is followed by a down-step, so the scale does not oscillate.
+// Encode time is EncodeGovernor's job.
+struct ResolutionControlConfig {
+    // Bitrate the full-size target is encoded at (CalcBitrate).
+    int64_t fullBps = 0;
+    // Share of the full-size bits per pixel below which a smaller picture looks better.
+    double minBitrateFraction = 0.35;
+    int minPercent = 50;
+};
+
+class ResolutionController {
+    ResolutionControlConfig cfg;
+    int percent = 100;
+
+    // Transport sample window.
+    int64_t windowStartUs = 0;
+    uint64_t windowStartBytes = 0;
+    bool windowCongested = false;
+    double throughputBps = -1.0;
+
+    int downWindows = 0;
+    int64_t upSinceUs = 0;
+    UpStepHold upHold;
+    uint64_t changes = 0;
+
+    [[nodiscard]] int BandwidthPercent() const;
+
+public:
+    void Reset(const ResolutionControlConfig& config);
+    void SetFullBitrate(int64_t bps) { cfg.fullBps = bps; }
+
+    // deliveredBytes is the transport's running total of video bytes that left its
+    // send buffer; congested is the send queue state for this frame. Returns true
+    // when Percent() changed.
+    bool OnFrame(int64_t nowUs, uint64_t deliveredBytes, bool congested);
+
+    [[nodiscard]] int Percent() const { return percent; }
+    [[nodiscard]] double ThroughputBps() const { return throughputBps; }
+    [[nodiscard]] const ResolutionControlConfig& Config() const { return cfg; }
+    [[nodiscard]] uint64_t ChangeCount() const { return changes; }
+};
+
+// width/height scaled to percent, rounded up to even and never above the input.
+[[nodiscard]] std::pair<int, int> ScaleResolution(int width, int height, int percent);
+// Next kScaleLevels step above percent (100 at most), and below it (minPercent at least).
+[[nodiscard]] int NextScaleUp(int percent);
+[[nodiscard]] int NextScaleDown(int percent, int minPercent);
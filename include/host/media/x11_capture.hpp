@@ -0,0 +1,14 @@
+#pragma once
+
+#include "host/media/capture_source.hpp"
+
+// X11 screen capture for Linux hosts, over XCB. The root window is read through
+// MIT-SHM, so the server writes pixels straight into a shared segment. With XDamage,
+// Read patches only the regions damaged since bgra was filled into it, when bgra is
+// one of the last 8 buffers a Read filled and was not modified since; an empty or
+// other buffer gets a whole fetch. Changes() reports the damage since the previous
+// Read so the encode path can skip unchanged frames without hashing. Root resizes
+// are picked up from ConfigureNotify at the start of each Read.
+// Needs a 24/32-bit TrueColor root (any X server, including Xvfb; no GPU).
+// display "" uses $DISPLAY. trackDamage = false fetches the whole screen every Read.
+[[nodiscard]] std::unique_ptr<CaptureSource> OpenX11Source(const std::string& display, int rateFps = 60, bool trackDamage = true);
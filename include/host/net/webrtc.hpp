@@ -1,7 +1,9 @@
 #pragma once
 #include "host/core/common.hpp"
 #include "host/media/encoder.hpp"
+#include "host/media/monitor_streams.hpp"
 #include "host/io/input.hpp"
+#include "host/io/cursor.hpp"
 #include <array>
 #include <unordered_set>
 
@@ -19,18 +21,33 @@ struct PacketHeader {
     uint8_t frameType;
     uint8_t packetType;
     uint8_t fecGroupSize;
+    uint8_t flags;
 };
 #pragma pack(pop)
 
+// MSG_ENCODE_ADJUST payload: the host's current encode limits and the decision behind them.
+struct EncodeAdjustInfo {
+    uint8_t limits = 0;
+    // GovernorAction of the last encode-time decision.
+    uint8_t action = 0;
+    uint8_t scalePercent = 100;
+    // Encode frame rate; 0 = the client's rate.
+    uint16_t fps = 0;
+    uint32_t p95Us = 0, budgetUs = 0;
+};
+
 struct WebRTCCallbacks {
     InputHandler* input = nullptr;
     std::function<void(int, uint8_t)> onFpsChange;
     std::function<int()> getHostFps, getMonitor;
     std::function<bool(int)> onMonitorChange;
     std::function<void()> onDisconnect, onConnected;
-    std::function<bool(CodecType)> onCodecChange;
+    std::function<bool(CodecType, EncodeFormat)> onCodecChange;
     std::function<CodecType()> getCodec;
+    std::function<EncodeFormat()> getFormat;
     std::function<uint8_t()> getCodecCaps;
+    // Bit per EncodeFormat, indexed by CodecType.
+    std::function<std::array<uint8_t, 3>()> getFormatCaps;
     std::function<std::string()> getEncoderName;
     std::function<void(int, int)> onStreamTargetChange;
     std::function<std::string()> getClipboard;
@@ -38,6 +55,15 @@ struct WebRTCCallbacks {
     std::function<void(bool)> onCursorCapture, onAudioEnable, onMicEnable;
     std::function<void(const uint8_t*, size_t)> onMicData;
     std::function<void()> onSessionReset;
+    // Monitors to stream next to the primary one; getStreams lists every stream, 0 included.
+    std::function<void(const std::vector<int>&)> onStreamsSet;
+    std::function<std::vector<VideoStreamInfo>()> getStreams;
+    std::function<bool(uint8_t)> onStreamFocus;
+    std::function<void(uint8_t)> onStreamKeyRequest;
+    // MSG_AUDIO_FEEDBACK: client audio caps and the loss it saw over the last second.
+    std::function<void(uint8_t, int)> onAudioFeedback;
+    // 6-byte MSG_AUDIO_ENABLE: requested Opus frame size in samples at 48 kHz.
+    std::function<void(int)> onAudioFrameSize;
 };
 
 class WebRTCServer {
@@ -56,7 +82,10 @@ class WebRTCServer {
     std::atomic<bool> conn{false}, needsKey{true}, fpsRecv{false}, gathered{false}, hasDesc{false};
     std::atomic<int> chRdy{0}, overflow{0};
     std::atomic<int64_t> lastPing{0}, lastStatLog{0}, lastKeyReqMs{0};
-    std::atomic<uint32_t> frmId{0}, audioPktId{0};
+    std::atomic<uint32_t> audioPktId{0};
+    std::array<std::atomic<uint32_t>, MAX_VIDEO_STREAMS> frmId{};
+    // Key requests of streams 1 and up, a bit per stream id; stream 0 uses needsKey.
+    std::atomic<uint32_t> streamKeys_{0};
     std::atomic<CodecType> curCodec{CODEC_AV1};
 
     std::string localDescription_;
@@ -67,6 +96,9 @@ class WebRTCServer {
     std::queue<std::vector<uint8_t>> videoPacketQueue_, audioPacketQueue_;
     std::unordered_map<uint32_t, MicFecGroupState> micFecGroups_;
     std::unordered_set<uint32_t> micSeenPacketIds_;
+    // Cursor bitmaps this peer has been sent; later shapes refer to them by id.
+    std::unordered_set<uint32_t> sentCursorIds_;
+    std::mutex cursorMutex_;
 
     static constexpr size_t VID_BUF=262144, AUD_BUF=131072, CHUNK=1400;
     static constexpr size_t HDR_SZ=sizeof(PacketHeader), DATA_CHUNK=CHUNK-HDR_SZ, BUF_LOW=CHUNK*16;
@@ -77,18 +109,33 @@ class WebRTCServer {
     std::array<std::vector<uint8_t>, AUDIO_FEC_GROUP_SIZE> audioFecPackets_;
     uint8_t audioFecCount_ = 0;
     uint32_t audioFecGroupStart_ = 0;
+    // AUDIO_CAP_* of the client; 0 until it reports, which keeps the XOR groups.
+    std::atomic<uint8_t> audioCaps_{0};
+    std::atomic<bool> audioRedundancy_{false};
+    // Previous audio packet, repeated after the next one while redundancy is on.
+    std::vector<uint8_t> audioPrev_;
+    int64_t audioPrevTs_ = 0;
+    uint16_t audioPrevSamples_ = 0;
 
-    std::atomic<uint64_t> videoSent{0}, audioSent{0}, videoErr{0}, audioErr{0};
+    std::atomic<uint64_t> videoSent{0}, audioSent{0}, videoErr{0}, audioErr{0}, repeatSent{0}, layerDrops{0};
+    static constexpr int kNoLayerDrop = 0xFF;
+    // Lowest temporal layer being discarded; frames at or above it may reference a dropped frame.
+    std::array<std::atomic<int>, MAX_VIDEO_STREAMS> layerDropFloor_{};
     std::atomic<uint64_t> ctrlSent{0}, ctrlRecv{0}, inputRecv{0}, micRecv{0}, connCount{0};
+    // Video bytes handed to the data channel.
+    std::atomic<uint64_t> videoBytes_{0};
     std::atomic<uint64_t> peerEpoch{0};
     std::atomic<bool> videoDrainActive_{false}, audioDrainActive_{false};
 
     bool SendCtrl(const void* d, size_t len);
+    bool SendCursorImage(const CursorImage& image);
     void SendHostInfo();
     void SendEncoderInfo();
     void SendMonitorList();
     void SendCodecCaps();
     void SendVersion();
+    void SendStreamList();
+    void RequestStreamKeyframes() { streamKeys_.store(~1u, std::memory_order_release); }
     void HandleCtrl(const rtc::binary& m);
     void HandleInput(const rtc::binary& m);
     void HandleMic(const rtc::binary& m);
@@ -120,9 +167,26 @@ public:
     [[nodiscard]] bool NeedsKey() const { return needsKey.load(std::memory_order_acquire); }
     void RequestKeyframe() { needsKey.store(true, std::memory_order_release); }
     void OnKeyframeSent() { needsKey.store(false, std::memory_order_release); }
+    [[nodiscard]] bool StreamNeedsKey(uint8_t stream) const {
+        return stream == 0 ? NeedsKey() : (streamKeys_.load(std::memory_order_acquire) >> stream) & 1u;
+    }
+    void OnStreamKeyframeSent(uint8_t stream) {
+        if (stream == 0) OnKeyframeSent();
+        else streamKeys_.fetch_and(~(1u << stream), std::memory_order_acq_rel);
+    }
     [[nodiscard]] bool IsCongested() const;
-    [[nodiscard]] bool SendCursorShape(CursorType ct);
-    [[nodiscard]] bool Send(const EncodedFrame& f);
+    // Running total of video bytes that have left the data channel's send buffer.
+    [[nodiscard]] uint64_t GetVideoBytesDelivered() const;
+    // Sends the bitmap first if this peer has not had it; image may be nullptr.
+    [[nodiscard]] bool SendCursorShape(CursorType ct, const CursorImage* image);
+    // On the input channel, which otherwise only carries client input; x, y are 0..1
+    // on the captured monitor. Skipped while the channel is backed up.
+    bool SendCursorPos(float nx, float ny, bool visible);
+    bool SendEncodeAdjust(const EncodeAdjustInfo& info);
+    // stream is the video stream id (0 = primary); only stream 0 checks for a stale peer.
+    [[nodiscard]] bool Send(const EncodedFrame& f, uint8_t stream = 0);
     [[nodiscard]] bool SendAudio(const std::vector<uint8_t>& data, int64_t ts, int samples);
+    // Only takes effect for clients that report AUDIO_CAP_REDUNDANCY.
+    void SetAudioRedundancy(bool enabled) { audioRedundancy_.store(enabled, std::memory_order_release); }
     void GetStats(uint64_t& vS, uint64_t& vE, uint64_t& aS, uint64_t& aE, uint64_t& c);
 };
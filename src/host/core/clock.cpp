@@ -0,0 +1,90 @@
+#include "host/core/clock.hpp"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+namespace {
+    // High 64 bits of a * b.
+    uint64_t MulHigh64(uint64_t a, uint64_t b) {
+#if defined(__SIZEOF_INT128__)
+        return static_cast<uint64_t>((static_cast<unsigned __int128>(a) * b) >> 64);
+#else
+        const uint64_t aLo = a & 0xFFFFFFFFu, aHi = a >> 32;
+        const uint64_t bLo = b & 0xFFFFFFFFu, bHi = b >> 32;
+        const uint64_t lo = aLo * bLo;
+        const uint64_t mid1 = aHi * bLo + (lo >> 32);
+        const uint64_t mid2 = aLo * bHi + (mid1 & 0xFFFFFFFFu);
+        return aHi * bHi + (mid1 >> 32) + (mid2 >> 32);
+#endif
+    }
+
+    // ticks * 1e6 / frequency as one multiply: scale = floor(1e6 * 2^64 / frequency).
+    // Exact to well under a microsecond for any uptime, where the old
+    // (ticks * 1000000) / frequency overflowed after ~10 days at 10 MHz.
+    struct TickScale {
+        int64_t frequency = 1;
+        uint64_t scale = 0;  // 0: frequency <= 1 MHz, divide instead
+
+        explicit TickScale(int64_t freq) : frequency(freq > 0 ? freq : 1) {
+            const uint64_t f = static_cast<uint64_t>(frequency);
+            if (f <= 1000000u || f >= (1ull << 63)) return;
+            uint64_t rem = 1000000u;
+            for (int bit = 0; bit < 64; ++bit) {
+                rem <<= 1;
+                scale <<= 1;
+                if (rem >= f) { rem -= f; scale |= 1; }
+            }
+        }
+
+        [[nodiscard]] int64_t ToUs(int64_t ticks) const {
+            if (ticks < 0) return -ToUs(-ticks);
+            if (scale != 0) return static_cast<int64_t>(MulHigh64(static_cast<uint64_t>(ticks), scale));
+            return (ticks / frequency) * 1000000 + (ticks % frequency) * 1000000 / frequency;
+        }
+    };
+
+#if defined(_WIN32)
+    const TickScale& SystemScale() {
+        static const TickScale scale = [] {
+            LARGE_INTEGER f{};
+            QueryPerformanceFrequency(&f);
+            return TickScale(static_cast<int64_t>(f.QuadPart));
+        }();
+        return scale;
+    }
+#endif
+}
+
+#if defined(_WIN32)
+
+int64_t ReadSystemClockUs() {
+    LARGE_INTEGER counter{};
+    QueryPerformanceCounter(&counter);
+    return SystemScale().ToUs(static_cast<int64_t>(counter.QuadPart));
+}
+
+int64_t SystemTicksToUs(int64_t ticks) {
+    return SystemScale().ToUs(ticks);
+}
+
+#else
+
+// CLOCK_MONOTONIC_RAW is not slewed by NTP, like QPC.
+int64_t ReadSystemClockUs() {
+    timespec ts{};
+#if defined(CLOCK_MONOTONIC_RAW)
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+#else
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+    return static_cast<int64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+int64_t SystemTicksToUs(int64_t ticks) {
+    return ticks / 1000;
+}
+
+#endif
@@ -0,0 +1,64 @@
+#include "host/core/wait_word.hpp"
+
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__linux__)
+#include <cerrno>
+#include <climits>
+#include <ctime>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#else
+#include <chrono>
+#include <thread>
+#endif
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "WaitWord needs a plain 32-bit word");
+
+#if defined(_WIN32)
+
+bool WaitWord(std::atomic<uint32_t>& word, uint32_t expected, int timeoutMs) {
+    if (word.load(std::memory_order_acquire) != expected) return true;
+    const DWORD ms = timeoutMs < 0 ? INFINITE : static_cast<DWORD>(timeoutMs);
+    if (WaitOnAddress(&word, &expected, sizeof(expected), ms)) return true;
+    return GetLastError() != ERROR_TIMEOUT;
+}
+
+void WakeWord(std::atomic<uint32_t>& word) {
+    WakeByAddressAll(&word);
+}
+
+#elif defined(__linux__)
+
+bool WaitWord(std::atomic<uint32_t>& word, uint32_t expected, int timeoutMs) {
+    if (word.load(std::memory_order_acquire) != expected) return true;
+    timespec timeout{};
+    if (timeoutMs >= 0) {
+        timeout.tv_sec = timeoutMs / 1000;
+        timeout.tv_nsec = static_cast<long>(timeoutMs % 1000) * 1000000L;
+    }
+    const long r = syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT_PRIVATE, expected,
+        timeoutMs >= 0 ? &timeout : nullptr, nullptr, 0);
+    return r == 0 || errno != ETIMEDOUT;
+}
+
+void WakeWord(std::atomic<uint32_t>& word) {
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+}
+
+#else
+
+// No address wait: poll at 100 us, which only matters for the offline tools.
+bool WaitWord(std::atomic<uint32_t>& word, uint32_t expected, int timeoutMs) {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    while (word.load(std::memory_order_acquire) == expected) {
+        if (timeoutMs >= 0 && std::chrono::steady_clock::now() >= deadline) return false;
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    return true;
+}
+
+void WakeWord(std::atomic<uint32_t>&) {}
+
+#endif
@@ -5,6 +5,11 @@
 #include "host/media/capture.hpp"
 #include "host/core/common.hpp"
 #include "host/media/encoder.hpp"
+#include "host/media/encode_governor.hpp"
+#include "host/media/frame_scheduler.hpp"
+#include "host/media/monitor_streams.hpp"
+#include "host/media/resolution_controller.hpp"
+#include "host/io/cursor.hpp"
 #include "host/io/input.hpp"
 #include "host/io/tray.hpp"
 #include "host/net/port_mapper.hpp"
@@ -114,14 +119,14 @@ class WiggleManager {
             std::this_thread::sleep_for(std::chrono::milliseconds(50));
             auto requestTimestampMs = lastRequestTimestampMs_.load(std::memory_order_acquire);
             if (requestTimestampMs <= 0) continue;
-            auto now = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+            const int64_t now = GetTimestamp() / 1000;
             if (now - requestTimestampMs >= 100) { lastRequestTimestampMs_.store(0, std::memory_order_release); input_.WiggleCenter(); }
         }
     }
 public:
     WiggleManager(std::atomic<bool>& r, InputHandler& i) : running_(r), input_(i), worker_([this] { Run(); }) {}
     ~WiggleManager() { if (worker_.joinable()) worker_.join(); }
-    void Request() { lastRequestTimestampMs_.store(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count(), std::memory_order_release); }
+    void Request() { lastRequestTimestampMs_.store(GetTimestamp() / 1000, std::memory_order_release); }
 };
 
 class OfferProcessingGate {
@@ -163,8 +168,7 @@ public:
 
 private:
     static int64_t NowMs() {
-        return std::chrono::duration_cast<std::chrono::milliseconds>(
-            std::chrono::steady_clock::now().time_since_epoch()).count();
+        return GetTimestamp() / 1000;
     }
 
     std::atomic<uint64_t> ownerToken_{0};
@@ -224,7 +228,7 @@ void RegisterStaticRoutes(httplib::SSLServer& server) {
     RegisterStaticAsset(server, "/styles.css", "text/css", "styles.css");
     RegisterStaticAsset(server, "/SlipStream.ico", "image/x-icon", "SlipStream.ico");
 
-    constexpr std::array<const char*, 12> kJsModules = {"constants", "input", "media", "network", "renderer", "state", "ui", "mic", "auth", "protocol", "audio-worklet", "mic-worklet"};
+    constexpr std::array<const char*, 13> kJsModules = {"constants", "input", "media", "network", "renderer", "state", "ui", "mic", "auth", "protocol", "streams", "audio-worklet", "mic-worklet"};
     for (const auto* module : kJsModules) {
         RegisterStaticAsset(server,
             std::string("/js/") + module + ".js",
@@ -335,28 +339,37 @@ std::thread StartEncoderThread(
     FrameSlot& frameSlot,
     ScreenCapture& capture,
     const std::shared_ptr<WebRTCServer>& webrtcServer,
+    InputHandler& input,
     std::atomic<bool>& running,
     std::mutex& encoderMutex,
     std::unique_ptr<VideoEncoder>& encoder,
     std::atomic<bool>& encoderReady,
     std::atomic<int64_t>& lastEncodeTs,
-    std::atomic<int>& targetFps) {
+    std::atomic<int>& targetFps,
+    const std::function<void(int64_t, int64_t)>& onEncodeSample,
+    const std::function<void()>& onEncoderLost) {
     return std::thread([&] {
         SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL);
 
         FrameData currentFrame;
         FrameData pendingFrame;
+        FrameScheduler scheduler;
 
         bool wasStreaming = false;
-        bool hasPendingFrame = false;
 
         int64_t framePeriodUs = kFallbackFramePeriodUs;
-        int64_t nextTs = 0;
+        int64_t staticSinceUs = 0;
+        uint64_t idleEnterCount = 0;
+        const int idleFps = GetEnvInt("SLIPSTREAM_IDLE_FPS", 20, 0, 240);
+        const int64_t idleAfterUs = static_cast<int64_t>(GetEnvInt("SLIPSTREAM_IDLE_AFTER_MS", 500, 0, 60000)) * 1000;
         uint64_t lastGeneration = frameSlot.GetGeneration();
+        uint64_t statsLoggedAt = 0;
 
-        auto freePending = [&] { frameSlot.MarkReleased(pendingFrame.poolIdx); pendingFrame.Release(); hasPendingFrame = false; };
+        // pendingFrame is set exactly while the scheduler holds a frame.
+        auto releasePending = [&] { frameSlot.MarkReleased(pendingFrame.poolIdx); pendingFrame.Release(); };
+        auto freePending = [&] { if (scheduler.HasHeld()) { releasePending(); scheduler.DropHeld(); } };
         auto freeCurrent = [&] { frameSlot.MarkReleased(currentFrame.poolIdx); currentFrame.Release(); };
-        auto promoteCurrent = [&] { pendingFrame = currentFrame; currentFrame = {}; hasPendingFrame = true; };
+        auto promoteCurrent = [&] { pendingFrame = currentFrame; currentFrame = {}; };
         auto loadTargetFps = [&] { int fps = targetFps.load(std::memory_order_acquire); return fps > 0 ? fps : 60; };
 
         while (running.load(std::memory_order_acquire)) {
@@ -371,9 +384,10 @@ std::thread StartEncoderThread(
             const uint64_t currentGeneration = frameSlot.GetGeneration();
 
             if (currentGeneration != lastGeneration) {
-                if (hasPendingFrame) freePending();
+                freePending();
+                scheduler.Reset();
+                scheduler.SetRefreshHint(capture.GetHostFPS());
                 lastGeneration = currentGeneration;
-                nextTs = 0;
             }
 
             if (currentFrame.generation != currentGeneration) { freeCurrent(); continue; }
@@ -389,8 +403,10 @@ std::thread StartEncoderThread(
 
                 framePeriodUs = 1000000 / loadTargetFps();
                 lastEncodeTs.store(0, std::memory_order_release);
-                nextTs = 0;
-                if (hasPendingFrame) freePending();
+                staticSinceUs = 0;
+                freePending();
+                scheduler.Reset();
+                scheduler.SetRefreshHint(capture.GetHostFPS());
             }
 
             wasStreaming = isStreaming;
@@ -405,15 +421,15 @@ std::thread StartEncoderThread(
             }
 
             framePeriodUs = 1000000 / loadTargetFps();
+            if (idleFps > 0 && staticSinceUs > 0 && now - staticSinceUs >= idleAfterUs) {
+                framePeriodUs = std::max<int64_t>(framePeriodUs, 1000000 / idleFps);
+            }
+            scheduler.SetPeriod(framePeriodUs);
 
             bool needsKeyFrame = SafeCall("EncoderThread: Exception checking NeedsKey", true, [&] {
                 return webrtcServer->NeedsKey();
             });
 
-            if (nextTs == 0) {
-                nextTs = currentFrame.ts;
-            }
-
             const auto encodeAndSend = [&](FrameData& frame, bool forceKey) {
                 if (frame.needsSync && !capture.WaitReady(frame.fence)) {
                     WARN("EncoderThread: GPU fence not ready (ts=%lld, forceKey=%d) - frame dropped",
@@ -421,23 +437,44 @@ std::thread StartEncoderThread(
                     return false;
                 }
 
+                float cursorNx = 0.0f, cursorNy = 0.0f;
+                const bool cursorVisible = input.GetCursorPosition(cursorNx, cursorNy);
+                // Encode time of the frame just sent; -1 for repeats and keyframes, 0 if nothing was sent.
+                int64_t sampleEncUs = 0;
+                bool encoderLost = false;
+
                 try {
                     std::lock_guard<std::mutex> lock(encoderMutex);
                     if (encoder && webrtcServer->IsStreaming()) {
-                        auto* encoded = encoder->Encode(frame.tex, frame.ts, frame.sourceTs, forceKey);
+                        encoder->SetCursorHint(cursorVisible, cursorNx, cursorNy);
+                        auto encoded = encoder->Encode(frame.tex, frame.ts, frame.sourceTs, forceKey);
                         if (encoded) {
                             if (webrtcServer->Send(*encoded)) {
+                                sampleEncUs = encoded->isRepeat || encoded->isKey ? -1 : encoded->encUs;
                                 if (encoded->isKey) {
                                     webrtcServer->OnKeyframeSent();
                                 }
+                                if (!encoded->isRepeat) {
+                                    if (staticSinceUs > 0 && frame.ts - staticSinceUs >= idleAfterUs) {
+                                        DBG("EncoderThread: Motion resumed after %lldus idle", frame.ts - staticSinceUs);
+                                    }
+                                    staticSinceUs = 0;
+                                } else if (staticSinceUs == 0) {
+                                    staticSinceUs = frame.ts;
+                                    if (++idleEnterCount == 1 || idleEnterCount % 100 == 0) {
+                                        DBG("EncoderThread: Static content detected (#%llu, idleFps=%d)", idleEnterCount, idleFps);
+                                    }
+                                }
                                 lastEncodeTs.store(frame.ts, std::memory_order_release);
                             } else {
+                                encoder->OnSendFailed();
                                 WARN("EncoderThread: WebRTC Send failed (ts=%lld, key=%d, size=%zu)",
-                                    encoded->ts, encoded->isKey ? 1 : 0, encoded->data.size());
+                                    encoded->ts, encoded->isKey ? 1 : 0, encoded->size);
                             }
                         } else {
                             DBG("EncoderThread: Encode returned null (ts=%lld, forceKey=%d) - frame dropped by encoder",
                                 frame.ts, forceKey ? 1 : 0);
+                            encoderLost = encoder->NeedsRebuild();
                         }
                     } else {
                         DBG("EncoderThread: Skipping encode - encoder=%s streaming=%s",
@@ -467,78 +504,64 @@ std::thread StartEncoderThread(
                     ERR("EncoderThread: Unknown exception waiting for encode completion");
                 }
 
+                if (encoderLost && onEncoderLost) {
+                    SafeCall("EncoderThread: Exception rebuilding encoder", [&] { onEncoderLost(); });
+                }
+                if (sampleEncUs != 0 && onEncodeSample) {
+                    SafeCall("EncoderThread: Exception in encode sample", [&] { onEncodeSample(sampleEncUs, framePeriodUs); });
+                }
+
                 return true;
             };
 
             if (needsKeyFrame) {
-                if (hasPendingFrame) freePending();
-                if (encodeAndSend(currentFrame, true)) nextTs = currentFrame.ts + framePeriodUs;
+                freePending();
+                if (encodeAndSend(currentFrame, true)) scheduler.OnForcedEncode(currentFrame.ts);
                 freeCurrent();
                 continue;
             }
 
-            // Backpressure: skip encoding when the network send queue is congested
-            static int congestionSkipCount = 0;
-            static int64_t congestionStartUs = 0;
-            bool congested = SafeCall("EncoderThread: Exception checking congestion state", false, [&] {
+            // Backpressure: the scheduler skips input while the network send queue is congested
+            const bool congested = SafeCall("EncoderThread: Exception checking congestion state", false, [&] {
                 return webrtcServer->IsCongested();
             });
-            if (congested && !needsKeyFrame) {
-                if (congestionSkipCount == 0) congestionStartUs = GetTimestamp();
-                congestionSkipCount++;
-                if (congestionSkipCount == 1 || congestionSkipCount % 10 == 0) {
-                    DBG("EncoderThread: Congestion skip #%d (ts=%lld, duration=%lldus)",
-                        congestionSkipCount, currentFrame.ts, GetTimestamp() - congestionStartUs);
-                }
-                DBG("EncoderThread: Network congested, skipping frame (ts=%lld)", currentFrame.ts);
-                freeCurrent();
-                // Advance nextTs so we don't try to catch up and flood the queue further
-                while (nextTs < currentFrame.ts) nextTs += framePeriodUs;
-                continue;
-            } else if (!congested && congestionSkipCount > 0) {
-                LOG("EncoderThread: Congestion cleared after %d skipped frames (%lldus total)",
-                    congestionSkipCount, GetTimestamp() - congestionStartUs);
-                congestionSkipCount = 0;
-            }
+            // With temporal layers, Send drops the enhancement frames while congested, so the
+            // scheduler keeps encoding for one layer period before it skips input.
+            const int layerPeriod = congested ? SafeCall("EncoderThread: Exception reading temporal layers", 0, [&] {
+                std::lock_guard<std::mutex> lock(encoderMutex);
+                return encoder && encoder->GetTemporalLayers() > 1 ? 1 << (encoder->GetTemporalLayers() - 1) : 0;
+            }) : 0;
 
-            if (currentFrame.ts - nextTs < -framePeriodUs * 3 / 2) {
-                DBG("EncoderThread: Frame too old (ts=%lld nextTs=%lld delta=%lld framePeriod=%lld) - dropping",
-                    currentFrame.ts, nextTs, currentFrame.ts - nextTs, framePeriodUs);
-                freeCurrent();
-                continue;
+            if (scheduler.HasHeld() && pendingFrame.generation != currentGeneration) freePending();
+
+            switch (scheduler.Offer(currentFrame.ts, now, congested, layerPeriod)) {
+            case FrameOffer::Held: promoteCurrent(); break;
+            case FrameOffer::Replaced: releasePending(); promoteCurrent(); break;
+            case FrameOffer::Superseded: freeCurrent(); break;
+            case FrameOffer::Dropped: freeCurrent(); continue;
             }
 
-            if (hasPendingFrame) {
-                if (pendingFrame.generation != currentGeneration) freePending();
-                if (hasPendingFrame) {
-                    if (std::abs(currentFrame.ts - nextTs) < std::abs(pendingFrame.ts - nextTs)) {
-                        freePending();
-                        promoteCurrent();
-                    } else { freeCurrent(); }
-                } else { promoteCurrent(); }
-            } else { promoteCurrent(); }
-
-            if (hasPendingFrame && (pendingFrame.ts >= nextTs || now >= nextTs + framePeriodUs / 2)) {
-                if (pendingFrame.generation != frameSlot.GetGeneration()) { freePending(); continue; }
-
-                if (now - pendingFrame.ts > framePeriodUs * 2) {
-                    DBG("EncoderThread: Pending frame too stale (age=%lldus, limit=%lldus, ts=%lld) - dropping",
-                        now - pendingFrame.ts, framePeriodUs * 2, pendingFrame.ts);
-                    freePending();
-                    while (nextTs < now - framePeriodUs) nextTs += framePeriodUs;
-                    continue;
-                }
+            if (scheduler.HasHeld() && pendingFrame.generation != frameSlot.GetGeneration()) { freePending(); continue; }
 
+            switch (scheduler.Due(now)) {
+            case FrameDue::Wait: break;
+            case FrameDue::Stale: releasePending(); break;
+            case FrameDue::Encode:
                 encodeAndSend(pendingFrame, false);
-                freePending();
-                nextTs += framePeriodUs;
-                if (nextTs < now - framePeriodUs * 2) {
-                    nextTs = now;
-                }
+                releasePending();
+                break;
+            }
+
+            const auto& stats = scheduler.Stats();
+            if (stats.encoded - statsLoggedAt >= 3600) {
+                statsLoggedAt = stats.encoded;
+                DBG("EncoderThread: Pacing encoded=%llu misses=%llu stale=%llu tooOld=%llu jitter=%.0fus drift=%.0fus aligned=%d",
+                    stats.encoded, stats.deadlineMisses, stats.stale, stats.tooOld, stats.jitterUs, stats.driftUs,
+                    stats.aligned ? 1 : 0);
             }
         }
 
-        if (hasPendingFrame) freePending();
+        freePending();
     });
 }
 
@@ -632,6 +655,8 @@ bool StartWorkerThreads(
     std::atomic<bool>& encoderReady,
     std::atomic<int64_t>& lastEncodeTs,
     std::atomic<int>& targetFps,
+    const std::function<void(int64_t, int64_t)>& onEncodeSample,
+    const std::function<void()>& onEncoderLost,
     std::unique_ptr<AudioCapture>& audioCapture,
     WorkerThreads& threads) {
     const bool bound = server.bind_to_port("0.0.0.0", kHttpsPort);
@@ -655,7 +680,8 @@ bool StartWorkerThreads(
                 continue;
             }
 
-            if (audioCapture->PopPacket(packet, 5)) {
+            // Woken by the capture thread for every packet; the timeout only rechecks state.
+            if (audioCapture->PopPacket(packet)) {
                 SafeCall("AudioThread: Exception sending audio", [&] {
                     bool sent = webrtcServer->SendAudio(packet.data, packet.ts, packet.samples);
                     if (!sent) {
@@ -667,24 +693,50 @@ bool StartWorkerThreads(
         }
     });
 
-    threads.cursorThread = StartThreadWithPriority(THREAD_PRIORITY_BELOW_NORMAL, [&input, &cursorCapture, webrtcServer, &app] {
+    // Sends the cursor for the client to draw: the shape (with its bitmap the first
+    // time) when it changes and the position whenever it moves, polled at input rate.
+    threads.cursorThread = StartThreadWithPriority(THREAD_PRIORITY_NORMAL, [&input, &cursorCapture, webrtcServer, &app] {
+        const int64_t periodUs = 1000000 / GetEnvInt("SLIPSTREAM_CURSOR_HZ", 120, 10, 500);
+        CursorTracker tracker;
+        CursorSample sent;
+        bool active = false, posSent = false;
+        int64_t nextUs = GetTimestamp();
         while (app.running.load(std::memory_order_acquire)) {
             if (!webrtcServer->IsStreaming() || cursorCapture.load(std::memory_order_acquire)) {
+                active = false;
                 std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                nextUs = GetTimestamp();
                 continue;
             }
+            if (!active) {
+                // New client, or the cursor left the video again: start from scratch.
+                tracker.Invalidate();
+                active = true;
+                posSent = false;
+            }
 
-            CursorType cursor{};
-            if (input.GetCurrentCursor(cursor)) {
+            CursorSample cursor;
+            if (tracker.Poll(input, cursor)) {
                 SafeCall("CursorThread: Exception sending cursor", [&] {
-                    bool sent = webrtcServer->SendCursorShape(cursor);
-                    if (!sent) {
+                    if (!webrtcServer->SendCursorShape(cursor.type, cursor.image)) {
                         DBG("CursorThread: SendCursorShape returned false");
                     }
                 });
             }
+            const bool moved = cursor.visible != sent.visible || (cursor.visible && (cursor.x != sent.x || cursor.y != sent.y));
+            if (!posSent || moved) {
+                SafeCall("CursorThread: Exception sending cursor position", [&] {
+                    if (webrtcServer->SendCursorPos(cursor.x, cursor.y, cursor.visible)) {
+                        sent = cursor;
+                        posSent = true;
+                    }
+                });
+            }
 
-            std::this_thread::sleep_for(std::chrono::milliseconds(33));
+            nextUs += periodUs;
+            const int64_t now = GetTimestamp();
+            if (nextUs <= now) nextUs = now;
+            else std::this_thread::sleep_for(std::chrono::microseconds(nextUs - now));
         }
     });
 
@@ -692,12 +744,15 @@ bool StartWorkerThreads(
         frameSlot,
         capture,
         webrtcServer,
+        input,
         app.running,
         encoderMutex,
         encoder,
         encoderReady,
         lastEncodeTs,
-        targetFps);
+        targetFps,
+        onEncodeSample,
+        onEncoderLost);
 
     return true;
 }
@@ -752,6 +807,8 @@ int RunHostApp(int argc, char* argv[]) {
         }
 
         SetPriorityClass(GetCurrentProcess(), ABOVE_NORMAL_PRIORITY_CLASS);
+        // Optional curve fitted by slipstream_quality; built-in factors apply otherwise.
+        LoadBitrateModel(GetSlipStreamDataFilePath("bitrate_model.json"));
         const auto localIpAddresses = GetLocalIPv4Addresses();
 
         FrameSlot frameSlot;
@@ -763,10 +820,24 @@ int RunHostApp(int argc, char* argv[]) {
             webrtcServer->IsIceTcpEnabled());
         ScreenCapture capture(&frameSlot);
 
+        // Extra monitors streamed beside the primary one; the focused stream gets the
+        // client's frame rate and the others the background rate.
+        const int backgroundFps = GetEnvInt("SLIPSTREAM_BACKGROUND_FPS", 10, 1, 60);
+        MonitorStreams monitorStreams(MonitorStreamCallbacks{
+                [&](uint8_t stream, const EncodedFrame& frame) { return webrtcServer->Send(frame, stream); },
+                [&](uint8_t stream) { return webrtcServer->StreamNeedsKey(stream); },
+                [&](uint8_t stream) { webrtcServer->OnStreamKeyframeSent(stream); }},
+            GetEnvInt("SLIPSTREAM_ENCODE_WORKERS", 2, 1, 8),
+            GetEnvInt("SLIPSTREAM_MAX_STREAMS", 4, 1, MAX_VIDEO_STREAMS));
+        std::atomic<uint8_t> focusedStream{0};
+
         std::mutex encoderMutex;
         std::unique_ptr<VideoEncoder> encoder;
         std::atomic<bool> encoderReady{false};
         std::atomic<CodecType> currentCodec{CODEC_AV1};
+        // Requested by the client; currentFormat is what the active encoder produces.
+        std::atomic<EncodeFormat> requestedFormat{FORMAT_YUV420};
+        std::atomic<EncodeFormat> currentFormat{FORMAT_YUV420};
         std::mutex encoderInfoMutex;
         std::string activeEncoderName;
         std::atomic<int> clientTargetWidth{0};
@@ -780,12 +851,32 @@ int RunHostApp(int argc, char* argv[]) {
 
         WiggleManager wiggle(app.running, input);
 
+        VideoEncoder::Calibrate(capture.GetDev(), capture.GetW(), capture.GetH(), capture.GetHostFPS());
         const uint8_t codecCaps = VideoEncoder::ProbeSupport(capture.GetDev());
         const uint8_t hardwareCodecCaps = VideoEncoder::ProbeHardwareSupport(capture.GetDev());
         LOG("Codec support: AV1=%d H265=%d H264=%d", (codecCaps & 1) ? 1 : 0, (codecCaps & 2) ? 1 : 0, (codecCaps & 4) ? 1 : 0);
+        std::array<uint8_t, 3> formatCaps{};
+        const bool extendedFormats = GetEnvBool("SLIPSTREAM_EXTENDED_FORMATS", true);
+        for (int c = 0; c <= 2; c++) {
+            if (!(codecCaps & (1 << c))) continue;
+            formatCaps[c] = extendedFormats
+                ? VideoEncoder::ProbeFormatSupport(capture.GetDev(), static_cast<CodecType>(c), hardwareCodecCaps & (1 << c))
+                : static_cast<uint8_t>(1 << FORMAT_YUV420);
+        }
+        LOG("Format support (bit0=4:2:0 bit1=4:4:4 bit2=10-bit): AV1=0x%X H265=0x%X H264=0x%X",
+            formatCaps[0], formatCaps[1], formatCaps[2]);
 
         std::unique_ptr<AudioCapture> audioCapture;
         try { audioCapture = std::make_unique<AudioCapture>(); } catch (...) { WARN("AudioCapture init failed"); }
+        AudioProtectionConfig audioProtectionConfig;
+        audioProtectionConfig.bitrate = GetEnvInt("SLIPSTREAM_AUDIO_BITRATE", 96000, 24000, 256000);
+        audioProtectionConfig.minBitrate = GetEnvInt("SLIPSTREAM_AUDIO_MIN_BITRATE", 48000, 12000, 256000);
+        audioProtectionConfig.dtx = GetEnvBool("SLIPSTREAM_AUDIO_DTX", true);
+        audioProtectionConfig.inbandFec = GetEnvBool("SLIPSTREAM_AUDIO_INBAND_FEC", false);
+        audioProtectionConfig.dredMs = GetEnvInt("SLIPSTREAM_AUDIO_DRED_MS", 0, 0, 1000);
+        AudioLossController audioLoss(audioProtectionConfig);
+        std::mutex audioLossMutex;
+        if (audioCapture) audioCapture->SetProtection(audioLoss.Current());
         std::unique_ptr<MicPlayback> micPlayback;
         try { micPlayback = std::make_unique<MicPlayback>("CABLE Input"); } catch (...) { LOG("MicPlayback not available"); }
 
@@ -801,6 +892,10 @@ int RunHostApp(int argc, char* argv[]) {
                 activeEncoder ? activeEncoder->GetActiveEncoderName().c_str() : "unknown");
         };
 
+        // Encode-time governor preset lever (see EncodeGovernor), kept across rebuilds.
+        std::atomic<bool> governorFastPreset{false};
+        std::atomic<bool> encoderHasFasterPreset{false};
+
         auto createEncoder = [&](int width, int height, int fps, CodecType codec) {
             auto nextEncoder = std::make_unique<VideoEncoder>(
                 width,
@@ -809,8 +904,12 @@ int RunHostApp(int argc, char* argv[]) {
                 capture.GetDev(),
                 capture.GetCtx(),
                 capture.GetMT(),
-                codec);
+                codec,
+                requestedFormat.load(std::memory_order_acquire));
             currentCodec.store(codec, std::memory_order_release);
+            currentFormat.store(nextEncoder->GetFormat(), std::memory_order_release);
+            encoderHasFasterPreset.store(nextEncoder->HasFasterPreset(), std::memory_order_release);
+            if (governorFastPreset.load(std::memory_order_acquire)) nextEncoder->SetFastPreset(true);
             updateEncoderInfo(codec, nextEncoder.get());
             return nextEncoder;
         };
@@ -838,8 +937,45 @@ int RunHostApp(int argc, char* argv[]) {
             }
         };
 
-        auto rebuildResolvedEncoder = [&](int fps, CodecType codec, const char* reason) -> bool {
+        // Adaptive resolution: ResolutionController's scale, in percent of the resolved
+        // target. The encode-time governor has its own scale, the frame-rate cap and the
+        // encoder preset. The encoder is built at the smaller of the two scales.
+        const bool adaptiveResolution = GetEnvBool("SLIPSTREAM_ADAPTIVE_RESOLUTION", true);
+        const int adaptiveMinScale = GetEnvInt("SLIPSTREAM_ADAPTIVE_MIN_SCALE", 50, 50, 100);
+        const bool encodeGovernorEnabled = GetEnvBool("SLIPSTREAM_ENCODE_GOVERNOR", true);
+        const int governorMinFps = GetEnvInt("SLIPSTREAM_GOVERNOR_MIN_FPS", 30, 1, 240);
+        std::mutex adaptMutex;
+        ResolutionController resolutionController;
+        EncodeGovernor governor;
+        std::atomic<int> bandwidthScale{100};
+        std::atomic<int> governorScale{100};
+        std::atomic<int> governorFpsCap{0};
+        std::atomic<int> clientFps{60};
+        auto resetAdaptiveResolution = [&] {
+            std::lock_guard<std::mutex> lock(adaptMutex);
+            ResolutionControlConfig config;
+            config.minPercent = adaptiveMinScale;
+            resolutionController.Reset(config);
+            GovernorConfig governorConfig;
+            governorConfig.requestedFps = clientFps.load(std::memory_order_acquire);
+            governorConfig.minFps = governorMinFps;
+            governorConfig.minScalePercent = adaptiveMinScale;
+            governor.Reset(governorConfig);
+            bandwidthScale.store(100, std::memory_order_release);
+            governorScale.store(100, std::memory_order_release);
+            governorFpsCap.store(0, std::memory_order_release);
+            governorFastPreset.store(false, std::memory_order_release);
+        };
+        resetAdaptiveResolution();
+        auto adaptiveEncodeTarget = [&] {
             const auto [targetWidth, targetHeight] = resolveEncodeTarget();
+            return ScaleResolution(targetWidth, targetHeight, std::min(
+                bandwidthScale.load(std::memory_order_acquire),
+                governorScale.load(std::memory_order_acquire)));
+        };
+
+        auto rebuildResolvedEncoder = [&](int fps, CodecType codec, const char* reason) -> bool {
+            const auto [targetWidth, targetHeight] = adaptiveEncodeTarget();
             if (targetWidth <= 0 || targetHeight <= 0) {
                 ERR("Invalid encode target size resolved for %s", reason ? reason : "unknown");
                 return false;
@@ -861,17 +997,121 @@ int RunHostApp(int argc, char* argv[]) {
             return rebuildEncoder(targetWidth, targetHeight, fps, codec);
         };
 
+        // Moves the encoder to the current adaptive target. None of the encoders can
+        // change the coded size of an open session, so a new size means a rebuild and a
+        // keyframe; a target that still matches the coded size keeps the stream.
+        auto retargetEncoder = [&](int fps, const char* reason) -> bool {
+            const auto [targetWidth, targetHeight] = adaptiveEncodeTarget();
+            {
+                std::lock_guard<std::mutex> lock(encoderMutex);
+                if (encoder && encoder->GetWidth() == targetWidth && encoder->GetHeight() == targetHeight) return true;
+            }
+            if (!rebuildResolvedEncoder(fps, currentCodec.load(std::memory_order_acquire), reason)) return false;
+            webrtcServer->RequestKeyframe();
+            return true;
+        };
+
         capture.SetResolutionChangeCallback([&](int width, int height, int fps) {
             LOG("Resolution change: %dx%d@%d", width, height, fps);
-            if (rebuildResolvedEncoder(fps, currentCodec.load(std::memory_order_acquire), "source-resolution-change")) {
-                webrtcServer->RequestKeyframe();
-            }
+            // The GPU scaler takes any input size, so the stream only restarts when the
+            // resolved target no longer matches the coded size.
+            retargetEncoder(fps, "source-resolution-change");
         });
 
         std::atomic<bool> cursorCapture{false};
         std::atomic<int64_t> lastEncodeTs{0};
         std::atomic<int> targetFps{60};
 
+        // Encode rate: the client's request, capped by the governor, or the background
+        // rate while another stream has focus.
+        auto applyEncodeFps = [&]() -> int {
+            const int requested = clientFps.load(std::memory_order_acquire);
+            const int cap = governorFpsCap.load(std::memory_order_acquire);
+            const uint8_t focused = focusedStream.load(std::memory_order_acquire);
+            int fps = cap > 0 ? std::min(requested, cap) : requested;
+            if (focused != 0) fps = std::min(fps, backgroundFps);
+            monitorStreams.SetRates(focused, requested, backgroundFps);
+            capture.SetFPS(fps);
+            targetFps.store(fps, std::memory_order_release);
+            lastEncodeTs.store(0, std::memory_order_release);
+            return fps;
+        };
+
+        // Called by the encoder thread, outside encoderMutex, after each frame it sends.
+        std::function<void(int64_t, int64_t)> onEncodeSample = [&](int64_t encUs, int64_t framePeriodUs) {
+            if (!adaptiveResolution && !encodeGovernorEnabled) return;
+            const auto [targetWidth, targetHeight] = resolveEncodeTarget();
+            const CodecType codec = currentCodec.load(std::memory_order_acquire);
+            const int64_t nowUs = GetTimestamp();
+            bool bandwidthChanged = false;
+            GovernorAction action = GovernorAction::None;
+            EncodeAdjustInfo info{};
+            {
+                std::lock_guard<std::mutex> lock(adaptMutex);
+                if (adaptiveResolution) {
+                    resolutionController.SetFullBitrate(CalcBitrate(codec, targetWidth, targetHeight, targetFps.load(std::memory_order_acquire)));
+                    bandwidthChanged = resolutionController.OnFrame(nowUs, webrtcServer->GetVideoBytesDelivered(),
+                        webrtcServer->IsCongested());
+                }
+                if (encodeGovernorEnabled) {
+                    governor.SetPresetAvailable(encoderHasFasterPreset.load(std::memory_order_acquire));
+                    action = governor.OnFrame(nowUs, encUs, framePeriodUs);
+                }
+                if (!bandwidthChanged && action == GovernorAction::None) return;
+
+                if (bandwidthChanged) bandwidthScale.store(resolutionController.Percent(), std::memory_order_release);
+                governorScale.store(governor.ScalePercent(), std::memory_order_release);
+                governorFpsCap.store(governor.FpsCap(), std::memory_order_release);
+                governorFastPreset.store(governor.FastPreset(), std::memory_order_release);
+
+                if (governor.IsLimiting()) info.limits |= LIMIT_ENCODE_TIME;
+                if (resolutionController.Percent() < 100) info.limits |= LIMIT_BANDWIDTH;
+                if (governor.FastPreset()) info.limits |= LIMIT_FAST_PRESET;
+                info.action = static_cast<uint8_t>(action);
+                info.scalePercent = static_cast<uint8_t>(std::min(resolutionController.Percent(), governor.ScalePercent()));
+                info.fps = static_cast<uint16_t>(governor.FpsCap());
+                info.p95Us = static_cast<uint32_t>(std::max<int64_t>(governor.P95Us(), 0));
+                info.budgetUs = static_cast<uint32_t>(governor.BudgetUs());
+                LOG("Encode adjust: %s (bandwidth=%d%% throughput=%.2f Mbps, governor=%d%% fps cap=%d fast preset=%d, encode p95=%.1f/%.1f ms)",
+                    bandwidthChanged && action == GovernorAction::None ? "bandwidth" : GovernorActionName(action),
+                    resolutionController.Percent(), resolutionController.ThroughputBps() / 1e6,
+                    governor.ScalePercent(), governor.FpsCap(), governor.FastPreset() ? 1 : 0,
+                    governor.P95Us() / 1000.0, governor.BudgetUs() / 1000.0);
+            }
+
+            switch (action) {
+                case GovernorAction::FasterPreset:
+                case GovernorAction::RestorePreset: {
+                    std::lock_guard<std::mutex> lock(encoderMutex);
+                    if (encoder) encoder->SetFastPreset(governorFastPreset.load(std::memory_order_acquire));
+                    break;
+                }
+                case GovernorAction::LowerFps:
+                case GovernorAction::RestoreFps: {
+                    const int fps = applyEncodeFps();
+                    std::lock_guard<std::mutex> lock(encoderMutex);
+                    if (encoder) encoder->UpdateFPS(fps);
+                    break;
+                }
+                default:
+                    break;
+            }
+            const bool governorResize = action == GovernorAction::LowerResolution || action == GovernorAction::RestoreResolution;
+            if (governorResize || bandwidthChanged) {
+                retargetEncoder(capture.GetCurrentFPS(), governorResize ? "encode-governor" : "adaptive-resolution");
+            }
+            webrtcServer->SendEncodeAdjust(info);
+        };
+
+        // Called by the encoder thread, outside encoderMutex, when the encoder was left
+        // without a codec (a failed software reopen).
+        std::function<void()> onEncoderLost = [&] {
+            WARN("Encoder lost its codec context, rebuilding");
+            if (rebuildResolvedEncoder(capture.GetCurrentFPS(), currentCodec.load(std::memory_order_acquire), "encoder-lost")) {
+                webrtcServer->RequestKeyframe();
+            }
+        };
+
         auto clearStreamingState = [&](bool resetFrameSlot) {
             lastEncodeTs.store(0, std::memory_order_release);
             clientTargetWidth.store(0, std::memory_order_release);
@@ -880,6 +1120,7 @@ int RunHostApp(int argc, char* argv[]) {
             encodeTargetHeight.store(0, std::memory_order_release);
             encoderReady.store(false, std::memory_order_release);
             { std::lock_guard<std::mutex> lock(encoderMutex); encoder.reset(); }
+            resetAdaptiveResolution();
             { std::lock_guard<std::mutex> lock(encoderInfoMutex); activeEncoderName.clear(); }
             if (audioCapture) audioCapture->SetStreaming(false);
             if (micPlayback) micPlayback->SetStreaming(false);
@@ -893,16 +1134,20 @@ int RunHostApp(int argc, char* argv[]) {
 
         WebRTCCallbacks callbacks{};
         callbacks.input = &input;
-        callbacks.onFpsChange = [&](int fps, uint8_t) {
-                capture.SetFPS(fps);
-                targetFps.store(fps, std::memory_order_release);
-                lastEncodeTs.store(0, std::memory_order_release);
+        callbacks.onFpsChange = [&](int requestedFps, uint8_t) {
+                clientFps.store(requestedFps, std::memory_order_release);
+                {
+                    std::lock_guard<std::mutex> lock(adaptMutex);
+                    governor.SetRequestedFps(requestedFps);
+                    governorFpsCap.store(governor.FpsCap(), std::memory_order_release);
+                }
+                const int fps = applyEncodeFps();
                 std::lock_guard<std::mutex> lock(encoderMutex);
                 if (encoder) {
                     encoder->UpdateFPS(fps);
                 } else {
                     try {
-                        const auto [targetWidth, targetHeight] = resolveEncodeTarget();
+                        const auto [targetWidth, targetHeight] = adaptiveEncodeTarget();
                         encoder = createEncoder(targetWidth, targetHeight, fps,
                             currentCodec.load(std::memory_order_acquire));
                         encodeTargetWidth.store(targetWidth, std::memory_order_release);
@@ -919,31 +1164,72 @@ int RunHostApp(int argc, char* argv[]) {
             };
         callbacks.getHostFps = [&] { return capture.RefreshHostFPS(); };
         callbacks.getMonitor = [&] { return capture.GetCurrentMonitorIndex(); };
+        // Moves input and the full frame rate to a stream (0 = the primary monitor).
+        auto focusStream = [&](uint8_t stream, int monitor) {
+            focusedStream.store(stream, std::memory_order_release);
+            UpdateInputBoundsForMonitor(input, monitor);
+            const int fps = applyEncodeFps();
+            std::lock_guard<std::mutex> lock(encoderMutex);
+            if (encoder) encoder->UpdateFPS(fps);
+        };
+        // Focus returns to stream 0 with its new monitor, whose extra stream would only duplicate it.
         callbacks.onMonitorChange = [&](int idx) -> bool {
                 if (!capture.SwitchMonitor(idx)) return false;
-                UpdateInputBoundsForMonitor(input, idx);
+                monitorStreams.RemoveMonitor(idx);
+                focusStream(0, idx);
                 lastEncodeTs.store(0, std::memory_order_release);
                 wiggle.Request();
                 return true;
             };
+        // Clients draw the cursor themselves unless they ask for it in the video.
+        const auto resetCursorCapture = [&] {
+            if (cursorCapture.exchange(false, std::memory_order_acq_rel)) {
+                capture.SetCursorCapture(false);
+                monitorStreams.SetCursorCapture(false);
+            }
+        };
+        const auto resetAudioSession = [&] {
+            std::lock_guard<std::mutex> lock(audioLossMutex);
+            audioLoss.Reset();
+            if (!audioCapture) return;
+            audioCapture->SetProtection(audioLoss.Current());
+            audioCapture->ResetFrameSamples();
+        };
+        auto resetMonitorStreams = [&] {
+            monitorStreams.Clear();
+            focusedStream.store(0, std::memory_order_release);
+            UpdateInputBoundsForMonitor(input, capture.GetCurrentMonitorIndex());
+        };
         callbacks.onDisconnect = [&] {
+                resetMonitorStreams();
+                resetAudioSession();
                 capture.PauseCapture();
                 clearStreamingState(false);
+                resetCursorCapture();
             };
         callbacks.onConnected = [&] {
             frameSlot.Wake();
             lastEncodeTs.store(0, std::memory_order_release);
             wiggle.Request();
         };
-        callbacks.onCodecChange = [&](CodecType codec) -> bool {
-                if (codec == currentCodec.load(std::memory_order_acquire)) return true;
+        callbacks.onCodecChange = [&](CodecType codec, EncodeFormat format) -> bool {
+                if (codec == currentCodec.load(std::memory_order_acquire) &&
+                    format == requestedFormat.load(std::memory_order_acquire)) return true;
                 if (!(codecCaps & (1 << static_cast<int>(codec)))) return false;
-                if (!rebuildResolvedEncoder(capture.GetCurrentFPS(), codec, "codec-change")) return false;
+                if (!(formatCaps[codec] & (1 << format))) return false;
+                const EncodeFormat previousFormat = requestedFormat.exchange(format, std::memory_order_acq_rel);
+                if (!rebuildResolvedEncoder(capture.GetCurrentFPS(), codec, "codec-change")) {
+                    requestedFormat.store(previousFormat, std::memory_order_release);
+                    return false;
+                }
                 lastEncodeTs.store(0, std::memory_order_release);
+                monitorStreams.SetCodec(codec, format);
                 return true;
             };
         callbacks.getCodec = [&] { return currentCodec.load(std::memory_order_acquire); };
+        callbacks.getFormat = [&] { return currentFormat.load(std::memory_order_acquire); };
         callbacks.getCodecCaps = [&] { return codecCaps; };
+        callbacks.getFormatCaps = [&] { return formatCaps; };
         callbacks.getEncoderName = [&] {
                 std::lock_guard<std::mutex> lock(encoderInfoMutex);
                 return activeEncoderName;
@@ -952,29 +1238,75 @@ int RunHostApp(int argc, char* argv[]) {
                 clientTargetWidth.store(width, std::memory_order_release);
                 clientTargetHeight.store(height, std::memory_order_release);
 
-                const auto [targetWidth, targetHeight] = resolveEncodeTarget();
+                const auto [targetWidth, targetHeight] = adaptiveEncodeTarget();
                 const int currentWidth = encodeTargetWidth.load(std::memory_order_acquire);
                 const int currentHeight = encodeTargetHeight.load(std::memory_order_acquire);
                 if (targetWidth == currentWidth && targetHeight == currentHeight) return;
 
-                if (rebuildResolvedEncoder(capture.GetCurrentFPS(), currentCodec.load(std::memory_order_acquire), "client-stream-target")) {
-                    webrtcServer->RequestKeyframe();
+                if (retargetEncoder(capture.GetCurrentFPS(), "client-stream-target")) {
                     lastEncodeTs.store(0, std::memory_order_release);
                     frameSlot.Wake();
                 }
             };
         callbacks.getClipboard = [&] { return input.GetClipboardText(); };
         callbacks.setClipboard = [&](const std::string& text) { return input.SetClipboardText(text); };
-        callbacks.onCursorCapture = [&](bool e) { cursorCapture.store(e, std::memory_order_release); capture.SetCursorCapture(e); };
+        callbacks.onCursorCapture = [&](bool e) {
+            cursorCapture.store(e, std::memory_order_release);
+            capture.SetCursorCapture(e);
+            monitorStreams.SetCursorCapture(e);
+        };
         callbacks.onAudioEnable = [&](bool e) { if (audioCapture) audioCapture->SetStreaming(e); };
+        callbacks.onAudioFrameSize = [&](int samples) { if (audioCapture) audioCapture->SetFrameSamples(samples); };
         callbacks.onMicEnable = [&](bool e) { if (micPlayback) micPlayback->SetStreaming(e); };
+        callbacks.onAudioFeedback = [&](uint8_t caps, int lossPercent) {
+            std::lock_guard<std::mutex> lock(audioLossMutex);
+            if (!audioLoss.Report(caps, lossPercent)) return;
+            const AudioProtection& protection = audioLoss.Current();
+            if (audioCapture) audioCapture->SetProtection(protection);
+            webrtcServer->SetAudioRedundancy(protection.redundancy);
+            LOG("Audio protection: loss %.1f%% -> %d kbps, redundancy %d, dtx %d",
+                audioLoss.SmoothedLoss(), protection.bitrate / 1000, protection.redundancy ? 1 : 0, protection.dtx ? 1 : 0);
+        };
         callbacks.onMicData = [&](const uint8_t* d, size_t n) {
             if (micPlayback && micPlayback->IsInitialized()) micPlayback->PushPacket(d, n);
         };
         callbacks.onSessionReset = [&] {
+            resetMonitorStreams();
+            resetAudioSession();
             capture.PauseCapture();
             clearStreamingState(true);
+            resetCursorCapture();
+        };
+
+        callbacks.onStreamsSet = [&](const std::vector<int>& monitors) {
+            std::vector<int> extra;
+            for (int monitor : monitors) {
+                if (monitor != capture.GetCurrentMonitorIndex()) extra.push_back(monitor);
+            }
+            monitorStreams.Set(extra, currentCodec.load(std::memory_order_acquire), requestedFormat.load(std::memory_order_acquire));
+            const uint8_t focused = focusedStream.load(std::memory_order_acquire);
+            if (focused != 0 && monitorStreams.MonitorOf(focused) < 0) focusStream(0, capture.GetCurrentMonitorIndex());
+            else applyEncodeFps();
+        };
+        callbacks.getStreams = [&] {
+            VideoStreamInfo primary;
+            primary.monitor = static_cast<uint8_t>(capture.GetCurrentMonitorIndex());
+            primary.codec = currentCodec.load(std::memory_order_acquire);
+            primary.format = currentFormat.load(std::memory_order_acquire);
+            primary.width = static_cast<uint16_t>(capture.GetW());
+            primary.height = static_cast<uint16_t>(capture.GetH());
+            std::vector<VideoStreamInfo> streams{primary};
+            for (const auto& stream : monitorStreams.List()) streams.push_back(stream);
+            return streams;
+        };
+        callbacks.onStreamFocus = [&](uint8_t stream) -> bool {
+            const int monitor = stream == 0 ? capture.GetCurrentMonitorIndex() : monitorStreams.MonitorOf(stream);
+            if (monitor < 0) return false;
+            focusStream(stream, monitor);
+            LOG("Stream focus: %u (monitor %d)", stream, monitor);
+            return true;
         };
+        callbacks.onStreamKeyRequest = [&](uint8_t stream) { monitorStreams.Kick(stream); };
 
         webrtcServer->Init(std::move(callbacks));
 
@@ -1003,6 +1335,8 @@ int RunHostApp(int argc, char* argv[]) {
             encoderReady,
             lastEncodeTs,
             targetFps,
+            onEncodeSample,
+            onEncoderLost,
             audioCapture,
             threads)) {
             return 1;
@@ -1030,6 +1364,7 @@ int RunHostApp(int argc, char* argv[]) {
         }
 
         LOG("Shutting down...");
+        monitorStreams.Clear();
         ShutdownHost(audioCapture, micPlayback, server, frameSlot, capture, webrtcServer, portMapper, threads);
 
         CleanupAppTray();
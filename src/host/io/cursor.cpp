@@ -0,0 +1,134 @@
+#include "host/io/cursor.hpp"
+#include <array>
+
+namespace {
+    HCURSOR GetStdCursor(int i) {
+        static const std::array<LPCTSTR, 13> ids = {
+            IDC_ARROW, IDC_IBEAM, IDC_HAND, IDC_WAIT, IDC_APPSTARTING, IDC_CROSS, IDC_SIZEALL,
+            IDC_SIZEWE, IDC_SIZENS, IDC_SIZENWSE, IDC_SIZENESW, IDC_NO, IDC_HELP
+        };
+        static HCURSOR cache[13] = {};
+        if (!cache[0]) {
+            for (size_t j = 0; j < ids.size(); ++j) cache[j] = LoadCursor(nullptr, ids[j]);
+        }
+        return cache[i];
+    }
+
+    CursorType ClassifyCursor(HCURSOR cursor) {
+        for (int i = 0; i < 13; i++) if (cursor == GetStdCursor(i)) return static_cast<CursorType>(i);
+        return CURSOR_CUSTOM;
+    }
+
+    // GetIconInfo hands both bitmaps to the caller.
+    struct IconBitmaps {
+        ICONINFO info{};
+        ~IconBitmaps() {
+            if (info.hbmColor) DeleteObject(info.hbmColor);
+            if (info.hbmMask) DeleteObject(info.hbmMask);
+        }
+    };
+
+    bool ReadBits(HDC dc, HBITMAP bitmap, int width, int rows, std::vector<uint32_t>& px) {
+        BITMAPINFO bi{};
+        bi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+        bi.bmiHeader.biWidth = width;
+        bi.bmiHeader.biHeight = -rows;
+        bi.bmiHeader.biPlanes = 1;
+        bi.bmiHeader.biBitCount = 32;
+        bi.bmiHeader.biCompression = BI_RGB;
+        px.assign(static_cast<size_t>(width) * rows, 0);
+        return GetDIBits(dc, bitmap, 0, static_cast<UINT>(rows), px.data(), &bi, DIB_RGB_COLORS) == rows;
+    }
+
+    // Monochrome cursors are an AND mask over an XOR mask; colour cursors without an
+    // alpha channel take transparency from the AND mask.
+    bool ReadCursorImage(HCURSOR cursor, int maxSize, CursorImage& out) {
+        IconBitmaps icon;
+        if (!GetIconInfo(cursor, &icon.info) || !icon.info.hbmMask) return false;
+        BITMAP bm{};
+        if (!GetObject(icon.info.hbmMask, sizeof(bm), &bm)) return false;
+        const bool mono = icon.info.hbmColor == nullptr;
+        const int width = bm.bmWidth, height = mono ? bm.bmHeight / 2 : bm.bmHeight;
+        if (width <= 0 || height <= 0 || width > maxSize || height > maxSize) return false;
+
+        std::vector<uint32_t> mask, color;
+        HDC dc = GetDC(nullptr);
+        const bool read = ReadBits(dc, icon.info.hbmMask, width, mono ? height * 2 : height, mask) &&
+                          (mono || ReadBits(dc, icon.info.hbmColor, width, height, color));
+        ReleaseDC(nullptr, dc);
+        if (!read) return false;
+
+        const bool hasAlpha = std::any_of(color.begin(), color.end(), [](uint32_t p) { return (p >> 24) != 0; });
+        const size_t count = static_cast<size_t>(width) * height;
+        out.rgba.resize(count * 4);
+        for (size_t i = 0; i < count; ++i) {
+            const bool andBit = (mask[i] & 0xFFFFFF) != 0;
+            uint32_t bgra;
+            if (mono) {
+                // Inverting pixels (AND and XOR both set) have no RGBA form; they are drawn black.
+                const bool xorBit = (mask[count + i] & 0xFFFFFF) != 0;
+                bgra = andBit ? (xorBit ? 0xFF000000u : 0u) : (xorBit ? 0xFFFFFFFFu : 0xFF000000u);
+            } else if (hasAlpha) {
+                bgra = color[i];
+            } else {
+                bgra = andBit ? 0u : (color[i] | 0xFF000000u);
+            }
+            uint8_t* px = &out.rgba[i * 4];
+            px[0] = static_cast<uint8_t>(bgra >> 16);
+            px[1] = static_cast<uint8_t>(bgra >> 8);
+            px[2] = static_cast<uint8_t>(bgra);
+            px[3] = static_cast<uint8_t>(bgra >> 24);
+        }
+        out.width = static_cast<uint16_t>(width);
+        out.height = static_cast<uint16_t>(height);
+        out.hotX = static_cast<uint16_t>(std::min<DWORD>(icon.info.xHotspot, static_cast<DWORD>(width - 1)));
+        out.hotY = static_cast<uint16_t>(std::min<DWORD>(icon.info.yHotspot, static_cast<DWORD>(height - 1)));
+        return true;
+    }
+
+    // FNV-1a over the size, hotspot and pixels.
+    uint64_t HashCursorImage(const CursorImage& image) {
+        uint64_t h = 0xCBF29CE484222325ull;
+        const auto mix = [&h](uint8_t b) { h = (h ^ b) * 0x100000001B3ull; };
+        for (uint16_t v : {image.width, image.height, image.hotX, image.hotY}) {
+            mix(static_cast<uint8_t>(v));
+            mix(static_cast<uint8_t>(v >> 8));
+        }
+        for (uint8_t b : image.rgba) mix(b);
+        return h;
+    }
+}
+
+const CursorImage* CursorTracker::Lookup(HCURSOR cursor) {
+    CursorImage image;
+    if (!ReadCursorImage(cursor, kMaxSize, image)) return nullptr;
+    const uint64_t hash = HashCursorImage(image);
+    if (auto it = images.find(hash); it != images.end()) return &it->second;
+    // Ids keep counting after a clear, so a client never draws a stale bitmap for one.
+    if (images.size() >= kMaxImages) images.clear();
+    image.id = nextId++;
+    DBG("CursorTracker: New cursor %u (%ux%u, hotspot %u,%u)", image.id, image.width, image.height, image.hotX, image.hotY);
+    return &images.emplace(hash, std::move(image)).first->second;
+}
+
+bool CursorTracker::Poll(const InputHandler& input, CursorSample& out) {
+    out = {};
+    CURSORINFO ci = {sizeof(ci)};
+    if (!GetCursorInfo(&ci)) return false;
+    if ((ci.flags & CURSOR_SHOWING) && ci.hCursor) {
+        if (ci.hCursor != lastHandle) {
+            lastHandle = ci.hCursor;
+            handleType = ClassifyCursor(ci.hCursor);
+            handleImage = Lookup(ci.hCursor);
+        }
+        out.type = handleType;
+        out.image = handleImage;
+        out.visible = input.ToMonitorNormalized(ci.ptScreenPos, out.x, out.y);
+    }
+    const uint32_t id = out.image ? out.image->id : 0;
+    const bool changed = !reported || out.type != reportedType || id != reportedId;
+    reported = true;
+    reportedType = out.type;
+    reportedId = id;
+    return changed;
+}
@@ -1,11 +1,6 @@
 #include "host/io/input.hpp"
-#include <array>
 #include <cstring>
 
-using std::chrono::duration_cast;
-using std::chrono::milliseconds;
-using std::chrono::steady_clock;
-
 namespace {
     const std::unordered_map<uint16_t, WORD> JS_VK_MAP = {
         {8,VK_BACK}, {9,VK_TAB}, {13,VK_RETURN}, {16,VK_SHIFT}, {17,VK_CONTROL}, {18,VK_MENU},
@@ -22,18 +17,6 @@ namespace {
         {220,VK_OEM_5}, {221,VK_OEM_6}, {222,VK_OEM_7}
     };
 
-    HCURSOR GetStdCursor(int i) {
-        static const std::array<LPCTSTR, 13> ids = {
-            IDC_ARROW, IDC_IBEAM, IDC_HAND, IDC_WAIT, IDC_APPSTARTING, IDC_CROSS, IDC_SIZEALL,
-            IDC_SIZEWE, IDC_SIZENS, IDC_SIZENWSE, IDC_SIZENESW, IDC_NO, IDC_HELP
-        };
-        static HCURSOR cache[13] = {};
-        if (!cache[0]) {
-            for (size_t j = 0; j < ids.size(); ++j) cache[j] = LoadCursor(nullptr, ids[j]);
-        }
-        return cache[i];
-    }
-
     bool IsExtendedKey(WORD vk) {
         return vk == VK_INSERT || vk == VK_DELETE || vk == VK_HOME || vk == VK_END ||
                vk == VK_PRIOR || vk == VK_NEXT || vk == VK_LEFT || vk == VK_RIGHT ||
@@ -55,7 +38,7 @@ WORD JsKeyToVK(uint16_t k) {
 }
 
 bool InputHandler::CheckLimit(std::atomic<int>& cnt, int max, std::atomic<uint64_t>& dropped) {
-    int64_t now = duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+    int64_t now = GetTimestamp() / 1000;
     if (now - rateStart.load() >= 1000) {
         rateStart = now;
         moveCnt = clickCnt = keyCnt = 0;
@@ -93,14 +76,18 @@ void InputHandler::UpdateFromMonitorInfo(const MonitorInfo& info) {
     }
 }
 
-bool InputHandler::GetCurrentCursor(CursorType& out) {
+bool InputHandler::GetCursorPosition(float& nx, float& ny) const {
     CURSORINFO ci = {sizeof(ci)};
-    if (!GetCursorInfo(&ci)) { out = CURSOR_DEFAULT; return false; }
-    if (!(ci.flags & CURSOR_SHOWING)) { out = CURSOR_NONE; return out != lastCur.exchange(out); }
-    CursorType nc = CURSOR_CUSTOM;
-    for (int i = 0; i < 13; i++) if (ci.hCursor == GetStdCursor(i)) { nc = static_cast<CursorType>(i); break; }
-    out = nc;
-    return nc != lastCur.exchange(nc);
+    if (!GetCursorInfo(&ci) || !(ci.flags & CURSOR_SHOWING)) return false;
+    return ToMonitorNormalized(ci.ptScreenPos, nx, ny);
+}
+
+bool InputHandler::ToMonitorNormalized(POINT pt, float& nx, float& ny) const {
+    const int w = monW.load(), h = monH.load();
+    if (w <= 0 || h <= 0) return false;
+    nx = static_cast<float>(pt.x - monX.load()) / static_cast<float>(w);
+    ny = static_cast<float>(pt.y - monY.load()) / static_cast<float>(h);
+    return nx >= 0.0f && nx < 1.0f && ny >= 0.0f && ny < 1.0f;
 }
 
 void InputHandler::WiggleCenter() {
@@ -3,6 +3,8 @@
 using namespace std::chrono_literals;
 
 namespace {
+constexpr int kMaxOpusFrameBytes = 1275;
+
 void InitCOM() {
     HRESULT hr = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
     if (FAILED(hr) && hr != RPC_E_CHANGED_MODE) throw std::runtime_error("COM initialization failed");
@@ -29,35 +31,18 @@ WAVEFORMATEX* GetAudioMixFormat(IAudioClient* client) {
 }
 
 template <typename LogFn>
-void LimitResamplerBuffer(std::vector<float>& buffer, size_t& readPos, size_t maxSamples, size_t keepSamples, int channelCount, LogFn&& logFn) {
-    const size_t bufferedSamples = buffer.size() > readPos ? (buffer.size() - readPos) : 0;
-    if (bufferedSamples <= maxSamples) return;
-
-    const size_t dropSamples = bufferedSamples - keepSamples;
-    readPos = std::min(readPos + dropSamples, buffer.size());
-    logFn(dropSamples, bufferedSamples, maxSamples, channelCount);
+void LimitResamplerBuffer(SampleRing& ring, size_t maxFrames, size_t keepFrames, LogFn&& logFn) {
+    const size_t bufferedFrames = ring.Size();
+    if (bufferedFrames <= maxFrames) return;
+    logFn(ring.DropOldest(keepFrames), bufferedFrames, maxFrames);
 }
 
-void TrimConsumedResamplerBuffer(std::vector<float>& buffer, size_t& readPos) {
-    if (readPos == 0 || (readPos < buffer.size() && readPos < 8192)) return;
-
-    if (readPos < buffer.size()) {
-        buffer.erase(buffer.begin(), buffer.begin() + static_cast<std::ptrdiff_t>(readPos));
-    } else {
-        buffer.clear();
+void ToPcm16(const SampleRing::Spans& spans, int channels, int16_t* out) {
+    for (const SampleRing::Span& span : {spans.first, spans.second}) {
+        const size_t values = span.frames * static_cast<size_t>(channels);
+        for (size_t i = 0; i < values; i++)
+            *out++ = static_cast<int16_t>(std::clamp(span.data[i], -1.0f, 1.0f) * 32767.0f);
     }
-    readPos = 0;
-}
-
-void ResetResamplerState(std::unique_ptr<SpeexResampler>& resampler, size_t& readPos) {
-    resampler->Reset();
-    readPos = 0;
-}
-
-template <typename Queue>
-void ClearQueueAndResetResampler(Queue& queue, std::mutex& queueMutex, std::unique_ptr<SpeexResampler>& resampler, size_t& readPos) {
-    ClearQueue(queue, queueMutex);
-    ResetResamplerState(resampler, readPos);
 }
 }
 
@@ -76,21 +61,42 @@ AudioCapture::AudioCapture() {
     systemSampleRate = waveFormat->nSamplesPerSec;
     channelCount = std::min(static_cast<int>(waveFormat->nChannels), 2);
 
-    ChkHR(audioClient->Initialize(AUDCLNT_SHAREMODE_SHARED, AUDCLNT_STREAMFLAGS_LOOPBACK, 30000, 0, waveFormat, nullptr),
-           "AudioClient Initialize");
+    // Event-driven capture picks each buffer up as the engine hands it over instead of
+    // on the next poll. Systems that refuse events on loopback get a fresh client and poll.
+    if (SUCCEEDED(audioClient->Initialize(AUDCLNT_SHAREMODE_SHARED, AUDCLNT_STREAMFLAGS_LOOPBACK | AUDCLNT_STREAMFLAGS_EVENTCALLBACK,
+                                          30000, 0, waveFormat, nullptr))) {
+        captureEvent = CreateEventW(nullptr, FALSE, FALSE, nullptr);
+        if (!captureEvent) throw std::runtime_error("Audio capture event");
+        ChkHR(audioClient->SetEventHandle(captureEvent), "SetEventHandle");
+    } else {
+        WARN("AudioCapture: Event-driven loopback unavailable, polling");
+        SafeRelease(audioClient);
+        audioClient = ActivateAudioClient(audioDevice, "AudioClient activation");
+        ChkHR(audioClient->Initialize(AUDCLNT_SHAREMODE_SHARED, AUDCLNT_STREAMFLAGS_LOOPBACK, 30000, 0, waveFormat, nullptr),
+               "AudioClient Initialize");
+    }
     ChkHR(audioClient->GetService(__uuidof(IAudioCaptureClient), reinterpret_cast<void**>(&captureClient)), "IAudioCaptureClient");
 
+    // Restricted low delay is CELT only, which saves 4 ms of lookahead but has no
+    // in-band FEC; LBRR needs the SILK or hybrid modes of the general application.
+    const bool lowDelay = GetEnvBool("SLIPSTREAM_AUDIO_LOWDELAY", true);
     int err;
-    opusEncoder = opus_encoder_create(kSampleRate, channelCount, OPUS_APPLICATION_RESTRICTED_LOWDELAY, &err);
+    opusEncoder = opus_encoder_create(kSampleRate, channelCount,
+        lowDelay ? OPUS_APPLICATION_RESTRICTED_LOWDELAY : OPUS_APPLICATION_AUDIO, &err);
     if (err != OPUS_OK) throw std::runtime_error("Opus encoder creation failed");
 
-    opus_encoder_ctl(opusEncoder, OPUS_SET_BITRATE(96000));
+    opus_encoder_ctl(opusEncoder, OPUS_SET_BITRATE(protection.bitrate));
     opus_encoder_ctl(opusEncoder, OPUS_SET_COMPLEXITY(3));
     opus_encoder_ctl(opusEncoder, OPUS_SET_SIGNAL(OPUS_SIGNAL_MUSIC));
 
-    encodeBuffer.resize(kFrameSamples * channelCount);
-    opusBuffer.resize(4000);
-    resampler = std::make_unique<SpeexResampler>(systemSampleRate, kSampleRate, channelCount);
+    repacketizer = opus_repacketizer_create();
+    if (!repacketizer) throw std::runtime_error("Opus repacketizer creation failed");
+
+    encodeBuffer.resize(kMaxFrameSamples * channelCount);
+    opusBuffer.resize(kMaxOpusFrameBytes);
+    batchBuffer.resize(static_cast<size_t>(kMaxPacketSamples / (kSampleRate / 400)) * kMaxOpusFrameBytes);
+    packetBuffer.resize(batchBuffer.size() + 16);
+    resampler = std::make_unique<SpeexResampler>(systemSampleRate, kSampleRate, channelCount, channelCount, kResamplerRingFrames);
 
     isInitialized = true;
     LOG("Audio: %dHz -> %dHz, %dch", systemSampleRate, kSampleRate, channelCount);
@@ -100,6 +106,8 @@ AudioCapture::AudioCapture() {
 AudioCapture::~AudioCapture() {
     Stop();
     if (opusEncoder) opus_encoder_destroy(opusEncoder);
+    if (repacketizer) opus_repacketizer_destroy(repacketizer);
+    if (captureEvent) CloseHandle(captureEvent);
     if (waveFormat) CoTaskMemFree(waveFormat);
     SafeRelease(captureClient, audioClient, audioDevice, deviceEnumerator);
 }
@@ -165,7 +173,9 @@ void AudioCapture::Loop() {
                 break;
             }
         }
-        std::this_thread::sleep_for(2ms);
+        // The timeout covers a paused engine, which signals nothing.
+        if (captureEvent) WaitForSingleObject(captureEvent, 20);
+        else std::this_thread::sleep_for(2ms);
     }
     CoUninitialize();
 }
@@ -173,29 +183,37 @@ void AudioCapture::Loop() {
 void AudioCapture::Process(const float* data, UINT32 frames, int64_t ts) {
     if (!opusEncoder || !resampler || !streaming.load()) {
         if (!streaming.load()) {
-            resampler->buf.clear();
-            resamplerReadPos = 0;
+            resampler->ring.Clear();
+            inDtx = false;
         }
         return;
     }
+    if (resamplerResetPending.exchange(false, std::memory_order_acq_rel)) resampler->Reset();
 
-    resampler->Process(data, frames);
+    if (protectionDirty.exchange(false, std::memory_order_acq_rel)) ApplyProtection();
 
-    const size_t maxBuf = kFrameSamples * channelCount * 6;
-    LimitResamplerBuffer(resampler->buf, resamplerReadPos, maxBuf, kFrameSamples * channelCount * 2, channelCount,
-        [&](size_t dropSamples, size_t bufferedSamples, size_t limitSamples, int channels) {
+    SampleRing& ring = resampler->ring;
+    if (const size_t dropped = resampler->Process(data, frames))
+        WARN("AudioCapture: Resampler ring full, dropping %zu input frames", dropped);
+
+    const int requestedFrames = requestedFrameSamples.load(std::memory_order_acquire);
+    if (requestedFrames != frameSamples) {
+        frameSamples = requestedFrames;
+        LOG("AudioCapture: %.1f ms frames", frameSamples * 1000.0 / kSampleRate);
+    }
+
+    LimitResamplerBuffer(ring, kDefaultFrameSamples * 6, kDefaultFrameSamples * 2,
+        [&](size_t droppedFrames, size_t bufferedFrames, size_t limitFrames) {
         WARN("AudioCapture: Resampler buffer overflow, dropping %zu samples (buf=%zu, max=%zu)",
-            dropSamples / channels, bufferedSamples / channels, limitSamples / channels);
+            droppedFrames, bufferedFrames, limitFrames);
         });
 
-    const size_t frameSamples = static_cast<size_t>(kFrameSamples * channelCount);
-    while (resampler->buf.size() >= resamplerReadPos + frameSamples) {
-        const float* src = resampler->buf.data() + resamplerReadPos;
-        for (int i = 0; i < kFrameSamples * channelCount; i++)
-            encodeBuffer[i] = static_cast<int16_t>(std::clamp(src[i], -1.0f, 1.0f) * 32767.0f);
-        resamplerReadPos += frameSamples;
+    const size_t frameLength = static_cast<size_t>(frameSamples);
+    while (ring.Size() >= frameLength) {
+        ToPcm16(ring.Readable(frameLength), channelCount, encodeBuffer.data());
+        ring.Consume(frameLength);
 
-        int bytes = opus_encode(opusEncoder, encodeBuffer.data(), kFrameSamples, opusBuffer.data(), static_cast<opus_int32>(opusBuffer.size()));
+        int bytes = opus_encode(opusEncoder, encodeBuffer.data(), frameSamples, opusBuffer.data(), static_cast<opus_int32>(opusBuffer.size()));
         if (bytes < 0) {
             ERR("AudioCapture: Opus encode error: %s (code=%d)", opus_strerror(bytes), bytes);
             continue;
@@ -204,13 +222,94 @@ void AudioCapture::Process(const float* data, UINT32 frames, int64_t ts) {
             DBG("AudioCapture: Opus encode returned 0 bytes (DTX silence?)");
             continue;
         }
+        // Packets of two bytes or less are DTX frames: the decoder only needs the first.
+        if (protection.dtx && bytes <= 2) {
+            dtxFrames++;
+            FlushBatch(ts);
+            if (inDtx) continue;
+            inDtx = true;
+            QueuePacket(opusBuffer.data(), static_cast<size_t>(bytes), ts, frameSamples);
+            continue;
+        }
+        inDtx = false;
+
+        if (batchSamples + frameSamples > kMaxPacketSamples) FlushBatch(ts);
+        memcpy(batchBuffer.data() + batchBytes, opusBuffer.data(), static_cast<size_t>(bytes));
+        if (opus_repacketizer_cat(repacketizer, batchBuffer.data() + batchBytes, bytes) != OPUS_OK) {
+            // The encoder switched bandwidth or channels mid-batch; such frames can't share a packet.
+            FlushBatch(ts);
+            memcpy(batchBuffer.data(), opusBuffer.data(), static_cast<size_t>(bytes));
+            opus_repacketizer_cat(repacketizer, batchBuffer.data(), bytes);
+        }
+        batchBytes += static_cast<size_t>(bytes);
+        batchSamples += frameSamples;
+    }
+    // Everything encoded from this buffer leaves now: batching never holds a frame back.
+    FlushBatch(ts);
+}
 
-        std::lock_guard<std::mutex> lk(queueMutex);
-        PushBoundedQueue(packetQueue, kMaxQueueSize, AudioPacket{{opusBuffer.begin(), opusBuffer.begin() + bytes}, ts, kFrameSamples});
-        queueCv.notify_one();
+void AudioCapture::FlushBatch(int64_t ts) {
+    if (batchSamples == 0) return;
+    if (opus_repacketizer_get_nb_frames(repacketizer) == 1) {
+        QueuePacket(batchBuffer.data(), batchBytes, ts, batchSamples);
+    } else {
+        const opus_int32 bytes = opus_repacketizer_out(repacketizer, packetBuffer.data(), static_cast<opus_int32>(packetBuffer.size()));
+        if (bytes > 0) QueuePacket(packetBuffer.data(), static_cast<size_t>(bytes), ts, batchSamples);
+        else ERR("AudioCapture: Opus repacketize error: %s (code=%d)", opus_strerror(bytes), bytes);
     }
+    opus_repacketizer_init(repacketizer);
+    batchBytes = 0;
+    batchSamples = 0;
+}
 
-    TrimConsumedResamplerBuffer(resampler->buf, resamplerReadPos);
+void AudioCapture::QueuePacket(const uint8_t* data, size_t bytes, int64_t ts, int samples) {
+    std::lock_guard<std::mutex> lk(queueMutex);
+    PushBoundedQueue(packetQueue, kMaxQueueSize, AudioPacket{{data, data + bytes}, ts, samples});
+    queueCv.notify_one();
+}
+
+void AudioCapture::ApplyProtection() {
+    {
+        std::lock_guard<std::mutex> lk(protectionMutex);
+        protection = pendingProtection;
+    }
+    opus_encoder_ctl(opusEncoder, OPUS_SET_BITRATE(protection.bitrate));
+    opus_encoder_ctl(opusEncoder, OPUS_SET_PACKET_LOSS_PERC(protection.lossPercent));
+    opus_encoder_ctl(opusEncoder, OPUS_SET_INBAND_FEC(protection.inbandFec ? 1 : 0));
+    opus_encoder_ctl(opusEncoder, OPUS_SET_DTX(protection.dtx ? 1 : 0));
+#ifdef OPUS_SET_DRED_DURATION_REQUEST
+    const int dredErr = opus_encoder_ctl(opusEncoder, OPUS_SET_DRED_DURATION(protection.dredFrames));
+    if (dredErr != OPUS_OK && protection.dredFrames > 0 && !dredWarned) {
+        dredWarned = true;
+        WARN("AudioCapture: DRED unavailable in this libopus build: %s", opus_strerror(dredErr));
+    }
+#else
+    if (protection.dredFrames > 0 && !dredWarned) {
+        dredWarned = true;
+        WARN("AudioCapture: DRED needs libopus 1.5 or newer");
+    }
+#endif
+    if (!protection.dtx) inDtx = false;
+    LOG("AudioCapture: %d kbps, loss %d%%, fec %d, dtx %d, redundancy %d (dtx frames so far: %llu)",
+        protection.bitrate / 1000, protection.lossPercent, protection.inbandFec ? 1 : 0,
+        protection.dtx ? 1 : 0, protection.redundancy ? 1 : 0, static_cast<unsigned long long>(dtxFrames));
+}
+
+void AudioCapture::SetProtection(const AudioProtection& p) {
+    {
+        std::lock_guard<std::mutex> lk(protectionMutex);
+        pendingProtection = p;
+    }
+    protectionDirty.store(true, std::memory_order_release);
+}
+
+bool AudioCapture::SetFrameSamples(int samples) {
+    if (samples != kSampleRate / 400 && samples != kSampleRate / 200 && samples != kSampleRate / 100 && samples != kSampleRate / 50) {
+        WARN("AudioCapture: Unsupported frame size %d samples", samples);
+        return false;
+    }
+    requestedFrameSamples.store(samples, std::memory_order_release);
+    return true;
 }
 
 void AudioCapture::Start() {
@@ -220,7 +319,7 @@ void AudioCapture::Start() {
     }
     running = true;
     captureActive = true;
-    ResetResamplerState(resampler, resamplerReadPos);
+    resampler->Reset();
     HRESULT startHr = audioClient->Start();
     if (FAILED(startHr)) {
         ERR("AudioCapture: IAudioClient::Start failed: 0x%08X", startHr);
@@ -238,6 +337,7 @@ void AudioCapture::Stop() {
     captureActive = false;
     streaming = false;
     queueCv.notify_all();
+    if (captureEvent) SetEvent(captureEvent);
     if (captureThread.joinable()) captureThread.join();
     if (audioClient) audioClient->Stop();
     LOG("AudioCapture: Stopped");
@@ -249,7 +349,8 @@ void AudioCapture::SetStreaming(bool s) {
         LOG("AudioCapture: Streaming %s -> %s", was ? "on" : "off", s ? "on" : "off");
     }
     if (s && !was) {
-        ClearQueueAndResetResampler(packetQueue, queueMutex, resampler, resamplerReadPos);
+        ClearQueue(packetQueue, queueMutex);
+        resamplerResetPending.store(true, std::memory_order_release);
     }
 }
 
@@ -305,7 +406,7 @@ void MicPlayback::Loop() {
         return;
     }
 
-    std::vector<float> decodedFloat(kFrameSamples);
+    std::vector<float> decodedFloat(kMaxPacketSamples);
 
     while (running.load(std::memory_order_acquire)) {
         if (!streaming.load(std::memory_order_acquire) || !renderClient || !init.load(std::memory_order_acquire)) {
@@ -313,6 +414,8 @@ void MicPlayback::Loop() {
             continue;
         }
 
+        if (resamplerResetPending.exchange(false, std::memory_order_acq_rel)) resampler->Reset();
+
         std::vector<uint8_t> pkt;
         {
             std::unique_lock<std::mutex> lk(queueMutex);
@@ -330,7 +433,7 @@ void MicPlayback::Loop() {
 
         packetsReceived++;
 
-        int ds = opus_decode(opusDecoder, pkt.data() + sizeof(MicPacketHeader), h->dataLength, decodeBuffer.data(), kFrameSamples, 0);
+        int ds = opus_decode(opusDecoder, pkt.data() + sizeof(MicPacketHeader), h->dataLength, decodeBuffer.data(), kMaxPacketSamples, 0);
         if (ds <= 0) {
             if (++decodeErrors % 100 == 1)
                 WARN("MicPlayback: Opus decode error: %s (total: %llu)", opus_strerror(ds), decodeErrors.load());
@@ -339,43 +442,38 @@ void MicPlayback::Loop() {
 
         packetsDecoded++;
         for (int i = 0; i < ds; i++) decodedFloat[i] = decodeBuffer[i] / 32768.0f;
-        resampler->ProcessMono(decodedFloat.data(), ds, channelCount);
+        SampleRing& ring = resampler->ring;
+        if (resampler->ProcessMono(decodedFloat.data(), static_cast<size_t>(ds)) > 0) bufferOverruns++;
 
-        for (int attempts = 0; resampler->buf.size() > resamplerReadPos && running.load(std::memory_order_acquire) && attempts < 50; attempts++) {
+        for (int attempts = 0; ring.Size() > 0 && running.load(std::memory_order_acquire) && attempts < 50; attempts++) {
             UINT32 bufFr = 0, pad = 0;
             if (FAILED(audioClient->GetBufferSize(&bufFr)) || FAILED(audioClient->GetCurrentPadding(&pad))) break;
 
             UINT32 avail = bufFr - pad;
             if (avail == 0) { std::this_thread::sleep_for(1ms); continue; }
 
-            const size_t bufferedSamples = resampler->buf.size() - resamplerReadPos;
-            UINT32 toW = std::min(avail, static_cast<UINT32>(bufferedSamples / channelCount));
-            if (toW == 0) break;
-
+            const UINT32 toW = static_cast<UINT32>(std::min<size_t>(avail, ring.Size()));
             BYTE* buf = nullptr;
             if (FAILED(renderClient->GetBuffer(toW, &buf))) break;
 
             float* out = reinterpret_cast<float*>(buf);
-            const float* src = resampler->buf.data() + resamplerReadPos;
-            std::memcpy(out, src, static_cast<size_t>(toW) * channelCount * sizeof(float));
+            const SampleRing::Spans spans = ring.Readable(toW);
+            for (const SampleRing::Span& span : {spans.first, spans.second}) {
+                const size_t values = span.frames * static_cast<size_t>(channelCount);
+                std::memcpy(out, span.data, values * sizeof(float));
+                out += values;
+            }
 
             if (FAILED(renderClient->ReleaseBuffer(toW, 0))) break;
-            resamplerReadPos += static_cast<size_t>(toW) * channelCount;
+            ring.Consume(toW);
             samplesWritten += toW;
         }
 
-        LimitResamplerBuffer(
-            resampler->buf,
-            resamplerReadPos,
-            static_cast<size_t>(kFrameSamples * channelCount * 10),
-            static_cast<size_t>(kFrameSamples * channelCount * 4),
-            channelCount,
-            [&](size_t dropSamples, size_t, size_t, int channels) {
+        LimitResamplerBuffer(ring, kFrameSamples * 10, kFrameSamples * 4,
+            [&](size_t droppedFrames, size_t, size_t) {
             bufferOverruns++;
-            DBG("MicPlayback: Buffer overrun, dropped %zu samples", dropSamples / channels);
+            DBG("MicPlayback: Buffer overrun, dropped %zu samples", droppedFrames);
             });
-
-        TrimConsumedResamplerBuffer(resampler->buf, resamplerReadPos);
     }
     CoUninitialize();
     DBG("MicPlayback: Loop thread exiting");
@@ -415,8 +513,10 @@ MicPlayback::MicPlayback(const std::string& deviceName) : targetDevice(deviceNam
     opusDecoder = opus_decoder_create(kSampleRate, 1, &err);
     if (err != OPUS_OK) throw std::runtime_error("Opus decoder creation failed");
 
-    decodeBuffer.resize(kFrameSamples);
-    resampler = std::make_unique<SpeexResampler>(kSampleRate, deviceSampleRate, 1);
+    decodeBuffer.resize(kMaxPacketSamples);
+    // Room for a 120 ms packet on top of the 100 ms the overrun limit allows.
+    resampler = std::make_unique<SpeexResampler>(kSampleRate, deviceSampleRate, 1, channelCount,
+        static_cast<size_t>(deviceSampleRate) / 4 + kFrameSamples * 10);
     init.store(true, std::memory_order_release);
     LOG("MicPlayback: %dHz -> %dHz, %dch, device: %s", kSampleRate, deviceSampleRate, channelCount, actualDeviceName.c_str());
     CoUninitialize();
@@ -436,7 +536,7 @@ MicPlayback::~MicPlayback() {
 void MicPlayback::Start() {
     if (running.load(std::memory_order_acquire) || !init.load(std::memory_order_acquire)) return;
     running.store(true, std::memory_order_release);
-    ResetResamplerState(resampler, resamplerReadPos);
+    resampler->Reset();
     if (FAILED(audioClient->Start())) { ERR("MicPlayback: IAudioClient::Start failed"); running.store(false, std::memory_order_release); return; }
     playbackThread = std::thread(&MicPlayback::Loop, this);
     LOG("MicPlayback: Started");
@@ -455,10 +555,9 @@ void MicPlayback::Stop() {
 
 void MicPlayback::SetStreaming(bool s) {
     bool was = streaming.exchange(s, std::memory_order_acq_rel);
-    if (s && !was) {
-        ClearQueueAndResetResampler(packetQueue, queueMutex, resampler, resamplerReadPos);
-    } else if (!s && was) {
-        ClearQueueAndResetResampler(packetQueue, queueMutex, resampler, resamplerReadPos);
+    if (s != was) {
+        ClearQueue(packetQueue, queueMutex);
+        resamplerResetPending.store(true, std::memory_order_release);
     }
 }
 
@@ -0,0 +1,58 @@
+#include "host/media/audio_protection.hpp"
+#include "host/core/protocol.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    // Rising loss is followed within a report or two; falling loss over about five.
+    constexpr double kAttack = 0.7;
+    constexpr double kDecay = 0.2;
+    // Share of the base bitrate the primary keeps while each packet is sent twice.
+    constexpr double kRedundantShare = 2.0 / 3.0;
+}
+
+AudioLossController::AudioLossController(const AudioProtectionConfig& config) : cfg(config) {
+    cfg.minBitrate = std::clamp(cfg.minBitrate, 6000, std::max(6000, cfg.bitrate));
+    Reset();
+}
+
+void AudioLossController::Reset() {
+    smoothedLoss = 0.0;
+    caps = 0;
+    current = Derive();
+}
+
+AudioProtection AudioLossController::Derive() const {
+    AudioProtection p;
+    p.bitrate = cfg.bitrate;
+    if (caps == 0) return p;
+
+    p.dtx = cfg.dtx && (caps & AUDIO_CAP_DTX);
+    p.lossPercent = std::clamp(static_cast<int>(std::ceil(smoothedLoss - 0.05)), 0, cfg.maxLossPercent);
+    p.inbandFec = cfg.inbandFec && p.lossPercent > 0;
+    p.dredFrames = p.lossPercent > 0 ? cfg.dredMs / 10 : 0;
+
+    if (caps & AUDIO_CAP_REDUNDANCY) {
+        const double threshold = current.redundancy ? cfg.redundancyOffPercent : cfg.redundancyOnPercent;
+        p.redundancy = smoothedLoss >= threshold;
+    }
+    if (smoothedLoss >= cfg.heavyLossPercent) {
+        p.bitrate = cfg.minBitrate;
+    } else if (p.redundancy) {
+        p.bitrate = std::max(cfg.minBitrate, static_cast<int>(cfg.bitrate * kRedundantShare));
+    }
+    return p;
+}
+
+bool AudioLossController::Report(uint8_t clientCaps, int lossPercent) {
+    const double loss = std::clamp(lossPercent, 0, 100);
+    caps = clientCaps;
+    smoothedLoss += (loss - smoothedLoss) * (loss > smoothedLoss ? kAttack : kDecay);
+    if (smoothedLoss < 0.01) smoothedLoss = 0.0;
+
+    const AudioProtection next = Derive();
+    if (next == current) return false;
+    current = next;
+    return true;
+}
@@ -0,0 +1,101 @@
+#include "host/media/bitstream.hpp"
+
+#include <algorithm>
+
+namespace {
+    constexpr uint8_t kObuFrameHeader = 3;
+    constexpr uint8_t kObuTileGroup = 4;
+    constexpr uint8_t kObuFrame = 6;
+    constexpr uint8_t kH264PrefixNal = 14;
+
+    // Returns the offset of the next 00 00 01 start code at or after pos, or size.
+    size_t NextStartCode(const uint8_t* data, size_t size, size_t pos) {
+        for (; pos + 3 <= size; ++pos) {
+            if (data[pos + 2] > 1) { pos += 2; continue; }
+            if (data[pos] == 0 && data[pos + 1] == 0 && data[pos + 2] == 1) return pos;
+        }
+        return size;
+    }
+
+    bool IsVclNal(CodecType codec, uint8_t header) {
+        if (codec == CODEC_H264) {
+            const uint8_t type = header & 0x1F;
+            return type >= 1 && type <= 5;
+        }
+        return ((header >> 1) & 0x3F) < 32;
+    }
+
+    int FindAnnexBTemporalLayer(CodecType codec, const uint8_t* data, size_t size) {
+        for (size_t start = NextStartCode(data, size, 0); start < size; start = NextStartCode(data, size, start + 3)) {
+            const size_t payload = start + 3;
+            if (payload + 1 >= size) break;
+            const uint8_t header = data[payload];
+            if (codec == CODEC_H265) {
+                // nuh_temporal_id_plus1 is the low three bits of the second header byte.
+                if (IsVclNal(codec, header)) return std::max(0, (data[payload + 1] & 0x07) - 1);
+                continue;
+            }
+            // An SVC prefix NAL carries temporal_id in its third extension byte.
+            if ((header & 0x1F) == kH264PrefixNal && (data[payload + 1] & 0x80) && payload + 3 < size) {
+                return data[payload + 3] >> 5;
+            }
+            // Plain AVC has no temporal id; a picture with nal_ref_idc 0 is never referenced.
+            if (IsVclNal(codec, header)) return (header & 0x60) == 0 ? 1 : 0;
+        }
+        return -1;
+    }
+
+    bool ReadLeb128(const uint8_t* data, size_t size, size_t& pos, uint64_t& value) {
+        value = 0;
+        for (int i = 0; i < 8; ++i) {
+            if (pos >= size) return false;
+            const uint8_t byte = data[pos++];
+            value |= static_cast<uint64_t>(byte & 0x7F) << (i * 7);
+            if (!(byte & 0x80)) return true;
+        }
+        return false;
+    }
+
+    int FindObuTemporalLayer(const uint8_t* data, size_t size) {
+        size_t pos = 0;
+        while (pos < size) {
+            const uint8_t header = data[pos++];
+            const uint8_t type = (header >> 3) & 0x0F;
+            int temporalId = -1;
+            if (header & 0x04) {
+                if (pos >= size) return -1;
+                temporalId = data[pos++] >> 5;
+            }
+            if (type == kObuFrame || type == kObuFrameHeader || type == kObuTileGroup) return temporalId;
+            if (!(header & 0x02)) return -1;
+            uint64_t obuSize = 0;
+            if (!ReadLeb128(data, size, pos, obuSize) || obuSize > size - std::min(pos, size)) return -1;
+            pos += static_cast<size_t>(obuSize);
+        }
+        return -1;
+    }
+}
+
+int FindTemporalLayer(CodecType codec, const uint8_t* data, size_t size) {
+    if (!data || !size) return -1;
+    return codec == CODEC_AV1 ? FindObuTemporalLayer(data, size) : FindAnnexBTemporalLayer(codec, data, size);
+}
+
+void TemporalLayerTracker::Reset(int layerCount) {
+    layers = std::clamp(layerCount, 1, 3);
+    position = 0;
+}
+
+int TemporalLayerTracker::Next(CodecType codec, const uint8_t* data, size_t size, bool key) {
+    if (key) position = 0;
+    const uint64_t index = position++;
+    const int signalled = FindTemporalLayer(codec, data, size);
+    if (signalled >= 0) return signalled;
+    // Every 2^(layers-1)-th frame is in the base layer; each halving of the
+    // period below that is one layer up.
+    const uint64_t phase = index % (uint64_t{1} << (layers - 1));
+    if (phase == 0) return 0;
+    int layer = layers - 1;
+    for (uint64_t p = phase; p % 2 == 0; p /= 2) layer--;
+    return layer;
+}
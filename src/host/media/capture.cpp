@@ -10,19 +10,13 @@ using namespace std::chrono_literals;
 
 namespace {
     int64_t ConvertFrameSourceTimestampUs(winrt::Windows::Foundation::TimeSpan systemRelativeTime, int64_t captureTsUs) {
-        static const int64_t qpcFrequency = [] {
-            LARGE_INTEGER f{};
-            QueryPerformanceFrequency(&f);
-            return static_cast<int64_t>(f.QuadPart > 0 ? f.QuadPart : 1);
-        }();
-
         const int64_t raw = systemRelativeTime.count();
         if (raw <= 0) {
             return captureTsUs;
         }
 
         const int64_t fromTimeSpanUs = raw / 10;
-        const int64_t fromQpcUs = static_cast<int64_t>((raw * 1000000LL) / qpcFrequency);
+        const int64_t fromQpcUs = SystemTicksToUs(raw);
         const int64_t deltaTimeSpanUs = std::llabs(captureTsUs - fromTimeSpanUs);
         const int64_t deltaQpcUs = std::llabs(captureTsUs - fromQpcUs);
         const int64_t sourceTsUs = deltaTimeSpanUs <= deltaQpcUs ? fromTimeSpanUs : fromQpcUs;
@@ -44,73 +38,19 @@ namespace {
     }
 }
 
-FrameSlot::FrameSlot() {
-    InitializeCriticalSection(&cs);
-    evt = CreateEventW(nullptr, FALSE, FALSE, nullptr);
-}
-
-FrameSlot::~FrameSlot() {
-    DeleteCriticalSection(&cs);
-    if (evt) CloseHandle(evt);
-    for (auto& frame : fr) frame.Release();
-}
-
 void FrameSlot::Push(ID3D11Texture2D* tex, int64_t ts, int64_t sourceTs, uint64_t fence, bool sync, int idx) {
     if (!tex) return;
-    EnterCriticalSection(&cs);
-    uint64_t gen = curGen.load(std::memory_order_acquire);
-
-    if (cnt >= N) {
-        if (fr[tail].poolIdx >= 0) inFlight &= ~(1u << fr[tail].poolIdx);
-        fr[tail].Release();
-        tail = (tail + 1) % N;
-        cnt--;
-    }
-
     tex->AddRef();
-    fr[head] = {tex, ts, sourceTs, fence, idx, sync, gen};
-    if (idx >= 0) inFlight |= (1u << idx);
-    head = (head + 1) % N;
-    cnt++;
-    SetEvent(evt);
-    LeaveCriticalSection(&cs);
-}
-
-bool FrameSlot::Pop(FrameData& out) {
-    if (WaitForSingleObject(evt, INFINITE) != WAIT_OBJECT_0) return false;
-    EnterCriticalSection(&cs);
-    if (cnt == 0) { LeaveCriticalSection(&cs); return false; }
-    out = fr[tail];
-    fr[tail] = {};
-    tail = (tail + 1) % N;
-    cnt--;
-    if (cnt > 0) SetEvent(evt);
-    LeaveCriticalSection(&cs);
-    return true;
-}
-
-void FrameSlot::MarkReleased(int i) {
-    if (i < 0) return;
-    EnterCriticalSection(&cs);
-    inFlight &= ~(1u << i);
-    LeaveCriticalSection(&cs);
-}
-
-bool FrameSlot::IsInFlight(int i) {
-    if (i < 0) return false;
-    EnterCriticalSection(&cs);
-    bool r = (inFlight & (1u << i)) != 0;
-    LeaveCriticalSection(&cs);
-    return r;
+    FrameData frame{tex, ts, sourceTs, fence, idx, sync, curGen.load(std::memory_order_acquire)};
+    if (idx >= 0) inFlight.fetch_or(1u << idx, std::memory_order_acq_rel);
+    FrameData replaced;
+    if (box.Publish(frame, replaced)) Drop(replaced);
+    if (onPush) onPush();
 }
 
 void FrameSlot::Reset() {
-    EnterCriticalSection(&cs);
-    for (auto& frame : fr) frame.Release();
-    head = tail = cnt = 0;
-    inFlight = 0;
-    ResetEvent(evt);
-    LeaveCriticalSection(&cs);
+    FrameData frame;
+    if (box.Take(frame)) Drop(frame);
 }
 
 int ScreenCapture::FindTex() {
@@ -230,7 +170,7 @@ void ScreenCapture::InitMon(HMONITOR mon, bool keepFps) {
     slot->SetGeneration(captureGen.fetch_add(1) + 1);
 }
 
-ScreenCapture::ScreenCapture(FrameSlot* s) : slot(s) {
+ScreenCapture::ScreenCapture(FrameSlot* s, int monitor) : slot(s) {
     try { winrt::init_apartment(winrt::apartment_type::multi_threaded); }
     catch (const winrt::hresult_error& e) { if (e.code() != RPC_E_CHANGED_MODE) throw; }
 
@@ -253,10 +193,18 @@ ScreenCapture::ScreenCapture(FrameSlot* s) : slot(s) {
         throw std::runtime_error("WinRT device failed");
     winrtDev = insp.as<WGD::Direct3D11::IDirect3DDevice>();
 
-    RefreshMonitorList();
+    HMONITOR mon = nullptr;
+    if (monitor < 0) {
+        RefreshMonitorList();
+    } else {
+        std::lock_guard<std::mutex> ml(g_monitorsMutex);
+        if (monitor >= static_cast<int>(g_monitors.size())) throw std::runtime_error("Unknown monitor");
+        mon = g_monitors[monitor].hMon;
+        monIdx = monitor;
+    }
     cursorCapture = false;
-    InitMon(MonitorFromPoint({0, 0}, MONITOR_DEFAULTTOPRIMARY));
-    LOG("Capture: %dx%d @ %dHz", w, h, hostFps);
+    InitMon(mon ? mon : MonitorFromPoint({0, 0}, MONITOR_DEFAULTTOPRIMARY));
+    LOG("Capture: %dx%d @ %dHz (monitor %d)", w, h, hostFps, monIdx.load());
 }
 
 ScreenCapture::~ScreenCapture() {
@@ -0,0 +1,441 @@
+#include "host/media/capture_source.hpp"
+
+#include "host/core/clock.hpp"
+#include "host/core/logging.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+extern "C" {
+#include <libavutil/pixfmt.h>
+#include <libswscale/swscale.h>
+}
+
+namespace {
+    // Frame times for sources that replay recorded timestamps: each loop starts one
+    // average frame interval after the previous loop's last frame.
+    class LoopTimeline {
+        int64_t first = 0, last = 0, offset = 0;
+        uint64_t count = 0;
+
+    public:
+        int64_t At(int64_t recordedUs) {
+            if (count == 0) first = recordedUs;
+            last = recordedUs;
+            count++;
+            return offset + recordedUs - first;
+        }
+
+        void Loop(int64_t fallbackPeriodUs) {
+            const int64_t period = count > 1 ? (last - first) / static_cast<int64_t>(count - 1) : fallbackPeriodUs;
+            offset += last - first + std::max<int64_t>(1, period);
+            count = 0;
+        }
+    };
+
+    inline uint32_t Hash32(uint32_t x) {
+        x ^= x >> 16;
+        x *= 0x7FEB352DU;
+        x ^= x >> 15;
+        x *= 0x846CA68BU;
+        return x ^ (x >> 16);
+    }
+
+    inline void PutPixel(uint8_t* p, uint8_t r, uint8_t g, uint8_t b) {
+        p[0] = b;
+        p[1] = g;
+        p[2] = r;
+        p[3] = 255;
+    }
+
+    // Lines of pseudo-glyphs on a light background: 16 px line pitch, 8 px cells.
+    void DrawTextRows(uint8_t* bgra, int w, int yTop, int yEnd, int docOffset) {
+        const int cellsPerRow = std::max(1, w / 8);
+        for (int y = yTop; y < yEnd; ++y) {
+            const int docY = y + docOffset;
+            const int line = docY / 16;
+            const int inLine = docY % 16;
+            const int lineCells = 8 + static_cast<int>(Hash32(static_cast<uint32_t>(line)) % static_cast<uint32_t>(cellsPerRow));
+            uint8_t* row = bgra + static_cast<size_t>(y) * w * 4;
+            for (int x = 0; x < w; ++x) {
+                const int cell = x / 8;
+                const bool glyphArea = inLine >= 3 && inLine < 13 && (x % 8) < 6 && cell < lineCells && cell > 1;
+                const uint32_t bits = Hash32(static_cast<uint32_t>(line * 4099 + cell * 131 + inLine));
+                const bool ink = glyphArea && (Hash32(static_cast<uint32_t>(line * 977 + cell)) % 6) != 0 && ((bits >> (x % 8)) & 1);
+                if (ink) PutPixel(row + x * 4, 32, 32, 40);
+                else PutPixel(row + x * 4, 250, 250, 250);
+            }
+        }
+    }
+
+    class SyntheticSource final : public CaptureSource {
+        std::string pattern;
+        int rateFps = 60;
+        uint64_t frame = 0;
+        uint32_t noiseState = 0x12345678U;
+        std::vector<uint8_t> still;
+
+        void DrawStatic(uint8_t* bgra) {
+            // Desktop wallpaper, a taskbar and one text window; identical every frame.
+            for (int y = 0; y < h; ++y) {
+                uint8_t* row = bgra + static_cast<size_t>(y) * w * 4;
+                for (int x = 0; x < w; ++x) PutPixel(row + x * 4, 20, static_cast<uint8_t>(60 + y * 80 / std::max(1, h)), 120);
+            }
+            const int barTop = h - std::max(1, h / 24);
+            for (int y = barTop; y < h; ++y) {
+                uint8_t* row = bgra + static_cast<size_t>(y) * w * 4;
+                for (int x = 0; x < w; ++x) PutPixel(row + x * 4, 32, 32, 36);
+            }
+            std::vector<uint8_t> window(static_cast<size_t>(w) * h * 4);
+            DrawTextRows(window.data(), w, 0, h, 0);
+            const int x0 = w / 8, x1 = w - w / 8, y0 = h / 10, y1 = barTop - h / 10;
+            for (int y = y0; y < y1; ++y) {
+                memcpy(bgra + (static_cast<size_t>(y) * w + x0) * 4, window.data() + (static_cast<size_t>(y - y0) * w) * 4,
+                       static_cast<size_t>(x1 - x0) * 4);
+            }
+        }
+
+        // The static desktop with a text caret blinking every half second, as an idle
+        // session looks: one tile changes twice a second.
+        void DrawIdle(uint8_t* bgra) {
+            if (still.empty()) {
+                still.resize(static_cast<size_t>(w) * h * 4);
+                DrawStatic(still.data());
+            }
+            memcpy(bgra, still.data(), still.size());
+            if ((frame / std::max(1, rateFps / 2)) % 2 != 0) return;
+            const int x = w / 8 + 40, y0 = h / 10 + 3 * 16 + 2;
+            for (int y = y0; y < std::min(h, y0 + 12); ++y) {
+                for (int dx = 0; dx < 2 && x + dx < w; ++dx) PutPixel(bgra + (static_cast<size_t>(y) * w + x + dx) * 4, 0, 0, 0);
+            }
+        }
+
+        void DrawGradient(uint8_t* bgra) {
+            const int shift = static_cast<int>(frame * 3);
+            for (int y = 0; y < h; ++y) {
+                uint8_t* row = bgra + static_cast<size_t>(y) * w * 4;
+                for (int x = 0; x < w; ++x) {
+                    PutPixel(row + x * 4, static_cast<uint8_t>((x + shift) * 255 / std::max(1, w)),
+                             static_cast<uint8_t>((y + shift / 2) * 255 / std::max(1, h)),
+                             static_cast<uint8_t>(((x + y) / 2 + shift) & 0xFF));
+                }
+            }
+        }
+
+        void DrawNoise(uint8_t* bgra) {
+            auto* px = reinterpret_cast<uint32_t*>(bgra);
+            const size_t count = static_cast<size_t>(w) * h;
+            for (size_t i = 0; i < count; ++i) {
+                noiseState ^= noiseState << 13;
+                noiseState ^= noiseState >> 17;
+                noiseState ^= noiseState << 5;
+                px[i] = noiseState | 0xFF000000U;
+            }
+        }
+
+    public:
+        SyntheticSource(std::string p, int width, int height, int rate) : pattern(std::move(p)), rateFps(std::max(1, rate)) {
+            w = width;
+            h = height;
+        }
+
+        bool Read(std::vector<uint8_t>& bgra) override {
+            bgra.resize(static_cast<size_t>(w) * h * 4);
+            if (pattern == "static") DrawStatic(bgra.data());
+            else if (pattern == "idle") DrawIdle(bgra.data());
+            else if (pattern == "scroll") DrawTextRows(bgra.data(), w, 0, h, static_cast<int>(frame * 4));
+            else if (pattern == "gradient") DrawGradient(bgra.data());
+            else DrawNoise(bgra.data());
+            frameTimeUs = static_cast<int64_t>(frame * 1000000 / static_cast<uint64_t>(rateFps));
+            frame++;
+            return true;
+        }
+
+        std::string Describe() const override { return "synthetic:" + pattern; }
+    };
+
+    class Y4MSource final : public CaptureSource {
+        FILE* file = nullptr;
+        std::string path;
+        long dataStart = 0;
+        int rateNum = 60, rateDen = 1;
+        uint64_t frame = 0;
+        bool recordedTimes = false;
+        LoopTimeline timeline;
+        AVPixelFormat format = AV_PIX_FMT_YUV420P;
+        std::vector<uint8_t> yuv;
+        SwsContext* sws = nullptr;
+
+        bool ParseHeader() {
+            char line[512];
+            if (!fgets(line, sizeof(line), file) || strncmp(line, "YUV4MPEG2", 9) != 0) return false;
+            int num = 0, den = 1;
+            for (char* tok = strtok(line + 9, " \n"); tok; tok = strtok(nullptr, " \n")) {
+                switch (tok[0]) {
+                    case 'W': w = atoi(tok + 1); break;
+                    case 'H': h = atoi(tok + 1); break;
+                    case 'F': sscanf(tok + 1, "%d:%d", &num, &den); break;
+                    case 'C':
+                        if (strncmp(tok + 1, "444", 3) == 0 && !strchr(tok, 'p')) format = AV_PIX_FMT_YUV444P;
+                        else if (strncmp(tok + 1, "420", 3) == 0) format = AV_PIX_FMT_YUV420P;
+                        else {
+                            ERR("Y4MSource: Unsupported colourspace %s in %s", tok, path.c_str());
+                            return false;
+                        }
+                        break;
+                    default: break;
+                }
+            }
+            if (num > 0 && den > 0) {
+                fps = (num + den / 2) / den;
+                rateNum = num;
+                rateDen = den;
+            }
+            dataStart = ftell(file);
+            return w > 0 && h > 0;
+        }
+
+        // FRAME may carry parameters; XTS=<microseconds> is the recorded presentation time.
+        bool ReadFrameHeader(int64_t& recordedUs) {
+            char line[128];
+            if (!fgets(line, sizeof(line), file) || strncmp(line, "FRAME", 5) != 0) return false;
+            const char* xts = strstr(line, " XTS=");
+            recordedUs = xts ? strtoll(xts + 5, nullptr, 10) : -1;
+            return true;
+        }
+
+        [[nodiscard]] int64_t PeriodUs() const { return static_cast<int64_t>(1000000) * rateDen / rateNum; }
+
+    public:
+        explicit Y4MSource(std::string p) : path(std::move(p)) {}
+        ~Y4MSource() override {
+            sws_freeContext(sws);
+            if (file) fclose(file);
+        }
+
+        bool Open() {
+            file = fopen(path.c_str(), "rb");
+            if (!file || !ParseHeader()) {
+                ERR("Y4MSource: Cannot read %s", path.c_str());
+                return false;
+            }
+            const size_t luma = static_cast<size_t>(w) * h;
+            const size_t chroma = format == AV_PIX_FMT_YUV444P ? luma : static_cast<size_t>((w + 1) / 2) * ((h + 1) / 2);
+            yuv.resize(luma + chroma * 2);
+            sws = sws_getContext(w, h, format, w, h, AV_PIX_FMT_BGRA, SWS_BILINEAR, nullptr, nullptr, nullptr);
+            return sws != nullptr;
+        }
+
+        bool Read(std::vector<uint8_t>& bgra) override {
+            int64_t recordedUs = -1;
+            bool ok = ReadFrameHeader(recordedUs) && fread(yuv.data(), 1, yuv.size(), file) == yuv.size();
+            if (!ok) {
+                fseek(file, dataStart, SEEK_SET);
+                timeline.Loop(PeriodUs());
+                ok = ReadFrameHeader(recordedUs) && fread(yuv.data(), 1, yuv.size(), file) == yuv.size();
+                if (!ok) return false;
+            }
+            if (frame == 0) recordedTimes = recordedUs >= 0;
+            frameTimeUs = recordedTimes && recordedUs >= 0 ? timeline.At(recordedUs)
+                : static_cast<int64_t>(frame * 1000000 * static_cast<uint64_t>(rateDen) / static_cast<uint64_t>(rateNum));
+            frame++;
+
+            const int cw = format == AV_PIX_FMT_YUV444P ? w : (w + 1) / 2;
+            const int ch = format == AV_PIX_FMT_YUV444P ? h : (h + 1) / 2;
+            const uint8_t* src[4] = {yuv.data(), yuv.data() + static_cast<size_t>(w) * h,
+                                     yuv.data() + static_cast<size_t>(w) * h + static_cast<size_t>(cw) * ch, nullptr};
+            const int srcStride[4] = {w, cw, cw, 0};
+            bgra.resize(static_cast<size_t>(w) * h * 4);
+            uint8_t* dst[4] = {bgra.data(), nullptr, nullptr, nullptr};
+            const int dstStride[4] = {w * 4, 0, 0, 0};
+            return sws_scale(sws, src, srcStride, 0, h, dst, dstStride) == h;
+        }
+
+        std::string Describe() const override { return "y4m:" + path; }
+    };
+
+    class RawBGRASource final : public CaptureSource {
+        FILE* file = nullptr;
+        std::string path;
+        int rateFps = 60;
+        uint64_t frame = 0;
+        std::vector<int64_t> recordedUs;
+        size_t next = 0;
+        LoopTimeline timeline;
+
+        void LoadTimestamps() {
+            std::ifstream ts(path + ".ts");
+            for (long long us; ts >> us;) recordedUs.push_back(us);
+            if (!recordedUs.empty()) LOG("RawBGRASource: %zu recorded timestamps from %s.ts", recordedUs.size(), path.c_str());
+        }
+
+        void NextFrameTime(bool looped) {
+            if (recordedUs.empty()) {
+                frameTimeUs = static_cast<int64_t>(frame * 1000000 / static_cast<uint64_t>(rateFps));
+            } else {
+                if (looped || next >= recordedUs.size()) {
+                    timeline.Loop(1000000 / rateFps);
+                    next = 0;
+                }
+                frameTimeUs = timeline.At(recordedUs[next++]);
+            }
+            frame++;
+        }
+
+    public:
+        RawBGRASource(std::string p, int width, int height, int rate) : path(std::move(p)), rateFps(std::max(1, rate)) {
+            w = width;
+            h = height;
+        }
+        ~RawBGRASource() override {
+            if (file) fclose(file);
+        }
+
+        bool Open() {
+            file = fopen(path.c_str(), "rb");
+            if (!file) {
+                ERR("RawBGRASource: Cannot open %s", path.c_str());
+                return false;
+            }
+            LoadTimestamps();
+            return true;
+        }
+
+        bool Read(std::vector<uint8_t>& bgra) override {
+            bgra.resize(static_cast<size_t>(w) * h * 4);
+            if (fread(bgra.data(), 1, bgra.size(), file) == bgra.size()) {
+                NextFrameTime(false);
+                return true;
+            }
+            rewind(file);
+            if (fread(bgra.data(), 1, bgra.size(), file) != bgra.size()) return false;
+            NextFrameTime(frame > 0);
+            return true;
+        }
+
+        std::string Describe() const override { return "bgra:" + path; }
+    };
+}
+
+std::unique_ptr<CaptureSource> CreateSyntheticSource(const std::string& pattern, int width, int height, int rateFps) {
+    if (pattern != "static" && pattern != "scroll" && pattern != "gradient" && pattern != "noise") {
+        ERR("CaptureSource: Unknown synthetic pattern '%s'", pattern.c_str());
+        return nullptr;
+    }
+    if (width <= 0 || height <= 0) return nullptr;
+    return std::make_unique<SyntheticSource>(pattern, width, height, rateFps);
+}
+
+std::unique_ptr<CaptureSource> OpenY4MSource(const std::string& path) {
+    auto source = std::make_unique<Y4MSource>(path);
+    if (!source->Open()) return nullptr;
+    return source;
+}
+
+std::unique_ptr<CaptureSource> OpenRawBGRASource(const std::string& path, int width, int height, int rateFps) {
+    if (width <= 0 || height <= 0) {
+        ERR("RawBGRASource: %s needs --size WxH", path.c_str());
+        return nullptr;
+    }
+    auto source = std::make_unique<RawBGRASource>(path, width, height, rateFps);
+    if (!source->Open()) return nullptr;
+    return source;
+}
+
+void MergeFrameChanges(FrameChangeInfo& into, const FrameChangeInfo& skipped) {
+    if (!into.valid || !skipped.valid) {
+        into = {};
+        return;
+    }
+    into.rects.insert(into.rects.end(), skipped.rects.begin(), skipped.rects.end());
+    into.changedTiles = std::min(into.totalTiles, into.changedTiles + skipped.changedTiles);
+}
+
+SourceCapture::SourceCapture(std::unique_ptr<CaptureSource> src) : source(std::move(src)) {}
+
+SourceCapture::~SourceCapture() {
+    Stop();
+}
+
+bool SourceCapture::Start() {
+    if (!source || running.load(std::memory_order_acquire)) return false;
+    running.store(true, std::memory_order_release);
+    worker = std::thread([this] { Run(); });
+    LOG("SourceCapture: Started %s (%dx%d)", source->Describe().c_str(), source->Width(), source->Height());
+    return true;
+}
+
+void SourceCapture::Stop() {
+    running.store(false, std::memory_order_release);
+    mailbox.Wake();
+    if (worker.joinable()) worker.join();
+}
+
+SourceCaptureStats SourceCapture::Stats() const {
+    return {delivered.load(std::memory_order_acquire), replaced.load(std::memory_order_acquire), late.load(std::memory_order_acquire)};
+}
+
+void SourceCapture::Run() {
+    const bool live = source->Live();
+    const int64_t periodUs = 1000000 / (source->Fps() > 0 ? source->Fps() : 60);
+    const int64_t startUs = GetTimestamp();
+    CpuFrame frame, spare;
+    FrameChangeInfo carried;
+    bool hasCarried = false;
+    uint64_t index = 0;
+    int64_t liveDueUs = startUs;
+
+    auto waitUntil = [&](int64_t dueUs) {
+        for (int64_t now = GetTimestamp(); now < dueUs && running.load(std::memory_order_acquire); now = GetTimestamp()) {
+            std::this_thread::sleep_for(std::chrono::microseconds(std::min<int64_t>(dueUs - now, 2000)));
+        }
+    };
+
+    while (running.load(std::memory_order_acquire)) {
+        int64_t dueUs = liveDueUs;
+        if (live) {
+            waitUntil(dueUs);
+            frame.ts = GetTimestamp();
+            // A capture that cannot keep up restarts the cadence from now instead of bursting.
+            liveDueUs = std::max(liveDueUs + periodUs, frame.ts);
+        }
+        if (frame.bgra.empty()) spares.Take(frame.bgra);
+        if (!source->Read(frame.bgra)) {
+            ERR("SourceCapture: %s stopped producing frames at %llu", source->Describe().c_str(), index);
+            break;
+        }
+        if (!live) {
+            dueUs = startUs + source->FrameTimeUs();
+            waitUntil(dueUs);
+            frame.ts = GetTimestamp();
+        }
+
+        frame.width = source->Width();
+        frame.height = source->Height();
+        frame.index = index++;
+        frame.sourceTs = dueUs;
+        const FrameChangeInfo* changes = source->Changes();
+        frame.changes = changes ? *changes : FrameChangeInfo{};
+        if (hasCarried) {
+            MergeFrameChanges(frame.changes, carried);
+            hasCarried = false;
+        }
+        if (frame.ts - dueUs > periodUs) late.fetch_add(1, std::memory_order_relaxed);
+        delivered.fetch_add(1, std::memory_order_release);
+        // The replaced frame's buffer is reused for the next read; its changes carry over.
+        if (mailbox.Publish(frame, spare)) {
+            replaced.fetch_add(1, std::memory_order_relaxed);
+            carried = std::move(spare.changes);
+            hasCarried = true;
+            frame = std::move(spare);
+            spare = {};
+        }
+    }
+
+    running.store(false, std::memory_order_release);
+    mailbox.Wake();
+}
@@ -0,0 +1,133 @@
+#include "host/media/color_convert.hpp"
+
+#include <algorithm>
+#include <bit>
+
+namespace {
+    constexpr int kShift = 14;
+    constexpr double kKr = 0.2126, kKb = 0.0722, kKg = 1.0 - kKr - kKb;
+
+    struct Coefficients {
+        int yr, yg, yb;
+        int ur, ug, ub;
+        int vr, vg, vb;
+        int maxValue, chromaZero;
+    };
+
+    constexpr int Fixed(double v) {
+        return static_cast<int>(v * (1 << kShift) + (v < 0.0 ? -0.5 : 0.5));
+    }
+
+    // Full range: 8-bit RGB 0..255 maps onto 0..2^bits-1 for luma, chroma is centred.
+    constexpr Coefficients MakeCoefficients(int bits) {
+        const double scale = ((1 << bits) - 1) / 255.0;
+        const double cb = 2.0 * (1.0 - kKb), cr = 2.0 * (1.0 - kKr);
+        return {
+            Fixed(kKr * scale), Fixed(kKg * scale), Fixed(kKb * scale),
+            Fixed(-kKr / cb * scale), Fixed(-kKg / cb * scale), Fixed(0.5 * scale),
+            Fixed(0.5 * scale), Fixed(-kKg / cr * scale), Fixed(-kKb / cr * scale),
+            (1 << bits) - 1, 1 << (bits - 1)
+        };
+    }
+
+    constexpr Coefficients k8Bit = MakeCoefficients(8);
+    constexpr Coefficients k10Bit = MakeCoefficients(10);
+
+    template <typename T>
+    inline T* PlaneRow(AVFrame* frame, int plane, int y) {
+        return reinterpret_cast<T*>(frame->data[plane] + static_cast<ptrdiff_t>(y) * frame->linesize[plane]);
+    }
+
+    inline int Clip(int v, int maxValue) {
+        return v < 0 ? 0 : v > maxValue ? maxValue : v;
+    }
+
+    template <int SampleShift>
+    inline uint16_t Luma10(const uint8_t* bgra) {
+        constexpr const Coefficients& c = k10Bit;
+        const int y = (c.yr * bgra[2] + c.yg * bgra[1] + c.yb * bgra[0] + (1 << (kShift - 1))) >> kShift;
+        return static_cast<uint16_t>(Clip(y, c.maxValue) << SampleShift);
+    }
+
+    void ConvertYuv444(const uint8_t* bgra, size_t stride, AVFrame* dst) {
+        constexpr const Coefficients& c = k8Bit;
+        constexpr int round = 1 << (kShift - 1);
+        constexpr int chromaBias = (c.chromaZero << kShift) + round;
+        const int width = dst->width;
+        for (int y = 0; y < dst->height; ++y) {
+            const uint8_t* __restrict src = bgra + static_cast<size_t>(y) * stride;
+            uint8_t* __restrict py = PlaneRow<uint8_t>(dst, 0, y);
+            uint8_t* __restrict pu = PlaneRow<uint8_t>(dst, 1, y);
+            uint8_t* __restrict pv = PlaneRow<uint8_t>(dst, 2, y);
+            for (int x = 0; x < width; ++x) {
+                const int b = src[x * 4], g = src[x * 4 + 1], r = src[x * 4 + 2];
+                py[x] = static_cast<uint8_t>(Clip((c.yr * r + c.yg * g + c.yb * b + round) >> kShift, c.maxValue));
+                pu[x] = static_cast<uint8_t>(Clip((c.ur * r + c.ug * g + c.ub * b + chromaBias) >> kShift, c.maxValue));
+                pv[x] = static_cast<uint8_t>(Clip((c.vr * r + c.vg * g + c.vb * b + chromaBias) >> kShift, c.maxValue));
+            }
+        }
+    }
+
+    // YUV420P10 (three planes) or P010 (interleaved UV, samples in the top ten bits).
+    template <bool SemiPlanar>
+    void ConvertYuv420P10(const uint8_t* bgra, size_t stride, AVFrame* dst) {
+        constexpr const Coefficients& c = k10Bit;
+        constexpr int sampleShift = SemiPlanar ? 6 : 0;
+        // Chroma is computed from the sum of four pixels.
+        constexpr int chromaShift = kShift + 2;
+        constexpr int chromaBias = (c.chromaZero << chromaShift) + (1 << (chromaShift - 1));
+        const int w = dst->width, h = dst->height;
+
+        for (int y = 0; y < h; y += 2) {
+            const int y1 = std::min(y + 1, h - 1);
+            const uint8_t* s0 = bgra + static_cast<size_t>(y) * stride;
+            const uint8_t* s1 = bgra + static_cast<size_t>(y1) * stride;
+            uint16_t* l0 = PlaneRow<uint16_t>(dst, 0, y);
+            uint16_t* l1 = PlaneRow<uint16_t>(dst, 0, y1);
+            uint16_t* pu = PlaneRow<uint16_t>(dst, 1, y / 2);
+            uint16_t* pv = SemiPlanar ? pu : PlaneRow<uint16_t>(dst, 2, y / 2);
+            for (int x = 0; x < w; x += 2) {
+                const int x1 = std::min(x + 1, w - 1);
+                const uint8_t* a = s0 + x * 4;
+                const uint8_t* b = s0 + x1 * 4;
+                const uint8_t* d = s1 + x * 4;
+                const uint8_t* e = s1 + x1 * 4;
+                l0[x] = Luma10<sampleShift>(a);
+                l0[x1] = Luma10<sampleShift>(b);
+                l1[x] = Luma10<sampleShift>(d);
+                l1[x1] = Luma10<sampleShift>(e);
+
+                const int bs = a[0] + b[0] + d[0] + e[0];
+                const int gs = a[1] + b[1] + d[1] + e[1];
+                const int rs = a[2] + b[2] + d[2] + e[2];
+                const auto u = static_cast<uint16_t>(Clip((c.ur * rs + c.ug * gs + c.ub * bs + chromaBias) >> chromaShift, c.maxValue) << sampleShift);
+                const auto v = static_cast<uint16_t>(Clip((c.vr * rs + c.vg * gs + c.vb * bs + chromaBias) >> chromaShift, c.maxValue) << sampleShift);
+                if constexpr (SemiPlanar) {
+                    pu[x] = u;
+                    pu[x + 1] = v;
+                } else {
+                    pu[x / 2] = u;
+                    pv[x / 2] = v;
+                }
+            }
+        }
+    }
+}
+
+bool HasDirectBgraConversion(AVPixelFormat format) {
+    if (format == AV_PIX_FMT_YUV444P) return true;
+    // The 16-bit writers store native-endian samples.
+    return std::endian::native == std::endian::little &&
+           (format == AV_PIX_FMT_YUV420P10LE || format == AV_PIX_FMT_P010LE);
+}
+
+bool ConvertBgraToFrame(const uint8_t* bgra, size_t stride, AVFrame* dst) {
+    if (!bgra || !dst || dst->width <= 0 || dst->height <= 0) return false;
+    const auto format = static_cast<AVPixelFormat>(dst->format);
+    if (!HasDirectBgraConversion(format)) return false;
+
+    if (format == AV_PIX_FMT_YUV444P) ConvertYuv444(bgra, stride, dst);
+    else if (format == AV_PIX_FMT_P010LE) ConvertYuv420P10<true>(bgra, stride, dst);
+    else ConvertYuv420P10<false>(bgra, stride, dst);
+    return true;
+}
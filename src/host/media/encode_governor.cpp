@@ -0,0 +1,152 @@
+#include "host/media/encode_governor.hpp"
+
+#include <algorithm>
+
+namespace {
+    constexpr int64_t kWindowUs = 1'000'000;
+    constexpr size_t kMinSamples = 20;
+    // p95 above kHigh of the frame period is a miss; a restore must project below kLow.
+    constexpr double kHigh = 0.9;
+    constexpr double kLow = 0.7;
+    // Rough encode-time cost of the default preset relative to the faster one.
+    constexpr double kPresetCost = 1.3;
+    constexpr int kOverWindows = 2;
+    constexpr int kBaseRestoreWindows = 3;
+    constexpr int kMaxRestoreWindows = 24;
+}
+
+const char* GovernorActionName(GovernorAction action) {
+    switch (action) {
+        case GovernorAction::FasterPreset: return "faster-preset";
+        case GovernorAction::LowerResolution: return "lower-resolution";
+        case GovernorAction::LowerFps: return "lower-fps";
+        case GovernorAction::RestoreFps: return "restore-fps";
+        case GovernorAction::RestoreResolution: return "restore-resolution";
+        case GovernorAction::RestorePreset: return "restore-preset";
+        default: return "none";
+    }
+}
+
+void EncodeGovernor::Reset(const GovernorConfig& config) {
+    cfg = config;
+    cfg.requestedFps = std::max(1, cfg.requestedFps);
+    cfg.minFps = std::max(1, cfg.minFps);
+    cfg.minScalePercent = std::clamp(cfg.minScalePercent, kMinScalePercent, 100);
+    ClearSamples();
+    windowStartUs = 0;
+    p95Us = -1;
+    budgetUs = 0;
+    fastPreset = false;
+    scalePercent = 100;
+    fpsCap = 0;
+    overWindows = 0;
+    headroomWindows = 0;
+    restoreHold.Reset(kBaseRestoreWindows, kMaxRestoreWindows);
+}
+
+void EncodeGovernor::SetRequestedFps(int fps) {
+    cfg.requestedFps = std::max(1, fps);
+    if (fpsCap >= cfg.requestedFps) fpsCap = 0;
+    overWindows = 0;
+    headroomWindows = 0;
+    ClearSamples();
+}
+
+void EncodeGovernor::ClearSamples() {
+    sampleCount = 0;
+    sampleNext = 0;
+}
+
+int64_t EncodeGovernor::Percentile95() {
+    std::array<int64_t, kSamples> sorted{};
+    std::copy_n(samples.begin(), sampleCount, sorted.begin());
+    const size_t index = (sampleCount * 95) / 100;
+    std::nth_element(sorted.begin(), sorted.begin() + index, sorted.begin() + sampleCount);
+    return sorted[index];
+}
+
+GovernorAction EncodeGovernor::StepDown() {
+    if (cfg.presetAvailable && !fastPreset) {
+        fastPreset = true;
+        return GovernorAction::FasterPreset;
+    }
+    if (scalePercent > cfg.minScalePercent) {
+        scalePercent = NextScaleDown(scalePercent, cfg.minScalePercent);
+        return GovernorAction::LowerResolution;
+    }
+    const int fps = fpsCap > 0 ? fpsCap : cfg.requestedFps;
+    if (fps > cfg.minFps) {
+        fpsCap = std::max(cfg.minFps, fps * 3 / 4);
+        return GovernorAction::LowerFps;
+    }
+    return GovernorAction::None;
+}
+
+GovernorAction EncodeGovernor::StepUp(int64_t framePeriodUs) const {
+    const double limit = kLow * static_cast<double>(framePeriodUs);
+    const double p95 = static_cast<double>(p95Us);
+    if (fpsCap > 0) {
+        const int next = std::min(cfg.requestedFps, std::max(fpsCap + 1, fpsCap * 4 / 3));
+        return p95 < kLow * 1e6 / next ? GovernorAction::RestoreFps : GovernorAction::None;
+    }
+    if (scalePercent < 100) {
+        // Encode time follows the coded pixel count.
+        const double ratio = static_cast<double>(NextScaleUp(scalePercent)) / scalePercent;
+        return p95 * ratio * ratio < limit ? GovernorAction::RestoreResolution : GovernorAction::None;
+    }
+    if (fastPreset) {
+        return p95 * kPresetCost < limit ? GovernorAction::RestorePreset : GovernorAction::None;
+    }
+    return GovernorAction::None;
+}
+
+GovernorAction EncodeGovernor::OnFrame(int64_t nowUs, int64_t encUs, int64_t framePeriodUs) {
+    if (encUs >= 0) {
+        samples[sampleNext] = encUs;
+        sampleNext = (sampleNext + 1) % kSamples;
+        sampleCount = std::min(sampleCount + 1, kSamples);
+    }
+    if (windowStartUs == 0) windowStartUs = nowUs;
+    if (nowUs - windowStartUs < kWindowUs) return GovernorAction::None;
+    windowStartUs = nowUs;
+    if (sampleCount < kMinSamples || framePeriodUs <= 0) return GovernorAction::None;
+
+    budgetUs = framePeriodUs;
+    p95Us = Percentile95();
+
+    if (static_cast<double>(p95Us) > kHigh * static_cast<double>(budgetUs)) {
+        headroomWindows = 0;
+        if (++overWindows < kOverWindows) return GovernorAction::None;
+        overWindows = 0;
+        const GovernorAction action = StepDown();
+        if (action == GovernorAction::None) return action;
+        restoreHold.OnStepDown(nowUs);
+        // Samples from the previous settings no longer apply.
+        ClearSamples();
+        changes++;
+        return action;
+    }
+    overWindows = 0;
+
+    const GovernorAction action = StepUp(framePeriodUs);
+    if (action == GovernorAction::None) {
+        headroomWindows = 0;
+        restoreHold.OnSteady(nowUs);
+        return action;
+    }
+    if (++headroomWindows < restoreHold.Value()) return GovernorAction::None;
+
+    headroomWindows = 0;
+    if (action == GovernorAction::RestoreFps) {
+        const int next = std::min(cfg.requestedFps, std::max(fpsCap + 1, fpsCap * 4 / 3));
+        fpsCap = next >= cfg.requestedFps ? 0 : next;
+    } else if (action == GovernorAction::RestoreResolution) {
+        scalePercent = NextScaleUp(scalePercent);
+    } else {
+        fastPreset = false;
+    }
+    restoreHold.OnStepUp(nowUs);
+    ClearSamples();
+    changes++;
+    return action;
+}
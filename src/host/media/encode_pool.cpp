@@ -0,0 +1,122 @@
+#include "host/media/encode_pool.hpp"
+#include "host/core/common.hpp"
+
+#include <algorithm>
+
+namespace {
+    int64_t PeriodFor(int fps) { return 1000000 / std::clamp(fps, 1, 240); }
+}
+
+EncodeWorkerPool::EncodeWorkerPool(int workers) {
+    const int count = std::clamp(workers, 1, 8);
+    workers_.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        workers_.emplace_back([this] {
+            SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_HIGHEST);
+            Run();
+        });
+    }
+    LOG("EncodeWorkerPool: %d workers", count);
+}
+
+EncodeWorkerPool::~EncodeWorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (auto& worker : workers_) {
+        if (worker.joinable()) worker.join();
+    }
+}
+
+EncodeWorkerPool::Entry* EncodeWorkerPool::Find(int handle) {
+    auto it = std::find_if(entries_.begin(), entries_.end(), [handle](const Entry& e) { return e.handle == handle; });
+    return it != entries_.end() ? &*it : nullptr;
+}
+
+int EncodeWorkerPool::Add(Job job, int fps) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Entry entry;
+    entry.handle = nextHandle_++;
+    entry.job = std::move(job);
+    entry.periodUs = PeriodFor(fps);
+    entries_.push_back(std::move(entry));
+    return entries_.back().handle;
+}
+
+void EncodeWorkerPool::Remove(int handle) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    idle_.wait(lock, [&] { const Entry* e = Find(handle); return !e || !e->busy; });
+    std::erase_if(entries_, [handle](const Entry& e) { return e.handle == handle; });
+}
+
+void EncodeWorkerPool::SetRate(int handle, int fps, bool focused) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Entry* entry = Find(handle);
+        if (!entry) return;
+        const int64_t periodUs = PeriodFor(fps);
+        // A stream gaining focus should not sit out the rest of a background period.
+        if (periodUs < entry->periodUs) entry->dueUs = std::min(entry->dueUs, GetTimestamp() + periodUs);
+        entry->periodUs = periodUs;
+        entry->focused = focused;
+    }
+    wake_.notify_all();
+}
+
+void EncodeWorkerPool::Notify(int handle) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Entry* entry = Find(handle);
+        if (!entry || entry->ready) return;
+        entry->ready = true;
+    }
+    wake_.notify_one();
+}
+
+EncodeWorkerPool::Entry* EncodeWorkerPool::Pick(int64_t nowUs, int64_t& waitUs) {
+    Entry* best = nullptr;
+    waitUs = -1;
+    for (auto& entry : entries_) {
+        if (!entry.ready || entry.busy) continue;
+        if (entry.dueUs > nowUs) {
+            const int64_t untilDue = entry.dueUs - nowUs;
+            if (waitUs < 0 || untilDue < waitUs) waitUs = untilDue;
+            continue;
+        }
+        if (!best || (entry.focused != best->focused ? entry.focused : entry.dueUs < best->dueUs)) best = &entry;
+    }
+    return best;
+}
+
+void EncodeWorkerPool::Run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopping_) {
+        int64_t waitUs = -1;
+        Entry* entry = Pick(GetTimestamp(), waitUs);
+        if (!entry) {
+            if (waitUs < 0) wake_.wait(lock);
+            else wake_.wait_for(lock, std::chrono::microseconds(waitUs));
+            continue;
+        }
+
+        // Deadlines advance by the period while the pool keeps up and restart from now
+        // after a stall, so a late stream does not burst to catch up.
+        const int64_t nowUs = GetTimestamp();
+        entry->dueUs = std::max(entry->dueUs + entry->periodUs, nowUs + entry->periodUs / 2);
+        entry->ready = false;
+        entry->busy = true;
+        const int handle = entry->handle;
+        Job job = entry->job;
+
+        lock.unlock();
+        try { job(); }
+        catch (const std::exception& e) { ERR("EncodeWorkerPool: Job %d failed: %s", handle, e.what()); }
+        catch (...) { ERR("EncodeWorkerPool: Job %d failed", handle); }
+        lock.lock();
+
+        if (Entry* done = Find(handle)) done->busy = false;
+        idle_.notify_all();
+    }
+}
@@ -0,0 +1,113 @@
+#include "host/media/encoded_frame.hpp"
+
+#include "host/core/logging.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+extern "C" {
+#include <libavutil/avutil.h>
+}
+
+EncodedFrame::~EncodedFrame() {
+    Clear();
+    for (AVPacket*& packet : spare) av_packet_free(&packet);
+}
+
+bool EncodedFrame::Append(AVPacket* src) {
+    AVPacket* dst = nullptr;
+    if (!spare.empty()) {
+        dst = spare.back();
+        spare.pop_back();
+    } else if (!(dst = av_packet_alloc())) {
+        ERR("EncodedFrame: av_packet_alloc failed");
+        av_packet_unref(src);
+        return false;
+    }
+    av_packet_move_ref(dst, src);
+    size += static_cast<size_t>(dst->size);
+    packets.push_back(dst);
+    return true;
+}
+
+size_t EncodedFrame::CopyRange(size_t offset, uint8_t* dst, size_t len) const {
+    size_t copied = 0;
+    for (const AVPacket* packet : packets) {
+        if (copied == len) break;
+        const size_t packetSize = static_cast<size_t>(packet->size);
+        if (offset >= packetSize) {
+            offset -= packetSize;
+            continue;
+        }
+        const size_t n = std::min(packetSize - offset, len - copied);
+        memcpy(dst + copied, packet->data + offset, n);
+        copied += n;
+        offset = 0;
+    }
+    return copied;
+}
+
+void EncodedFrame::Clear() {
+    for (AVPacket* packet : packets) {
+        av_packet_unref(packet);
+        spare.push_back(packet);
+    }
+    packets.clear();
+    size = 0;
+    qp = -1;
+    layer = 0;
+    ts = sourceTs = encodeEndTs = enqueueTs = encUs = 0;
+    isKey = isRepeat = false;
+}
+
+void EncodedFrameRecycler::operator()(EncodedFrame* frame) const {
+    if (!frame) return;
+    if (pool) pool->Recycle(frame);
+    else delete frame;
+}
+
+EncodedFrameRef EncodedFramePool::Acquire() {
+    std::unique_ptr<EncodedFrame> frame;
+    {
+        std::lock_guard<std::mutex> lk(mtx);
+        if (!freeFrames.empty()) {
+            frame = std::move(freeFrames.back());
+            freeFrames.pop_back();
+        }
+    }
+    if (!frame) frame = std::make_unique<EncodedFrame>();
+    return EncodedFrameRef(frame.release(), EncodedFrameRecycler{shared_from_this()});
+}
+
+void EncodedFramePool::Recycle(EncodedFrame* frame) {
+    std::unique_ptr<EncodedFrame> owned(frame);
+    owned->Clear();
+    std::lock_guard<std::mutex> lk(mtx);
+    if (freeFrames.size() < kMaxPooledFrames) freeFrames.push_back(std::move(owned));
+}
+
+int DrainEncoderPackets(AVCodecContext* cctx, AVPacket* pkt, EncodedFrame& out, bool& gotKey) {
+    int ret;
+    int packetCount = 0;
+    while ((ret = avcodec_receive_packet(cctx, pkt)) == 0) {
+        packetCount++;
+        if (pkt->flags & AV_PKT_FLAG_KEY) gotKey = true;
+        if (!pkt->data || pkt->size <= 0) {
+            ERR("EncodedFrame: Drained empty/null packet (pkt #%d, size=%d)", packetCount, pkt->size);
+            av_packet_unref(pkt);
+            continue;
+        }
+        DBG("EncodedFrame: Drained pkt #%d size=%d key=%d pts=%lld dts=%lld",
+            packetCount, pkt->size, (pkt->flags & AV_PKT_FLAG_KEY) ? 1 : 0, pkt->pts, pkt->dts);
+        size_t statsSize = 0;
+        if (const uint8_t* stats = av_packet_get_side_data(pkt, AV_PKT_DATA_QUALITY_STATS, &statsSize); stats && statsSize >= 4) {
+            const uint32_t quality = stats[0] | (stats[1] << 8) | (stats[2] << 16) | (static_cast<uint32_t>(stats[3]) << 24);
+            out.qp = static_cast<int>((quality + FF_QP2LAMBDA / 2) / FF_QP2LAMBDA);
+        }
+        out.Append(pkt);
+    }
+    if (ret != AVERROR(EAGAIN) && ret != AVERROR_EOF) {
+        ERR("EncodedFrame: avcodec_receive_packet failed: %s (after %d packets)", AvErr(ret), packetCount);
+    }
+    return packetCount;
+}
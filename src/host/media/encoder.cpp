@@ -2,133 +2,33 @@
 
 #include <d3dcompiler.h>
 
-using std::chrono::steady_clock;
-
 namespace {
     constexpr const char* ENC_NAMES[3][3] = {
         {"av1_nvenc", "hevc_nvenc", "h264_nvenc"},
         {"av1_qsv", "hevc_qsv", "h264_qsv"},
         {"av1_amf", "hevc_amf", "h264_amf"}
     };
-    constexpr const char* SW_AV1_ENC_NAMES[] = {"libsvtav1", "libaom-av1", "librav1e"};
-    constexpr const char* SW_H265_ENC_NAMES[] = {"libx265"};
-    constexpr const char* SW_H264_ENC_NAMES[] = {"libx264"};
-
-    inline int CalcEffectiveFps(int fps) {
-        if (fps <= 60) return fps;
-        if (fps <= 90) return 60 + ((fps - 60) * 2) / 3;
-        return 80 + ((fps - 90) / 3);
-    }
-
-    inline double CalcCodecBitrateFactor(CodecType codec) {
-        switch (codec) {
-            case CODEC_AV1: return 0.112;
-            case CODEC_H265: return 0.138;
-            case CODEC_H264: return 0.165;
-            default: return 0.145;
-        }
-    }
 
-    inline int64_t CalcBitrate(CodecType codec, int w, int h, int fps) {
-        const int effectiveFps = CalcEffectiveFps(fps);
-        const int64_t pixels = static_cast<int64_t>(w) * h;
-        const double factor = CalcCodecBitrateFactor(codec);
-        const int64_t bitrate = static_cast<int64_t>(factor * pixels * effectiveFps);
-        return std::max<int64_t>(6'000'000, bitrate);
-    }
+    // Written once by VideoEncoder::Calibrate before any encoder is created.
+    CalibrationResult g_calibration;
+    bool g_haveCalibration = false;
 
-    inline int64_t CalcMaxRate(int64_t bitrate) {
-        return std::max<int64_t>(bitrate, (bitrate * 115) / 100);
-    }
-
-    inline int CalcBufferSize(int64_t bitrate) {
-        return static_cast<int>(std::max<int64_t>(4'000'000, bitrate / 3));
-    }
-
-    inline int CalcQualityValue(CodecType codec, int w, int h, int fps) {
-        int value = codec == CODEC_H264 ? 25 : codec == CODEC_H265 ? 28 : 31;
-        if (fps > 90) value += 2;
-        else if (fps > 60) value += 1;
-        if (static_cast<int64_t>(w) * h >= 2560LL * 1440LL) value += 1;
-        return value;
-    }
+    constexpr size_t kMaxChangedRegions = 32;
+    constexpr double kMaxChangedRegionFraction = 0.5;
 
     inline const char* GetEncName(CodecType c, GPUVendor v) {
         return v <= GPUVendor::AMD ? ENC_NAMES[static_cast<int>(v)][static_cast<int>(c)] : nullptr;
     }
 
-    inline AVCodecID GetCodecId(CodecType codec) {
-        switch (codec) {
-            case CODEC_AV1: return AV_CODEC_ID_AV1;
-            case CODEC_H265: return AV_CODEC_ID_HEVC;
-            case CODEC_H264: return AV_CODEC_ID_H264;
-            default: return AV_CODEC_ID_NONE;
-        }
-    }
-
-    inline bool IsKnownHardwareEncoder(const char* name) {
-        if (!name) return false;
-        return strstr(name, "_nvenc") || strstr(name, "_qsv") || strstr(name, "_amf");
-    }
-
-    const char* const* GetSoftwareEncoderNames(CodecType codec, size_t& count) {
-        switch (codec) {
-            case CODEC_AV1:
-                count = std::size(SW_AV1_ENC_NAMES);
-                return SW_AV1_ENC_NAMES;
-            case CODEC_H265:
-                count = std::size(SW_H265_ENC_NAMES);
-                return SW_H265_ENC_NAMES;
-            case CODEC_H264:
-                count = std::size(SW_H264_ENC_NAMES);
-                return SW_H264_ENC_NAMES;
-            default:
-                count = 0;
-                return nullptr;
-        }
-    }
-
-    const AVCodec* FindSoftwareEncoder(CodecType codec, std::string& encoderName) {
-        size_t count = 0;
-        if (const char* const* names = GetSoftwareEncoderNames(codec, count)) {
-            for (size_t i = 0; i < count; ++i) {
-                if (const AVCodec* enc = avcodec_find_encoder_by_name(names[i])) {
-                    encoderName = names[i];
-                    return enc;
-                }
-            }
-        }
-
-        if (const AVCodec* enc = avcodec_find_encoder(GetCodecId(codec))) {
-            if (!IsKnownHardwareEncoder(enc->name)) {
-                encoderName = enc->name ? enc->name : "software";
-                return enc;
-            }
-        }
-
-        encoderName.clear();
-        return nullptr;
-    }
-
-    AVPixelFormat SelectSoftwarePixelFormat(const AVCodec* enc) {
-        if (!enc) return AV_PIX_FMT_YUV420P;
-
-        const void* rawFormats = nullptr;
-        int formatCount = 0;
-        if (avcodec_get_supported_config(nullptr, enc, AV_CODEC_CONFIG_PIX_FORMAT, 0, &rawFormats, &formatCount) < 0 ||
-            !rawFormats || formatCount <= 0) {
-            return AV_PIX_FMT_YUV420P;
-        }
-
-        const auto* formats = static_cast<const AVPixelFormat*>(rawFormats);
-
-        for (const AVPixelFormat preferred : {AV_PIX_FMT_YUV420P, AV_PIX_FMT_NV12}) {
-            for (int i = 0; i < formatCount; ++i) {
-                if (formats[i] == preferred) return preferred;
-            }
-        }
-
-        return AV_PIX_FMT_NONE;
+    // Skips encoders calibration saw fail to open, and hardware encoders that
+    // cannot keep up when a software encoder for the same codec can.
+    bool CalibrationAllows(const char* name, CodecType codec, bool hardware) {
+        if (!g_haveCalibration || !name) return true;
+        const EncoderMeasurement* m = g_calibration.Find(name);
+        if (!m) return true;
+        if (!m->opened) return false;
+        if (!hardware || g_calibration.Sustains(*m)) return true;
+        return !(g_calibration.SustainableCodecs() & ~g_calibration.SustainableCodecs(true) & (1 << static_cast<int>(codec)));
     }
 
     std::vector<GPUVendor> GetVendorPriority(GPUVendor detected) {
@@ -260,6 +160,10 @@ const char* VideoEncoder::CodecName(CodecType c) {
     return c <= CODEC_H264 ? names[static_cast<int>(c)] : "Unknown";
 }
 
+const char* VideoEncoder::ContentProfileName(ContentProfile p) {
+    return p == ContentProfile::Screen ? "screen" : "default";
+}
+
 GPUVendor VideoEncoder::DetectGPU(ID3D11Device* device) {
     if (!device) return GPUVendor::UNKNOWN;
 
@@ -287,7 +191,104 @@ GPUVendor VideoEncoder::DetectGPU(ID3D11Device* device) {
     return result;
 }
 
+std::string VideoEncoder::AdapterIdentity(ID3D11Device* device) {
+    std::string identity = "gpu";
+    IDXGIDevice* dxgiDev = nullptr;
+    IDXGIAdapter* adapter = nullptr;
+    if (device && SUCCEEDED(device->QueryInterface(IID_PPV_ARGS(&dxgiDev)))) {
+        if (SUCCEEDED(dxgiDev->GetAdapter(&adapter))) {
+            DXGI_ADAPTER_DESC desc;
+            if (SUCCEEDED(adapter->GetDesc(&desc))) {
+                char name[128];
+                WideCharToMultiByte(CP_UTF8, 0, desc.Description, -1, name, sizeof(name), nullptr, nullptr);
+                char ids[64];
+                snprintf(ids, sizeof(ids), " %04X:%04X", desc.VendorId, desc.DeviceId);
+                identity = std::string(name) + ids;
+            }
+            LARGE_INTEGER umdVersion{};
+            if (SUCCEEDED(adapter->CheckInterfaceSupport(__uuidof(IDXGIDevice), &umdVersion))) {
+                char driver[48];
+                snprintf(driver, sizeof(driver), " driver %u.%u.%u.%u",
+                         HIWORD(umdVersion.HighPart), LOWORD(umdVersion.HighPart),
+                         HIWORD(umdVersion.LowPart), LOWORD(umdVersion.LowPart));
+                identity += driver;
+            }
+            adapter->Release();
+        }
+        dxgiDev->Release();
+    }
+    return identity;
+}
+
+bool VideoEncoder::Calibrate(ID3D11Device* device, int width, int height, int fps) {
+    const int mode = GetEnvInt("SLIPSTREAM_ENCODER_CALIBRATION", 1, 0, 2);
+    if (mode == 0 || width <= 0 || height <= 0 || fps <= 0) {
+        LOG("VideoEncoder: Encoder calibration disabled; using existence probing");
+        return false;
+    }
+
+    CalibrationSettings settings;
+    settings.width = width;
+    settings.height = height;
+    settings.fps = fps;
+    settings.maxMillis = GetEnvInt("SLIPSTREAM_CALIBRATION_MS", settings.maxMillis, 250, 10000);
+    settings.coreBudget = GetEnvInt("SLIPSTREAM_ENCODER_CORE_BUDGET", 0, 0, 256);
+    settings.pin = GetEnvBool("SLIPSTREAM_ENCODER_PIN", false);
+
+    const std::string key = MakeCalibrationKey(AdapterIdentity(device), width, height, fps) +
+                            "|cores " + std::to_string(ResolveCoreBudget(settings.coreBudget));
+    const std::string cachePath = GetSlipStreamDataFilePath("encoder_calibration.json");
+    CalibrationResult result;
+    if (mode == 1 && LoadCalibration(cachePath, key, result)) {
+        LOG("VideoEncoder: Using cached encoder calibration for %dx%d@%d", width, height, fps);
+    } else {
+        std::vector<EncoderCandidate> candidates;
+        const GPUVendor detected = DetectGPU(device);
+        for (int c = 0; c <= 2; c++) {
+            const CodecType codec = static_cast<CodecType>(c);
+            for (GPUVendor v : GetVendorPriority(detected)) {
+                const char* name = GetEncName(codec, v);
+                if (name && avcodec_find_encoder_by_name(name)) candidates.push_back({name, codec, true});
+            }
+            size_t count = 0;
+            const char* const* names = GetSoftwareEncoderNames(codec, count);
+            for (size_t i = 0; names && i < count; ++i) {
+                if (avcodec_find_encoder_by_name(names[i])) candidates.push_back({names[i], codec, false});
+            }
+        }
+        result = CalibrateEncoders(candidates, settings, key);
+        SaveCalibration(cachePath, result);
+    }
+
+    for (int c = 0; c <= 2; c++) {
+        const CodecType codec = static_cast<CodecType>(c);
+        SetSoftwareEncoderPreference(codec, result.Ranked(codec, false));
+    }
+    g_calibration = std::move(result);
+    g_haveCalibration = true;
+    return true;
+}
+
 uint8_t VideoEncoder::ProbeSupport(ID3D11Device* device) {
+    if (g_haveCalibration) {
+        uint8_t support = g_calibration.SustainableCodecs();
+        if (!support) {
+            // Nothing keeps up: advertise the fastest codec rather than none.
+            const EncoderMeasurement* best = nullptr;
+            for (const auto& m : g_calibration.encoders) {
+                if (m.opened && (!best || m.fps > best->fps)) best = &m;
+            }
+            if (best) {
+                support = static_cast<uint8_t>(1 << static_cast<int>(best->codec));
+                WARN("VideoEncoder: No encoder sustains %d fps; offering %s (%.1f fps) only",
+                     g_calibration.fps, best->name.c_str(), best->fps);
+            }
+        }
+        LOG("VideoEncoder: Calibrated codec support: AV1=%d H265=%d H264=%d",
+            (support&1)?1:0, (support&2)?1:0, (support&4)?1:0);
+        if (support) return support;
+    }
+
     uint8_t support = 0;
     GPUVendor detected = DetectGPU(device);
     LOG("VideoEncoder: Probing encoder support (detected GPU: %s)", VendorName(detected));
@@ -320,6 +321,8 @@ uint8_t VideoEncoder::ProbeSupport(ID3D11Device* device) {
 }
 
 uint8_t VideoEncoder::ProbeHardwareSupport(ID3D11Device* device) {
+    if (g_haveCalibration) return g_calibration.SustainableCodecs(true);
+
     uint8_t support = 0;
     GPUVendor detected = DetectGPU(device);
 
@@ -340,6 +343,35 @@ uint8_t VideoEncoder::ProbeHardwareSupport(ID3D11Device* device) {
     return support;
 }
 
+uint8_t VideoEncoder::ProbeFormatSupport(ID3D11Device* device, CodecType codec, bool hardwareCodec) {
+    uint8_t support = 1 << FORMAT_YUV420;
+    const GPUVendor detected = DetectGPU(device);
+
+    // Formats come from the same class of encoder that serves 4:2:0, so opting in
+    // never moves a hardware-encoded codec onto the CPU.
+    for (const EncodeFormat format : {FORMAT_YUV444, FORMAT_YUV420_10}) {
+        bool available = false;
+        if (hardwareCodec) {
+            for (GPUVendor v : GetVendorPriority(detected)) {
+                const char* name = GetEncName(codec, v);
+                const AVCodec* enc = name ? avcodec_find_encoder_by_name(name) : nullptr;
+                if (enc && CalibrationAllows(name, codec, true) && HardwareEncoderSupportsFormat(enc, codec, format)) {
+                    available = true;
+                    break;
+                }
+            }
+        } else {
+            std::string encoderName;
+            available = FindSoftwareEncoder(codec, encoderName, format) != nullptr;
+        }
+        if (available) support |= 1 << format;
+    }
+
+    DBG("VideoEncoder: %s formats: 4:4:4=%d 10-bit=%d", CodecName(codec),
+        (support & (1 << FORMAT_YUV444)) ? 1 : 0, (support & (1 << FORMAT_YUV420_10)) ? 1 : 0);
+    return support;
+}
+
 bool VideoEncoder::InitHwCtx() {
     hwDev = av_hwdevice_ctx_alloc(AV_HWDEVICE_TYPE_D3D11VA);
     if (!hwDev) { ERR("VideoEncoder: av_hwdevice_ctx_alloc failed"); return false; }
@@ -384,71 +416,62 @@ bool VideoEncoder::InitHwCtx() {
     return true;
 }
 
-void VideoEncoder::Configure() {
-    auto set = [this](const char* k, const char* v) {
-        if (av_opt_set(cctx->priv_data, k, v, 0) < 0)
-            DBG("VideoEncoder: av_opt_set(%s=%s) failed", k, v);
-    };
-
+bool VideoEncoder::Configure() {
     if (!usingHardware) {
-        DBG("VideoEncoder: Configuring software encoder %s", activeEncoderName.c_str());
-
-        if (activeEncoderName == "libx264") {
-            set("preset", "ultrafast");
-            set("tune", "zerolatency");
-            set("x264-params", "scenecut=0:open-gop=0");
-            set("annexb", "1");
-        } else if (activeEncoderName == "libx265") {
-            set("preset", "ultrafast");
-            set("tune", "zerolatency");
-            set("x265-params", "scenecut=0:open-gop=0:repeat-headers=1");
-            set("annexb", "1");
-        } else if (activeEncoderName == "libsvtav1") {
-            set("preset", "12");
-            set("tune", "0");
-        } else if (activeEncoderName == "libaom-av1") {
-            set("usage", "realtime");
-            set("cpu-used", "8");
-            set("lag-in-frames", "0");
-            set("row-mt", "1");
-        } else if (activeEncoderName == "librav1e") {
-            set("speed", "10");
-        }
-        return;
+        DBG("VideoEncoder: Configuring software encoder %s (%s content)",
+            activeEncoderName.c_str(), ContentProfileName(contentProfile));
+        SoftwareEncoderOptions opts;
+        opts.profile = contentProfile;
+        opts.slices = sliceCount;
+        opts.coreBudget = coreBudget;
+        opts.pin = pinThreads;
+        opts.crf = rateControlMode ? RateControlTargetQp() : 0;
+        opts.temporalLayers = temporalLayers;
+        opts.roi = roi.enabled;
+        if (const char* faster = fastPreset ? FasterSoftwarePreset(activeEncoderName) : nullptr) opts.preset = faster;
+        ConfigureSoftwareEncoder(cctx, activeEncoderName, opts);
+        cappedQuality = opts.crf > 0 && SupportsCappedCrf(activeEncoderName);
+    } else {
+        DBG("VideoEncoder: Configuring for %s", VendorName(vendor));
+        if (!ConfigureHardwareEncoder(cctx, activeEncoderName, codec, sliceCount, format)) return false;
+        cappedQuality = false;
+    }
+    const bool applies = roi.enabled && SupportsRegionsOfInterest(activeEncoderName);
+    if (roi.enabled && !applies) {
+        LOG("VideoEncoder: %s ignores ROI side data; cursor and changed-region QP offsets are off", activeEncoderName.c_str());
     }
+    roiApplied = applies;
+    layerTracker.Reset(GetTemporalLayers());
+    ResetRateControl();
+    return true;
+}
 
-    DBG("VideoEncoder: Configuring for %s", VendorName(vendor));
-    const std::string qualityValue = std::to_string(CalcQualityValue(codec, w, h, curFps));
-    const char* quality = qualityValue.c_str();
+int VideoEncoder::RateControlTargetQp() const {
+    return targetQpOverride > 0 ? targetQpOverride : CalcQualityValue(codec, w, h, curFps);
+}
 
-    switch (vendor) {
-        case GPUVendor::NVIDIA:
-            set("preset", "p2"); set("tune", "ull"); set("zerolatency", "1");
-            set("rc-lookahead", "0"); set("rc", "vbr"); set("multipass", "disabled");
-            set("delay", "0"); set("surfaces", "3"); set("cq", quality);
-            set("no-scenecut", "1");
-            if (codec != CODEC_AV1) { set("forced-idr", "1"); }
-            break;
-        case GPUVendor::INTEL:
-            set("preset", "veryfast"); set("look_ahead", "0");
-            set("async_depth", "1"); set("low_power", "1"); set("global_quality", quality);
-            set("forced_idr", "1"); set("adaptive_i", "0"); set("adaptive_b", "0");
-            break;
-        case GPUVendor::AMD:
-            set("usage", "ultralowlatency"); set("quality", "balanced");
-            set("rc", "vbr_latency"); set("header_insertion_mode", "gop");
-            set("enforce_hrd", "0"); set("qp_i", quality); set("qp_p", quality);
-            set("forced_idr", "1");
-            break;
-        default:
-            WARN("VideoEncoder: Unknown GPU vendor");
-    }
+void VideoEncoder::ResetRateControl() {
+    dynamicRate = rateControlMode && !cappedQuality && SupportsDynamicBitrate(activeEncoderName);
+    if (!dynamicRate) return;
+    RateControlConfig rc;
+    rc.ceilingBps = CalcBitrate(codec, w, h, curFps);
+    rc.floorBps = std::max<int64_t>(1'000'000, rc.ceilingBps / 6);
+    rc.targetQp = RateControlTargetQp();
+    rc.fps = curFps;
+    rateControl.Reset(rc);
+}
+
+void VideoEncoder::ApplyBitrate(int64_t bitrate) {
+    cctx->bit_rate = bitrate;
+    cctx->rc_max_rate = CalcMaxRate(bitrate);
+    cctx->rc_buffer_size = CalcBufferSize(bitrate);
+    DBG("VideoEncoder: Rate control -> %.2f Mbps (ceiling %.2f Mbps)", bitrate / 1e6, rateControl.Config().ceilingBps / 1e6);
 }
 
 bool VideoEncoder::InitSwFrame(const AVCodec* enc) {
-    swPixFmt = SelectSoftwarePixelFormat(enc);
+    swPixFmt = SelectSoftwarePixelFormat(enc, format);
     if (swPixFmt == AV_PIX_FMT_NONE) {
-        ERR("VideoEncoder: No supported 8-bit software pixel format for %s", enc && enc->name ? enc->name : "unknown");
+        ERR("VideoEncoder: No %s software pixel format for %s", EncodeFormatName(format), enc && enc->name ? enc->name : "unknown");
         return false;
     }
 
@@ -483,6 +506,10 @@ bool VideoEncoder::InitSwFrame(const AVCodec* enc) {
         return false;
     }
 
+    // 4:4:4 and 10-bit frames are converted directly; swscale only reaches them
+    // through its generic scaler.
+    if (HasDirectBgraConversion(swPixFmt)) return true;
+
     swsCtx = sws_getCachedContext(
         nullptr,
         w,
@@ -679,8 +706,76 @@ ID3D11Texture2D* VideoEncoder::PrepareInputTexture(ID3D11Texture2D* tex, const D
     return scaleTex;
 }
 
-bool VideoEncoder::UploadSoftwareFrame(ID3D11Texture2D* tex, AVFrame* frame) {
-    if (!tex || !frame || !stagingTex || !swsCtx) return false;
+RoiConfig RoiConfig::FromEnv() {
+    RoiConfig config;
+    config.enabled = GetEnvBool("SLIPSTREAM_ROI", config.enabled);
+    config.cursorQOffset = GetEnvInt("SLIPSTREAM_ROI_CURSOR_QOFFSET", config.cursorQOffset, -100, 100);
+    config.changedQOffset = GetEnvInt("SLIPSTREAM_ROI_CHANGED_QOFFSET", config.changedQOffset, -100, 100);
+    config.cursorRadius = GetEnvInt("SLIPSTREAM_ROI_CURSOR_RADIUS", config.cursorRadius, 16, 1024);
+    return config;
+}
+
+bool VideoEncoder::SetFastPreset(bool fast) {
+    if (fast == fastPreset) return true;
+    if (!HasFasterPreset()) return false;
+    LOG("VideoEncoder: %s preset requested for %s", fast ? "Faster" : "Default", activeEncoderName.c_str());
+    fastPreset = fast;
+    presetSwitchPending = true;
+    return true;
+}
+
+void VideoEncoder::SetCursorHint(bool visible, float nx, float ny) {
+    cursorX.store(nx, std::memory_order_relaxed);
+    cursorY.store(ny, std::memory_order_relaxed);
+    cursorVisible.store(visible, std::memory_order_release);
+}
+
+void VideoEncoder::AttachRegionsOfInterest(AVFrame* frame, const FrameChangeInfo* changes) {
+    roiScratch.clear();
+    if (!roiApplied) {
+        SetFrameRegionsOfInterest(frame, roiScratch);
+        return;
+    }
+
+    auto addRegion = [&](int left, int top, int right, int bottom, int qoffset) {
+        left = std::clamp(left, 0, w);
+        right = std::clamp(right, 0, w);
+        top = std::clamp(top, 0, h);
+        bottom = std::clamp(bottom, 0, h);
+        if (qoffset == 0 || right <= left || bottom <= top) return;
+        AVRegionOfInterest region{};
+        region.self_size = sizeof(AVRegionOfInterest);
+        region.top = top;
+        region.bottom = bottom;
+        region.left = left;
+        region.right = right;
+        region.qoffset = {qoffset, 100};
+        roiScratch.push_back(region);
+    };
+
+    // Earlier entries take precedence where regions overlap, so the cursor goes first.
+    if (cursorVisible.load(std::memory_order_acquire)) {
+        const int cx = static_cast<int>(cursorX.load(std::memory_order_relaxed) * w);
+        const int cy = static_cast<int>(cursorY.load(std::memory_order_relaxed) * h);
+        addRegion(cx - roi.cursorRadius, cy - roi.cursorRadius, cx + roi.cursorRadius, cy + roi.cursorRadius, roi.cursorQOffset);
+    }
+
+    if (changes && changes->valid && changes->rects.size() <= kMaxChangedRegions &&
+        changes->ChangedFraction() <= kMaxChangedRegionFraction) {
+        for (const TileRect& rect : changes->rects) {
+            addRegion(rect.x, rect.y, rect.x + rect.width, rect.y + rect.height, roi.changedQOffset);
+        }
+    }
+
+    if (!SetFrameRegionsOfInterest(frame, roiScratch)) {
+        DBG("VideoEncoder: Failed to allocate ROI side data (%zu regions)", roiScratch.size());
+    }
+}
+
+bool VideoEncoder::UploadSoftwareFrame(ID3D11Texture2D* tex, AVFrame* frame, bool allowSkip, bool& unchanged) {
+    unchanged = false;
+    const bool direct = HasDirectBgraConversion(swPixFmt);
+    if (!tex || !frame || !stagingTex || (!swsCtx && !direct)) return false;
 
     D3D11_TEXTURE2D_DESC desc{};
     tex->GetDesc(&desc);
@@ -706,9 +801,31 @@ bool VideoEncoder::UploadSoftwareFrame(ID3D11Texture2D* tex, AVFrame* frame) {
         }
     }
 
-    const uint8_t* srcData[4] = {static_cast<const uint8_t*>(mapped.pData), nullptr, nullptr, nullptr};
-    const int srcLinesize[4] = {static_cast<int>(mapped.RowPitch), 0, 0, 0};
-    const int scaled = sws_scale(swsCtx, srcData, srcLinesize, 0, h, frame->data, frame->linesize);
+    const FrameChangeInfo* changes = nullptr;
+    if (staticDetection) {
+        changes = &changeDetector.Analyze(static_cast<const uint8_t*>(mapped.pData), mapped.RowPitch, w, h);
+        if (changes->IsStatic() && allowSkip) {
+            MTLock lk(mt);
+            ctx->Unmap(stagingTex, 0);
+            unchanged = true;
+            return true;
+        }
+    }
+    if (contentProfileMode < 0 && ++framesSinceClassify >= curFps) {
+        framesSinceClassify = 0;
+        const double sample = MeasureSyntheticContent(static_cast<const uint8_t*>(mapped.pData), mapped.RowPitch, w, h);
+        if (contentClassifier.Update(sample)) contentProfileSwitchPending = true;
+    }
+    AttachRegionsOfInterest(frame, changes);
+
+    int scaled = h;
+    if (direct) {
+        ConvertBgraToFrame(static_cast<const uint8_t*>(mapped.pData), mapped.RowPitch, frame);
+    } else {
+        const uint8_t* srcData[4] = {static_cast<const uint8_t*>(mapped.pData), nullptr, nullptr, nullptr};
+        const int srcLinesize[4] = {static_cast<int>(mapped.RowPitch), 0, 0, 0};
+        scaled = sws_scale(swsCtx, srcData, srcLinesize, 0, h, frame->data, frame->linesize);
+    }
 
     {
         MTLock lk(mt);
@@ -729,6 +846,14 @@ bool VideoEncoder::TryInitHardware(GPUVendor v, CodecType cc) {
 
     const AVCodec* enc = avcodec_find_encoder_by_name(encName);
     if (!enc) { DBG("VideoEncoder: Encoder %s not found", encName); return false; }
+    if (!CalibrationAllows(encName, cc, true)) {
+        DBG("VideoEncoder: Skipping %s (failed or too slow in calibration)", encName);
+        return false;
+    }
+    if (!HardwareEncoderSupportsFormat(enc, cc, format)) {
+        DBG("VideoEncoder: Skipping %s (no %s output)", encName, EncodeFormatName(format));
+        return false;
+    }
 
     LOG("VideoEncoder: Trying %s (%s on %s)", encName, CodecName(cc), VendorName(v));
 
@@ -739,30 +864,15 @@ bool VideoEncoder::TryInitHardware(GPUVendor v, CodecType cc) {
     activeEncoderName = encName;
     if (!InitHwCtx()) { avcodec_free_context(&cctx); return false; }
 
-    int64_t br = CalcBitrate(codec, w, h, curFps);
-    cctx->width = w;
-    cctx->height = h;
-    cctx->time_base = {1, curFps};
-    cctx->framerate = {curFps, 1};
-    cctx->bit_rate = br;
-    cctx->rc_max_rate = CalcMaxRate(br);
-    cctx->rc_buffer_size = CalcBufferSize(br);
-    cctx->gop_size = -1;
-    cctx->max_b_frames = 0;
-    cctx->flags |= AV_CODEC_FLAG_LOW_DELAY;
-    cctx->flags2 |= AV_CODEC_FLAG2_FAST;
-    cctx->delay = 0;
+    ApplyRealtimeEncoderDefaults(cctx, codec, w, h, curFps);
     cctx->thread_count = 1;
-    cctx->color_range = AVCOL_RANGE_JPEG;
-    cctx->colorspace = AVCOL_SPC_BT709;
-    cctx->color_primaries = AVCOL_PRI_BT709;
-    cctx->color_trc = AVCOL_TRC_BT709;
 
     vendor = v;
-    Configure();
+    const bool configured = Configure();
+    if (!configured) WARN("VideoEncoder: %s cannot encode %s", encName, EncodeFormatName(format));
 
-    if (avcodec_open2(cctx, enc, nullptr) < 0) {
-        ERR("VideoEncoder: avcodec_open2 failed for %s", encName);
+    if (!configured || avcodec_open2(cctx, enc, nullptr) < 0) {
+        if (configured) ERR("VideoEncoder: avcodec_open2 failed for %s", encName);
         av_buffer_unref(&hwFrCtx);
         av_buffer_unref(&hwDev);
         avcodec_free_context(&cctx);
@@ -778,10 +888,10 @@ bool VideoEncoder::TryInitHardware(GPUVendor v, CodecType cc) {
 
 bool VideoEncoder::TryInitSoftware(CodecType cc) {
     std::string encoderName;
-    const AVCodec* enc = FindSoftwareEncoder(cc, encoderName);
+    const AVCodec* enc = FindSoftwareEncoder(cc, encoderName, format);
     if (!enc) return false;
 
-    LOG("VideoEncoder: Trying software encoder %s (%s)", encoderName.c_str(), CodecName(cc));
+    LOG("VideoEncoder: Trying software encoder %s (%s %s)", encoderName.c_str(), CodecName(cc), EncodeFormatName(format));
 
     cctx = avcodec_alloc_context3(enc);
     if (!cctx) {
@@ -793,24 +903,7 @@ bool VideoEncoder::TryInitSoftware(CodecType cc) {
     vendor = GPUVendor::UNKNOWN;
     activeEncoderName = encoderName;
 
-    int64_t br = CalcBitrate(codec, w, h, curFps);
-    cctx->width = w;
-    cctx->height = h;
-    cctx->time_base = {1, curFps};
-    cctx->framerate = {curFps, 1};
-    cctx->bit_rate = br;
-    cctx->rc_max_rate = CalcMaxRate(br);
-    cctx->rc_buffer_size = CalcBufferSize(br);
-    cctx->gop_size = -1;
-    cctx->max_b_frames = 0;
-    cctx->flags |= AV_CODEC_FLAG_LOW_DELAY;
-    cctx->flags2 |= AV_CODEC_FLAG2_FAST;
-    cctx->delay = 0;
-    cctx->thread_count = 0;
-    cctx->color_range = AVCOL_RANGE_JPEG;
-    cctx->colorspace = AVCOL_SPC_BT709;
-    cctx->color_primaries = AVCOL_PRI_BT709;
-    cctx->color_trc = AVCOL_TRC_BT709;
+    ApplyRealtimeEncoderDefaults(cctx, codec, w, h, curFps);
 
     if (!InitSwFrame(enc)) {
         avcodec_free_context(&cctx);
@@ -819,7 +912,7 @@ bool VideoEncoder::TryInitSoftware(CodecType cc) {
     }
 
     cctx->pix_fmt = swPixFmt;
-    Configure();
+    (void)Configure();
 
     if (avcodec_open2(cctx, enc, nullptr) < 0) {
         ERR("VideoEncoder: avcodec_open2 failed for software encoder %s", encoderName.c_str());
@@ -836,49 +929,71 @@ bool VideoEncoder::TryInitSoftware(CodecType cc) {
     return true;
 }
 
-bool VideoEncoder::DrainPackets(bool& gotKey) {
-    int ret;
-    int packetCount = 0;
-    while ((ret = avcodec_receive_packet(cctx, pkt)) == 0) {
-        packetCount++;
-        if (pkt->flags & AV_PKT_FLAG_KEY) gotKey = true;
-        if (!pkt->data || pkt->size <= 0) {
-            ERR("VideoEncoder: DrainPackets got empty/null packet (pkt #%d, size=%d)", packetCount, pkt->size);
-            av_packet_unref(pkt);
-            continue;
-        }
-        DBG("VideoEncoder: DrainPackets pkt #%d size=%d key=%d pts=%lld dts=%lld",
-            packetCount, pkt->size, (pkt->flags & AV_PKT_FLAG_KEY) ? 1 : 0, pkt->pts, pkt->dts);
-        out.data.insert(out.data.end(), pkt->data, pkt->data + pkt->size);
-        av_packet_unref(pkt);
-    }
-    if (ret != AVERROR(EAGAIN) && ret != AVERROR_EOF) {
-        ERR("VideoEncoder: DrainPackets unexpected error: %s (after %d packets)", AvErr(ret), packetCount);
-    }
-    if (packetCount == 0) {
-        DBG("VideoEncoder: DrainPackets produced no packets (ret=%s)", AvErr(ret));
-    }
-    return !out.data.empty();
+void VideoEncoder::ReleaseSoftwareEncoder() {
+    sws_freeContext(swsCtx);
+    swsCtx = nullptr;
+    SafeRelease(stagingTex);
+    av_frame_free(&swFr);
+    if (cctx) avcodec_free_context(&cctx);
+    activeEncoderName.clear();
+}
+
+bool VideoEncoder::ReopenSoftwareEncoder(ContentProfile profile) {
+    const ContentProfile previous = contentProfile;
+    LOG("VideoEncoder: Reopening %s (%s -> %s content profile, score=%.2f, %s preset)",
+        activeEncoderName.c_str(), ContentProfileName(previous), ContentProfileName(profile), contentClassifier.GetScore(),
+        fastPreset ? "fast" : "default");
+
+    ReleaseSoftwareEncoder();
+    contentProfile = profile;
+    if (TryInitSoftware(codec)) return true;
+
+    WARN("VideoEncoder: Reopen with %s profile failed, restoring %s", ContentProfileName(profile), ContentProfileName(previous));
+    contentProfile = previous;
+    return TryInitSoftware(codec);
+}
+
+bool VideoEncoder::DrainPackets(EncodedFrame& out, bool& gotKey) {
+    const int packetCount = DrainEncoderPackets(cctx, pkt, out, gotKey);
+    if (packetCount == 0) DBG("VideoEncoder: DrainPackets produced no packets (frame=%d)", frameNum - 1);
+    return out.size > 0;
 }
 
 VideoEncoder::VideoEncoder(int width, int height, int fps, ID3D11Device* d,
-                           ID3D11DeviceContext* c, ID3D11Multithread* m, CodecType cc)
-    : w(width), h(height), curFps(fps), dev(d), ctx(c), mt(m), codec(cc) {
-    LOG("VideoEncoder: Creating %dx%d @ %dfps, codec: %s", w, h, fps, CodecName(cc));
+                           ID3D11DeviceContext* c, ID3D11Multithread* m, CodecType cc, EncodeFormat fmt)
+    : w(width), h(height), curFps(fps), dev(d), ctx(c), mt(m), codec(cc), format(fmt) {
+    LOG("VideoEncoder: Creating %dx%d @ %dfps, codec: %s %s", w, h, fps, CodecName(cc), EncodeFormatName(fmt));
 
     dev->AddRef();
     if (ctx) ctx->AddRef(); else dev->GetImmediateContext(&ctx);
     if (mt) mt->AddRef();
 
-    lastKey = steady_clock::now() - KEY_INT;
+    lastKeyUs = GetTimestamp() - KEY_INT_US;
+    staticDetection = GetEnvBool("SLIPSTREAM_STATIC_DETECTION", true);
+    roi = RoiConfig::FromEnv();
+    contentProfileMode = GetEnvInt("SLIPSTREAM_CONTENT_PROFILE", -1, -1, 1);
+    sliceCount = GetEnvInt("SLIPSTREAM_SLICES", 0, 0, 16);
+    temporalLayers = GetEnvInt("SLIPSTREAM_TEMPORAL_LAYERS", 1, 1, 3);
+    coreBudget = GetEnvInt("SLIPSTREAM_ENCODER_CORE_BUDGET", 0, 0, 256);
+    pinThreads = GetEnvBool("SLIPSTREAM_ENCODER_PIN", false);
+    rateControlMode = GetEnvInt("SLIPSTREAM_RATE_CONTROL", 1, 0, 1);
+    targetQpOverride = GetEnvInt("SLIPSTREAM_RC_TARGET_QP", 0, 0, 63);
+    if (contentProfileMode >= 0) contentProfile = static_cast<ContentProfile>(contentProfileMode);
     sync.Init(dev, ctx);
 
-    for (GPUVendor v : GetVendorPriority(DetectGPU(dev))) {
-        if (TryInitHardware(v, cc)) break;
+    const auto initEncoder = [&] {
+        for (GPUVendor v : GetVendorPriority(DetectGPU(dev))) {
+            if (TryInitHardware(v, cc)) return;
+        }
+        TryInitSoftware(cc);
+    };
+    initEncoder();
+    if (!cctx && format != FORMAT_YUV420) {
+        WARN("VideoEncoder: No %s encoder for %s, falling back to 4:2:0", EncodeFormatName(format), CodecName(cc));
+        format = FORMAT_YUV420;
+        initEncoder();
     }
 
-    if (!cctx) TryInitSoftware(cc);
-
     if (!cctx) throw std::runtime_error("No encoder available for requested codec");
 
     pkt = av_packet_alloc();
@@ -892,15 +1007,29 @@ VideoEncoder::VideoEncoder(int width, int height, int fps, ID3D11Device* d,
         hwFr->height = h;
     }
 
-    LOG("Encoder: %dx%d @ %dfps, %.2f Mbps, codec: %s, encoder: %s, backend: %s",
-        w, h, fps, CalcBitrate(cc, w, h, fps) / 1e6, CodecName(cc),
+    LOG("Encoder: %dx%d @ %dfps, %.2f Mbps, codec: %s %s, encoder: %s, backend: %s",
+        w, h, fps, CalcBitrate(cc, w, h, fps) / 1e6, CodecName(cc), EncodeFormatName(format),
         activeEncoderName.empty() ? "unknown" : activeEncoderName.c_str(),
         usingHardware ? VendorName(vendor) : "Software");
+    if (rateControlMode) {
+        LOG("VideoEncoder: Rate control: %s, target QP %d", cappedQuality ? "capped CRF" : dynamicRate ? "adaptive bitrate" : "fixed",
+            RateControlTargetQp());
+    }
+    if (temporalLayers > 1) {
+        if (GetTemporalLayers() > 1) LOG("VideoEncoder: Temporal layers: L1T%d", temporalLayers);
+        else WARN("VideoEncoder: %s has no temporal layer support - streaming a single layer", activeEncoderName.c_str());
+    }
 }
 
 VideoEncoder::~VideoEncoder() {
-    LOG("VideoEncoder: Destroying (encoded %llu frames, %llu failed)",
-        totalFrames.load(), failedFrames.load());
+    const uint64_t skipped = staticFrames.load();
+    const uint64_t seen = totalFrames.load() + skipped;
+    LOG("VideoEncoder: Destroying (encoded %llu frames, %llu failed, %llu static skipped = %.1f%%)",
+        totalFrames.load(), failedFrames.load(), skipped, seen ? 100.0 * skipped / seen : 0.0);
+    if (dynamicRate) {
+        LOG("VideoEncoder: Rate control averaged %.2f of %.2f Mbps over %llu updates",
+            rateControl.AverageTargetBps() / 1e6, rateControl.Config().ceilingBps / 1e6, rateControl.UpdateCount());
+    }
     av_packet_free(&pkt);
     av_frame_free(&hwFr);
     av_frame_free(&swFr);
@@ -921,7 +1050,8 @@ VideoEncoder::~VideoEncoder() {
 bool VideoEncoder::UpdateFPS(int fps) {
     if (fps == curFps || fps < 1 || fps > 240) return false;
     int64_t br = CalcBitrate(codec, w, h, fps);
-    cctx->bit_rate = br;
+    // Capped-CRF encoders keep bit_rate at 0; only the ceiling follows the frame rate.
+    if (!cappedQuality) cctx->bit_rate = br;
     cctx->rc_max_rate = CalcMaxRate(br);
     cctx->rc_buffer_size = CalcBufferSize(br);
     cctx->time_base = {1, fps};
@@ -929,7 +1059,8 @@ bool VideoEncoder::UpdateFPS(int fps) {
     cctx->gop_size = -1;
     LOG("VideoEncoder: FPS updated %d -> %d (bitrate: %.2f Mbps)", curFps, fps, br / 1e6);
     curFps = fps;
-    lastKey = steady_clock::now() - KEY_INT;
+    ResetRateControl();
+    lastKeyUs = GetTimestamp() - KEY_INT_US;
     return true;
 }
 
@@ -948,17 +1079,30 @@ void VideoEncoder::Flush() {
     }
     DBG("VideoEncoder: Flush drained %d packets", flushedPackets);
     avcodec_flush_buffers(cctx);
-    lastKey = steady_clock::now() - KEY_INT;
+    lastKeyUs = GetTimestamp() - KEY_INT_US;
     LOG("VideoEncoder: Flush complete");
 }
 
-EncodedFrame* VideoEncoder::Encode(ID3D11Texture2D* tex, int64_t ts, int64_t sourceTs, bool forceKey) {
-    LARGE_INTEGER t0, t1;
-    QueryPerformanceCounter(&t0);
-    out.Clear();
+EncodedFrameRef VideoEncoder::Encode(ID3D11Texture2D* tex, int64_t ts, int64_t sourceTs, bool forceKey) {
+    const int64_t t0 = GetTimestamp();
 
     if (!tex) { WARN("VideoEncoder: Null texture"); return nullptr; }
 
+    if (!usingHardware && (contentProfileSwitchPending || presetSwitchPending)) {
+        // Each reopen costs a keyframe, so profile flips wait out the hold; preset steps have the governor's.
+        const bool profileDue = contentProfileSwitchPending && t0 - lastProfileSwitchUs >= kProfileSwitchHoldUs;
+        const ContentProfile profile = profileDue ? contentClassifier.GetProfile() : contentProfile;
+        if (profileDue) contentProfileSwitchPending = false;
+        if (presetSwitchPending || profile != contentProfile) {
+            presetSwitchPending = false;
+            if (profile != contentProfile) lastProfileSwitchUs = t0;
+            if (!ReopenSoftwareEncoder(profile)) {
+                ERR("VideoEncoder: %s could not be reopened - the encoder needs a rebuild", CodecName(codec));
+            }
+        }
+    }
+    if (!cctx) { failedFrames++; return nullptr; }
+
     D3D11_TEXTURE2D_DESC desc;
     tex->GetDesc(&desc);
     ID3D11Texture2D* inputTex = PrepareInputTexture(tex, desc);
@@ -998,12 +1142,24 @@ EncodedFrame* VideoEncoder::Encode(ID3D11Texture2D* tex, int64_t ts, int64_t sou
             return nullptr;
         }
 
+        AttachRegionsOfInterest(hwFr, nullptr);
         encodeFrame = hwFr;
     } else {
-        if (!UploadSoftwareFrame(inputTex, swFr)) {
+        bool unchanged = false;
+        if (!UploadSoftwareFrame(inputTex, swFr, !needKey, unchanged)) {
+            changeDetector.Reset();
             failedFrames++;
             return nullptr;
         }
+        if (unchanged) {
+            EncodedFrameRef repeat = framePool->Acquire();
+            repeat->ts = ts;
+            repeat->sourceTs = sourceTs > 0 ? sourceTs : ts;
+            repeat->encodeEndTs = GetTimestamp();
+            repeat->isRepeat = true;
+            staticFrames++;
+            return repeat;
+        }
         encodeFrame = swFr;
     }
 
@@ -1016,51 +1172,63 @@ EncodedFrame* VideoEncoder::Encode(ID3D11Texture2D* tex, int64_t ts, int64_t sou
         DBG("VideoEncoder: Encoding keyframe (frame %d)", frameNum - 1);
     }
 
+    EncodedFrameRef frameRef = framePool->Acquire();
+    EncodedFrame& out = *frameRef;
     bool gotKey = false;
     int ret = avcodec_send_frame(cctx, encodeFrame);
     if (ret == AVERROR(EAGAIN)) {
-        DrainPackets(gotKey);
+        DrainPackets(out, gotKey);
         ret = avcodec_send_frame(cctx, encodeFrame);
     }
 
     if (ret < 0 && ret != AVERROR_EOF) {
         ERR("VideoEncoder: avcodec_send_frame failed: %s", AvErr(ret));
-        av_frame_unref(encodeFrame);
+        if (usingHardware) av_frame_unref(encodeFrame);
+        // The tile hashes already hold this frame; without the reset its twin would be skipped.
+        changeDetector.Reset();
         failedFrames++;
         return nullptr;
     }
 
-    DrainPackets(gotKey);
-    av_frame_unref(encodeFrame);
+    DrainPackets(out, gotKey);
+    if (!out.packets.empty()) {
+        const AVPacket* first = out.packets.front();
+        out.layer = layerTracker.Next(codec, first->data, static_cast<size_t>(first->size), gotKey);
+    }
+    // swFr owns the persistent software buffers; unreffing it would reset its format and size.
+    if (usingHardware) av_frame_unref(encodeFrame);
 
-    if (out.data.empty()) {
+    if (out.size == 0) {
         WARN("VideoEncoder: Encode produced empty output (frame=%d, ts=%lld, needKey=%d) - frame dropped", frameNum - 1, ts, needKey ? 1 : 0);
+        changeDetector.Reset();
         failedFrames++;
         return nullptr;
     }
 
-    QueryPerformanceCounter(&t1);
-    static const int64_t freq = [] { LARGE_INTEGER f; QueryPerformanceFrequency(&f); return f.QuadPart; }();
-
     out.ts = ts;
     out.sourceTs = sourceTs > 0 ? sourceTs : ts;
     out.encodeEndTs = GetTimestamp();
-    out.encUs = ((t1.QuadPart - t0.QuadPart) * 1000000) / freq;
+    out.encUs = out.encodeEndTs - t0;
     out.isKey = gotKey;
     totalFrames++;
 
+    if (dynamicRate && rateControl.OnFrame(out.size, gotKey, out.qp)) {
+        ApplyBitrate(rateControl.TargetBitrate());
+    }
+
     if (gotKey) {
-        lastKey = steady_clock::now();
+        lastKeyUs = GetTimestamp();
     }
 
     if (needKey && !gotKey) {
         WARN("VideoEncoder: Requested keyframe but encoder did not produce one (frame=%d, ts=%lld, size=%zu)",
-            frameNum - 1, ts, out.data.size());
+            frameNum - 1, ts, out.size);
     }
 
     // Stream corruption check: verify frame starts with valid NAL/OBU header
-    if (out.data.size() >= 4) {
-        const uint8_t* d = out.data.data();
+    if (out.size >= 4) {
+        uint8_t d[4];
+        out.CopyRange(0, d, sizeof(d));
         bool validStart = false;
         if (codec == CODEC_H264 || codec == CODEC_H265) {
             // Check for Annex B start code (0x00000001 or 0x000001)
@@ -1074,16 +1242,16 @@ EncodedFrame* VideoEncoder::Encode(ID3D11Texture2D* tex, int64_t ts, int64_t sou
         if (!validStart) {
             ERR("VideoEncoder: STREAM CORRUPTION - invalid bitstream header [%02X %02X %02X %02X] "
                 "(frame=%d, key=%d, size=%zu, codec=%s)",
-                d[0], d[1], d[2], d[3], frameNum - 1, gotKey ? 1 : 0, out.data.size(), CodecName(codec));
+                d[0], d[1], d[2], d[3], frameNum - 1, gotKey ? 1 : 0, out.size, CodecName(codec));
         }
-    } else if (out.data.size() > 0) {
+    } else if (out.size > 0) {
         WARN("VideoEncoder: Suspiciously small encoded frame: %zu bytes (frame=%d, key=%d)",
-            out.data.size(), frameNum - 1, gotKey ? 1 : 0);
+            out.size, frameNum - 1, gotKey ? 1 : 0);
     }
 
     DBG("VideoEncoder: Encoded frame=%d ts=%lld sourceTs=%lld encodeStartTs=%lld encodeEndTs=%lld key=%d size=%zu encUs=%lld total=%llu failed=%llu",
-        frameNum - 1, ts, out.sourceTs, encodeStartTs, out.encodeEndTs, gotKey ? 1 : 0, out.data.size(), out.encUs,
+        frameNum - 1, ts, out.sourceTs, encodeStartTs, out.encodeEndTs, gotKey ? 1 : 0, out.size, out.encUs,
         totalFrames.load(), failedFrames.load());
 
-    return &out;
+    return frameRef;
 }
@@ -0,0 +1,349 @@
+#include "host/media/encoder_calibration.hpp"
+
+#include "host/core/logging.hpp"
+#include "host/media/encoded_frame.hpp"
+#include "host/media/encoder_settings.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <thread>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define SLIPSTREAM_HAVE_CPUID 1
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <cpuid.h>
+#define SLIPSTREAM_HAVE_CPUID 1
+#endif
+
+extern "C" {
+#include <libavutil/avutil.h>
+#include <libavutil/imgutils.h>
+#include <libavutil/pixdesc.h>
+}
+
+using std::chrono::steady_clock;
+
+namespace {
+    constexpr int kCacheVersion = 1;
+    constexpr size_t kMaxCacheEntries = 8;
+    constexpr int kWarmupFrames = 3;
+
+    std::string CpuBrand() {
+        std::string brand;
+#ifdef SLIPSTREAM_HAVE_CPUID
+        unsigned int regs[12] = {};
+#ifdef _MSC_VER
+        int info[4] = {};
+        __cpuid(info, static_cast<int>(0x80000000));
+        if (static_cast<unsigned int>(info[0]) >= 0x80000004) {
+            for (int i = 0; i < 3; ++i) {
+                __cpuid(info, static_cast<int>(0x80000002 + i));
+                memcpy(regs + i * 4, info, sizeof(info));
+            }
+        }
+#else
+        if (__get_cpuid_max(0x80000000, nullptr) >= 0x80000004) {
+            for (unsigned int i = 0; i < 3; ++i)
+                __get_cpuid(0x80000002 + i, &regs[i * 4], &regs[i * 4 + 1], &regs[i * 4 + 2], &regs[i * 4 + 3]);
+        }
+#endif
+        brand.assign(reinterpret_cast<const char*>(regs), strnlen(reinterpret_cast<const char*>(regs), sizeof(regs)));
+        brand.erase(0, brand.find_first_not_of(' '));
+#endif
+        if (brand.empty()) brand = "cpu";
+        return brand + " x" + std::to_string(std::thread::hardware_concurrency());
+    }
+
+    AVPixelFormat SelectCalibrationPixelFormat(const AVCodec* enc, bool hardware) {
+        if (!hardware) return SelectSoftwarePixelFormat(enc);
+        // Hardware encoders take system-memory NV12 and upload it themselves.
+        const void* rawFormats = nullptr;
+        int formatCount = 0;
+        if (avcodec_get_supported_config(nullptr, enc, AV_CODEC_CONFIG_PIX_FORMAT, 0, &rawFormats, &formatCount) < 0 ||
+            !rawFormats || formatCount <= 0) {
+            return AV_PIX_FMT_NV12;
+        }
+        const auto* formats = static_cast<const AVPixelFormat*>(rawFormats);
+        AVPixelFormat fallback = AV_PIX_FMT_NONE;
+        for (int i = 0; i < formatCount; ++i) {
+            if (formats[i] == AV_PIX_FMT_NV12) return formats[i];
+            const AVPixFmtDescriptor* desc = av_pix_fmt_desc_get(formats[i]);
+            if (fallback == AV_PIX_FMT_NONE && desc && !(desc->flags & AV_PIX_FMT_FLAG_HWACCEL) && desc->comp[0].depth == 8)
+                fallback = formats[i];
+        }
+        return fallback;
+    }
+
+    // A gradient scrolling under a block of moving noise: enough motion and
+    // detail that rate control and motion search do real work every frame.
+    void FillSyntheticFrame(AVFrame* frame, int index) {
+        const auto* desc = av_pix_fmt_desc_get(static_cast<AVPixelFormat>(frame->format));
+        const int w = frame->width, h = frame->height;
+        uint32_t seed = 0x9E3779B9u ^ static_cast<uint32_t>(index);
+
+        const int boxW = std::max(16, w / 4), boxH = std::max(16, h / 4);
+        const int boxX = (index * 7) % std::max(1, w - boxW);
+        const int boxY = (index * 3) % std::max(1, h - boxH);
+        for (int y = 0; y < h; ++y) {
+            uint8_t* row = frame->data[0] + static_cast<size_t>(y) * frame->linesize[0];
+            const bool inBoxRow = y >= boxY && y < boxY + boxH;
+            for (int x = 0; x < w; ++x) {
+                if (inBoxRow && x >= boxX && x < boxX + boxW) {
+                    seed = seed * 1664525u + 1013904223u;
+                    row[x] = static_cast<uint8_t>(seed >> 24);
+                } else {
+                    row[x] = static_cast<uint8_t>(((x + index * 4) ^ (y / 8)) & 0xFF);
+                }
+            }
+        }
+
+        const int chromaRows = desc ? AV_CEIL_RSHIFT(h, desc->log2_chroma_h) : h / 2;
+        for (int plane = 1; plane < 4 && frame->data[plane]; ++plane) {
+            const int rowBytes = av_image_get_linesize(static_cast<AVPixelFormat>(frame->format), w, plane);
+            for (int y = 0; y < chromaRows; ++y) {
+                uint8_t* row = frame->data[plane] + static_cast<size_t>(y) * frame->linesize[plane];
+                for (int x = 0; x < rowBytes; ++x) row[x] = static_cast<uint8_t>(128 + ((x + y + index) & 31) - 16);
+            }
+        }
+    }
+
+    double Percentile(std::vector<double> values, double p) {
+        if (values.empty()) return 0.0;
+        std::sort(values.begin(), values.end());
+        const size_t idx = std::min(values.size() - 1, static_cast<size_t>(p * static_cast<double>(values.size() - 1) + 0.5));
+        return values[idx];
+    }
+
+    nlohmann::json ToJson(const CalibrationResult& result) {
+        nlohmann::json encoders = nlohmann::json::array();
+        for (const auto& m : result.encoders) {
+            encoders.push_back({{"name", m.name}, {"codec", static_cast<int>(m.codec)}, {"hardware", m.hardware},
+                                {"opened", m.opened}, {"frames", m.frames}, {"fps", m.fps},
+                                {"latencyP50Ms", m.latencyP50Ms}, {"latencyP95Ms", m.latencyP95Ms}});
+        }
+        return {{"key", result.key}, {"width", result.width}, {"height", result.height}, {"fps", result.fps},
+                {"headroom", result.headroom}, {"encoders", encoders}};
+    }
+}
+
+bool CalibrationResult::Sustains(const EncoderMeasurement& m) const {
+    return m.opened && m.fps >= static_cast<double>(fps) * headroom;
+}
+
+uint8_t CalibrationResult::SustainableCodecs(bool hardwareOnly) const {
+    uint8_t caps = 0;
+    for (const auto& m : encoders) {
+        if ((!hardwareOnly || m.hardware) && Sustains(m)) caps |= static_cast<uint8_t>(1 << static_cast<int>(m.codec));
+    }
+    return caps;
+}
+
+const EncoderMeasurement* CalibrationResult::Find(const std::string& name) const {
+    for (const auto& m : encoders) {
+        if (m.name == name) return &m;
+    }
+    return nullptr;
+}
+
+std::vector<std::string> CalibrationResult::Ranked(CodecType codec, bool hardware) const {
+    std::vector<const EncoderMeasurement*> sustaining, slow;
+    for (const auto& m : encoders) {
+        if (m.codec != codec || m.hardware != hardware || !m.opened) continue;
+        (Sustains(m) ? sustaining : slow).push_back(&m);
+    }
+    std::stable_sort(slow.begin(), slow.end(), [](const auto* a, const auto* b) { return a->fps > b->fps; });
+
+    std::vector<std::string> names;
+    for (const auto* m : sustaining) names.push_back(m->name);
+    for (const auto* m : slow) names.push_back(m->name);
+    return names;
+}
+
+std::string MakeCalibrationKey(const std::string& gpuIdentity, int width, int height, int fps) {
+    return CpuBrand() + "|" + gpuIdentity + "|ffmpeg " + av_version_info() + " lavc " +
+           std::to_string(avcodec_version()) + "|" + std::to_string(width) + "x" + std::to_string(height) +
+           "@" + std::to_string(fps);
+}
+
+EncoderMeasurement MeasureEncoder(const EncoderCandidate& candidate, const CalibrationSettings& settings) {
+    EncoderMeasurement m;
+    m.name = candidate.name;
+    m.codec = candidate.codec;
+    m.hardware = candidate.hardware;
+
+    const AVCodec* enc = avcodec_find_encoder_by_name(candidate.name.c_str());
+    if (!enc) return m;
+    const AVPixelFormat format = SelectCalibrationPixelFormat(enc, candidate.hardware);
+    if (format == AV_PIX_FMT_NONE) return m;
+
+    AVCodecContext* cctx = avcodec_alloc_context3(enc);
+    AVFrame* frame = av_frame_alloc();
+    AVPacket* pkt = av_packet_alloc();
+    if (!cctx || !frame || !pkt) {
+        av_packet_free(&pkt);
+        av_frame_free(&frame);
+        if (cctx) avcodec_free_context(&cctx);
+        return m;
+    }
+
+    ApplyRealtimeEncoderDefaults(cctx, candidate.codec, settings.width, settings.height, settings.fps);
+    cctx->pix_fmt = format;
+    if (candidate.hardware) {
+        cctx->thread_count = 1;
+        ConfigureHardwareEncoder(cctx, candidate.name, candidate.codec, 0);
+    } else {
+        SoftwareEncoderOptions opts;
+        opts.coreBudget = settings.coreBudget;
+        opts.pin = settings.pin;
+        ConfigureSoftwareEncoder(cctx, candidate.name, opts);
+    }
+
+    frame->format = format;
+    frame->width = settings.width;
+    frame->height = settings.height;
+    const int openRet = avcodec_open2(cctx, enc, nullptr);
+    if (openRet < 0 || av_frame_get_buffer(frame, 32) < 0) {
+        DBG("EncoderCalibration: %s did not open: %s", candidate.name.c_str(), openRet < 0 ? AvErr(openRet) : "frame alloc");
+    } else {
+        m.opened = true;
+        std::vector<double> latencies;
+        steady_clock::time_point measureStart{};
+        const auto deadline = steady_clock::now() + std::chrono::milliseconds(settings.maxMillis);
+
+        for (int i = 0; i < settings.maxFrames + kWarmupFrames; ++i) {
+            if (i == kWarmupFrames) measureStart = steady_clock::now();
+            if (av_frame_make_writable(frame) < 0) break;
+            FillSyntheticFrame(frame, i);
+            frame->pts = i;
+            frame->pict_type = i == 0 ? AV_PICTURE_TYPE_I : AV_PICTURE_TYPE_NONE;
+
+            const auto t0 = steady_clock::now();
+            if (avcodec_send_frame(cctx, frame) < 0) {
+                m.opened = false;
+                break;
+            }
+            while (avcodec_receive_packet(cctx, pkt) == 0) av_packet_unref(pkt);
+            const auto t1 = steady_clock::now();
+
+            if (i >= kWarmupFrames) latencies.push_back(std::chrono::duration<double, std::milli>(t1 - t0).count());
+            if (t1 >= deadline && i > kWarmupFrames) break;
+        }
+
+        if (!latencies.empty()) {
+            const double seconds = std::chrono::duration<double>(steady_clock::now() - measureStart).count();
+            m.frames = static_cast<int>(latencies.size());
+            m.fps = seconds > 0.0 ? m.frames / seconds : 0.0;
+            m.latencyP50Ms = Percentile(latencies, 0.50);
+            m.latencyP95Ms = Percentile(latencies, 0.95);
+        } else {
+            m.opened = false;
+        }
+    }
+
+    av_packet_free(&pkt);
+    av_frame_free(&frame);
+    avcodec_free_context(&cctx);
+    return m;
+}
+
+CalibrationResult CalibrateEncoders(const std::vector<EncoderCandidate>& candidates,
+                                    const CalibrationSettings& settings, const std::string& key) {
+    CalibrationResult result;
+    result.key = key;
+    result.width = settings.width;
+    result.height = settings.height;
+    result.fps = settings.fps;
+    result.headroom = settings.headroom;
+    result.encoders.resize(candidates.size());
+
+    LOG("EncoderCalibration: Measuring %zu encoder(s) at %dx%d@%d", candidates.size(), settings.width, settings.height, settings.fps);
+    const auto start = steady_clock::now();
+
+    std::vector<std::thread> hardwareThreads;
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        if (!candidates[i].hardware) continue;
+        hardwareThreads.emplace_back([&, i] { result.encoders[i] = MeasureEncoder(candidates[i], settings); });
+    }
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        if (!candidates[i].hardware) result.encoders[i] = MeasureEncoder(candidates[i], settings);
+    }
+    for (auto& t : hardwareThreads) t.join();
+
+    for (const auto& m : result.encoders) {
+        if (!m.opened) {
+            LOG("EncoderCalibration: %-12s unavailable", m.name.c_str());
+            continue;
+        }
+        LOG("EncoderCalibration: %-12s %6.1f fps, p50 %.2f ms, p95 %.2f ms%s", m.name.c_str(), m.fps,
+            m.latencyP50Ms, m.latencyP95Ms, result.Sustains(m) ? "" : " (too slow)");
+    }
+    LOG("EncoderCalibration: Done in %.1f s", std::chrono::duration<double>(steady_clock::now() - start).count());
+    return result;
+}
+
+bool LoadCalibration(const std::string& path, const std::string& key, CalibrationResult& out) {
+    std::ifstream file(path);
+    if (!file) return false;
+
+    try {
+        const auto cache = nlohmann::json::parse(file);
+        if (cache.value("version", 0) != kCacheVersion) return false;
+        for (const auto& entry : cache.at("entries")) {
+            if (entry.at("key").get<std::string>() != key) continue;
+            CalibrationResult result;
+            result.key = key;
+            result.width = entry.at("width").get<int>();
+            result.height = entry.at("height").get<int>();
+            result.fps = entry.at("fps").get<int>();
+            result.headroom = entry.value("headroom", 1.1);
+            for (const auto& e : entry.at("encoders")) {
+                EncoderMeasurement m;
+                m.name = e.at("name").get<std::string>();
+                m.codec = static_cast<CodecType>(std::clamp(e.at("codec").get<int>(), 0, 2));
+                m.hardware = e.at("hardware").get<bool>();
+                m.opened = e.at("opened").get<bool>();
+                m.frames = e.value("frames", 0);
+                m.fps = e.at("fps").get<double>();
+                m.latencyP50Ms = e.value("latencyP50Ms", 0.0);
+                m.latencyP95Ms = e.value("latencyP95Ms", 0.0);
+                result.encoders.push_back(std::move(m));
+            }
+            out = std::move(result);
+            return true;
+        }
+    } catch (const std::exception& e) {
+        WARN("EncoderCalibration: Ignoring cache %s: %s", path.c_str(), e.what());
+    }
+    return false;
+}
+
+bool SaveCalibration(const std::string& path, const CalibrationResult& result) {
+    nlohmann::json entries = nlohmann::json::array();
+    entries.push_back(ToJson(result));
+
+    // Keep results for other keys (monitors, drivers) so switching back is free.
+    if (std::ifstream existing(path); existing) {
+        try {
+            const auto cache = nlohmann::json::parse(existing);
+            if (cache.value("version", 0) == kCacheVersion) {
+                for (const auto& entry : cache.at("entries")) {
+                    if (entries.size() >= kMaxCacheEntries) break;
+                    if (entry.value("key", std::string{}) != result.key) entries.push_back(entry);
+                }
+            }
+        } catch (const std::exception&) {}
+    }
+
+    std::ofstream file(path, std::ios::trunc);
+    if (!file) {
+        WARN("EncoderCalibration: Cannot write %s", path.c_str());
+        return false;
+    }
+    file << nlohmann::json{{"version", kCacheVersion}, {"entries", entries}}.dump(2) << '\n';
+    return static_cast<bool>(file);
+}
@@ -0,0 +1,416 @@
+#include "host/media/encoder_settings.hpp"
+
+#include "host/core/logging.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <span>
+
+extern "C" {
+#include <libavutil/opt.h>
+}
+
+namespace {
+    constexpr const char* SW_AV1_ENC_NAMES[] = {"libsvtav1", "libaom-av1", "librav1e"};
+    constexpr const char* SW_H265_ENC_NAMES[] = {"libx265"};
+    constexpr const char* SW_H264_ENC_NAMES[] = {"libx264"};
+
+    // Per EncodeFormat, most preferred first. The planar formats have direct BGRA
+    // converters (color_convert) or fast swscale paths.
+    constexpr AVPixelFormat kYuv420Formats[] = {AV_PIX_FMT_YUV420P, AV_PIX_FMT_NV12};
+    constexpr AVPixelFormat kYuv444Formats[] = {AV_PIX_FMT_YUV444P};
+    constexpr AVPixelFormat kYuv420P10Formats[] = {AV_PIX_FMT_YUV420P10LE, AV_PIX_FMT_P010LE};
+
+    // Empty curves fall back to CalcCodecBitrateFactor. Written once at startup.
+    std::array<std::vector<BitrateModelPoint>, 3> g_bitrateModel;
+    // Measured order from encoder calibration; tried before the static lists.
+    std::array<std::vector<std::string>, 3> g_softwarePreference;
+
+    inline bool IsKnownHardwareEncoder(const char* name) {
+        if (!name) return false;
+        return strstr(name, "_nvenc") || strstr(name, "_qsv") || strstr(name, "_amf");
+    }
+}
+
+bool LoadBitrateModel(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) return false;
+
+    try {
+        const auto model = nlohmann::json::parse(file);
+        const auto& codecs = model.at("codecs");
+        int loaded = 0;
+        for (const auto& [key, codec] : {std::pair{"av1", CODEC_AV1}, std::pair{"h265", CODEC_H265}, std::pair{"h264", CODEC_H264}}) {
+            if (!codecs.contains(key)) continue;
+            std::vector<BitrateModelPoint> points;
+            for (const auto& entry : codecs.at(key)) {
+                BitrateModelPoint point{entry.at("pixels").get<int64_t>(), entry.at("factor").get<double>()};
+                if (point.pixels > 0 && point.factor > 0.0 && point.factor < 1.0) points.push_back(point);
+            }
+            if (points.empty()) continue;
+            SetBitrateModel(codec, std::move(points));
+            loaded++;
+        }
+        if (!loaded) {
+            WARN("EncoderSettings: %s has no usable codec curves", path.c_str());
+            return false;
+        }
+        LOG("EncoderSettings: Loaded bitrate model for %d codec(s) from %s", loaded, path.c_str());
+        return true;
+    } catch (const std::exception& e) {
+        WARN("EncoderSettings: Ignoring bitrate model %s: %s", path.c_str(), e.what());
+        return false;
+    }
+}
+
+void SetBitrateModel(CodecType codec, std::vector<BitrateModelPoint> points) {
+    if (codec > CODEC_H264) return;
+    std::sort(points.begin(), points.end(), [](const auto& a, const auto& b) { return a.pixels < b.pixels; });
+    g_bitrateModel[codec] = std::move(points);
+}
+
+double CalcModelBitrateFactor(CodecType codec, int64_t pixels) {
+    if (codec > CODEC_H264 || g_bitrateModel[codec].empty()) return CalcCodecBitrateFactor(codec);
+    const auto& points = g_bitrateModel[codec];
+    if (pixels <= points.front().pixels) return points.front().factor;
+    if (pixels >= points.back().pixels) return points.back().factor;
+
+    const auto upper = std::lower_bound(points.begin(), points.end(), pixels,
+        [](const BitrateModelPoint& p, int64_t value) { return p.pixels < value; });
+    const auto lower = upper - 1;
+    const double t = (std::log(static_cast<double>(pixels)) - std::log(static_cast<double>(lower->pixels))) /
+                     (std::log(static_cast<double>(upper->pixels)) - std::log(static_cast<double>(lower->pixels)));
+    return lower->factor + (upper->factor - lower->factor) * t;
+}
+
+int CalcEffectiveFps(int fps) {
+    if (fps <= 60) return fps;
+    if (fps <= 90) return 60 + ((fps - 60) * 2) / 3;
+    return 80 + ((fps - 90) / 3);
+}
+
+double CalcCodecBitrateFactor(CodecType codec) {
+    switch (codec) {
+        case CODEC_AV1: return 0.112;
+        case CODEC_H265: return 0.138;
+        case CODEC_H264: return 0.165;
+        default: return 0.145;
+    }
+}
+
+int64_t CalcBitrate(CodecType codec, int w, int h, int fps) {
+    const int effectiveFps = CalcEffectiveFps(fps);
+    const int64_t pixels = static_cast<int64_t>(w) * h;
+    const double factor = CalcModelBitrateFactor(codec, pixels);
+    const int64_t bitrate = static_cast<int64_t>(factor * pixels * effectiveFps);
+    return std::max<int64_t>(6'000'000, bitrate);
+}
+
+int64_t CalcMaxRate(int64_t bitrate) {
+    return std::max<int64_t>(bitrate, (bitrate * 115) / 100);
+}
+
+int CalcBufferSize(int64_t bitrate) {
+    return static_cast<int>(std::max<int64_t>(4'000'000, bitrate / 3));
+}
+
+int CalcQualityValue(CodecType codec, int w, int h, int fps) {
+    int value = codec == CODEC_H264 ? 25 : codec == CODEC_H265 ? 28 : 31;
+    if (fps > 90) value += 2;
+    else if (fps > 60) value += 1;
+    if (static_cast<int64_t>(w) * h >= 2560LL * 1440LL) value += 1;
+    return value;
+}
+
+// AV1 tile rows are configured as log2; round the requested slice count down.
+int TileRowsLog2(int slices) {
+    int log2 = 0;
+    while ((2 << log2) <= slices && log2 < 6) ++log2;
+    return log2;
+}
+
+AVCodecID GetCodecId(CodecType codec) {
+    switch (codec) {
+        case CODEC_AV1: return AV_CODEC_ID_AV1;
+        case CODEC_H265: return AV_CODEC_ID_HEVC;
+        case CODEC_H264: return AV_CODEC_ID_H264;
+        default: return AV_CODEC_ID_NONE;
+    }
+}
+
+const char* const* GetSoftwareEncoderNames(CodecType codec, size_t& count) {
+    switch (codec) {
+        case CODEC_AV1:
+            count = std::size(SW_AV1_ENC_NAMES);
+            return SW_AV1_ENC_NAMES;
+        case CODEC_H265:
+            count = std::size(SW_H265_ENC_NAMES);
+            return SW_H265_ENC_NAMES;
+        case CODEC_H264:
+            count = std::size(SW_H264_ENC_NAMES);
+            return SW_H264_ENC_NAMES;
+        default:
+            count = 0;
+            return nullptr;
+    }
+}
+
+void SetSoftwareEncoderPreference(CodecType codec, std::vector<std::string> names) {
+    if (codec <= CODEC_H264) g_softwarePreference[static_cast<size_t>(codec)] = std::move(names);
+}
+
+const AVCodec* FindSoftwareEncoder(CodecType codec, std::string& encoderName, EncodeFormat format) {
+    auto usable = [format](const AVCodec* enc) {
+        return enc && SelectSoftwarePixelFormat(enc, format) != AV_PIX_FMT_NONE;
+    };
+    if (codec <= CODEC_H264) {
+        for (const auto& name : g_softwarePreference[static_cast<size_t>(codec)]) {
+            if (const AVCodec* enc = avcodec_find_encoder_by_name(name.c_str()); usable(enc)) {
+                encoderName = name;
+                return enc;
+            }
+        }
+    }
+
+    size_t count = 0;
+    if (const char* const* names = GetSoftwareEncoderNames(codec, count)) {
+        for (size_t i = 0; i < count; ++i) {
+            if (const AVCodec* enc = avcodec_find_encoder_by_name(names[i]); usable(enc)) {
+                encoderName = names[i];
+                return enc;
+            }
+        }
+    }
+
+    if (const AVCodec* enc = avcodec_find_encoder(GetCodecId(codec)); usable(enc)) {
+        if (!IsKnownHardwareEncoder(enc->name)) {
+            encoderName = enc->name ? enc->name : "software";
+            return enc;
+        }
+    }
+
+    encoderName.clear();
+    return nullptr;
+}
+
+AVPixelFormat SelectSoftwarePixelFormat(const AVCodec* enc, EncodeFormat format) {
+    const std::span<const AVPixelFormat> preferred =
+        format == FORMAT_YUV444 ? std::span<const AVPixelFormat>(kYuv444Formats)
+        : format == FORMAT_YUV420_10 ? std::span<const AVPixelFormat>(kYuv420P10Formats)
+        : std::span<const AVPixelFormat>(kYuv420Formats);
+    if (!enc) return preferred.front();
+
+    const void* rawFormats = nullptr;
+    int formatCount = 0;
+    if (avcodec_get_supported_config(nullptr, enc, AV_CODEC_CONFIG_PIX_FORMAT, 0, &rawFormats, &formatCount) < 0 ||
+        !rawFormats || formatCount <= 0) {
+        // No list means anything goes; only assume that for plain 4:2:0.
+        return format == FORMAT_YUV420 ? AV_PIX_FMT_YUV420P : AV_PIX_FMT_NONE;
+    }
+
+    const auto* formats = static_cast<const AVPixelFormat*>(rawFormats);
+
+    for (const AVPixelFormat candidate : preferred) {
+        for (int i = 0; i < formatCount; ++i) {
+            if (formats[i] == candidate) return candidate;
+        }
+    }
+
+    return AV_PIX_FMT_NONE;
+}
+
+const char* EncodeFormatName(EncodeFormat format) {
+    switch (format) {
+        case FORMAT_YUV444: return "4:4:4";
+        case FORMAT_YUV420_10: return "4:2:0 10-bit";
+        default: return "4:2:0";
+    }
+}
+
+bool HardwareEncoderSupportsFormat(const AVCodec* enc, CodecType codec, EncodeFormat format) {
+    if (!enc || !enc->name) return false;
+    if (format == FORMAT_YUV420) return true;
+    if (!strstr(enc->name, "_nvenc") || !enc->priv_class) return false;
+
+    const char* option = nullptr;
+    if (format == FORMAT_YUV444 && codec != CODEC_AV1) option = "rgb_mode";
+    else if (format == FORMAT_YUV420_10 && codec != CODEC_H264) option = "highbitdepth";
+    const AVClass* cls = enc->priv_class;
+    return option && av_opt_find(&cls, option, nullptr, 0, AV_OPT_SEARCH_FAKE_OBJ);
+}
+
+void ApplyRealtimeEncoderDefaults(AVCodecContext* cctx, CodecType codec, int w, int h, int fps) {
+    const int64_t br = CalcBitrate(codec, w, h, fps);
+    cctx->width = w;
+    cctx->height = h;
+    cctx->time_base = {1, fps};
+    cctx->framerate = {fps, 1};
+    cctx->bit_rate = br;
+    cctx->rc_max_rate = CalcMaxRate(br);
+    cctx->rc_buffer_size = CalcBufferSize(br);
+    cctx->gop_size = -1;
+    cctx->max_b_frames = 0;
+    cctx->flags |= AV_CODEC_FLAG_LOW_DELAY;
+    cctx->flags2 |= AV_CODEC_FLAG2_FAST;
+    cctx->delay = 0;
+    cctx->color_range = AVCOL_RANGE_JPEG;
+    cctx->colorspace = AVCOL_SPC_BT709;
+    cctx->color_primaries = AVCOL_PRI_BT709;
+    cctx->color_trc = AVCOL_TRC_BT709;
+}
+
+bool SupportsCappedCrf(const std::string& encoderName) {
+    return encoderName == "libx264" || encoderName == "libx265" || encoderName == "libsvtav1";
+}
+
+bool SupportsTemporalLayers(const std::string& encoderName) {
+    return encoderName == "libsvtav1";
+}
+
+bool SupportsRegionsOfInterest(const std::string& encoderName) {
+    return encoderName == "libx264" || encoderName == "libx265" || encoderName == "h264_qsv" || encoderName == "hevc_qsv";
+}
+
+bool SetFrameRegionsOfInterest(AVFrame* frame, const std::vector<AVRegionOfInterest>& regions) {
+    av_frame_remove_side_data(frame, AV_FRAME_DATA_REGIONS_OF_INTEREST);
+    if (regions.empty()) return true;
+    AVFrameSideData* sd = av_frame_new_side_data(frame, AV_FRAME_DATA_REGIONS_OF_INTEREST,
+        regions.size() * sizeof(AVRegionOfInterest));
+    if (!sd) return false;
+    memcpy(sd->data, regions.data(), regions.size() * sizeof(AVRegionOfInterest));
+    return true;
+}
+
+const char* FasterSoftwarePreset(const std::string& encoderName) {
+    if (encoderName == "libsvtav1") return "13";
+    if (encoderName == "libaom-av1") return "10";
+    return nullptr;
+}
+
+SoftwareThreadingPlan ConfigureSoftwareEncoder(AVCodecContext* cctx, const std::string& encoderName,
+                                               const SoftwareEncoderOptions& opts) {
+    auto set = [cctx](const char* k, const char* v) {
+        if (av_opt_set(cctx->priv_data, k, v, 0) < 0)
+            DBG("EncoderSettings: av_opt_set(%s=%s) failed", k, v);
+    };
+    auto preset = [&opts](const char* fallback) {
+        return opts.preset.empty() ? fallback : opts.preset.c_str();
+    };
+
+    const int fps = cctx->framerate.num > 0 ? cctx->framerate.num / std::max(1, cctx->framerate.den) : 60;
+    const SoftwareThreadingPlan plan = PlanSoftwareThreading(encoderName, cctx->width, cctx->height, fps,
+                                                             ResolveCoreBudget(opts.coreBudget), opts.slices, opts.pin);
+    cctx->thread_count = plan.threads;
+
+    const bool cappedCrf = opts.crf > 0 && SupportsCappedCrf(encoderName);
+    if (cappedCrf) {
+        cctx->bit_rate = 0;
+        set("crf", std::to_string(opts.crf).c_str());
+    }
+
+    const bool screen = opts.profile == ContentProfile::Screen;
+    const std::string slices = std::to_string(opts.slices);
+    const std::string threads = std::to_string(plan.threads);
+    const std::string tileColumnsLog2 = std::to_string(plan.tileColumnsLog2);
+    const std::string tileRowsLog2 = std::to_string(plan.tileRowsLog2);
+    const int temporalLayers = SupportsTemporalLayers(encoderName) ? std::clamp(opts.temporalLayers, 1, 3) : 1;
+    if (encoderName == "libx264") {
+        std::string params = "scenecut=0:open-gop=0:threads=" + threads;
+        if (screen) params += ":deblock=-1,-1";
+        if (opts.slices > 1) params += ":slices=" + slices;
+        if (opts.roi) params += ":aq-mode=1";
+        set("preset", preset("ultrafast"));
+        set("tune", "zerolatency");
+        set("x264-params", params.c_str());
+        set("annexb", "1");
+    } else if (encoderName == "libx265") {
+        std::string params = "scenecut=0:open-gop=0:repeat-headers=1:frame-threads=1:pools=" + std::to_string(plan.x265Pools);
+        if (screen) params += ":deblock=-1,-1:psy-rd=0";
+        if (opts.slices > 1) params += ":slices=" + slices;
+        if (opts.roi) params += ":aq-mode=1";
+        set("preset", preset("ultrafast"));
+        set("tune", "zerolatency");
+        set("x265-params", params.c_str());
+        set("annexb", "1");
+    } else if (encoderName == "libsvtav1") {
+        std::string params = "lp=" + threads + ":tile-columns=" + tileColumnsLog2 + ":tile-rows=" + tileRowsLog2;
+        if (plan.pin) params += ":pin=1";
+        if (screen) params += ":scm=1";
+        // Low-delay prediction: level n puts every 2^n-th frame in the base layer.
+        if (temporalLayers > 1) params += ":pred-struct=1:hierarchical-levels=" + std::to_string(temporalLayers - 1);
+        set("preset", preset("12"));
+        set("tune", "0");
+        set("svtav1-params", params.c_str());
+    } else if (encoderName == "libaom-av1") {
+        set("usage", "realtime");
+        set("cpu-used", preset("8"));
+        set("lag-in-frames", "0");
+        set("row-mt", plan.rowMt ? "1" : "0");
+        set("tile-columns", tileColumnsLog2.c_str());
+        set("tile-rows", tileRowsLog2.c_str());
+        if (screen) set("aom-params", "tune-content=screen:enable-palette=1:enable-intrabc=1");
+    } else if (encoderName == "librav1e") {
+        set("speed", preset("10"));
+        const int tiles = opts.slices > 1 ? opts.slices : 1 << (plan.tileColumnsLog2 + plan.tileRowsLog2);
+        set("tiles", std::to_string(tiles).c_str());
+    }
+    return plan;
+}
+
+bool ConfigureHardwareEncoder(AVCodecContext* cctx, const std::string& encoderName, CodecType codec, int slices,
+                              EncodeFormat format) {
+    auto set = [cctx](const char* k, const char* v) {
+        if (av_opt_set(cctx->priv_data, k, v, 0) < 0) {
+            DBG("EncoderSettings: av_opt_set(%s=%s) failed", k, v);
+            return false;
+        }
+        return true;
+    };
+    auto endsWith = [&encoderName](const char* suffix) {
+        const size_t n = strlen(suffix);
+        return encoderName.size() >= n && encoderName.compare(encoderName.size() - n, n, suffix) == 0;
+    };
+
+    const bool nvenc = endsWith("_nvenc");
+    if (slices > 1) {
+        cctx->slices = slices;
+        if (codec == CODEC_AV1 && nvenc) set("tile-rows", std::to_string(slices).c_str());
+    }
+
+    const int fps = cctx->framerate.num > 0 ? cctx->framerate.num / std::max(1, cctx->framerate.den) : 60;
+    const std::string qualityValue = std::to_string(CalcQualityValue(codec, cctx->width, cctx->height, fps));
+    const char* quality = qualityValue.c_str();
+
+    if (nvenc) {
+        set("preset", "p2"); set("tune", "ull"); set("zerolatency", "1");
+        set("rc-lookahead", "0"); set("rc", "vbr"); set("multipass", "disabled");
+        set("delay", "0"); set("surfaces", "3"); set("cq", quality);
+        set("no-scenecut", "1");
+        if (codec != CODEC_AV1) { set("forced-idr", "1"); }
+        if (format == FORMAT_YUV444) {
+            if (codec == CODEC_AV1 || !set("rgb_mode", "yuv444")) return false;
+            set("profile", codec == CODEC_H264 ? "high444p" : "rext");
+        } else if (format == FORMAT_YUV420_10) {
+            if (codec == CODEC_H264 || !set("highbitdepth", "1")) return false;
+            if (codec == CODEC_H265) set("profile", "main10");
+        }
+    } else if (endsWith("_qsv")) {
+        set("preset", "veryfast"); set("look_ahead", "0");
+        set("async_depth", "1"); set("low_power", "1"); set("global_quality", quality);
+        set("forced_idr", "1"); set("adaptive_i", "0"); set("adaptive_b", "0");
+    } else if (endsWith("_amf")) {
+        set("usage", "ultralowlatency"); set("quality", "balanced");
+        set("rc", "vbr_latency"); set("header_insertion_mode", "gop");
+        set("enforce_hrd", "0"); set("qp_i", quality); set("qp_p", quality);
+        set("forced_idr", "1");
+    } else {
+        WARN("EncoderSettings: No hardware options for %s", encoderName.c_str());
+    }
+    return nvenc || format == FORMAT_YUV420;
+}
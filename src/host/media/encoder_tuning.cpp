@@ -0,0 +1,139 @@
+#include "host/media/encoder_tuning.hpp"
+
+#include "host/core/logging.hpp"
+#include "host/media/encoder_settings.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__linux__)
+#include <sched.h>
+#include <fstream>
+#include <set>
+#include <utility>
+#endif
+
+namespace {
+    // Narrowest tile the planner will create; keeps per-tile motion search and
+    // entropy contexts efficient at 720p and up.
+    constexpr int kMinTileWidth = 400;
+    constexpr int kMaxTileColumnsLog2 = 3;
+    // Pixels per second one thread of a realtime preset keeps up with: 1080p60
+    // wants 4 threads, 1440p120 14 and 4K60 16.
+    constexpr double kPixelRatePerThread = 32e6;
+
+    CpuTopology DetectCpuTopology() {
+        CpuTopology topo;
+        topo.logicalCores = std::max(1u, std::thread::hardware_concurrency());
+        topo.physicalCores = topo.logicalCores;
+#ifdef _WIN32
+        DWORD length = 0;
+        GetLogicalProcessorInformationEx(RelationProcessorCore, nullptr, &length);
+        if (GetLastError() == ERROR_INSUFFICIENT_BUFFER && length > 0) {
+            std::vector<uint8_t> buffer(length);
+            auto* info = reinterpret_cast<SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*>(buffer.data());
+            if (GetLogicalProcessorInformationEx(RelationProcessorCore, info, &length)) {
+                int cores = 0;
+                for (DWORD offset = 0; offset < length;) {
+                    auto* entry = reinterpret_cast<SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*>(buffer.data() + offset);
+                    if (entry->Relationship == RelationProcessorCore) cores++;
+                    offset += entry->Size;
+                }
+                if (cores > 0) topo.physicalCores = cores;
+            }
+        }
+#elif defined(__linux__)
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if (sched_getaffinity(0, sizeof(set), &set) == 0) topo.logicalCores = std::max(1, CPU_COUNT(&set));
+        std::ifstream cpuinfo("/proc/cpuinfo");
+        std::set<std::pair<int, int>> cores;
+        int physicalId = 0;
+        for (std::string line; std::getline(cpuinfo, line);) {
+            const size_t colon = line.find(':');
+            if (colon == std::string::npos) continue;
+            if (line.rfind("physical id", 0) == 0) physicalId = atoi(line.c_str() + colon + 1);
+            else if (line.rfind("core id", 0) == 0) cores.emplace(physicalId, atoi(line.c_str() + colon + 1));
+        }
+        if (!cores.empty()) topo.physicalCores = static_cast<int>(cores.size());
+#endif
+        topo.physicalCores = std::clamp(topo.physicalCores, 1, topo.logicalCores);
+        return topo;
+    }
+
+    int ThreadsForPixelRate(int width, int height, int fps) {
+        const double pixelRate = static_cast<double>(width) * height * std::max(1, fps);
+        return std::max(2, static_cast<int>(std::ceil(pixelRate / kPixelRatePerThread)));
+    }
+
+    int FloorLog2(int v) {
+        int log2 = 0;
+        while (v > 1) { v >>= 1; log2++; }
+        return log2;
+    }
+}
+
+const CpuTopology& GetCpuTopology() {
+    static const CpuTopology topo = [] {
+        const CpuTopology t = DetectCpuTopology();
+        DBG("EncoderTuning: %d logical / %d physical cores", t.logicalCores, t.physicalCores);
+        return t;
+    }();
+    return topo;
+}
+
+int ResolveCoreBudget(int requested) {
+    const int logical = GetCpuTopology().logicalCores;
+    if (requested > 0) return std::min(requested, logical);
+    const int reserve = logical <= 4 ? 1 : std::clamp(logical / 8, 2, 4);
+    return std::max(1, logical - reserve);
+}
+
+SoftwareThreadingPlan PlanSoftwareThreading(const std::string& encoderName, int width, int height,
+                                            int fps, int coreBudget, int slices, bool pin) {
+    SoftwareThreadingPlan plan;
+    const CpuTopology& topo = GetCpuTopology();
+    const int budget = std::max(1, coreBudget);
+    // Threads past what the pixel rate needs only add synchronisation, and more
+    // tiles than that cost compression for no speed.
+    const int wanted = std::min(budget, ThreadsForPixelRate(width, height, fps));
+    // SMT siblings share the SIMD units the encoders spend their time in.
+    const int physicalBudget = std::clamp(budget * topo.physicalCores / topo.logicalCores, 1, budget);
+
+    // Two threads per tile column keeps row-MT busy without splitting the frame
+    // into more tiles than the width supports.
+    const int widthLimit = FloorLog2(std::max(1, width / kMinTileWidth));
+    const int threadLimit = FloorLog2(std::max(1, wanted / 2));
+    plan.tileColumnsLog2 = std::min({widthLimit, threadLimit, kMaxTileColumnsLog2});
+    if (slices > 1) plan.tileRowsLog2 = TileRowsLog2(slices);
+    else if (wanted >= 16 && height >= 1440) plan.tileRowsLog2 = 1;
+
+    if (encoderName == "libx264") {
+        // Sliced threads split every frame; past ~120 lines per slice the
+        // compression loss outweighs the latency gain.
+        plan.threads = std::min(wanted, std::clamp(height / 120, 2, 16));
+    } else if (encoderName == "libx265") {
+        plan.threads = wanted;
+        plan.x265Pools = wanted;
+    } else if (encoderName == "libsvtav1") {
+        plan.threads = std::min(wanted, physicalBudget);
+        plan.pin = pin && plan.threads < topo.logicalCores;
+    } else if (encoderName == "libaom-av1" || encoderName == "librav1e") {
+        plan.threads = wanted;
+        plan.rowMt = true;
+    } else {
+        plan.threads = wanted;
+    }
+
+    DBG("EncoderTuning: %s %dx%d@%d budget %d (%d physical) -> threads %d, tiles %dx%d%s", encoderName.c_str(), width,
+        height, fps, budget, physicalBudget, plan.threads, 1 << plan.tileColumnsLog2, 1 << plan.tileRowsLog2,
+        plan.pin ? ", pinned" : "");
+    return plan;
+}
@@ -0,0 +1,244 @@
+#include "host/media/frame_analysis.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SLIPSTREAM_HASH_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+    constexpr uint64_t kPrime1 = 0x9E3779B185EBCA87ULL;
+    constexpr uint64_t kPrime2 = 0xC2B2AE3D27D4EB4FULL;
+    constexpr uint64_t kPrime3 = 0x165667B19E3779F9ULL;
+    constexpr uint32_t kScramblePrime = 0x9E3779B1U;
+    constexpr int kKeyBlocks = 16;
+
+    constexpr uint64_t SplitMix(uint64_t& state) {
+        uint64_t z = (state += kPrime1);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    // Two 64-bit key lanes per 16-byte block of a tile row (64 px * 4 B = 16 blocks).
+    constexpr std::array<uint64_t, kKeyBlocks * 2> MakeKeys() {
+        std::array<uint64_t, kKeyBlocks * 2> keys{};
+        uint64_t state = kPrime3;
+        for (auto& key : keys) key = SplitMix(state);
+        return keys;
+    }
+
+    alignas(16) constexpr std::array<uint64_t, kKeyBlocks * 2> kKeys = MakeKeys();
+
+    inline uint64_t Load64(const uint8_t* p) {
+        uint64_t v;
+        memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    inline uint64_t Avalanche(uint64_t h) {
+        h ^= h >> 33;
+        h *= kPrime2;
+        h ^= h >> 29;
+        h *= kPrime3;
+        return h ^ (h >> 32);
+    }
+
+    // Scalar form of the SSE2 accumulate/scramble below; both produce identical hashes.
+    inline void AccumulateScalar(uint64_t acc[2], const uint8_t* p, int block) {
+        for (int lane = 0; lane < 2; ++lane) {
+            const uint64_t data = Load64(p + lane * 8);
+            const uint64_t dataKey = data ^ kKeys[block * 2 + lane];
+            acc[lane ^ 1] += data;
+            acc[lane] += (dataKey & 0xFFFFFFFFULL) * (dataKey >> 32);
+        }
+    }
+
+    inline void ScrambleScalar(uint64_t acc[2], uint64_t rowKey) {
+        for (int lane = 0; lane < 2; ++lane) {
+            uint64_t a = acc[lane];
+            a ^= a >> 47;
+            a ^= rowKey;
+            acc[lane] = a * kScramblePrime;
+        }
+    }
+}
+
+uint64_t HashTileBGRA(const uint8_t* bgra, size_t stride, int width, int height) {
+    const size_t rowBytes = static_cast<size_t>(width) * 4;
+    const int blocks = static_cast<int>(rowBytes / 16);
+    const size_t tailOffset = static_cast<size_t>(blocks) * 16;
+    uint64_t tail = kPrime3 ^ rowBytes;
+
+#ifdef SLIPSTREAM_HASH_SSE2
+    __m128i acc = _mm_set_epi64x(static_cast<long long>(kPrime2), static_cast<long long>(kPrime1));
+    const __m128i prime = _mm_set1_epi32(static_cast<int>(kScramblePrime));
+    const auto* keys = reinterpret_cast<const __m128i*>(kKeys.data());
+#else
+    uint64_t acc[2] = {kPrime1, kPrime2};
+#endif
+
+    for (int y = 0; y < height; ++y) {
+        const uint8_t* row = bgra + static_cast<size_t>(y) * stride;
+#ifdef SLIPSTREAM_HASH_SSE2
+        for (int b = 0; b < blocks; ++b) {
+            const __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + b * 16));
+            const __m128i dataKey = _mm_xor_si128(data, _mm_load_si128(keys + (b & (kKeyBlocks - 1))));
+            const __m128i dataKeyHi = _mm_shuffle_epi32(dataKey, _MM_SHUFFLE(0, 3, 0, 1));
+            const __m128i product = _mm_mul_epu32(dataKey, dataKeyHi);
+            const __m128i swapped = _mm_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+            acc = _mm_add_epi64(acc, _mm_add_epi64(product, swapped));
+        }
+        const __m128i rowKey = _mm_set1_epi64x(static_cast<long long>(kKeys[y & (kKeyBlocks * 2 - 1)]));
+        acc = _mm_xor_si128(acc, _mm_srli_epi64(acc, 47));
+        acc = _mm_xor_si128(acc, rowKey);
+        const __m128i lo = _mm_mul_epu32(acc, prime);
+        const __m128i hi = _mm_mul_epu32(_mm_srli_epi64(acc, 32), prime);
+        acc = _mm_add_epi64(lo, _mm_slli_epi64(hi, 32));
+#else
+        for (int b = 0; b < blocks; ++b) AccumulateScalar(acc, row + b * 16, b & (kKeyBlocks - 1));
+        ScrambleScalar(acc, kKeys[y & (kKeyBlocks * 2 - 1)]);
+#endif
+        for (size_t i = tailOffset; i + 4 <= rowBytes; i += 4) {
+            uint32_t px;
+            memcpy(&px, row + i, sizeof(px));
+            tail = (tail ^ px) * kPrime1;
+            tail ^= tail >> 31;
+        }
+    }
+
+#ifdef SLIPSTREAM_HASH_SSE2
+    alignas(16) uint64_t lanes[2];
+    _mm_store_si128(reinterpret_cast<__m128i*>(lanes), acc);
+#else
+    const uint64_t* lanes = acc;
+#endif
+    const uint64_t h = lanes[0] ^ ((lanes[1] << 31) | (lanes[1] >> 33)) ^ tail ^
+                       (static_cast<uint64_t>(height) * kPrime2);
+    return Avalanche(h);
+}
+
+void TileChangeDetector::Reset() {
+    hashes.clear();
+    changed.clear();
+    info = {};
+    w = h = cols = rows = 0;
+}
+
+const FrameChangeInfo& TileChangeDetector::Analyze(const uint8_t* bgra, size_t stride, int width, int height) {
+    const bool resized = width != w || height != h;
+    if (resized) {
+        w = width;
+        h = height;
+        cols = (w + kTileSize - 1) / kTileSize;
+        rows = (h + kTileSize - 1) / kTileSize;
+        hashes.assign(static_cast<size_t>(cols) * rows, 0);
+        changed.assign(hashes.size(), 1);
+    }
+
+    info.totalTiles = cols * rows;
+    info.changedTiles = 0;
+    for (int ty = 0; ty < rows; ++ty) {
+        const int y = ty * kTileSize;
+        const int tileH = std::min(kTileSize, h - y);
+        for (int tx = 0; tx < cols; ++tx) {
+            const int x = tx * kTileSize;
+            const int tileW = std::min(kTileSize, w - x);
+            const size_t index = static_cast<size_t>(ty) * cols + tx;
+            const uint64_t hash = HashTileBGRA(bgra + static_cast<size_t>(y) * stride + static_cast<size_t>(x) * 4,
+                                               stride, tileW, tileH);
+            const bool tileChanged = resized || hash != hashes[index];
+            hashes[index] = hash;
+            changed[index] = tileChanged ? 1 : 0;
+            if (tileChanged) info.changedTiles++;
+        }
+    }
+
+    info.valid = !resized;
+    BuildRects();
+    return info;
+}
+
+void TileChangeDetector::BuildRects() {
+    struct Span { int c0, c1, lastRow; };
+    std::vector<Span> spans;
+    info.rects.clear();
+
+    for (int ty = 0; ty < rows; ++ty) {
+        for (int tx = 0; tx < cols;) {
+            if (!changed[static_cast<size_t>(ty) * cols + tx]) { ++tx; continue; }
+            const int c0 = tx;
+            while (tx < cols && changed[static_cast<size_t>(ty) * cols + tx]) ++tx;
+            const int c1 = tx;
+
+            const int y = ty * kTileSize;
+            const int tileH = std::min(kTileSize, h - y);
+            bool merged = false;
+            for (size_t i = 0; i < spans.size(); ++i) {
+                if (spans[i].lastRow == ty - 1 && spans[i].c0 == c0 && spans[i].c1 == c1) {
+                    spans[i].lastRow = ty;
+                    info.rects[i].height += tileH;
+                    merged = true;
+                    break;
+                }
+            }
+            if (merged) continue;
+
+            const int x = c0 * kTileSize;
+            spans.push_back({c0, c1, ty});
+            info.rects.push_back({x, y, std::min(c1 * kTileSize, w) - x, tileH});
+        }
+    }
+}
+
+double MeasureSyntheticContent(const uint8_t* bgra, size_t stride, int width, int height) {
+    constexpr int kBlock = 8;
+    constexpr int kStep = 32;
+    constexpr int kMaxColors = 8;
+    int synthetic = 0, textured = 0;
+
+    for (int y = 0; y + kBlock <= height; y += kStep) {
+        for (int x = 0; x + kBlock <= width; x += kStep) {
+            uint32_t colors[kMaxColors + 1];
+            int count = 0;
+            for (int by = 0; by < kBlock && count <= kMaxColors; ++by) {
+                const uint8_t* row = bgra + static_cast<size_t>(y + by) * stride + static_cast<size_t>(x) * 4;
+                for (int bx = 0; bx < kBlock && count <= kMaxColors; ++bx) {
+                    uint32_t px;
+                    memcpy(&px, row + bx * 4, sizeof(px));
+                    px &= 0x00FFFFFFU;
+                    bool seen = false;
+                    for (int i = 0; i < count; ++i) {
+                        if (colors[i] == px) { seen = true; break; }
+                    }
+                    if (!seen) colors[count++] = px;
+                }
+            }
+            if (count <= 1) continue;
+            textured++;
+            if (count <= kMaxColors) synthetic++;
+        }
+    }
+
+    return textured > 0 ? static_cast<double>(synthetic) / textured : -1.0;
+}
+
+bool ContentClassifier::Update(double sample) {
+    if (sample < 0.0) return false;
+    score = primed ? score * 0.6 + sample * 0.4 : sample;
+    primed = true;
+
+    const bool wantScreen = profile == ContentProfile::Screen ? score > kExitScreen : score >= kEnterScreen;
+    const ContentProfile desired = wantScreen ? ContentProfile::Screen : ContentProfile::Default;
+    if (desired == profile) {
+        confirm = 0;
+        return false;
+    }
+    if (++confirm < kConfirmSamples) return false;
+    confirm = 0;
+    profile = desired;
+    return true;
+}
@@ -0,0 +1,153 @@
+#include "host/media/frame_scheduler.hpp"
+
+#include "host/core/logging.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+namespace {
+    constexpr double kEwma = 1.0 / 16.0;
+    // Deadlines snap while frame intervals stay within vsync / 8 of a whole number of vsyncs.
+    constexpr int64_t kAlignedDivisor = 8;
+    // Longer gaps are static content, not cadence.
+    constexpr int64_t kMaxCadenceGapUs = 100'000;
+}
+
+void FrameScheduler::Reset() {
+    idealUs = targetUs = deadlineUs = 0;
+    hasHeld = false;
+    heldTs = 0;
+    lastEncodedTs = 0;
+    congestionSkipCount = 0;
+    congestedLayerFrames = 0;
+}
+
+void FrameScheduler::SetPeriod(int64_t framePeriodUs) {
+    periodUs = std::max<int64_t>(1, framePeriodUs);
+}
+
+void FrameScheduler::SetRefreshHint(int hz) {
+    const int64_t next = hz > 0 ? 1000000 / hz : 0;
+    if (next == vsyncUs) return;
+    vsyncUs = next;
+    cadenceErrUs = -1.0;
+    stats.vsyncUs = vsyncUs;
+}
+
+bool FrameScheduler::Aligned() const {
+    // Below ~one vsync per frame every captured frame is encoded; there is nothing to pick.
+    return vsyncUs > 0 && cadenceErrUs >= 0.0 && cadenceErrUs < static_cast<double>(vsyncUs / kAlignedDivisor) &&
+        periodUs * 10 >= vsyncUs * 9;
+}
+
+void FrameScheduler::Retarget() {
+    if (!Aligned() || lastFrameTs <= 0) {
+        targetUs = deadlineUs = idealUs;
+        return;
+    }
+    const double vsyncs = std::round(static_cast<double>(idealUs - lastFrameTs) / static_cast<double>(vsyncUs));
+    targetUs = lastFrameTs + static_cast<int64_t>(vsyncs) * vsyncUs;
+    deadlineUs = targetUs - vsyncUs / 4;
+}
+
+void FrameScheduler::TrackCadence(int64_t frameTs) {
+    if (lastFrameTs > 0 && vsyncUs > 0) {
+        const int64_t delta = frameTs - lastFrameTs;
+        if (delta > 0 && delta < kMaxCadenceGapUs) {
+            const int64_t rem = delta % vsyncUs;
+            const double err = static_cast<double>(std::min(rem, vsyncUs - rem));
+            cadenceErrUs = cadenceErrUs < 0.0 ? err : cadenceErrUs + kEwma * (err - cadenceErrUs);
+        }
+    }
+    lastFrameTs = std::max(lastFrameTs, frameTs);
+    stats.aligned = Aligned();
+}
+
+void FrameScheduler::OnForcedEncode(int64_t frameTs) {
+    hasHeld = false;
+    stats.encoded++;
+    lastEncodedTs = frameTs;
+    idealUs = frameTs + periodUs;
+    Retarget();
+}
+
+FrameOffer FrameScheduler::Offer(int64_t frameTs, int64_t nowUs, bool congested, int layerPeriod) {
+    stats.offered++;
+    TrackCadence(frameTs);
+    if (idealUs == 0) idealUs = frameTs;
+    Retarget();
+
+    // With temporal layers, Send drops the enhancement frames while congested, so keep
+    // encoding for one layer period and skip input only if the base layer alone cannot drain.
+    if (congested && congestionSkipCount == 0 && congestedLayerFrames < layerPeriod) {
+        congestedLayerFrames++;
+    } else if (congested) {
+        if (congestionSkipCount == 0) congestionStartUs = nowUs;
+        congestionSkipCount++;
+        if (congestionSkipCount == 1 || congestionSkipCount % 10 == 0) {
+            DBG("FrameScheduler: Congestion skip #%d (ts=%lld, duration=%lldus)",
+                congestionSkipCount, frameTs, nowUs - congestionStartUs);
+        }
+        stats.congestionSkips++;
+        // Advance the deadline so we don't try to catch up and flood the queue further.
+        while (idealUs < frameTs) idealUs += periodUs;
+        Retarget();
+        return FrameOffer::Dropped;
+    } else if (congestionSkipCount > 0) {
+        LOG("FrameScheduler: Congestion cleared after %d skipped frames (%lldus total)",
+            congestionSkipCount, nowUs - congestionStartUs);
+        congestionSkipCount = 0;
+    }
+    if (!congested) congestedLayerFrames = 0;
+
+    if (frameTs - targetUs < -periodUs * 3 / 2) {
+        DBG("FrameScheduler: Frame too old (ts=%lld target=%lld delta=%lld framePeriod=%lld) - dropping",
+            frameTs, targetUs, frameTs - targetUs, periodUs);
+        stats.tooOld++;
+        return FrameOffer::Dropped;
+    }
+
+    if (!hasHeld) {
+        hasHeld = true;
+        heldTs = frameTs;
+        return FrameOffer::Held;
+    }
+    stats.superseded++;
+    if (std::llabs(frameTs - targetUs) < std::llabs(heldTs - targetUs)) {
+        heldTs = frameTs;
+        return FrameOffer::Replaced;
+    }
+    return FrameOffer::Superseded;
+}
+
+FrameDue FrameScheduler::Due(int64_t nowUs) {
+    if (!hasHeld) return FrameDue::Wait;
+    const bool late = heldTs < deadlineUs;
+    if (late && nowUs < targetUs + periodUs / 2) return FrameDue::Wait;
+    hasHeld = false;
+
+    if (nowUs - heldTs > periodUs * 2) {
+        DBG("FrameScheduler: Held frame too stale (age=%lldus, limit=%lldus, ts=%lld) - dropping",
+            nowUs - heldTs, periodUs * 2, heldTs);
+        stats.stale++;
+        stats.deadlineMisses++;
+        while (idealUs < nowUs - periodUs) idealUs += periodUs;
+        Retarget();
+        return FrameDue::Stale;
+    }
+
+    if (late) stats.deadlineMisses++;
+    stats.encoded++;
+    if (lastEncodedTs > 0) {
+        const double error = static_cast<double>(std::llabs(heldTs - lastEncodedTs - periodUs));
+        stats.jitterUs += kEwma * (error - stats.jitterUs);
+    }
+    stats.driftUs += kEwma * (static_cast<double>(heldTs - idealUs) - stats.driftUs);
+    lastEncodedTs = heldTs;
+
+    idealUs += periodUs;
+    if (idealUs < nowUs - periodUs * 2) idealUs = nowUs;
+    Retarget();
+    return FrameDue::Encode;
+}
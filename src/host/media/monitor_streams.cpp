@@ -0,0 +1,233 @@
+#include "host/media/monitor_streams.hpp"
+
+#include <algorithm>
+
+struct MonitorStreams::Session {
+    uint8_t id = 0;
+    int monitor = -1;
+    // Declared before capture, which pushes into it until destroyed.
+    FrameSlot slot;
+    std::unique_ptr<ScreenCapture> capture;
+    std::mutex encoderMutex;
+    std::unique_ptr<VideoEncoder> encoder;
+    // Most recent frame, kept so a key request on a static screen has something to encode.
+    FrameData last;
+    int handle = 0;
+};
+
+MonitorStreams::MonitorStreams(MonitorStreamCallbacks callbacks, int workers, int maxStreams)
+    : callbacks_(std::move(callbacks)), pool_(workers), maxStreams_(std::clamp(maxStreams, 1, MAX_VIDEO_STREAMS)) {}
+
+MonitorStreams::~MonitorStreams() { Clear(); }
+
+int MonitorStreams::RateOf(const Session& session) const {
+    return session.id == focused_ ? focusedFps_ : backgroundFps_;
+}
+
+bool MonitorStreams::BuildEncoder(Session& session) {
+    std::lock_guard<std::mutex> lock(session.encoderMutex);
+    session.encoder.reset();
+    try {
+        session.encoder = std::make_unique<VideoEncoder>(
+            std::max(2, session.capture->GetW() & ~1),
+            std::max(2, session.capture->GetH() & ~1),
+            RateOf(session),
+            session.capture->GetDev(),
+            session.capture->GetCtx(),
+            session.capture->GetMT(),
+            codec_,
+            format_);
+        LOG("MonitorStreams: Stream %u encoder %s %dx%d", session.id, session.encoder->GetActiveEncoderName().c_str(),
+            session.encoder->GetWidth(), session.encoder->GetHeight());
+        return true;
+    } catch (const std::exception& e) {
+        ERR("MonitorStreams: Encoder for stream %u failed: %s", session.id, e.what());
+        return false;
+    }
+}
+
+std::unique_ptr<MonitorStreams::Session> MonitorStreams::Open(uint8_t id, int monitor) {
+    auto session = std::make_unique<Session>();
+    session->id = id;
+    session->monitor = monitor;
+    try {
+        session->capture = std::make_unique<ScreenCapture>(&session->slot, monitor);
+    } catch (const std::exception& e) {
+        WARN("MonitorStreams: Capture of monitor %d failed: %s", monitor, e.what());
+        return nullptr;
+    }
+    session->capture->SetCursorCapture(cursorCapture_);
+    session->capture->SetFPS(RateOf(*session));
+    if (!BuildEncoder(*session)) return nullptr;
+
+    Session* raw = session.get();
+    raw->handle = pool_.Add([this, raw] { Encode(*raw); }, RateOf(*raw));
+    pool_.SetRate(raw->handle, RateOf(*raw), raw->id == focused_);
+    raw->slot.SetPushCallback([this, raw] { pool_.Notify(raw->handle); });
+    raw->capture->StartCapture();
+    LOG("MonitorStreams: Stream %u on monitor %d (%dx%d)", id, monitor, raw->capture->GetW(), raw->capture->GetH());
+    return session;
+}
+
+void MonitorStreams::Close(Session& session) {
+    session.capture->Shutdown();
+    pool_.Remove(session.handle);
+    session.slot.MarkReleased(session.last.poolIdx);
+    session.last.Release();
+    std::lock_guard<std::mutex> lock(session.encoderMutex);
+    session.encoder.reset();
+    LOG("MonitorStreams: Stream %u on monitor %d closed", session.id, session.monitor);
+}
+
+void MonitorStreams::Encode(Session& session) {
+    FrameData frame;
+    if (session.slot.Take(frame)) {
+        if (frame.generation != session.slot.GetGeneration() || !frame.tex) {
+            session.slot.MarkReleased(frame.poolIdx);
+            frame.Release();
+            return;
+        }
+        session.slot.MarkReleased(session.last.poolIdx);
+        session.last.Release();
+        session.last = frame;
+    } else if (!session.last.tex || !callbacks_.needsKey(session.id)) {
+        return;
+    }
+
+    FrameData& current = session.last;
+    if (current.needsSync && !session.capture->WaitReady(current.fence)) {
+        WARN("MonitorStreams: GPU fence not ready on stream %u (ts=%lld) - frame dropped", session.id, current.ts);
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(session.encoderMutex);
+    if (!session.encoder) return;
+    const bool forceKey = callbacks_.needsKey(session.id);
+    auto encoded = session.encoder->Encode(current.tex, current.ts, current.sourceTs, forceKey);
+    if (encoded) {
+        if (!callbacks_.send(session.id, *encoded)) session.encoder->OnSendFailed();
+        else if (encoded->isKey) callbacks_.onKeySent(session.id);
+    }
+
+    // The capture reuses the texture once it is released, so the encoder must be done reading it.
+    for (int retry = 0; retry < 8 && !session.encoder->IsEncodeComplete(); ++retry) {
+        std::this_thread::sleep_for(std::chrono::microseconds(500));
+    }
+    if (!encoded && session.encoder->NeedsRebuild()) {
+        lock.unlock();
+        WARN("MonitorStreams: Stream %u encoder lost its codec context, rebuilding", session.id);
+        BuildEncoder(session);
+    }
+}
+
+size_t MonitorStreams::Set(const std::vector<int>& monitors, CodecType codec, EncodeFormat format) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto it = sessions_.begin(); it != sessions_.end();) {
+        if (std::find(monitors.begin(), monitors.end(), (*it)->monitor) == monitors.end()) {
+            Close(**it);
+            it = sessions_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    if (codec != codec_ || format != format_) {
+        codec_ = codec;
+        format_ = format;
+        for (auto& session : sessions_) BuildEncoder(*session);
+    }
+
+    for (int monitor : monitors) {
+        const bool running = std::any_of(sessions_.begin(), sessions_.end(),
+            [monitor](const auto& s) { return s->monitor == monitor; });
+        if (running) continue;
+        if (static_cast<int>(sessions_.size()) + 1 >= maxStreams_) {
+            WARN("MonitorStreams: Stream limit %d reached - monitor %d not streamed", maxStreams_, monitor);
+            break;
+        }
+        uint8_t id = 1;
+        while (std::any_of(sessions_.begin(), sessions_.end(), [id](const auto& s) { return s->id == id; })) id++;
+        if (auto session = Open(id, monitor)) sessions_.push_back(std::move(session));
+    }
+
+    std::sort(sessions_.begin(), sessions_.end(), [](const auto& a, const auto& b) { return a->id < b->id; });
+    return sessions_.size();
+}
+
+void MonitorStreams::Clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& session : sessions_) Close(*session);
+    sessions_.clear();
+    focused_ = 0;
+}
+
+void MonitorStreams::RemoveMonitor(int monitor) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = std::find_if(sessions_.begin(), sessions_.end(), [monitor](const auto& s) { return s->monitor == monitor; });
+    if (it == sessions_.end()) return;
+    if ((*it)->id == focused_) focused_ = 0;
+    Close(**it);
+    sessions_.erase(it);
+}
+
+void MonitorStreams::SetCodec(CodecType codec, EncodeFormat format) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (codec == codec_ && format == format_) return;
+    codec_ = codec;
+    format_ = format;
+    for (auto& session : sessions_) BuildEncoder(*session);
+}
+
+void MonitorStreams::SetRates(uint8_t focused, int focusedFps, int backgroundFps) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (focused == focused_ && focusedFps == focusedFps_ && backgroundFps == backgroundFps_) return;
+    focused_ = focused;
+    focusedFps_ = focusedFps;
+    backgroundFps_ = backgroundFps;
+    for (auto& session : sessions_) {
+        const int fps = RateOf(*session);
+        pool_.SetRate(session->handle, fps, session->id == focused_);
+        session->capture->SetFPS(fps);
+        std::lock_guard<std::mutex> encoderLock(session->encoderMutex);
+        if (session->encoder) session->encoder->UpdateFPS(fps);
+    }
+}
+
+void MonitorStreams::SetCursorCapture(bool enabled) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    cursorCapture_ = enabled;
+    for (auto& session : sessions_) session->capture->SetCursorCapture(enabled);
+}
+
+void MonitorStreams::Kick(uint8_t id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& session : sessions_) {
+        if (session->id == id) pool_.Notify(session->handle);
+    }
+}
+
+int MonitorStreams::MonitorOf(uint8_t id) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& session : sessions_) {
+        if (session->id == id) return session->monitor;
+    }
+    return -1;
+}
+
+std::vector<VideoStreamInfo> MonitorStreams::List() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<VideoStreamInfo> list;
+    for (const auto& session : sessions_) {
+        std::lock_guard<std::mutex> encoderLock(session->encoderMutex);
+        if (!session->encoder) continue;
+        VideoStreamInfo info;
+        info.id = session->id;
+        info.monitor = static_cast<uint8_t>(session->monitor);
+        info.codec = codec_;
+        info.format = session->encoder->GetFormat();
+        info.width = static_cast<uint16_t>(session->encoder->GetWidth());
+        info.height = static_cast<uint16_t>(session->encoder->GetHeight());
+        list.push_back(info);
+    }
+    return list;
+}
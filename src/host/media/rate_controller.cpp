@@ -0,0 +1,77 @@
+#include "host/media/rate_controller.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    // Roughly +6 QP halves the bitrate for H.264/HEVC; AV1 hardware QPs are
+    // reported on the same scale by NVENC.
+    constexpr double kQpPerHalving = 6.0;
+    constexpr double kQpDeadband = 1.5;
+    constexpr double kMaxStepDown = 0.8;
+    constexpr double kMaxStepUp = 1.5;
+    constexpr double kApplyThreshold = 0.08;
+    // Frame size over the per-frame budget, treated as a motion onset.
+    constexpr double kOverBudget = 2.0;
+}
+
+void RateController::Reset(const RateControlConfig& config) {
+    cfg = config;
+    cfg.fps = std::max(1, cfg.fps);
+    cfg.floorBps = std::clamp<int64_t>(cfg.floorBps, 1, std::max<int64_t>(1, cfg.ceilingBps));
+    targetBps = static_cast<double>(cfg.ceilingBps);
+    appliedBps = cfg.ceilingBps;
+    qpAvg = -1.0;
+    bytesAvg = 0.0;
+    framesSinceApply = 0;
+}
+
+bool RateController::OnFrame(size_t bytes, bool key, int qp) {
+    frames++;
+    targetSum += static_cast<double>(appliedBps);
+    framesSinceApply++;
+    if (cfg.ceilingBps <= 0 || appliedBps <= 0) return false;
+    // Keyframe size and QP say nothing about the steady state.
+    if (key) return false;
+
+    const double frameBytes = static_cast<double>(bytes);
+    bytesAvg = bytesAvg <= 0.0 ? frameBytes : 0.85 * bytesAvg + 0.15 * frameBytes;
+    if (qp >= 0) qpAvg = qpAvg < 0.0 ? qp : 0.8 * qpAvg + 0.2 * qp;
+
+    const double applied = static_cast<double>(appliedBps);
+    const double budgetBytes = applied / 8.0 / cfg.fps;
+    const bool motion = appliedBps < cfg.ceilingBps && frameBytes > budgetBytes * kOverBudget;
+
+    double desired = targetBps;
+    if (motion) {
+        desired = static_cast<double>(cfg.ceilingBps);
+    } else if (qpAvg >= 0.0) {
+        // Positive error: the encoder is below the target QP, i.e. spending more than needed.
+        const double err = cfg.targetQp - qpAvg;
+        if (std::abs(err) > kQpDeadband) {
+            const double excess = err > 0.0 ? err - kQpDeadband : err + kQpDeadband;
+            desired = applied * std::clamp(std::exp2(-excess / kQpPerHalving), kMaxStepDown, kMaxStepUp);
+        }
+    } else {
+        const double utilization = bytesAvg * 8.0 * cfg.fps / applied;
+        if (utilization < 0.5) desired = applied * std::max(kMaxStepDown, utilization * 1.5);
+        else if (utilization > 0.9) desired = applied * 1.25;
+    }
+    targetBps = std::clamp(desired, static_cast<double>(cfg.floorBps), static_cast<double>(cfg.ceilingBps));
+
+    const bool due = framesSinceApply >= std::max(1, cfg.fps / 4);
+    if (!motion && !(due && std::abs(targetBps - applied) > applied * kApplyThreshold)) return false;
+    if (std::llround(targetBps) == appliedBps) return false;
+
+    appliedBps = std::llround(targetBps);
+    framesSinceApply = 0;
+    updates++;
+    return true;
+}
+
+bool SupportsDynamicBitrate(const std::string& encoderName) {
+    auto endsWith = [&encoderName](const char* suffix, size_t n) {
+        return encoderName.size() >= n && encoderName.compare(encoderName.size() - n, n, suffix) == 0;
+    };
+    return endsWith("_nvenc", 6) || endsWith("_qsv", 4) || endsWith("_amf", 4);
+}
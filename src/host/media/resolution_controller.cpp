@@ -0,0 +1,124 @@
+#include "host/media/resolution_controller.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    constexpr int64_t kWindowUs = 250'000;
+    // Consecutive windows of pressure before stepping down.
+    constexpr int kDownWindows = 2;
+    constexpr int64_t kBaseUpHoldUs = 2'000'000;
+    constexpr int64_t kMaxUpHoldUs = 16'000'000;
+}
+
+void UpStepHold::Reset(int64_t baseHold, int64_t maxHold) {
+    base = baseHold;
+    cap = std::max(baseHold, maxHold);
+    hold = base;
+    lastUpUs = 0;
+}
+
+void UpStepHold::OnStepDown(int64_t nowUs) {
+    // A down-step this soon after an up-step means the up-step did not fit.
+    if (lastUpUs > 0 && nowUs - lastUpUs < kFailedUpStepUs) hold = std::min(hold * 2, cap);
+}
+
+void UpStepHold::OnSteady(int64_t nowUs) {
+    if (lastUpUs > 0 && nowUs - lastUpUs > kStableUpStepUs) hold = base;
+}
+
+void ResolutionController::Reset(const ResolutionControlConfig& config) {
+    cfg = config;
+    cfg.minPercent = std::clamp(cfg.minPercent, kMinScalePercent, 100);
+    cfg.minBitrateFraction = std::clamp(cfg.minBitrateFraction, 0.05, 1.0);
+    percent = 100;
+    windowStartUs = 0;
+    windowStartBytes = 0;
+    windowCongested = false;
+    throughputBps = -1.0;
+    downWindows = 0;
+    upSinceUs = 0;
+    upHold.Reset(kBaseUpHoldUs, kMaxUpHoldUs);
+}
+
+int ResolutionController::BandwidthPercent() const {
+    if (!windowCongested || throughputBps < 0.0 || cfg.fullBps <= 0) return 100;
+    // Bits per pixel scale with the inverse square of the linear scale.
+    const double fit = 100.0 * std::sqrt(throughputBps / (cfg.minBitrateFraction * static_cast<double>(cfg.fullBps)));
+    for (const int level : kScaleLevels) {
+        if (level <= fit && level >= cfg.minPercent) return level;
+    }
+    return cfg.minPercent;
+}
+
+bool ResolutionController::OnFrame(int64_t nowUs, uint64_t deliveredBytes, bool congested) {
+    windowCongested = windowCongested || congested;
+
+    if (windowStartUs == 0 || deliveredBytes < windowStartBytes) {
+        windowStartUs = nowUs;
+        windowStartBytes = deliveredBytes;
+        windowCongested = congested;
+        return false;
+    }
+    const int64_t elapsedUs = nowUs - windowStartUs;
+    if (elapsedUs < kWindowUs) return false;
+
+    // Only a backed-up queue shows what the link can carry; otherwise it carried everything offered.
+    if (windowCongested) {
+        const double rate = static_cast<double>(deliveredBytes - windowStartBytes) * 8.0 * 1e6 / static_cast<double>(elapsedUs);
+        throughputBps = throughputBps < 0.0 ? rate : 0.5 * throughputBps + 0.5 * rate;
+    }
+    const int desired = BandwidthPercent();
+    windowStartUs = nowUs;
+    windowStartBytes = deliveredBytes;
+    windowCongested = congested;
+
+    if (desired < percent) {
+        upSinceUs = 0;
+        if (++downWindows < kDownWindows) return false;
+        upHold.OnStepDown(nowUs);
+        percent = desired;
+        downWindows = 0;
+        changes++;
+        return true;
+    }
+
+    downWindows = 0;
+    if (desired > percent) {
+        if (upSinceUs == 0) upSinceUs = nowUs;
+        if (nowUs - upSinceUs < upHold.Value()) return false;
+        percent = NextScaleUp(percent);
+        upSinceUs = 0;
+        upHold.OnStepUp(nowUs);
+        changes++;
+        return true;
+    }
+
+    upSinceUs = 0;
+    upHold.OnSteady(nowUs);
+    return false;
+}
+
+std::pair<int, int> ScaleResolution(int width, int height, int percent) {
+    if (percent >= 100) return {width, height};
+    auto scale = [percent](int v) {
+        const int scaled = ((v * percent + 99) / 100 + 1) & ~1;
+        return std::clamp(scaled, std::min(v, 2), v);
+    };
+    return {scale(width), scale(height)};
+}
+
+int NextScaleUp(int percent) {
+    int up = 100;
+    for (const int level : kScaleLevels) {
+        if (level > percent) up = level;
+    }
+    return up;
+}
+
+int NextScaleDown(int percent, int minPercent) {
+    for (const int level : kScaleLevels) {
+        if (level < percent) return std::max(level, minPercent);
+    }
+    return minPercent;
+}
@@ -0,0 +1,357 @@
+#include "host/media/x11_capture.hpp"
+
+#include "host/core/logging.hpp"
+
+#include <xcb/xcb.h>
+#include <xcb/damage.h>
+#include <xcb/shm.h>
+#include <xcb/xfixes.h>
+
+#include <sys/ipc.h>
+#include <sys/shm.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+    // Past this many rectangles or this share of the screen, one whole-screen fetch
+    // is cheaper than a request per rectangle.
+    constexpr size_t kMaxDamageRects = 64;
+    constexpr int64_t kWholeFetchPercent = 50;
+    constexpr uint32_t kRectAlign = 64;
+    // Reads a returned buffer can be behind and still be patched from damage.
+    constexpr uint64_t kHistory = 8;
+
+    class X11Source final : public CaptureSource {
+        xcb_connection_t* conn = nullptr;
+        xcb_window_t root = XCB_NONE;
+        std::string displayName;
+        int rateFps = 60;
+        bool trackDamage = true;
+        uint64_t frame = 0;
+        bool resized = false;
+
+        int shmId = -1;
+        uint8_t* shm = nullptr;
+        size_t shmSize = 0;
+        xcb_shm_seg_t seg = XCB_NONE;
+        xcb_damage_damage_t damage = XCB_NONE;
+        xcb_xfixes_region_t region = XCB_NONE;
+
+        // Damage collected by each of the last kHistory Reads and the buffer each one
+        // filled, so a buffer handed back a few Reads later only needs what changed since.
+        struct Past {
+            std::vector<xcb_rectangle_t> rects;
+            bool known = false;
+            const uint8_t* data = nullptr;
+            size_t size = 0;
+            uint64_t frame = 0;
+        };
+        std::array<Past, kHistory> history;
+        std::vector<xcb_rectangle_t> rects, fetch;
+        std::vector<uint8_t> tileMask;
+        FrameChangeInfo changes;
+
+        void DetachShm() {
+            if (seg != XCB_NONE) xcb_shm_detach(conn, seg);
+            if (shm) shmdt(shm);
+            seg = XCB_NONE;
+            shm = nullptr;
+            shmSize = 0;
+        }
+
+        bool AttachShm() {
+            DetachShm();
+            shmSize = static_cast<size_t>(w) * h * 4;
+            shmId = shmget(IPC_PRIVATE, shmSize, IPC_CREAT | 0600);
+            if (shmId < 0) {
+                ERR("X11Capture: shmget of %zu bytes failed: %s", shmSize, strerror(errno));
+                return false;
+            }
+            void* mem = shmat(shmId, nullptr, 0);
+            if (mem == reinterpret_cast<void*>(-1)) {
+                ERR("X11Capture: shmat failed: %s", strerror(errno));
+                shmctl(shmId, IPC_RMID, nullptr);
+                return false;
+            }
+            shm = static_cast<uint8_t*>(mem);
+            seg = xcb_generate_id(conn);
+            xcb_generic_error_t* error = xcb_request_check(conn, xcb_shm_attach_checked(conn, seg, static_cast<uint32_t>(shmId), 0));
+            // Freed once both processes detach.
+            shmctl(shmId, IPC_RMID, nullptr);
+            if (error) {
+                free(error);
+                seg = XCB_NONE;
+                ERR("X11Capture: MIT-SHM attach failed (is the X server on another machine?)");
+                return false;
+            }
+            return true;
+        }
+
+        bool EnableDamage() {
+            const xcb_query_extension_reply_t* fixesExt = xcb_get_extension_data(conn, &xcb_xfixes_id);
+            const xcb_query_extension_reply_t* damageExt = xcb_get_extension_data(conn, &xcb_damage_id);
+            if (!fixesExt || !fixesExt->present || !damageExt || !damageExt->present) {
+                WARN("X11Capture: XDamage/XFixes not available - fetching whole frames");
+                return false;
+            }
+            // Both extensions reject requests until their version is negotiated.
+            free(xcb_xfixes_query_version_reply(conn, xcb_xfixes_query_version(conn, 5, 0), nullptr));
+            free(xcb_damage_query_version_reply(conn, xcb_damage_query_version(conn, 1, 1), nullptr));
+            damage = xcb_generate_id(conn);
+            xcb_damage_create(conn, damage, root, XCB_DAMAGE_REPORT_LEVEL_NON_EMPTY);
+            region = xcb_generate_id(conn);
+            xcb_xfixes_create_region(conn, region, 0, nullptr);
+            return true;
+        }
+
+        // The root can change size (RandR); the segment follows it.
+        bool Resize(int gw, int gh) {
+            if (gw == w && gh == h) return true;
+            LOG("X11Capture: Root resized %dx%d -> %dx%d", w, h, gw, gh);
+            w = gw;
+            h = gh;
+            resized = true;
+            return AttachShm();
+        }
+
+        bool CheckGeometry() {
+            xcb_get_geometry_reply_t* geometry = xcb_get_geometry_reply(conn, xcb_get_geometry(conn, root), nullptr);
+            if (!geometry) return false;
+            const int gw = geometry->width, gh = geometry->height;
+            free(geometry);
+            return Resize(gw, gh);
+        }
+
+        // Drains the event queue. A RandR resize sends the root a ConfigureNotify.
+        bool PollEvents() {
+            int gw = w, gh = h;
+            while (xcb_generic_event_t* event = xcb_poll_for_event(conn)) {
+                if ((event->response_type & 0x7f) == XCB_CONFIGURE_NOTIFY) {
+                    const auto* configure = reinterpret_cast<const xcb_configure_notify_event_t*>(event);
+                    if (configure->window == root) {
+                        gw = configure->width;
+                        gh = configure->height;
+                    }
+                }
+                free(event);
+            }
+            return Resize(gw, gh);
+        }
+
+        // Reads since bgra was filled here, 0 when it is not a recent buffer of this size.
+        uint64_t BufferAge(const std::vector<uint8_t>& bgra) const {
+            uint64_t age = 0;
+            for (const auto& past : history) {
+                if (past.data && past.data == bgra.data() && past.size == bgra.size() && frame - past.frame < kHistory) {
+                    if (age == 0 || frame - past.frame < age) age = frame - past.frame;
+                }
+            }
+            return age;
+        }
+
+        bool FetchWhole(uint8_t* dst) {
+            xcb_shm_get_image_reply_t* reply = xcb_shm_get_image_reply(conn,
+                xcb_shm_get_image(conn, root, 0, 0, static_cast<uint16_t>(w), static_cast<uint16_t>(h), ~0u,
+                    XCB_IMAGE_FORMAT_Z_PIXMAP, seg, 0), nullptr);
+            if (!reply) return false;
+            free(reply);
+            memcpy(dst, shm, static_cast<size_t>(w) * h * 4);
+            return true;
+        }
+
+        // Packs the rectangles into the segment, one batch of requests per fill, and
+        // copies each into dst at its position.
+        bool FetchRects(uint8_t* dst) {
+            const size_t rowBytes = static_cast<size_t>(w) * 4;
+            size_t begin = 0;
+            while (begin < fetch.size()) {
+                std::vector<xcb_shm_get_image_cookie_t> cookies;
+                std::vector<uint32_t> offsets;
+                uint32_t offset = 0;
+                size_t end = begin;
+                for (; end < fetch.size(); ++end) {
+                    const xcb_rectangle_t& r = fetch[end];
+                    const uint32_t bytes = static_cast<uint32_t>(r.width) * r.height * 4;
+                    if (offset + bytes > shmSize) break;
+                    cookies.push_back(xcb_shm_get_image(conn, root, r.x, r.y, r.width, r.height, ~0u,
+                        XCB_IMAGE_FORMAT_Z_PIXMAP, seg, offset));
+                    offsets.push_back(offset);
+                    offset = (offset + bytes + kRectAlign - 1) / kRectAlign * kRectAlign;
+                }
+                bool ok = true;
+                for (size_t i = 0; i < cookies.size(); ++i) {
+                    xcb_shm_get_image_reply_t* reply = xcb_shm_get_image_reply(conn, cookies[i], nullptr);
+                    if (!reply) {
+                        ok = false;
+                        continue;
+                    }
+                    free(reply);
+                    const xcb_rectangle_t& r = fetch[begin + i];
+                    const size_t rectRow = static_cast<size_t>(r.width) * 4;
+                    const uint8_t* src = shm + offsets[i];
+                    uint8_t* at = dst + static_cast<size_t>(r.y) * rowBytes + static_cast<size_t>(r.x) * 4;
+                    for (int y = 0; y < r.height; ++y) memcpy(at + y * rowBytes, src + y * rectRow, rectRow);
+                }
+                if (!ok) return false;
+                begin = end;
+            }
+            return true;
+        }
+
+        // Takes the damage accumulated since the last call. False: not known.
+        bool CollectDamage() {
+            rects.clear();
+            xcb_damage_subtract(conn, damage, XCB_NONE, region);
+            xcb_xfixes_fetch_region_reply_t* reply = xcb_xfixes_fetch_region_reply(conn, xcb_xfixes_fetch_region(conn, region), nullptr);
+            if (!reply) return false;
+            const xcb_rectangle_t* list = xcb_xfixes_fetch_region_rectangles(reply);
+            const int count = xcb_xfixes_fetch_region_rectangles_length(reply);
+            for (int i = 0; i < count; ++i) {
+                const int x0 = std::max<int>(0, list[i].x), y0 = std::max<int>(0, list[i].y);
+                const int x1 = std::min<int>(w, list[i].x + list[i].width), y1 = std::min<int>(h, list[i].y + list[i].height);
+                if (x1 <= x0 || y1 <= y0) continue;
+                rects.push_back({static_cast<int16_t>(x0), static_cast<int16_t>(y0),
+                                 static_cast<uint16_t>(x1 - x0), static_cast<uint16_t>(y1 - y0)});
+            }
+            free(reply);
+            return true;
+        }
+
+        void BuildChanges() {
+            constexpr int tile = TileChangeDetector::kTileSize;
+            const int cols = (w + tile - 1) / tile, rows = (h + tile - 1) / tile;
+            tileMask.assign(static_cast<size_t>(cols) * rows, 0);
+            changes.rects.clear();
+            for (const auto& r : rects) {
+                changes.rects.push_back({r.x, r.y, r.width, r.height});
+                for (int ty = r.y / tile; ty <= (r.y + r.height - 1) / tile; ++ty) {
+                    for (int tx = r.x / tile; tx <= (r.x + r.width - 1) / tile; ++tx) tileMask[static_cast<size_t>(ty) * cols + tx] = 1;
+                }
+            }
+            changes.totalTiles = cols * rows;
+            changes.changedTiles = static_cast<int>(std::count(tileMask.begin(), tileMask.end(), 1));
+            changes.valid = true;
+        }
+
+    public:
+        X11Source(std::string display, int rate, bool damageTracking)
+            : displayName(std::move(display)), rateFps(std::max(1, rate)), trackDamage(damageTracking) {}
+
+        ~X11Source() override {
+            if (!conn) return;
+            if (damage != XCB_NONE) xcb_damage_destroy(conn, damage);
+            if (region != XCB_NONE) xcb_xfixes_destroy_region(conn, region);
+            DetachShm();
+            xcb_disconnect(conn);
+        }
+
+        bool Open() {
+            int screenNum = 0;
+            conn = xcb_connect(displayName.empty() ? nullptr : displayName.c_str(), &screenNum);
+            if (xcb_connection_has_error(conn)) {
+                ERR("X11Capture: Cannot connect to display '%s'", displayName.empty() ? getenv("DISPLAY") ? getenv("DISPLAY") : "" : displayName.c_str());
+                return false;
+            }
+            const xcb_setup_t* setup = xcb_get_setup(conn);
+            xcb_screen_iterator_t it = xcb_setup_roots_iterator(setup);
+            for (int i = 0; i < screenNum && it.rem > 0; ++i) xcb_screen_next(&it);
+            const xcb_screen_t* scr = it.data;
+            if (!scr) return false;
+            root = scr->root;
+            w = scr->width_in_pixels;
+            h = scr->height_in_pixels;
+            fps = rateFps;
+
+            bool fourBytes = false;
+            for (auto f = xcb_setup_pixmap_formats_iterator(setup); f.rem > 0; xcb_format_next(&f)) {
+                if (f.data->depth == scr->root_depth && f.data->bits_per_pixel == 32) fourBytes = true;
+            }
+            if ((scr->root_depth != 24 && scr->root_depth != 32) || !fourBytes) {
+                ERR("X11Capture: Root depth %d is not 32-bit TrueColor", scr->root_depth);
+                return false;
+            }
+            const xcb_query_extension_reply_t* shmExt = xcb_get_extension_data(conn, &xcb_shm_id);
+            if (!shmExt || !shmExt->present) {
+                ERR("X11Capture: MIT-SHM not available");
+                return false;
+            }
+            if (!AttachShm()) return false;
+            const uint32_t events = XCB_EVENT_MASK_STRUCTURE_NOTIFY;
+            xcb_change_window_attributes(conn, root, XCB_CW_EVENT_MASK, &events);
+            if (trackDamage) trackDamage = EnableDamage();
+            LOG("X11Capture: %s %dx%d depth %d, MIT-SHM%s", Describe().c_str(), w, h, scr->root_depth,
+                trackDamage ? " + XDamage" : "");
+            return true;
+        }
+
+        bool Read(std::vector<uint8_t>& bgra) override {
+            if (xcb_connection_has_error(conn)) {
+                ERR("X11Capture: Connection to the X server lost");
+                return false;
+            }
+            frameTimeUs = static_cast<int64_t>(frame * 1000000 / static_cast<uint64_t>(rateFps));
+            if (!PollEvents()) {
+                ERR("X11Capture: Cannot follow the root resize at frame %llu", static_cast<unsigned long long>(frame));
+                return false;
+            }
+
+            // Always collected, so damage from before a whole fetch is not reported later.
+            bool known = false;
+            if (trackDamage) known = CollectDamage() && frame > 0 && !resized;
+            resized = false;
+            Past& now = history[frame % kHistory];
+            now.rects = rects;
+            now.known = known;
+
+            // A buffer filled by a recent Read gets the damage since; any other a whole fetch.
+            const uint64_t age = BufferAge(bgra);
+            bool patch = age > 0;
+            fetch.clear();
+            for (uint64_t f = frame + 1 - age; patch && f <= frame; ++f) {
+                const Past& past = history[f % kHistory];
+                patch = past.known;
+                fetch.insert(fetch.end(), past.rects.begin(), past.rects.end());
+            }
+            int64_t area = 0;
+            for (const auto& r : fetch) area += static_cast<int64_t>(r.width) * r.height;
+            const bool whole = !patch || fetch.size() > kMaxDamageRects || area * 100 > static_cast<int64_t>(w) * h * kWholeFetchPercent;
+
+            bgra.resize(static_cast<size_t>(w) * h * 4);
+            bool ok = whole ? FetchWhole(bgra.data()) : FetchRects(bgra.data());
+            if (!ok) {
+                // A failed fetch is usually a resize racing the request.
+                if (!CheckGeometry() || (bgra.resize(static_cast<size_t>(w) * h * 4), !FetchWhole(bgra.data()))) {
+                    ERR("X11Capture: Screen fetch failed at frame %llu", static_cast<unsigned long long>(frame));
+                    return false;
+                }
+                if (trackDamage) CollectDamage();
+                resized = false;
+                now.known = false;
+                changes = {};
+            } else if (known) {
+                BuildChanges();
+            } else {
+                changes = {};
+            }
+            now.data = bgra.data();
+            now.size = bgra.size();
+            now.frame = frame;
+            frame++;
+            return true;
+        }
+
+        std::string Describe() const override { return "x11:" + displayName; }
+        bool Live() const override { return true; }
+        const FrameChangeInfo* Changes() const override { return &changes; }
+    };
+}
+
+std::unique_ptr<CaptureSource> OpenX11Source(const std::string& display, int rateFps, bool trackDamage) {
+    auto source = std::make_unique<X11Source>(display, rateFps, trackDamage);
+    if (!source->Open()) return nullptr;
+    return source;
+}
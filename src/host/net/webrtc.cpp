@@ -1,6 +1,7 @@
 #include "host/net/webrtc.hpp"
 #include <algorithm>
 #include <array>
+#include <cstddef>
 #include <cstring>
 #include <utility>
 
@@ -41,6 +42,52 @@ std::vector<uint8_t> BuildPacket(const Header& header, const uint8_t* payload, s
     return packet;
 }
 
+std::vector<uint8_t> BuildPacket(const PacketHeader& header, const EncodedFrame& frame, size_t offset, size_t payloadBytes) {
+    std::vector<uint8_t> packet(sizeof(PacketHeader) + payloadBytes);
+    memcpy(packet.data(), &header, sizeof(PacketHeader));
+    frame.CopyRange(offset, packet.data() + sizeof(PacketHeader), payloadBytes);
+    return packet;
+}
+
+uint8_t LayerFlags(int layer) {
+    return static_cast<uint8_t>((std::clamp(layer, 0, PKT_FLAG_LAYER_MASK >> PKT_FLAG_LAYER_SHIFT) << PKT_FLAG_LAYER_SHIFT) & PKT_FLAG_LAYER_MASK);
+}
+
+uint8_t StreamFlags(uint8_t stream) {
+    return static_cast<uint8_t>((stream << PKT_FLAG_STREAM_SHIFT) & PKT_FLAG_STREAM_MASK);
+}
+
+// Removes every queued packet of a temporal enhancement layer frame; base layer,
+// keyframe and repeat packets keep their order. Each discarded frame leaves a
+// FRAME_DROPPED header in its place so the client can tell its id apart from a
+// loss. Returns the number of packets removed.
+size_t DropEnhancementLayerPackets(std::queue<std::vector<uint8_t>>& queue) {
+    std::queue<std::vector<uint8_t>> kept;
+    size_t dropped = 0;
+    bool marked = false;
+    uint32_t markedFrameId = 0;
+    for (; !queue.empty(); queue.pop()) {
+        std::vector<uint8_t>& packet = queue.front();
+        if (packet.size() < sizeof(PacketHeader) || !(packet[offsetof(PacketHeader, flags)] & PKT_FLAG_LAYER_MASK)) {
+            kept.push(std::move(packet));
+            continue;
+        }
+        dropped++;
+        PacketHeader header;
+        memcpy(&header, packet.data(), sizeof(header));
+        if (marked && header.frameId == markedFrameId) continue;
+        marked = true;
+        markedFrameId = header.frameId;
+        header.frameType = FRAME_DROPPED;
+        header.packetType = PKT_DATA;
+        header.chunkIndex = 0;
+        header.chunkBytes = 0;
+        kept.push(BuildPacket(header, nullptr, 0));
+    }
+    queue.swap(kept);
+    return dropped;
+}
+
 void DrainQueuedChannel(
     const std::shared_ptr<rtc::DataChannel>& channel,
     std::queue<std::vector<uint8_t>>& queue,
@@ -49,7 +96,8 @@ void DrainQueuedChannel(
     std::atomic<uint64_t>& errorCounter,
     std::atomic<bool>& drainActive,
     std::atomic<int>* overflowCounter = nullptr,
-    std::atomic<bool>* requestKey = nullptr) {
+    std::atomic<bool>* requestKey = nullptr,
+    std::atomic<uint64_t>* sentBytes = nullptr) {
     bool expected = false;
     if (!drainActive.compare_exchange_strong(expected, true, std::memory_order_acq_rel, std::memory_order_acquire)) return;
     struct DrainGuard { std::atomic<bool>& active; ~DrainGuard() { active.store(false, std::memory_order_release); } } guard{drainActive};
@@ -77,6 +125,7 @@ void DrainQueuedChannel(
         try {
             channel->send((const std::byte*)packet.data(), packet.size());
             sent++;
+            if (sentBytes) sentBytes->fetch_add(packet.size(), std::memory_order_relaxed);
         } catch (const std::exception& e) {
             errorCounter++;
             failed++;
@@ -167,8 +216,10 @@ void WebRTCServer::SendMonitorList() {
 }
 
 void WebRTCServer::SendCodecCaps() {
-    uint8_t buf[5]{};
+    uint8_t buf[8]{};
     WritePod<uint32_t>(buf, MSG_CODEC_CAPS); buf[4] = callbacks_.getCodecCaps ? callbacks_.getCodecCaps() : 0x07;
+    const std::array<uint8_t, 3> formats = callbacks_.getFormatCaps ? callbacks_.getFormatCaps() : std::array<uint8_t, 3>{1, 1, 1};
+    memcpy(buf + 5, formats.data(), formats.size());
     SendCtrl(buf, sizeof(buf));
 }
 
@@ -180,6 +231,24 @@ void WebRTCServer::SendVersion() {
     SendCtrl(buf.data(), buf.size());
 }
 
+void WebRTCServer::SendStreamList() {
+    const std::vector<VideoStreamInfo> streams = callbacks_.getStreams ? callbacks_.getStreams() : std::vector<VideoStreamInfo>{};
+    std::vector<uint8_t> buf(5 + streams.size() * 8);
+    WritePod<uint32_t>(buf.data(), MSG_STREAMS_INFO);
+    buf[4] = static_cast<uint8_t>(streams.size());
+    size_t offset = 5;
+    for (const auto& stream : streams) {
+        buf[offset] = stream.id;
+        buf[offset + 1] = stream.monitor;
+        buf[offset + 2] = static_cast<uint8_t>(stream.codec);
+        buf[offset + 3] = static_cast<uint8_t>(stream.format);
+        WritePod<uint16_t>(buf.data() + offset + 4, stream.width);
+        WritePod<uint16_t>(buf.data() + offset + 6, stream.height);
+        offset += 8;
+    }
+    SendCtrl(buf.data(), buf.size());
+}
+
 void WebRTCServer::HandleCtrl(const rtc::binary& message) {
     if (message.size() < 4 || chRdy < NUM_CH) {
         if (message.size() < 4) WARN("WebRTC: HandleCtrl - message too small (%zu bytes)", message.size());
@@ -196,12 +265,6 @@ void WebRTCServer::HandleCtrl(const rtc::binary& message) {
         ack[6] = mode;
         SendCtrl(ack, sizeof(ack));
     };
-    const auto sendAckU8 = [&](uint32_t ackType, uint8_t value) {
-        uint8_t ack[5]{};
-        WritePod<uint32_t>(ack, ackType);
-        ack[4] = value;
-        SendCtrl(ack, sizeof(ack));
-    };
     if (magic == MSG_PING) {
         if (message.size() == 16) {
             lastPing = GetTimestamp() / 1000;
@@ -228,17 +291,33 @@ void WebRTCServer::HandleCtrl(const rtc::binary& message) {
         return;
     }
     if (magic == MSG_CODEC_SET) {
-        if (message.size() == 5 && static_cast<uint8_t>(message[4]) <= 2) {
+        // The EncodeFormat byte is optional; 5-byte requests mean 4:2:0.
+        const uint8_t formatByte = message.size() == 6 ? static_cast<uint8_t>(message[5]) : FORMAT_YUV420;
+        if ((message.size() == 5 || message.size() == 6) && static_cast<uint8_t>(message[4]) <= 2 && formatByte <= FORMAT_YUV420_10) {
             const CodecType requestedCodec = static_cast<CodecType>(static_cast<uint8_t>(message[4]));
-            const bool accepted = !callbacks_.onCodecChange || callbacks_.onCodecChange(requestedCodec);
-            if (accepted) { curCodec = requestedCodec; needsKey = true; }
-            sendAckU8(MSG_CODEC_ACK, static_cast<uint8_t>(curCodec.load()));
+            const EncodeFormat requestedFormat = static_cast<EncodeFormat>(formatByte);
+            const bool accepted = !callbacks_.onCodecChange || callbacks_.onCodecChange(requestedCodec, requestedFormat);
+            if (accepted) { curCodec = requestedCodec; needsKey = true; RequestStreamKeyframes(); }
+            uint8_t ack[6]{};
+            WritePod<uint32_t>(ack, MSG_CODEC_ACK);
+            ack[4] = static_cast<uint8_t>(curCodec.load());
+            ack[5] = static_cast<uint8_t>(callbacks_.getFormat ? callbacks_.getFormat() : FORMAT_YUV420);
+            SendCtrl(ack, sizeof(ack));
             SendHostInfo();
             SendEncoderInfo();
+            if (accepted) SendStreamList();
         }
         return;
     }
     if (magic == MSG_REQUEST_KEY) {
+        // A fifth byte names a stream other than the primary one.
+        const uint8_t stream = message.size() == 5 ? static_cast<uint8_t>(message[4]) : 0;
+        if (stream >= MAX_VIDEO_STREAMS) return;
+        if (stream > 0) {
+            streamKeys_.fetch_or(1u << stream, std::memory_order_acq_rel);
+            if (callbacks_.onStreamKeyRequest) callbacks_.onStreamKeyRequest(stream);
+            return;
+        }
         constexpr int64_t kKeyReqMinIntervalMs = 350;
         const int64_t nowMs = GetTimestamp() / 1000;
         const int64_t lastMs = lastKeyReqMs.load(std::memory_order_acquire);
@@ -253,6 +332,33 @@ void WebRTCServer::HandleCtrl(const rtc::binary& message) {
             needsKey = true;
             SendMonitorList();
             SendHostInfo();
+            SendStreamList();
+            // The primary stream takes focus again.
+            uint8_t ack[5];
+            WritePod<uint32_t>(ack, MSG_STREAM_FOCUS);
+            ack[4] = 0;
+            SendCtrl(ack, sizeof(ack));
+        }
+        return;
+    }
+    if (magic == MSG_STREAMS_SET) {
+        if (message.size() >= 5 && message.size() == 5 + static_cast<size_t>(static_cast<uint8_t>(message[4])) &&
+            static_cast<uint8_t>(message[4]) < MAX_VIDEO_STREAMS) {
+            std::vector<int> monitors;
+            for (size_t i = 5; i < message.size(); ++i) monitors.push_back(static_cast<uint8_t>(message[i]));
+            RequestStreamKeyframes();
+            if (callbacks_.onStreamsSet) callbacks_.onStreamsSet(monitors);
+            SendStreamList();
+        }
+        return;
+    }
+    if (magic == MSG_STREAM_FOCUS) {
+        if (message.size() == 5 && static_cast<uint8_t>(message[4]) < MAX_VIDEO_STREAMS &&
+            callbacks_.onStreamFocus && callbacks_.onStreamFocus(static_cast<uint8_t>(message[4]))) {
+            uint8_t ack[5];
+            WritePod<uint32_t>(ack, MSG_STREAM_FOCUS);
+            ack[4] = static_cast<uint8_t>(message[4]);
+            SendCtrl(ack, sizeof(ack));
         }
         return;
     }
@@ -286,8 +392,25 @@ void WebRTCServer::HandleCtrl(const rtc::binary& message) {
         }
         return;
     }
+    if (magic == MSG_AUDIO_FEEDBACK) {
+        if (message.size() == 8) {
+            const uint8_t caps = static_cast<uint8_t>(message[4]) & (AUDIO_CAP_REDUNDANCY | AUDIO_CAP_DTX);
+            audioCaps_.store(caps, std::memory_order_release);
+            if (callbacks_.onAudioFeedback) callbacks_.onAudioFeedback(caps, std::min<int>(100, static_cast<uint8_t>(message[5])));
+        }
+        return;
+    }
     if (magic == MSG_CURSOR_CAPTURE) { handleToggle(callbacks_.onCursorCapture); return; }
-    if (magic == MSG_AUDIO_ENABLE) { handleToggle(callbacks_.onAudioEnable); return; }
+    if (magic == MSG_AUDIO_ENABLE) {
+        // Byte 5, when present: frame duration in 0.5 ms units, applied before streaming starts.
+        if (message.size() == 6) {
+            if (callbacks_.onAudioFrameSize) callbacks_.onAudioFrameSize(static_cast<uint8_t>(message[5]) * 24);
+            if (callbacks_.onAudioEnable) callbacks_.onAudioEnable(static_cast<uint8_t>(message[4]) != 0);
+            return;
+        }
+        handleToggle(callbacks_.onAudioEnable);
+        return;
+    }
     if (magic == MSG_MIC_ENABLE) handleToggle(callbacks_.onMicEnable);
 }
 
@@ -464,7 +587,7 @@ void WebRTCServer::DrainVideo() {
     std::shared_ptr<rtc::DataChannel> videoChannel;
     { std::lock_guard<std::mutex> lk(channelMutex_); videoChannel = videoDataChannel_; }
     const size_t bufferedBefore = (videoChannel && videoChannel->isOpen()) ? videoChannel->bufferedAmount() : 0;
-    DrainQueuedChannel(videoChannel, videoPacketQueue_, sendMutex_, VID_BUF, videoErr, videoDrainActive_, &overflow, &needsKey);
+    DrainQueuedChannel(videoChannel, videoPacketQueue_, sendMutex_, VID_BUF, videoErr, videoDrainActive_, &overflow, &needsKey, &videoBytes_);
 
     size_t queuedAfter = 0;
     { std::lock_guard<std::mutex> lk(sendMutex_); queuedAfter = videoPacketQueue_.size(); }
@@ -497,6 +620,8 @@ void WebRTCServer::Reset() {
 
     conn = false; fpsRecv = false; gathered = false; hasDesc = false;
     chRdy = 0; overflow = 0; lastPing = 0; audioPktId = 0;
+    streamKeys_ = 0;
+    for (auto& floor : layerDropFloor_) floor = kNoLayerDrop;
     { std::lock_guard<std::mutex> lk(descriptionMutex_); localDescription_.clear(); }
     {
         std::lock_guard<std::mutex> lk(sendMutex_);
@@ -505,8 +630,12 @@ void WebRTCServer::Reset() {
         audioFecCount_ = 0;
         audioFecGroupStart_ = 0;
         for (auto& packet : audioFecPackets_) packet.clear();
+        audioPrev_.clear();
     }
+    audioCaps_ = 0;
+    audioRedundancy_ = false;
     { std::lock_guard<std::mutex> lk(micFecMutex_); micFecGroups_.clear(); micSeenPacketIds_.clear(); }
+    { std::lock_guard<std::mutex> lk(cursorMutex_); sentCursorIds_.clear(); }
 
     std::thread([controlChannel = std::move(controlChannel),
                  videoChannel = std::move(videoChannel),
@@ -611,13 +740,21 @@ bool WebRTCServer::IsCongested() const {
     return queuedPackets > kVideoQueueCongestionThreshold || bufferedBytes >= VID_BUF / 2;
 }
 
+uint64_t WebRTCServer::GetVideoBytesDelivered() const {
+    std::shared_ptr<rtc::DataChannel> videoChannel;
+    { std::lock_guard<std::mutex> lk(const_cast<std::mutex&>(channelMutex_)); videoChannel = videoDataChannel_; }
+    const uint64_t handed = videoBytes_.load(std::memory_order_relaxed);
+    const uint64_t buffered = (videoChannel && videoChannel->isOpen()) ? videoChannel->bufferedAmount() : 0;
+    return handed > buffered ? handed - buffered : 0;
+}
+
 void WebRTCServer::LogStats() {
     const int64_t now = GetTimestamp() / 1000;
     if (now - lastStatLog.load() < 60000) return;
     lastStatLog.store(now);
     if (conn || videoSent > 0) {
-        LOG("WebRTC Stats: v=%llu/%llu a=%llu/%llu ctrl=%llu/%llu in=%llu mic=%llu conn=%llu overflow=%d",
-            videoSent.load(), videoErr.load(), audioSent.load(), audioErr.load(), ctrlSent.load(), ctrlRecv.load(),
+        LOG("WebRTC Stats: v=%llu/%llu repeat=%llu layerDrop=%llu a=%llu/%llu ctrl=%llu/%llu in=%llu mic=%llu conn=%llu overflow=%d",
+            videoSent.load(), videoErr.load(), repeatSent.load(), layerDrops.load(), audioSent.load(), audioErr.load(), ctrlSent.load(), ctrlRecv.load(),
             inputRecv.load(), micRecv.load(), connCount.load(), overflow.load());
     }
 }
@@ -663,52 +800,159 @@ void WebRTCServer::SetRemote(const std::string& sdp, const std::string& type) {
     localPc->setRemoteDescription(rtc::Description(sdp, type)); if (type == "offer") localPc->setLocalDescription();
 }
 
-bool WebRTCServer::SendCursorShape(CursorType ct) {
+bool WebRTCServer::SendCursorImage(const CursorImage& image) {
+    std::vector<uint8_t> buf(16 + image.rgba.size());
+    WritePod<uint32_t>(buf.data(), MSG_CURSOR_IMAGE);
+    WritePod<uint32_t>(buf.data() + 4, image.id);
+    WritePod<uint16_t>(buf.data() + 8, image.width);
+    WritePod<uint16_t>(buf.data() + 10, image.height);
+    WritePod<uint16_t>(buf.data() + 12, image.hotX);
+    WritePod<uint16_t>(buf.data() + 14, image.hotY);
+    memcpy(buf.data() + 16, image.rgba.data(), image.rgba.size());
+    return SendCtrl(buf.data(), buf.size());
+}
+
+bool WebRTCServer::SendCursorShape(CursorType ct, const CursorImage* image) {
     if (!IsStreaming()) return false;
-    uint8_t buf[5];
+    if (image) {
+        bool isNew;
+        { std::lock_guard<std::mutex> lk(cursorMutex_); isNew = sentCursorIds_.insert(image->id).second; }
+        if (isNew && !SendCursorImage(*image)) {
+            { std::lock_guard<std::mutex> lk(cursorMutex_); sentCursorIds_.erase(image->id); }
+            image = nullptr;
+        }
+    }
+    uint8_t buf[9];
     WritePod<uint32_t>(buf, MSG_CURSOR_SHAPE);
     buf[4] = static_cast<uint8_t>(ct);
+    if (!image) return SendCtrl(buf, 5);
+    WritePod<uint32_t>(buf + 5, image->id);
+    return SendCtrl(buf, sizeof(buf));
+}
+
+bool WebRTCServer::SendCursorPos(float nx, float ny, bool visible) {
+    if (!IsStreaming()) return false;
+    std::shared_ptr<rtc::DataChannel> input;
+    { std::lock_guard<std::mutex> lk(channelMutex_); input = inputDataChannel_; }
+    if (!input || !input->isOpen() || input->bufferedAmount() > BUF_LOW) return false;
+    const auto toU16 = [](float v) { return static_cast<uint16_t>(std::clamp(v, 0.0f, 1.0f) * 65535.0f + 0.5f); };
+    uint8_t buf[9];
+    WritePod<uint32_t>(buf, MSG_CURSOR_POS);
+    WritePod<uint16_t>(buf + 4, toU16(nx));
+    WritePod<uint16_t>(buf + 6, toU16(ny));
+    buf[8] = visible ? CURSOR_POS_VISIBLE : 0;
+    try {
+        input->send(reinterpret_cast<const std::byte*>(buf), sizeof(buf));
+        return true;
+    } catch (const std::exception& e) {
+        DBG("WebRTC: SendCursorPos failed: %s", e.what());
+    }
+    return false;
+}
+
+bool WebRTCServer::SendEncodeAdjust(const EncodeAdjustInfo& info) {
+    if (!IsStreaming()) return false;
+    uint8_t buf[18];
+    WritePod<uint32_t>(buf, MSG_ENCODE_ADJUST);
+    buf[4] = info.limits;
+    buf[5] = info.action;
+    buf[6] = info.scalePercent;
+    buf[7] = 0;
+    WritePod<uint16_t>(buf + 8, info.fps);
+    WritePod<uint32_t>(buf + 10, info.p95Us);
+    WritePod<uint32_t>(buf + 14, info.budgetUs);
     return SendCtrl(buf, sizeof(buf));
 }
 
-bool WebRTCServer::Send(const EncodedFrame& frame) {
+bool WebRTCServer::Send(const EncodedFrame& frame, uint8_t stream) {
     if (!IsStreaming()) {
         DBG("WebRTC: Send skipped - not streaming (conn=%d fpsRecv=%d chRdy=%d)", conn.load() ? 1 : 0, fpsRecv.load() ? 1 : 0, chRdy.load());
         return false;
     }
-    if (IsStale()) {
+    if (stream >= MAX_VIDEO_STREAMS) return false;
+    // Extra streams encode on the shared pool, which a reset from here would deadlock.
+    if (stream == 0 && IsStale()) {
         WARN("WebRTC: Connection stale (lastPing=%lld overflow=%d) - resetting", lastPing.load(), overflow.load());
         Reset();
         if (callbacks_.onDisconnect) callbacks_.onDisconnect();
         return false;
     }
 
-    const size_t frameSizeBytes = frame.data.size();
+    if (frame.isRepeat) {
+        PacketHeader header{};
+        header.timestamp = frame.ts;
+        header.sourceTimestamp = frame.sourceTs > 0 ? frame.sourceTs : frame.ts;
+        header.encodeEndTimestamp = frame.encodeEndTs > 0 ? frame.encodeEndTs : frame.ts;
+        header.enqueueTimestamp = GetTimestamp();
+        header.frameId = frmId[stream].load(std::memory_order_acquire) - 1;
+        header.dataChunkSize = static_cast<uint16_t>(DATA_CHUNK);
+        header.frameType = FRAME_REPEAT;
+        header.packetType = PKT_DATA;
+        header.flags = StreamFlags(stream);
+        {
+            std::lock_guard<std::mutex> lk(sendMutex_);
+            videoPacketQueue_.push(BuildPacket(header, nullptr, 0));
+        }
+        DrainVideo();
+        repeatSent++;
+        return true;
+    }
+
+    const size_t frameSizeBytes = frame.size;
     if (!frameSizeBytes || frameSizeBytes > DATA_CHUNK * 65535) {
         ERR("WebRTC: Send invalid frame size: %zu (ts=%lld, key=%d)", frameSizeBytes, frame.ts, frame.isKey ? 1 : 0);
         return false;
     }
 
     const size_t chunkCount = (frameSizeBytes + DATA_CHUNK - 1) / DATA_CHUNK;
-    const uint32_t frameId = frmId++;
+    std::shared_ptr<rtc::DataChannel> videoChannel;
+    { std::lock_guard<std::mutex> lk(channelMutex_); videoChannel = videoDataChannel_; }
+    size_t queuedBefore = 0;
+    size_t layerPacketsDropped = 0;
+    {
+        std::lock_guard<std::mutex> lk(sendMutex_);
+        // Shed enhancement layers before the trim below has to cut into the base layer.
+        if (videoPacketQueue_.size() > kVideoQueueMaxPackets) layerPacketsDropped = DropEnhancementLayerPackets(videoPacketQueue_);
+        queuedBefore = videoPacketQueue_.size();
+    }
+    const size_t bufferedNow = (videoChannel && videoChannel->isOpen()) ? videoChannel->bufferedAmount() : 0;
+
+    // Temporal layers: a frame above the base layer is never referenced by a lower
+    // layer, so under congestion it is discarded here instead of queued. Later frames
+    // of the same or higher layers may reference it and follow it until a lower layer
+    // frame arrives. Dropped frames take no frame id, so the client sees no gap.
+    const int layer = frame.isKey ? 0 : frame.layer;
+    std::atomic<int>& layerDropFloor = layerDropFloor_[stream];
+    int dropFloor = layerPacketsDropped > 0 ? 1 : layerDropFloor.load(std::memory_order_relaxed);
+    if (layerPacketsDropped > 0) {
+        // The queue is shared, so every stream may have lost enhancement frames.
+        for (auto& floor : layerDropFloor_) floor.store(1, std::memory_order_relaxed);
+        WARN("WebRTC: Video queue overflow - dropped %zu enhancement layer packets (%zu remaining)", layerPacketsDropped, queuedBefore);
+    }
+    if (layer < dropFloor) dropFloor = kNoLayerDrop;
+    const bool congested = queuedBefore > kVideoQueueCongestionThreshold || bufferedNow >= VID_BUF / 2;
+    if (layer > 0 && (layer >= dropFloor || congested)) {
+        layerDropFloor.store(std::min(dropFloor, layer), std::memory_order_relaxed);
+        layerDrops++;
+        DBG("WebRTC: Dropped layer %d frame (ts=%lld size=%zu q=%zu buf=%zu)", layer, frame.ts, frameSizeBytes, queuedBefore, bufferedNow);
+        return true;
+    }
+    layerDropFloor.store(dropFloor, std::memory_order_relaxed);
+
+    const uint32_t frameId = frmId[stream]++;
     if (chunkCount > 65535) {
         ERR("WebRTC: Send too many chunks: %zu for frame %u (size=%zu)", chunkCount, frameId, frameSizeBytes);
         return false;
     }
     constexpr uint8_t kPktData = 0;
     constexpr uint8_t kPktFec = 1;
-    std::shared_ptr<rtc::DataChannel> videoChannel;
-    { std::lock_guard<std::mutex> lk(channelMutex_); videoChannel = videoDataChannel_; }
-    size_t queuedBefore = 0;
-    { std::lock_guard<std::mutex> lk(sendMutex_); queuedBefore = videoPacketQueue_.size(); }
-    const size_t bufferedNow = (videoChannel && videoChannel->isOpen()) ? videoChannel->bufferedAmount() : 0;
     const bool heavyFrame = chunkCount >= kLargeFrameChunkThreshold;
     const bool bypassFec = !frame.isKey && (queuedBefore >= kVideoQueueFecBypassThreshold || bufferedNow >= kVideoTransportFecBypassThreshold || heavyFrame);
     const uint8_t fecGroupSize = bypassFec ? static_cast<uint8_t>(0) : (!frame.isKey && chunkCount >= kLargeFrameChunkThreshold / 2) ? kRelaxedVideoFecGroupSize : static_cast<uint8_t>(10);
     const int64_t enqueueTs = GetTimestamp();
 
-    DBG("WebRTC: Send frame=%u ts=%lld sourceTs=%lld encodeEndTs=%lld enqueueTs=%lld key=%d size=%zu chunks=%zu encUs=%lld q=%zu buf=%zu fec=%s gsz=%u heavy=%d",
-        frameId, frame.ts, frame.sourceTs, frame.encodeEndTs, enqueueTs, frame.isKey ? 1 : 0, frameSizeBytes, chunkCount, frame.encUs,
+    DBG("WebRTC: Send stream=%u frame=%u ts=%lld sourceTs=%lld encodeEndTs=%lld enqueueTs=%lld key=%d layer=%d size=%zu chunks=%zu encUs=%lld q=%zu buf=%zu fec=%s gsz=%u heavy=%d",
+        stream, frameId, frame.ts, frame.sourceTs, frame.encodeEndTs, enqueueTs, frame.isKey ? 1 : 0, layer, frameSizeBytes, chunkCount, frame.encUs,
         queuedBefore, bufferedNow, bypassFec ? "off" : "on", static_cast<unsigned>(fecGroupSize), heavyFrame ? 1 : 0);
 
     PacketHeader header = {
@@ -723,10 +967,12 @@ bool WebRTCServer::Send(const EncodedFrame& frame) {
         static_cast<uint16_t>(chunkCount),
         0,
         static_cast<uint16_t>(DATA_CHUNK),
-        frame.isKey ? static_cast<uint8_t>(1) : static_cast<uint8_t>(0),
+        frame.isKey ? FRAME_KEY : FRAME_DELTA,
         kPktData,
-        fecGroupSize
+        fecGroupSize,
+        0
     };
+    const uint8_t layerFlags = LayerFlags(layer) | StreamFlags(stream);
 
     {
         std::lock_guard<std::mutex> lk(sendMutex_);
@@ -740,6 +986,7 @@ bool WebRTCServer::Send(const EncodedFrame& frame) {
                 videoPacketQueue_.pop();
                 droppedPackets++;
             }
+            RequestStreamKeyframes();
             if (!needsKey.exchange(true, std::memory_order_acq_rel)) {
                 WARN("WebRTC: Trimmed video queue (%zu packets dropped, %zu remaining); requesting recovery keyframe", droppedPackets, videoPacketQueue_.size());
             }
@@ -757,15 +1004,17 @@ bool WebRTCServer::Send(const EncodedFrame& frame) {
                 const size_t chunkLength = std::min(DATA_CHUNK, frameSizeBytes - chunkOffset);
                 header.chunkBytes = static_cast<uint16_t>(chunkLength);
                 header.packetType = kPktData;
-                videoPacketQueue_.push(BuildPacket(header, frame.data.data() + chunkOffset, chunkLength));
+                header.flags = layerFlags;
+                videoPacketQueue_.push(BuildPacket(header, frame, chunkOffset, chunkLength));
                 parityLen = std::max(parityLen, chunkLength);
-                const uint8_t* source = frame.data.data() + chunkOffset;
+                const uint8_t* source = videoPacketQueue_.back().data() + HDR_SZ;
                 for (size_t j = 0; j < chunkLength; j++) parity[j] ^= source[j];
             }
             if (!bypassFec && endChunkIndex - startChunkIndex == packetGroupSize && parityLen > 0) {
                 header.chunkIndex = static_cast<uint16_t>(groupIndex);
                 header.chunkBytes = static_cast<uint16_t>(parityLen);
                 header.packetType = kPktFec;
+                header.flags = layerFlags;
                 videoPacketQueue_.push(BuildPacket(header, parity.data(), parityLen));
             }
         }
@@ -794,6 +1043,10 @@ bool WebRTCServer::SendAudio(const std::vector<uint8_t>& data, int64_t ts, int s
     outgoing.reserve(2);
     {
         std::lock_guard<std::mutex> lk(sendMutex_);
+        const uint8_t caps = audioCaps_.load(std::memory_order_acquire);
+        const bool redundant = (caps & AUDIO_CAP_REDUNDANCY) && audioRedundancy_.load(std::memory_order_acquire) && !audioPrev_.empty();
+        const size_t extraBytes = redundant ? sizeof(int64_t) + sizeof(uint16_t) + audioPrev_.size() : 0;
+
         AudioPacketHeader dataHeader{};
         dataHeader.magic = MSG_AUDIO_DATA;
         dataHeader.timestamp = ts;
@@ -802,11 +1055,29 @@ bool WebRTCServer::SendAudio(const std::vector<uint8_t>& data, int64_t ts, int s
         dataHeader.dataLength = static_cast<uint16_t>(data.size());
         dataHeader.packetType = PKT_DATA;
         dataHeader.fecGroupSize = AUDIO_FEC_GROUP_SIZE;
-        dataHeader.reserved = 0;
+        dataHeader.extraLength = static_cast<uint16_t>(extraBytes);
         outgoing.push_back(BuildPacket(dataHeader, data.data(), data.size()));
+        if (redundant) {
+            auto& packet = outgoing.back();
+            const size_t offset = packet.size();
+            packet.resize(offset + extraBytes);
+            WritePod<int64_t>(packet.data() + offset, audioPrevTs_);
+            WritePod<uint16_t>(packet.data() + offset + sizeof(int64_t), audioPrevSamples_);
+            memcpy(packet.data() + offset + sizeof(int64_t) + sizeof(uint16_t), audioPrev_.data(), audioPrev_.size());
+        }
+        audioPrev_ = data;
+        audioPrevTs_ = ts;
+        audioPrevSamples_ = static_cast<uint16_t>(samples);
+
+        // Clients that handle redundancy get it instead of the parity groups, which
+        // recover one loss per ten packets and only once the group is complete.
         static_assert(AUDIO_FEC_GROUP_SIZE > 0, "AUDIO_FEC_GROUP_SIZE must be > 0");
-        if (audioFecCount_ == 0) audioFecGroupStart_ = dataHeader.packetId;
-        audioFecPackets_[audioFecCount_++] = outgoing.back();
+        if (caps & AUDIO_CAP_REDUNDANCY) {
+            audioFecCount_ = 0;
+        } else {
+            if (audioFecCount_ == 0) audioFecGroupStart_ = dataHeader.packetId;
+            audioFecPackets_[audioFecCount_++] = outgoing.back();
+        }
         if (audioFecCount_ == AUDIO_FEC_GROUP_SIZE) {
             size_t parityLen = 0;
             for (const auto& packet : audioFecPackets_) parityLen = std::max(parityLen, packet.size());
@@ -824,7 +1095,7 @@ bool WebRTCServer::SendAudio(const std::vector<uint8_t>& data, int64_t ts, int s
                 fecHeader.dataLength = static_cast<uint16_t>(parity.size());
                 fecHeader.packetType = PKT_FEC;
                 fecHeader.fecGroupSize = AUDIO_FEC_GROUP_SIZE;
-                fecHeader.reserved = 0;
+                fecHeader.extraLength = 0;
                 outgoing.push_back(BuildPacket(fecHeader, parity.data(), parity.size()));
             }
             for (auto& packet : audioFecPackets_) packet.clear();
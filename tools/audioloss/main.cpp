@@ -0,0 +1,341 @@
+// slipstream_audioloss: loss simulation of the audio transport. Runs 10 ms Opus
+// packets through a Gilbert-Elliott loss model under the legacy XOR parity groups
+// and under the adaptive path (AudioLossController driving bitrate, redundancy and
+// DTX from one-second loss reports), and reports wire bandwidth, residual loss at
+// the playout deadline and recovery latency. --check fails on regressions.
+
+#include "host/core/logging.hpp"
+#include "host/core/protocol.hpp"
+#include "host/media/audio_protection.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using json = nlohmann::json;
+
+namespace {
+    constexpr int64_t kFrameUs = 10'000;
+    constexpr int kFramesPerReport = 100;
+    constexpr int kXorGroup = 10;
+    constexpr size_t kHeaderBytes = sizeof(AudioPacketHeader);
+    constexpr size_t kRedundantHeaderBytes = sizeof(int64_t) + sizeof(uint16_t);
+    // UDP/IP, DTLS and SCTP DATA chunk framing per message, roughly.
+    constexpr size_t kWireOverheadBytes = 60;
+    // An Opus frame of digital silence without DTX, and a DTX frame.
+    constexpr size_t kSilentFrameBytes = 3;
+    constexpr size_t kDtxFrameBytes = 1;
+
+    struct Rng {
+        uint64_t state;
+        explicit Rng(uint64_t seed) : state(seed) {}
+        uint64_t Next() {
+            uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            return z ^ (z >> 31);
+        }
+        double Unit() { return static_cast<double>(Next() >> 11) / static_cast<double>(1ull << 53); }
+    };
+
+    struct Scenario {
+        const char* name;
+        const char* description;
+        double lossPercent;    // long-run share of packets lost
+        double meanBurst;      // mean length of a loss burst in packets (1 = independent)
+        double silenceShare;   // share of time without sound
+        // --check limit: residual loss of the adaptive path over that of the XOR groups.
+        double maxResidualRatio = 1.0;
+    };
+
+    const Scenario kScenarios[] = {
+        {"clean", "No loss, continuous sound", 0.0, 1.0, 0.0},
+        {"random-1", "1% independent loss", 1.0, 1.0, 0.0},
+        {"random-5", "5% independent loss", 5.0, 1.0, 0.0},
+        {"burst-3", "3% loss in bursts of 3 packets", 3.0, 3.0, 0.0},
+        {"heavy-15", "15% loss in bursts of 2 packets", 15.0, 2.0, 0.0},
+        {"speech-1", "1% loss, silent 60% of the time", 1.0, 1.0, 0.6},
+    };
+
+    struct Args {
+        std::vector<std::string> only;
+        double seconds = 120.0;
+        int deadlineMs = 60;
+        uint64_t seed = 1;
+        bool check = false;
+        std::string output;
+    };
+
+    // Gilbert-Elliott with a lossless good state and an always-lossy bad state.
+    struct LossModel {
+        double enterBad = 0.0, leaveBad = 1.0;
+        bool bad = false;
+        LossModel(double lossPercent, double meanBurst) {
+            const double p = std::clamp(lossPercent / 100.0, 0.0, 0.9);
+            leaveBad = 1.0 / std::max(1.0, meanBurst);
+            enterBad = p > 0.0 ? p * leaveBad / (1.0 - p) : 0.0;
+        }
+        bool Lost(Rng& rng) {
+            bad = bad ? rng.Unit() >= leaveBad : rng.Unit() < enterBad;
+            return bad;
+        }
+    };
+
+    // Sound and silence segments of about two seconds each.
+    std::vector<bool> GenerateSilence(const Scenario& sc, size_t frames, Rng& rng) {
+        std::vector<bool> silent(frames, false);
+        if (sc.silenceShare <= 0.0) return silent;
+        constexpr double kMeanSegment = 200.0;
+        bool inSilence = false;
+        for (size_t i = 0; i < frames; ++i) {
+            const double mean = inSilence ? kMeanSegment * sc.silenceShare / (1.0 - sc.silenceShare) * 2.0 : kMeanSegment;
+            if (rng.Unit() < 1.0 / mean) inSilence = !inSilence;
+            silent[i] = inSilence;
+        }
+        return silent;
+    }
+
+    double Percentile(std::vector<double> values, double p) {
+        if (values.empty()) return 0.0;
+        std::sort(values.begin(), values.end());
+        const size_t index = std::min(values.size() - 1, static_cast<size_t>(p * (values.size() - 1) + 0.5));
+        return values[index];
+    }
+
+    struct Packet {
+        size_t frame = 0;
+        size_t bytes = 0;
+        bool parity = false;
+        // Frame carried as a redundant copy, if any.
+        size_t redundantFrame = 0;
+        bool hasRedundant = false;
+    };
+
+    // adaptive = false: the legacy stream at the base bitrate with XOR parity groups.
+    json Simulate(const Scenario& sc, const Args& args, const std::vector<bool>& silent, bool adaptive) {
+        const size_t frames = silent.size();
+        AudioLossController controller;
+        const AudioProtection base = controller.Current();
+        const uint8_t caps = adaptive ? (AUDIO_CAP_REDUNDANCY | AUDIO_CAP_DTX) : 0;
+        Rng lossRng(args.seed * 7919 + 1);
+        LossModel loss(sc.lossPercent, sc.meanBurst);
+
+        // Arrival time of each frame at the client, or -1 if it never arrives.
+        std::vector<int64_t> available(frames, -1);
+        std::vector<bool> sent(frames, false), primaryLost(frames, false);
+        uint64_t wireBytes = 0, packetsSent = 0, packetsLost = 0, redundantPackets = 0;
+        std::vector<size_t> group;
+        std::vector<bool> groupLost;
+
+        AudioProtection protection = adaptive ? controller.Current() : base;
+        uint64_t windowSent = 0, windowLost = 0;
+        bool inDtx = false, prevSent = false;
+        size_t prevFrame = 0, prevBytes = 0;
+        double bitrateSum = 0.0;
+        uint64_t redundancyReports = 0, reports = 0;
+
+        for (size_t i = 0; i < frames; ++i) {
+            const int64_t sendUs = static_cast<int64_t>(i) * kFrameUs;
+            bitrateSum += protection.bitrate;
+
+            size_t bytes = silent[i] ? kSilentFrameBytes : static_cast<size_t>(protection.bitrate / 8 / 100);
+            bool suppressed = false;
+            if (silent[i] && protection.dtx) {
+                // After the first DTX frame nothing is sent; the client plays silence.
+                suppressed = inDtx;
+                inDtx = true;
+                bytes = kDtxFrameBytes;
+            } else {
+                inDtx = false;
+            }
+
+            if (suppressed) {
+                available[i] = sendUs;
+                prevSent = false;
+            } else {
+                Packet packet{i, kHeaderBytes + bytes};
+                if (protection.redundancy && prevSent) {
+                    packet.bytes += kRedundantHeaderBytes + prevBytes;
+                    packet.redundantFrame = prevFrame;
+                    packet.hasRedundant = true;
+                    redundantPackets++;
+                }
+                sent[i] = true;
+                prevSent = true;
+                prevFrame = i;
+                prevBytes = bytes;
+
+                const bool lost = loss.Lost(lossRng);
+                wireBytes += packet.bytes + kWireOverheadBytes;
+                packetsSent++;
+                windowSent++;
+                if (lost) {
+                    packetsLost++;
+                    windowLost++;
+                    primaryLost[i] = true;
+                } else {
+                    if (available[i] < 0) available[i] = sendUs;
+                    if (packet.hasRedundant && available[packet.redundantFrame] < 0) available[packet.redundantFrame] = sendUs;
+                }
+
+                if (!adaptive) {
+                    group.push_back(i);
+                    groupLost.push_back(lost);
+                    if (group.size() == kXorGroup) {
+                        // Parity follows the tenth packet and restores a single missing one.
+                        const bool parityLost = loss.Lost(lossRng);
+                        size_t parityBytes = 0;
+                        for (size_t f : group) parityBytes = std::max(parityBytes, silent[f] ? kSilentFrameBytes : static_cast<size_t>(protection.bitrate / 8 / 100));
+                        wireBytes += kHeaderBytes * 2 + parityBytes + kWireOverheadBytes;
+                        packetsSent++;
+                        const auto missing = std::count(groupLost.begin(), groupLost.end(), true);
+                        if (!parityLost && missing == 1) {
+                            for (size_t g = 0; g < group.size(); ++g) {
+                                if (groupLost[g]) available[group[g]] = sendUs;
+                            }
+                        }
+                        group.clear();
+                        groupLost.clear();
+                    }
+                }
+            }
+
+            if (adaptive && (i + 1) % kFramesPerReport == 0) {
+                const int lossPercent = windowSent > 0 ? static_cast<int>((windowLost * 100 + windowSent / 2) / windowSent) : 0;
+                controller.Report(caps, lossPercent);
+                protection = controller.Current();
+                reports++;
+                if (protection.redundancy) redundancyReports++;
+                windowSent = windowLost = 0;
+            }
+        }
+
+        // A frame counts once it arrives before its playout deadline.
+        const int64_t deadlineUs = static_cast<int64_t>(args.deadlineMs) * 1000;
+        uint64_t residual = 0, recovered = 0, late = 0;
+        std::vector<double> recoveryMs;
+        for (size_t i = 0; i < frames; ++i) {
+            const int64_t dueUs = static_cast<int64_t>(i) * kFrameUs;
+            if (available[i] < 0) { residual++; continue; }
+            if (!primaryLost[i]) continue;
+            const int64_t delayUs = available[i] - dueUs;
+            if (delayUs > deadlineUs) { late++; residual++; continue; }
+            recovered++;
+            recoveryMs.push_back(static_cast<double>(delayUs) / 1000.0);
+        }
+
+        const double seconds = static_cast<double>(frames) * kFrameUs / 1e6;
+        return {
+            {"kbps", static_cast<double>(wireBytes) * 8.0 / seconds / 1000.0},
+            {"packetsPerSecond", static_cast<double>(packetsSent) / seconds},
+            {"meanBitrate", bitrateSum / static_cast<double>(frames)},
+            {"rawLossPercent", packetsSent > 0 ? static_cast<double>(packetsLost) * 100.0 / static_cast<double>(packetsSent) : 0.0},
+            {"residualLossPercent", static_cast<double>(residual) * 100.0 / static_cast<double>(frames)},
+            {"recovered", recovered},
+            {"recoveredLate", late},
+            {"recoveryMs", {{"p50", Percentile(recoveryMs, 0.5)}, {"p95", Percentile(recoveryMs, 0.95)}}},
+            {"redundantPackets", redundantPackets},
+            {"redundancyShare", reports > 0 ? static_cast<double>(redundancyReports) / static_cast<double>(reports) : 0.0}
+        };
+    }
+
+    void PrintUsage() {
+        fprintf(stderr,
+            "Usage: slipstream_audioloss [options]\n"
+            "  --scenario LIST      scenarios to run (default: all)\n"
+            "  --list               print the scenarios and exit\n"
+            "  --seconds N          simulated seconds per scenario (default: 120)\n"
+            "  --deadline-ms N      playout deadline after the packet's send time (default: 60)\n"
+            "  --seed N             loss and silence seed (default: 1)\n"
+            "  --check              exit non-zero if a scenario misses its limits\n"
+            "  --output FILE        write JSON here instead of stdout\n");
+    }
+
+    bool ParseArgs(int argc, char* argv[], Args& args) {
+        for (int i = 1; i < argc; ++i) {
+            const std::string arg = argv[i];
+            if (arg == "--help" || arg == "-h") return false;
+            if (arg == "--check") { args.check = true; continue; }
+            if (arg == "--list") {
+                for (const auto& sc : kScenarios) printf("%-12s %s\n", sc.name, sc.description);
+                exit(0);
+            }
+            if (i + 1 >= argc) {
+                ERR("Missing value for %s", arg.c_str());
+                return false;
+            }
+            const std::string value = argv[++i];
+            if (arg == "--scenario") {
+                std::stringstream ss(value);
+                for (std::string item; std::getline(ss, item, ',');) args.only.push_back(item);
+            } else if (arg == "--seconds") {
+                args.seconds = std::clamp(atof(value.c_str()), 10.0, 3600.0);
+            } else if (arg == "--deadline-ms") {
+                args.deadlineMs = std::clamp(atoi(value.c_str()), 10, 1000);
+            } else if (arg == "--seed") {
+                args.seed = std::strtoull(value.c_str(), nullptr, 10);
+            } else if (arg == "--output") {
+                args.output = value;
+            } else {
+                ERR("Unknown option %s", arg.c_str());
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    Args args;
+    if (!ParseArgs(argc, argv, args)) {
+        PrintUsage();
+        return 2;
+    }
+
+    json report = {{"seconds", args.seconds}, {"deadlineMs", args.deadlineMs}, {"seed", args.seed}};
+    bool passed = true;
+    for (const auto& sc : kScenarios) {
+        if (!args.only.empty() && std::find(args.only.begin(), args.only.end(), sc.name) == args.only.end()) continue;
+        Rng rng(args.seed);
+        const auto silent = GenerateSilence(sc, static_cast<size_t>(args.seconds * 1e6 / kFrameUs), rng);
+        json run = {{"scenario", sc.name}, {"description", sc.description},
+                    {"xor", Simulate(sc, args, silent, false)},
+                    {"adaptive", Simulate(sc, args, silent, true)}};
+        if (args.check) {
+            const double xorResidual = run["xor"]["residualLossPercent"].get<double>();
+            const double adaptiveResidual = run["adaptive"]["residualLossPercent"].get<double>();
+            const double xorKbps = run["xor"]["kbps"].get<double>();
+            const double adaptiveKbps = run["adaptive"]["kbps"].get<double>();
+            // Without loss the adaptive path must not cost more than the parity groups.
+            const bool ok = adaptiveResidual <= xorResidual * sc.maxResidualRatio + 0.05 &&
+                (sc.lossPercent > 0.0 || adaptiveKbps <= xorKbps);
+            run["passed"] = ok;
+            if (!ok) {
+                ERR("AudioLoss: %s missed its limits (residual %.2f%% vs %.2f%%, %.1f vs %.1f kbps)", sc.name,
+                    adaptiveResidual, xorResidual, adaptiveKbps, xorKbps);
+                passed = false;
+            }
+        }
+        report["runs"].push_back(run);
+    }
+
+    const std::string text = report.dump(2);
+    if (args.output.empty()) {
+        std::cout << text << std::endl;
+    } else {
+        std::ofstream file(args.output);
+        if (!file) {
+            ERR("AudioLoss: Cannot write %s", args.output.c_str());
+            return 1;
+        }
+        file << text << '\n';
+    }
+    return passed ? 0 : 1;
+}
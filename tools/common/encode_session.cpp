@@ -0,0 +1,110 @@
+#include "encode_session.hpp"
+
+#include "host/core/logging.hpp"
+#include "host/media/color_convert.hpp"
+
+extern "C" {
+#include <libswscale/swscale.h>
+}
+
+EncodeSession::~EncodeSession() {
+    sws_freeContext(sws);
+    av_frame_free(&frame);
+    av_packet_free(&pkt);
+    if (cctx) avcodec_free_context(&cctx);
+}
+
+bool EncodeSession::Open(CodecType codec, const std::string& encoder, int width, int height, int fps,
+                         const SoftwareEncoderOptions& opts, int64_t bitrate, EncodeFormat format) {
+    const AVCodec* enc = nullptr;
+    if (encoder.empty()) {
+        enc = FindSoftwareEncoder(codec, encoderName, format);
+    } else if ((enc = avcodec_find_encoder_by_name(encoder.c_str()))) {
+        encoderName = encoder;
+    }
+    if (!enc) {
+        ERR("EncodeSession: Encoder %s not available", encoder.empty() ? "(default)" : encoder.c_str());
+        return false;
+    }
+
+    const AVPixelFormat pixFmt = SelectSoftwarePixelFormat(enc, format);
+    if (pixFmt == AV_PIX_FMT_NONE) {
+        ERR("EncodeSession: No %s pixel format for %s", EncodeFormatName(format), encoderName.c_str());
+        return false;
+    }
+
+    w = width;
+    h = height;
+    cctx = avcodec_alloc_context3(enc);
+    frame = av_frame_alloc();
+    pkt = av_packet_alloc();
+    if (!cctx || !frame || !pkt) {
+        ERR("EncodeSession: Allocation failed for %s", encoderName.c_str());
+        return false;
+    }
+
+    ApplyRealtimeEncoderDefaults(cctx, codec, w, h, fps);
+    if (bitrate > 0) {
+        cctx->bit_rate = bitrate;
+        cctx->rc_max_rate = CalcMaxRate(bitrate);
+        cctx->rc_buffer_size = CalcBufferSize(bitrate);
+    }
+    cctx->pix_fmt = pixFmt;
+    plan = ConfigureSoftwareEncoder(cctx, encoderName, opts);
+
+    const int ret = avcodec_open2(cctx, enc, nullptr);
+    if (ret < 0) {
+        ERR("EncodeSession: avcodec_open2 failed for %s: %s", encoderName.c_str(), AvErr(ret));
+        return false;
+    }
+
+    frame->format = pixFmt;
+    frame->width = w;
+    frame->height = h;
+    if (av_frame_get_buffer(frame, 32) < 0) {
+        ERR("EncodeSession: av_frame_get_buffer failed");
+        return false;
+    }
+
+    if (HasDirectBgraConversion(pixFmt)) return true;
+    sws = sws_getCachedContext(nullptr, w, h, AV_PIX_FMT_BGRA, w, h, pixFmt, SWS_BILINEAR, nullptr, nullptr, nullptr);
+    if (!sws) {
+        ERR("EncodeSession: sws_getCachedContext failed");
+        return false;
+    }
+    return true;
+}
+
+bool EncodeSession::Encode(const uint8_t* bgra, size_t stride, bool forceKey, EncodedFrame& out, bool& gotKey) {
+    if (av_frame_make_writable(frame) < 0) return false;
+
+    if (!sws) {
+        if (!ConvertBgraToFrame(bgra, stride, frame)) return false;
+    } else {
+        const uint8_t* srcData[4] = {bgra, nullptr, nullptr, nullptr};
+        const int srcLinesize[4] = {static_cast<int>(stride), 0, 0, 0};
+        if (sws_scale(sws, srcData, srcLinesize, 0, h, frame->data, frame->linesize) != h) return false;
+    }
+
+    if (!SetFrameRegionsOfInterest(frame, regions)) return false;
+    frame->pts = nextPts++;
+    frame->pict_type = forceKey ? AV_PICTURE_TYPE_I : AV_PICTURE_TYPE_NONE;
+    frame->flags = forceKey ? (frame->flags | AV_FRAME_FLAG_KEY) : (frame->flags & ~AV_FRAME_FLAG_KEY);
+
+    int ret = avcodec_send_frame(cctx, frame);
+    if (ret == AVERROR(EAGAIN)) {
+        DrainEncoderPackets(cctx, pkt, out, gotKey);
+        ret = avcodec_send_frame(cctx, frame);
+    }
+    if (ret < 0) {
+        ERR("EncodeSession: avcodec_send_frame failed: %s", AvErr(ret));
+        return false;
+    }
+    DrainEncoderPackets(cctx, pkt, out, gotKey);
+    return true;
+}
+
+void EncodeSession::Flush(EncodedFrame& out, bool& gotKey) {
+    if (avcodec_send_frame(cctx, nullptr) < 0) return;
+    DrainEncoderPackets(cctx, pkt, out, gotKey);
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "host/media/encoded_frame.hpp"
+#include "host/media/encoder_settings.hpp"
+
+#include <string>
+#include <vector>
+
+struct SwsContext;
+
+// The host's software encode path without the D3D11 staging copy: BGRA in,
+// converted to the encoder's pixel format (direct or sws_scale), send, drain.
+class EncodeSession {
+    AVCodecContext* cctx = nullptr;
+    AVFrame* frame = nullptr;
+    AVPacket* pkt = nullptr;
+    SwsContext* sws = nullptr;
+    std::string encoderName;
+    SoftwareThreadingPlan plan;
+    int w = 0, h = 0;
+    int64_t nextPts = 0;
+    std::vector<AVRegionOfInterest> regions;
+
+public:
+    EncodeSession() = default;
+    EncodeSession(const EncodeSession&) = delete;
+    EncodeSession& operator=(const EncodeSession&) = delete;
+    ~EncodeSession();
+
+    // An empty encoder name picks the host's preferred software encoder for codec.
+    // A non-zero bitrate replaces CalcBitrate (max rate and VBV follow it).
+    bool Open(CodecType codec, const std::string& encoder, int width, int height, int fps,
+              const SoftwareEncoderOptions& opts, int64_t bitrate = 0, EncodeFormat format = FORMAT_YUV420);
+    // Appends whatever packets the encoder returns for this input to out.
+    bool Encode(const uint8_t* bgra, size_t stride, bool forceKey, EncodedFrame& out, bool& gotKey);
+    // Attached to every following frame as ROI side data; empty stops attaching it.
+    void SetRegionsOfInterest(std::vector<AVRegionOfInterest> rois) { regions = std::move(rois); }
+    // Signals end of stream and drains the remaining packets.
+    void Flush(EncodedFrame& out, bool& gotKey);
+
+    [[nodiscard]] const std::string& EncoderName() const { return encoderName; }
+    [[nodiscard]] const SoftwareThreadingPlan& ThreadingPlan() const { return plan; }
+    [[nodiscard]] AVPixelFormat PixelFormat() const { return cctx ? cctx->pix_fmt : AV_PIX_FMT_NONE; }
+    [[nodiscard]] const AVCodecContext* Context() const { return cctx; }
+};
@@ -0,0 +1,18 @@
+#include "host/core/logging.hpp"
+
+#include <cstdarg>
+#include <cstdio>
+
+// Offline tools keep stdout for their report, so every log level goes to stderr.
+void InitLogging() {}
+void ShutdownLogging() {}
+
+void LogPrint(const char* level, bool toStderr, const char* fmt, ...) {
+    (void)toStderr;
+    char message[4096];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(message, sizeof(message), fmt, args);
+    va_end(args);
+    fprintf(stderr, "[%s] %s\n", level, message);
+}
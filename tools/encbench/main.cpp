@@ -0,0 +1,408 @@
+// slipstream_encbench: runs the host's software encode path offline and reports
+// throughput, latency, rate accuracy and CPU use as JSON.
+
+#include "../common/encode_session.hpp"
+#include "../common/process_stats.hpp"
+
+#include "host/core/logging.hpp"
+#include "host/media/bitstream.hpp"
+#include "host/media/capture_source.hpp"
+#include "host/media/frame_analysis.hpp"
+
+#include <nlohmann/json.hpp>
+
+extern "C" {
+#include <libavutil/log.h>
+#include <libavutil/pixdesc.h>
+}
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <thread>
+
+using json = nlohmann::json;
+
+namespace {
+    struct BenchArgs {
+        std::vector<CodecType> codecs{CODEC_H264, CODEC_H265, CODEC_AV1};
+        std::vector<std::string> encoders, presets{""};
+        std::vector<int> coreBudgets{0};
+        std::vector<EncodeFormat> formats{FORMAT_YUV420};
+        std::string input, synthetic = "scroll", output;
+        int width = 1920, height = 1080, fps = 60, frames = 300, keyInterval = 120, slices = 0, temporalLayers = 1;
+        ContentProfile profile = ContentProfile::Default;
+        bool staticDetection = true;
+        bool pin = false;
+        bool qualityRateControl = false;
+    };
+
+    std::vector<std::string> SplitList(const std::string& value) {
+        std::vector<std::string> items;
+        std::stringstream ss(value);
+        for (std::string item; std::getline(ss, item, ',');) items.push_back(item);
+        return items;
+    }
+
+    bool ParseCodec(const std::string& name, CodecType& codec) {
+        if (name == "h264" || name == "avc") codec = CODEC_H264;
+        else if (name == "h265" || name == "hevc") codec = CODEC_H265;
+        else if (name == "av1") codec = CODEC_AV1;
+        else return false;
+        return true;
+    }
+
+    bool ParseFormat(const std::string& name, EncodeFormat& format) {
+        if (name == "420") format = FORMAT_YUV420;
+        else if (name == "444") format = FORMAT_YUV444;
+        else if (name == "420p10" || name == "10bit") format = FORMAT_YUV420_10;
+        else return false;
+        return true;
+    }
+
+    const char* FormatKey(EncodeFormat format) {
+        return format == FORMAT_YUV444 ? "444" : format == FORMAT_YUV420_10 ? "420p10" : "420";
+    }
+
+    const char* CodecKey(CodecType codec) {
+        return codec == CODEC_AV1 ? "av1" : codec == CODEC_H265 ? "h265" : "h264";
+    }
+
+    void PrintUsage() {
+        fprintf(stderr,
+            "Usage: slipstream_encbench [options]\n"
+            "  --codec LIST         h264,h265,av1 (default: all)\n"
+            "  --encoder LIST       software encoders to run (default: every one available per codec)\n"
+            "  --preset LIST        x264/x265 preset, SVT-AV1 preset, libaom cpu-used or rav1e speed\n"
+            "  --input FILE         .y4m file or raw BGRA frames (raw needs --size)\n"
+            "  --synthetic NAME     static, scroll, gradient or noise (default: scroll)\n"
+            "  --size WxH           frame size (default: 1920x1080)\n"
+            "  --fps N              target frame rate for CalcBitrate (default: input rate or 60)\n"
+            "  --frames N           frames per run (default: 300)\n"
+            "  --keyint N           force a keyframe every N frames, 0 = first only (default: 120)\n"
+            "  --slices N           slices/tiles per frame (default: 0)\n"
+            "  --profile NAME       default or screen\n"
+            "  --format LIST        420, 444 or 420p10 (default: 420)\n"
+            "  --core-budget LIST   logical cores per encoder, 0 = host default (default: 0)\n"
+            "  --pin                pin SVT-AV1 threads to the budgeted cores\n"
+            "  --temporal-layers N  request an L1TN structure (1-3); fails a run that only delivers layer 0\n"
+            "  --rate-control MODE  abr (CalcBitrate) or quality (capped CRF, as SLIPSTREAM_RATE_CONTROL=1)\n"
+            "  --no-static-skip     encode unchanged frames instead of skipping them\n"
+            "  --output FILE        write JSON here instead of stdout\n"
+            "  --debug              verbose encoder logging\n");
+    }
+
+    bool ParseArgs(int argc, char* argv[], BenchArgs& args) {
+        bool fpsSet = false;
+        for (int i = 1; i < argc; ++i) {
+            const std::string arg = argv[i];
+            auto next = [&](std::string& value) {
+                if (i + 1 >= argc) return false;
+                value = argv[++i];
+                return true;
+            };
+            std::string value;
+            if (arg == "--debug") {
+                g_debugLogging = true;
+            } else if (arg == "--no-static-skip") {
+                args.staticDetection = false;
+            } else if (arg == "--pin") {
+                args.pin = true;
+            } else if (arg == "--help" || arg == "-h") {
+                return false;
+            } else if (!next(value)) {
+                ERR("Missing value for %s", arg.c_str());
+                return false;
+            } else if (arg == "--codec") {
+                args.codecs.clear();
+                for (const auto& name : SplitList(value)) {
+                    CodecType codec;
+                    if (!ParseCodec(name, codec)) { ERR("Unknown codec '%s'", name.c_str()); return false; }
+                    args.codecs.push_back(codec);
+                }
+            } else if (arg == "--encoder") {
+                args.encoders = SplitList(value);
+            } else if (arg == "--preset") {
+                args.presets = SplitList(value);
+            } else if (arg == "--input") {
+                args.input = value;
+            } else if (arg == "--synthetic") {
+                args.synthetic = value;
+            } else if (arg == "--size") {
+                if (sscanf(value.c_str(), "%dx%d", &args.width, &args.height) != 2) return false;
+            } else if (arg == "--fps") {
+                args.fps = std::clamp(atoi(value.c_str()), 1, 240);
+                fpsSet = true;
+            } else if (arg == "--frames") {
+                args.frames = std::max(1, atoi(value.c_str()));
+            } else if (arg == "--keyint") {
+                args.keyInterval = std::max(0, atoi(value.c_str()));
+            } else if (arg == "--slices") {
+                args.slices = std::clamp(atoi(value.c_str()), 0, 16);
+            } else if (arg == "--temporal-layers") {
+                args.temporalLayers = std::clamp(atoi(value.c_str()), 1, 3);
+            } else if (arg == "--rate-control") {
+                if (value != "abr" && value != "quality") return false;
+                args.qualityRateControl = value == "quality";
+            } else if (arg == "--format") {
+                args.formats.clear();
+                for (const auto& name : SplitList(value)) {
+                    EncodeFormat format;
+                    if (!ParseFormat(name, format)) { ERR("Unknown format '%s'", name.c_str()); return false; }
+                    args.formats.push_back(format);
+                }
+                if (args.formats.empty()) args.formats.push_back(FORMAT_YUV420);
+            } else if (arg == "--core-budget") {
+                args.coreBudgets.clear();
+                for (const auto& item : SplitList(value)) args.coreBudgets.push_back(std::clamp(atoi(item.c_str()), 0, 256));
+                if (args.coreBudgets.empty()) args.coreBudgets.push_back(0);
+            } else if (arg == "--profile") {
+                args.profile = value == "screen" ? ContentProfile::Screen : ContentProfile::Default;
+            } else if (arg == "--output") {
+                args.output = value;
+            } else {
+                ERR("Unknown option %s", arg.c_str());
+                return false;
+            }
+        }
+        if (!fpsSet) args.fps = 0;
+        return true;
+    }
+
+    std::unique_ptr<CaptureSource> OpenSource(const BenchArgs& args) {
+        if (args.input.empty()) return CreateSyntheticSource(args.synthetic, args.width, args.height);
+        const std::string& path = args.input;
+        if (path.size() > 4 && path.compare(path.size() - 4, 4, ".y4m") == 0) return OpenY4MSource(path);
+        return OpenRawBGRASource(path, args.width, args.height);
+    }
+
+    double Percentile(std::vector<double> values, double p) {
+        if (values.empty()) return 0.0;
+        std::sort(values.begin(), values.end());
+        const size_t index = std::min(values.size() - 1, static_cast<size_t>(p * (values.size() - 1) + 0.5));
+        return values[index];
+    }
+
+    json RunBenchmark(const BenchArgs& args, CodecType codec, const std::string& encoder, const std::string& preset,
+                      int coreBudget, EncodeFormat format, CaptureSource& source, int fps) {
+        json result = {{"codec", CodecKey(codec)}, {"encoder", encoder}, {"preset", preset.empty() ? "default" : preset},
+                       {"coreBudget", ResolveCoreBudget(coreBudget)}, {"format", FormatKey(format)}};
+
+        SoftwareEncoderOptions opts;
+        opts.profile = args.profile;
+        opts.slices = args.slices;
+        opts.preset = preset;
+        opts.coreBudget = coreBudget;
+        opts.pin = args.pin;
+        opts.temporalLayers = args.temporalLayers;
+        if (args.qualityRateControl) opts.crf = CalcQualityValue(codec, source.Width(), source.Height(), fps);
+        result["rateControl"] = opts.crf > 0 && SupportsCappedCrf(encoder) ? "capped-crf" : "abr";
+        EncodeSession session;
+        if (!session.Open(codec, encoder, source.Width(), source.Height(), fps, opts, 0, format)) {
+            result["error"] = "encoder open failed";
+            return result;
+        }
+
+        const int w = source.Width(), h = source.Height();
+        const size_t stride = static_cast<size_t>(w) * 4;
+        TileChangeDetector detector;
+        EncodedFrame out;
+        std::vector<uint8_t> bgra;
+        std::vector<double> latencyMs;
+        std::vector<size_t> keySizes;
+        latencyMs.reserve(static_cast<size_t>(args.frames));
+        size_t totalBytes = 0;
+        int sourceFrames = 0, staticFrames = 0, failedFrames = 0, emptyFrames = 0;
+        // Layer ids as the bitstream signals them (-1 = none) and as the host
+        // delivers them, falling back to the configured pattern.
+        const bool layered = SupportsTemporalLayers(encoder);
+        TemporalLayerTracker layerTracker;
+        layerTracker.Reset(layered ? args.temporalLayers : 1);
+        std::map<int, int> signalledLayers, deliveredLayers;
+
+        const double cpuStart = ProcessCpuSeconds();
+        const int64_t wallStart = SteadyMicros();
+        for (int i = 0; i < args.frames; ++i) {
+            if (!source.Read(bgra)) {
+                ERR("EncBench: %s stopped producing frames at %d", source.Describe().c_str(), i);
+                break;
+            }
+            sourceFrames++;
+            const bool forceKey = i == 0 || (args.keyInterval > 0 && i % args.keyInterval == 0);
+            const int64_t t0 = SteadyMicros();
+            if (args.staticDetection && detector.Analyze(bgra.data(), stride, w, h).IsStatic() && !forceKey) {
+                staticFrames++;
+                continue;
+            }
+
+            out.Clear();
+            bool gotKey = false;
+            if (!session.Encode(bgra.data(), stride, forceKey, out, gotKey)) {
+                failedFrames++;
+                continue;
+            }
+            latencyMs.push_back(static_cast<double>(SteadyMicros() - t0) / 1000.0);
+            if (out.size == 0) emptyFrames++;
+            totalBytes += out.size;
+            if (gotKey) keySizes.push_back(out.size);
+            if (!out.packets.empty()) {
+                const AVPacket* first = out.packets.front();
+                const size_t size = static_cast<size_t>(first->size);
+                signalledLayers[FindTemporalLayer(codec, first->data, size)]++;
+                deliveredLayers[layerTracker.Next(codec, first->data, size, gotKey)]++;
+            }
+        }
+
+        out.Clear();
+        bool flushKey = false;
+        session.Flush(out, flushKey);
+        totalBytes += out.size;
+        const double wallSeconds = static_cast<double>(SteadyMicros() - wallStart) / 1e6;
+        const double cpuSeconds = ProcessCpuSeconds() - cpuStart;
+
+        double encodeSeconds = 0.0;
+        for (double ms : latencyMs) encodeSeconds += ms / 1000.0;
+        // A short file ends the run early. Static skips still take up stream time.
+        const double streamSeconds = static_cast<double>(sourceFrames) / fps;
+        const int64_t targetBitrate = CalcBitrate(codec, w, h, fps);
+        const double actualBitrate = streamSeconds > 0.0 ? static_cast<double>(totalBytes) * 8.0 / streamSeconds : 0.0;
+        const double cores = std::max(1u, std::thread::hardware_concurrency());
+
+        json keyframes = {{"count", keySizes.size()}};
+        if (!keySizes.empty()) {
+            size_t sum = 0;
+            for (size_t size : keySizes) sum += size;
+            keyframes["minBytes"] = *std::min_element(keySizes.begin(), keySizes.end());
+            keyframes["maxBytes"] = *std::max_element(keySizes.begin(), keySizes.end());
+            keyframes["avgBytes"] = sum / keySizes.size();
+        }
+
+        result["encoder"] = session.EncoderName();
+        result["pixelFormat"] = av_get_pix_fmt_name(session.PixelFormat()) ? av_get_pix_fmt_name(session.PixelFormat()) : "unknown";
+        result["frames"] = args.frames;
+        result["sourceFrames"] = sourceFrames;
+        result["encodedFrames"] = latencyMs.size();
+        result["failedFrames"] = failedFrames;
+        result["delayedOutputFrames"] = emptyFrames;
+        result["staticSkipRate"] = sourceFrames > 0 ? static_cast<double>(staticFrames) / sourceFrames : 0.0;
+        result["encodeFps"] = encodeSeconds > 0.0 ? latencyMs.size() / encodeSeconds : 0.0;
+        result["wallSeconds"] = wallSeconds;
+        result["latencyMs"] = {
+            {"p50", Percentile(latencyMs, 0.50)}, {"p90", Percentile(latencyMs, 0.90)},
+            {"p99", Percentile(latencyMs, 0.99)}, {"max", Percentile(latencyMs, 1.0)}
+        };
+        result["bitrate"] = {
+            {"targetBps", targetBitrate}, {"actualBps", actualBitrate},
+            {"accuracy", targetBitrate > 0 ? actualBitrate / static_cast<double>(targetBitrate) : 0.0},
+            {"totalBytes", totalBytes}
+        };
+        result["keyframes"] = keyframes;
+        json signalled = json::object(), delivered = json::object();
+        for (const auto& [layer, count] : signalledLayers) signalled[layer < 0 ? "none" : std::to_string(layer)] = count;
+        for (const auto& [layer, count] : deliveredLayers) delivered[std::to_string(layer)] = count;
+        const bool baseOnly = deliveredLayers.empty() || deliveredLayers.rbegin()->first == 0;
+        result["temporalLayers"] = {
+            {"requested", args.temporalLayers}, {"supported", layered},
+            {"signalled", signalled}, {"delivered", delivered},
+            {"pass", args.temporalLayers == 1 || !layered || !baseOnly}
+        };
+        const SoftwareThreadingPlan& plan = session.ThreadingPlan();
+        result["threading"] = {
+            {"threads", plan.threads}, {"tileColumns", 1 << plan.tileColumnsLog2},
+            {"tileRows", 1 << plan.tileRowsLog2}, {"rowMt", plan.rowMt}, {"pin", plan.pin}
+        };
+        result["cpu"] = {
+            {"seconds", cpuSeconds},
+            {"coresUsed", wallSeconds > 0.0 ? cpuSeconds / wallSeconds : 0.0},
+            {"utilization", wallSeconds > 0.0 ? cpuSeconds / wallSeconds / cores : 0.0}
+        };
+        return result;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    BenchArgs args;
+    if (!ParseArgs(argc, argv, args)) {
+        PrintUsage();
+        return 2;
+    }
+    av_log_set_level(g_debugLogging ? AV_LOG_INFO : AV_LOG_ERROR);
+
+    std::unique_ptr<CaptureSource> probe = OpenSource(args);
+    if (!probe) return 1;
+    const int fps = args.fps > 0 ? args.fps : probe->Fps() > 0 ? probe->Fps() : 60;
+
+    json report = {
+        {"tool", "slipstream_encbench"},
+        {"input", {{"source", probe->Describe()}, {"width", probe->Width()}, {"height", probe->Height()}, {"fps", fps}}},
+        {"settings", {
+            {"frames", args.frames}, {"keyInterval", args.keyInterval}, {"slices", args.slices},
+            {"profile", args.profile == ContentProfile::Screen ? "screen" : "default"},
+            {"staticDetection", args.staticDetection}, {"temporalLayers", args.temporalLayers},
+            {"hardwareThreads", std::thread::hardware_concurrency()},
+            {"logicalCores", GetCpuTopology().logicalCores}, {"physicalCores", GetCpuTopology().physicalCores}
+        }},
+        {"runs", json::array()}
+    };
+    probe.reset();
+
+    bool failed = false;
+    for (CodecType codec : args.codecs) {
+        std::vector<std::string> encoders;
+        for (const auto& name : args.encoders) {
+            const AVCodec* enc = avcodec_find_encoder_by_name(name.c_str());
+            if (enc && enc->id == GetCodecId(codec)) encoders.push_back(name);
+        }
+        if (args.encoders.empty()) {
+            size_t count = 0;
+            const char* const* names = GetSoftwareEncoderNames(codec, count);
+            for (size_t i = 0; i < count; ++i) {
+                if (avcodec_find_encoder_by_name(names[i])) encoders.emplace_back(names[i]);
+            }
+        }
+        if (encoders.empty()) {
+            WARN("EncBench: No software encoder available for %s", CodecKey(codec));
+            continue;
+        }
+
+        for (const auto& encoder : encoders) {
+            for (EncodeFormat format : args.formats) {
+                if (SelectSoftwarePixelFormat(avcodec_find_encoder_by_name(encoder.c_str()), format) == AV_PIX_FMT_NONE) {
+                    WARN("EncBench: %s has no %s input, skipping", encoder.c_str(), EncodeFormatName(format));
+                    continue;
+                }
+                for (const auto& preset : args.presets) {
+                    for (int coreBudget : args.coreBudgets) {
+                        auto source = OpenSource(args);
+                        if (!source) return 1;
+                        LOG("EncBench: %s %s / %s / preset %s / %d cores on %s", CodecKey(codec), FormatKey(format), encoder.c_str(),
+                            preset.empty() ? "default" : preset.c_str(), ResolveCoreBudget(coreBudget), source->Describe().c_str());
+                        json run = RunBenchmark(args, codec, encoder, preset, coreBudget, format, *source, fps);
+                        if (run.contains("temporalLayers") && !run["temporalLayers"]["pass"].get<bool>()) {
+                            ERR("EncBench: %s was asked for L1T%d but only delivered layer 0", encoder.c_str(), args.temporalLayers);
+                            failed = true;
+                        }
+                        report["runs"].push_back(std::move(run));
+                    }
+                }
+            }
+        }
+    }
+
+    const std::string text = report.dump(2);
+    if (args.output.empty()) {
+        std::cout << text << std::endl;
+    } else {
+        std::ofstream file(args.output);
+        if (!file) {
+            ERR("EncBench: Cannot write %s", args.output.c_str());
+            return 1;
+        }
+        file << text << '\n';
+    }
+    return failed ? 1 : 0;
+}
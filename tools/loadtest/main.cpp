@@ -0,0 +1,328 @@
+// slipstream_loadtest: runs the host's capture -> pacing -> software encode loop
+// headless. A CaptureSource (synthetic pattern, Y4M/raw BGRA replay or, on Linux, an
+// X11 display) is played in real time through SourceCapture, paced by FrameScheduler
+// and encoded through the software path, and the capture-to-encoded latency, encode
+// time, drops and CPU use are reported as JSON. Needs no GPU.
+
+#include "../common/encode_session.hpp"
+#include "../common/process_stats.hpp"
+
+#include "host/core/clock.hpp"
+#include "host/core/logging.hpp"
+#include "host/media/capture_source.hpp"
+#include "host/media/frame_analysis.hpp"
+#include "host/media/frame_scheduler.hpp"
+#ifdef SLIPSTREAM_HAVE_X11
+#include "host/media/x11_capture.hpp"
+#endif
+
+#include <nlohmann/json.hpp>
+
+extern "C" {
+#include <libavutil/log.h>
+}
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+using json = nlohmann::json;
+
+namespace {
+    struct LoadArgs {
+        std::string source = "synthetic:scroll", encoder, preset, output;
+        CodecType codec = CODEC_H264;
+        int width = 1920, height = 1080, fps = 60, targetFps = 0;
+        double seconds = 30.0;
+        double maxP95Ms = 0.0;
+        bool staticDetection = true;
+        bool compareStatic = false;
+    };
+
+    const char* CodecKey(CodecType codec) {
+        return codec == CODEC_AV1 ? "av1" : codec == CODEC_H265 ? "h265" : "h264";
+    }
+
+    bool ParseCodec(const std::string& name, CodecType& codec) {
+        if (name == "h264" || name == "avc") codec = CODEC_H264;
+        else if (name == "h265" || name == "hevc") codec = CODEC_H265;
+        else if (name == "av1") codec = CODEC_AV1;
+        else return false;
+        return true;
+    }
+
+    void PrintUsage() {
+        fprintf(stderr,
+            "Usage: slipstream_loadtest [options]\n"
+            "  --source SPEC        synthetic:static|idle|scroll|gradient|noise, a .y4m file, or raw BGRA\n"
+            "                       frames (needs --size; FILE.ts holds their timestamps)\n"
+            "                       (default: synthetic:scroll)\n"
+#ifdef SLIPSTREAM_HAVE_X11
+            "                       x11[:DISPLAY] captures a live X server at --fps\n"
+#endif
+            "  --size WxH           synthetic and raw frame size (default: 1920x1080)\n"
+            "  --fps N              synthetic and raw frame rate without timestamps (default: 60)\n"
+            "  --target-fps N       encode frame rate (default: the source rate)\n"
+            "  --codec NAME         h264, h265 or av1 (default: h264)\n"
+            "  --encoder NAME       software encoder (default: the host's choice for the codec)\n"
+            "  --preset NAME        encoder preset\n"
+            "  --seconds N          run time (default: 30)\n"
+            "  --no-static-skip     encode unchanged frames instead of skipping them\n"
+            "  --compare-static     run twice, with and without the static skip, and report\n"
+            "                       the CPU and bytes it saves (e.g. with synthetic:idle)\n"
+            "  --max-p95-ms N       exit non-zero if p95 capture-to-encoded latency exceeds N ms\n"
+            "  --output FILE        write JSON here instead of stdout\n"
+            "  --debug              verbose logging\n");
+    }
+
+    bool ParseArgs(int argc, char* argv[], LoadArgs& args) {
+        for (int i = 1; i < argc; ++i) {
+            const std::string arg = argv[i];
+            if (arg == "--debug") { g_debugLogging = true; continue; }
+            if (arg == "--no-static-skip") { args.staticDetection = false; continue; }
+            if (arg == "--compare-static") { args.compareStatic = true; continue; }
+            if (arg == "--help" || arg == "-h") return false;
+            if (i + 1 >= argc) {
+                ERR("Missing value for %s", arg.c_str());
+                return false;
+            }
+            const std::string value = argv[++i];
+            if (arg == "--source") {
+                args.source = value;
+            } else if (arg == "--size") {
+                if (sscanf(value.c_str(), "%dx%d", &args.width, &args.height) != 2) return false;
+            } else if (arg == "--fps") {
+                args.fps = std::clamp(atoi(value.c_str()), 1, 480);
+            } else if (arg == "--target-fps") {
+                args.targetFps = std::clamp(atoi(value.c_str()), 1, 240);
+            } else if (arg == "--codec") {
+                if (!ParseCodec(value, args.codec)) { ERR("Unknown codec '%s'", value.c_str()); return false; }
+            } else if (arg == "--encoder") {
+                args.encoder = value;
+            } else if (arg == "--preset") {
+                args.preset = value;
+            } else if (arg == "--seconds") {
+                args.seconds = std::clamp(atof(value.c_str()), 1.0, 3600.0);
+            } else if (arg == "--max-p95-ms") {
+                args.maxP95Ms = std::max(0.0, atof(value.c_str()));
+            } else if (arg == "--output") {
+                args.output = value;
+            } else {
+                ERR("Unknown option %s", arg.c_str());
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::unique_ptr<CaptureSource> OpenSource(const LoadArgs& args) {
+        const std::string& spec = args.source;
+#ifdef SLIPSTREAM_HAVE_X11
+        if (spec == "x11") return OpenX11Source("", args.fps);
+        if (spec.rfind("x11:", 0) == 0) return OpenX11Source(spec.substr(4), args.fps);
+#endif
+        if (spec.rfind("synthetic:", 0) == 0) return CreateSyntheticSource(spec.substr(10), args.width, args.height, args.fps);
+        if (spec.size() > 4 && spec.compare(spec.size() - 4, 4, ".y4m") == 0) return OpenY4MSource(spec);
+        return OpenRawBGRASource(spec, args.width, args.height, args.fps);
+    }
+
+    double Percentile(std::vector<double> values, double p) {
+        if (values.empty()) return 0.0;
+        std::sort(values.begin(), values.end());
+        const size_t index = std::min(values.size() - 1, static_cast<size_t>(p * (values.size() - 1) + 0.5));
+        return values[index];
+    }
+
+    json Summary(const std::vector<double>& values) {
+        return {{"p50", Percentile(values, 0.50)}, {"p95", Percentile(values, 0.95)},
+                {"p99", Percentile(values, 0.99)}, {"max", Percentile(values, 1.0)}};
+    }
+
+    // One run of the capture -> pacing -> encode loop; null if the source or encoder
+    // does not open.
+    json RunLoad(const LoadArgs& args, bool staticDetection) {
+        auto source = OpenSource(args);
+        if (!source) return nullptr;
+        const int w = source->Width(), h = source->Height();
+        const int sourceFps = source->Fps() > 0 ? source->Fps() : args.fps;
+        const int targetFps = args.targetFps > 0 ? args.targetFps : sourceFps;
+        const std::string description = source->Describe();
+
+        SoftwareEncoderOptions opts;
+        opts.preset = args.preset;
+        EncodeSession session;
+        if (!session.Open(args.codec, args.encoder, w, h, targetFps, opts)) {
+            ERR("LoadTest: Cannot open a %s encoder for %dx%d", CodecKey(args.codec), w, h);
+            return nullptr;
+        }
+
+        FrameScheduler scheduler;
+        scheduler.SetPeriod(1000000 / targetFps);
+        scheduler.SetRefreshHint(sourceFps);
+        SourceCapture capture(std::move(source));
+
+        const size_t stride = static_cast<size_t>(w) * 4;
+        TileChangeDetector detector;
+        EncodedFrame out;
+        CpuFrame current, pending;
+        std::vector<double> encodeMs, latencyMs;
+        size_t totalBytes = 0;
+        uint64_t staticFrames = 0, failedFrames = 0, damageDecisions = 0;
+        bool firstEncode = true;
+        // Changes since the last encode decision, through the newest frame popped. A
+        // frame replaced or dropped after pending leaves its changes for the next decision.
+        FrameChangeInfo since;
+        bool haveSince = false, newerThanPending = false;
+
+        const double cpuStart = ProcessCpuSeconds();
+        const int64_t startUs = GetTimestamp();
+        const int64_t endUs = startUs + static_cast<int64_t>(args.seconds * 1e6);
+        if (!capture.Start()) return nullptr;
+        LOG("LoadTest: %s %dx%d at %d fps -> %s at %d fps for %.0f s", description.c_str(), w, h, sourceFps,
+            session.EncoderName().c_str(), targetFps, args.seconds);
+
+        while (GetTimestamp() < endUs) {
+            capture.Recycle(current.bgra);
+            if (!capture.Pop(current)) {
+                if (!capture.Running()) break;
+                continue;
+            }
+            if (haveSince) {
+                MergeFrameChanges(since, current.changes);
+            } else {
+                since = current.changes;
+                haveSince = true;
+            }
+            const int64_t now = GetTimestamp();
+            const FrameOffer offer = scheduler.Offer(current.ts, now, false, 0);
+            if (offer == FrameOffer::Dropped || offer == FrameOffer::Superseded) {
+                newerThanPending = true;
+                if (offer == FrameOffer::Dropped) continue;
+            } else {
+                capture.Recycle(pending.bgra);
+                pending = std::move(current);
+                newerThanPending = false;
+            }
+            if (scheduler.Due(now) != FrameDue::Encode) continue;
+
+            const FrameChangeInfo changes = since;
+            if (!newerThanPending) haveSince = false;
+            if (staticDetection) {
+                // Damage from the source decides without hashing; the detector's reference
+                // frame is stale afterwards, so it starts over.
+                bool isStatic;
+                if (changes.valid) {
+                    isStatic = changes.IsStatic();
+                    detector.Reset();
+                    damageDecisions++;
+                } else {
+                    isStatic = detector.Analyze(pending.bgra.data(), stride, w, h).IsStatic();
+                }
+                if (isStatic && !firstEncode) {
+                    staticFrames++;
+                    continue;
+                }
+            }
+            out.Clear();
+            bool gotKey = false;
+            const int64_t t0 = GetTimestamp();
+            if (!session.Encode(pending.bgra.data(), stride, firstEncode, out, gotKey)) {
+                failedFrames++;
+                continue;
+            }
+            const int64_t t1 = GetTimestamp();
+            firstEncode = false;
+            encodeMs.push_back(static_cast<double>(t1 - t0) / 1000.0);
+            latencyMs.push_back(static_cast<double>(t1 - pending.ts) / 1000.0);
+            totalBytes += out.size;
+        }
+
+        capture.Stop();
+        const double wallSeconds = static_cast<double>(GetTimestamp() - startUs) / 1e6;
+        const double cpuSeconds = ProcessCpuSeconds() - cpuStart;
+        const SourceCaptureStats captureStats = capture.Stats();
+        const FrameSchedulerStats& pacing = scheduler.Stats();
+        const int64_t targetBitrate = CalcBitrate(args.codec, w, h, targetFps);
+        const double actualBitrate = wallSeconds > 0.0 ? static_cast<double>(totalBytes) * 8.0 / wallSeconds : 0.0;
+
+        json report = {
+            {"tool", "slipstream_loadtest"},
+            {"input", {{"source", description}, {"width", w}, {"height", h}, {"fps", sourceFps}}},
+            {"codec", CodecKey(args.codec)},
+            {"encoder", session.EncoderName()},
+            {"targetFps", targetFps},
+            {"staticDetection", staticDetection},
+            {"wallSeconds", wallSeconds},
+            {"capture", {{"delivered", captureStats.delivered}, {"replaced", captureStats.replaced}, {"late", captureStats.late}}},
+            {"pacing", {
+                {"encoded", pacing.encoded}, {"deadlineMisses", pacing.deadlineMisses}, {"stale", pacing.stale},
+                {"tooOld", pacing.tooOld}, {"superseded", pacing.superseded}, {"jitterUs", pacing.jitterUs},
+                {"driftUs", pacing.driftUs}, {"aligned", pacing.aligned}
+            }},
+            {"encodedFrames", encodeMs.size()},
+            {"encodedFps", wallSeconds > 0.0 ? static_cast<double>(encodeMs.size() + staticFrames) / wallSeconds : 0.0},
+            {"staticFrames", staticFrames},
+            {"damageDecisions", damageDecisions},
+            {"failedFrames", failedFrames},
+            {"encodeMs", Summary(encodeMs)},
+            {"latencyMs", Summary(latencyMs)},
+            {"bitrate", {{"targetBps", targetBitrate}, {"actualBps", actualBitrate}, {"totalBytes", totalBytes}}},
+            {"cpu", {{"seconds", cpuSeconds}, {"coresUsed", wallSeconds > 0.0 ? cpuSeconds / wallSeconds : 0.0}}}
+        };
+        return report;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    LoadArgs args;
+    if (!ParseArgs(argc, argv, args)) {
+        PrintUsage();
+        return 2;
+    }
+    av_log_set_level(g_debugLogging ? AV_LOG_INFO : AV_LOG_ERROR);
+
+    json report;
+    if (!args.compareStatic) {
+        report = RunLoad(args, args.staticDetection);
+        if (report.is_null()) return 1;
+    } else {
+        // Same source and settings twice; what the skip saves on this content.
+        json skip = RunLoad(args, true);
+        if (skip.is_null()) return 1;
+        json full = RunLoad(args, false);
+        if (full.is_null()) return 1;
+        const double skipCpu = skip["cpu"]["seconds"].get<double>(), fullCpu = full["cpu"]["seconds"].get<double>();
+        const double skipBytes = skip["bitrate"]["totalBytes"].get<double>(), fullBytes = full["bitrate"]["totalBytes"].get<double>();
+        report = {
+            {"tool", "slipstream_loadtest"},
+            {"staticSkip", skip},
+            {"noStaticSkip", full},
+            {"savings", {
+                {"cpuSeconds", fullCpu - skipCpu}, {"cpuFraction", fullCpu > 0.0 ? 1.0 - skipCpu / fullCpu : 0.0},
+                {"bytes", fullBytes - skipBytes}, {"bytesFraction", fullBytes > 0.0 ? 1.0 - skipBytes / fullBytes : 0.0}
+            }}
+        };
+        LOG("LoadTest: Static skip saved %.0f%% CPU and %.0f%% bytes", 100.0 * report["savings"]["cpuFraction"].get<double>(),
+            100.0 * report["savings"]["bytesFraction"].get<double>());
+    }
+    const json& primary = args.compareStatic ? report["staticSkip"] : report;
+    const double p95 = primary["latencyMs"]["p95"].get<double>();
+    const bool passed = args.maxP95Ms <= 0.0 || p95 <= args.maxP95Ms;
+    if (!passed) ERR("LoadTest: p95 latency %.2f ms exceeds %.2f ms", p95, args.maxP95Ms);
+
+    const std::string text = report.dump(2);
+    if (args.output.empty()) {
+        std::cout << text << std::endl;
+    } else {
+        std::ofstream file(args.output);
+        if (!file) {
+            ERR("LoadTest: Cannot write %s", args.output.c_str());
+            return 1;
+        }
+        file << text << '\n';
+    }
+    return passed ? 0 : 1;
+}
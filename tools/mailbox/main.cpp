@@ -0,0 +1,493 @@
+// slipstream_mailbox: contention benchmark and stress check for the capture -> encoder
+// handoff. "mailbox" is FrameSlot's protocol over FrameMailbox; "ring" is the
+// previous FrameSlot (4-entry ring, one lock, auto-reset event) as a baseline.
+
+#include "host/core/frame_mailbox.hpp"
+#include "host/core/logging.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using json = nlohmann::json;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+    // Matches ScreenCapture::POOL.
+    constexpr int kPoolSize = 6;
+
+    struct BenchFrame {
+        uint64_t id = 0;
+        int64_t publishNs = 0;
+        int poolIdx = -1;
+    };
+
+    using DropFn = std::function<void(const BenchFrame&)>;
+
+    int64_t NowNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+    }
+
+    // splitmix64; every stress decision comes from a seeded stream.
+    struct Rng {
+        uint64_t state;
+        explicit Rng(uint64_t seed) : state(seed) {}
+        uint64_t Next() {
+            uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            return z ^ (z >> 31);
+        }
+        int Below(int n) { return static_cast<int>(Next() % static_cast<uint64_t>(n)); }
+    };
+
+    class MailboxSlot {
+        FrameMailbox<BenchFrame> box;
+        std::atomic<uint32_t> inFlight{0};
+        DropFn onDrop;
+
+        void Drop(const BenchFrame& frame) { MarkReleased(frame.poolIdx); onDrop(frame); }
+
+    public:
+        explicit MailboxSlot(DropFn drop) : onDrop(std::move(drop)) {}
+        void Push(BenchFrame frame) {
+            if (frame.poolIdx >= 0) inFlight.fetch_or(1u << frame.poolIdx, std::memory_order_acq_rel);
+            BenchFrame replaced;
+            if (box.Publish(frame, replaced)) Drop(replaced);
+        }
+        bool Pop(BenchFrame& out) { return box.Pop(out); }
+        void Wake() { box.Wake(); }
+        void MarkReleased(int i) { if (i >= 0) inFlight.fetch_and(~(1u << i), std::memory_order_release); }
+        bool IsInFlight(int i) const { return i >= 0 && (inFlight.load(std::memory_order_acquire) & (1u << i)) != 0; }
+        uint32_t InFlightMask() const { return inFlight.load(std::memory_order_acquire); }
+        void Reset() {
+            BenchFrame frame;
+            if (box.Take(frame)) Drop(frame);
+        }
+    };
+
+    class RingSlot {
+        static constexpr int N = 4;
+        BenchFrame fr[N];
+        std::mutex cs;
+        std::condition_variable cv;
+        bool signaled = false;
+        int head = 0, tail = 0, cnt = 0;
+        uint32_t inFlight = 0;
+        DropFn onDrop;
+
+    public:
+        explicit RingSlot(DropFn drop) : onDrop(std::move(drop)) {}
+        void Push(BenchFrame frame) {
+            std::lock_guard<std::mutex> lock(cs);
+            if (cnt >= N) {
+                if (fr[tail].poolIdx >= 0) inFlight &= ~(1u << fr[tail].poolIdx);
+                onDrop(fr[tail]);
+                tail = (tail + 1) % N;
+                cnt--;
+            }
+            fr[head] = frame;
+            if (frame.poolIdx >= 0) inFlight |= (1u << frame.poolIdx);
+            head = (head + 1) % N;
+            cnt++;
+            signaled = true;
+            cv.notify_one();
+        }
+        bool Pop(BenchFrame& out) {
+            std::unique_lock<std::mutex> lock(cs);
+            cv.wait(lock, [&] { return signaled; });
+            signaled = false;
+            if (cnt == 0) return false;
+            out = fr[tail];
+            tail = (tail + 1) % N;
+            cnt--;
+            if (cnt > 0) signaled = true;
+            return true;
+        }
+        void Wake() {
+            std::lock_guard<std::mutex> lock(cs);
+            signaled = true;
+            cv.notify_one();
+        }
+        void MarkReleased(int i) {
+            if (i < 0) return;
+            std::lock_guard<std::mutex> lock(cs);
+            inFlight &= ~(1u << i);
+        }
+        bool IsInFlight(int i) {
+            if (i < 0) return false;
+            std::lock_guard<std::mutex> lock(cs);
+            return (inFlight & (1u << i)) != 0;
+        }
+        void Reset() {
+            std::lock_guard<std::mutex> lock(cs);
+            while (cnt > 0) {
+                onDrop(fr[tail]);
+                tail = (tail + 1) % N;
+                cnt--;
+            }
+            head = tail = 0;
+            inFlight = 0;
+            signaled = false;
+        }
+    };
+
+    // ScreenCapture::FindTex without the fences.
+    template <typename Slot>
+    int FindFree(Slot& slot, int& next) {
+        for (int i = 0; i < kPoolSize; i++) {
+            const int idx = (next + i) % kPoolSize;
+            if (!slot.IsInFlight(idx)) {
+                next = idx + 1;
+                return idx;
+            }
+        }
+        return -1;
+    }
+
+    double Percentile(std::vector<double> values, double p) {
+        if (values.empty()) return 0.0;
+        std::sort(values.begin(), values.end());
+        const size_t index = std::min(values.size() - 1, static_cast<size_t>(p * (values.size() - 1) + 0.5));
+        return values[index];
+    }
+
+    struct Args {
+        std::string mode = "bench";
+        std::vector<std::string> impls{"mailbox", "ring"};
+        double seconds = 2.0;
+        int intervalUs = 0;
+        int holdUs = 200;
+        int queryThreads = 1;
+        uint64_t seed = 1;
+        int frames = 200000;
+        int steps = 1000000;
+        std::string output;
+    };
+
+    // Producer at capture rate (or flat out), one encoder thread holding each frame for
+    // holdUs, and queryThreads polling IsInFlight the way FindTex does.
+    template <typename Slot>
+    json RunBench(const Args& args, const char* name) {
+        std::atomic<uint64_t> dropped{0};
+        Slot slot([&](const BenchFrame&) { dropped.fetch_add(1, std::memory_order_relaxed); });
+        std::atomic<bool> running{true};
+        std::atomic<uint64_t> queries{0}, busyQueries{0};
+        uint64_t published = 0, taken = 0, poolStalls = 0;
+        int64_t pushNs = 0;
+        std::vector<double> latencyUs;
+        latencyUs.reserve(1 << 20);
+
+        std::thread consumer([&] {
+            BenchFrame frame;
+            while (running.load(std::memory_order_acquire)) {
+                if (!slot.Pop(frame)) continue;
+                const int64_t now = NowNs();
+                if (latencyUs.size() < latencyUs.capacity()) latencyUs.push_back((now - frame.publishNs) / 1000.0);
+                while (NowNs() - now < static_cast<int64_t>(args.holdUs) * 1000) {}
+                slot.MarkReleased(frame.poolIdx);
+                taken++;
+            }
+        });
+        std::vector<std::thread> pollers;
+        for (int t = 0; t < args.queryThreads; t++) {
+            pollers.emplace_back([&, t] {
+                uint64_t count = 0, busy = 0;
+                for (int i = t; running.load(std::memory_order_relaxed); i++, count++) {
+                    if (slot.IsInFlight(i % kPoolSize)) busy++;
+                }
+                queries.fetch_add(count, std::memory_order_relaxed);
+                busyQueries.fetch_add(busy, std::memory_order_relaxed);
+            });
+        }
+
+        const auto start = Clock::now();
+        const auto deadline = start + std::chrono::duration<double>(args.seconds);
+        auto nextPush = start;
+        int next = 0;
+        while (Clock::now() < deadline) {
+            const int idx = FindFree(slot, next);
+            if (idx < 0) {
+                poolStalls++;
+                std::this_thread::yield();
+                continue;
+            }
+            const int64_t before = NowNs();
+            slot.Push({published + 1, before, idx});
+            pushNs += NowNs() - before;
+            published++;
+            if (args.intervalUs > 0) {
+                nextPush += std::chrono::microseconds(args.intervalUs);
+                std::this_thread::sleep_until(nextPush);
+            }
+        }
+        running.store(false, std::memory_order_release);
+        slot.Wake();
+        consumer.join();
+        for (auto& poller : pollers) poller.join();
+        slot.Reset();
+        const double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+        return {
+            {"impl", name},
+            {"published", published},
+            {"taken", taken},
+            {"dropped", dropped.load()},
+            {"poolStalls", poolStalls},
+            {"pushNsAvg", published > 0 ? static_cast<double>(pushNs) / published : 0.0},
+            {"latencyUs", {{"p50", Percentile(latencyUs, 0.5)}, {"p99", Percentile(latencyUs, 0.99)},
+                           {"max", latencyUs.empty() ? 0.0 : *std::max_element(latencyUs.begin(), latencyUs.end())}}},
+            {"inFlightQueriesPerSec", queries.load() / elapsed},
+            {"inFlightBusyShare", queries.load() > 0 ? static_cast<double>(busyQueries.load()) / queries.load() : 0.0}
+        };
+    }
+
+    // Single-threaded: random Push/Pop/Reset/Wake/release against a model of the
+    // expected state, checked after every step. Same seed, same sequence.
+    bool RunModelCheck(const Args& args, json& result) {
+        std::vector<uint64_t> drops;
+        MailboxSlot slot([&](const BenchFrame& f) { drops.push_back(f.id); });
+        Rng rng(args.seed);
+        BenchFrame waiting;
+        bool hasWaiting = false;
+        std::vector<BenchFrame> held;
+        bool pending = false;
+        uint64_t nextId = 1;
+        int next = 0;
+        uint64_t counts[5]{};
+
+        auto fail = [&](int step, const char* what) {
+            ERR("Mailbox: model check failed at step %d (seed %llu): %s", step, static_cast<unsigned long long>(args.seed), what);
+            result = {{"passed", false}, {"step", step}, {"error", what}};
+            return false;
+        };
+
+        for (int step = 0; step < args.steps; step++) {
+            drops.clear();
+            const int op = rng.Below(5);
+            counts[op]++;
+            if (op == 0) {
+                const int idx = FindFree(slot, next);
+                if (idx < 0) continue;
+                const BenchFrame frame{nextId++, 0, idx};
+                slot.Push(frame);
+                if (hasWaiting && (drops.size() != 1 || drops[0] != waiting.id)) return fail(step, "push did not drop the waiting frame");
+                if (!hasWaiting && !drops.empty()) return fail(step, "push dropped with nothing waiting");
+                waiting = frame;
+                hasWaiting = true;
+                pending = true;
+            } else if (op == 1) {
+                // Pop would block with nothing pending.
+                if (!pending) continue;
+                BenchFrame frame;
+                const bool got = slot.Pop(frame);
+                if (got != hasWaiting) return fail(step, "pop result does not match");
+                if (got) {
+                    if (frame.id != waiting.id) return fail(step, "pop returned a stale frame");
+                    held.push_back(frame);
+                    hasWaiting = false;
+                }
+                pending = false;
+            } else if (op == 2) {
+                slot.Reset();
+                if (hasWaiting && (drops.size() != 1 || drops[0] != waiting.id)) return fail(step, "reset did not drop the waiting frame");
+                if (!hasWaiting && !drops.empty()) return fail(step, "reset dropped with nothing waiting");
+                hasWaiting = false;
+            } else if (op == 3) {
+                slot.Wake();
+                pending = true;
+            } else if (!held.empty()) {
+                const size_t i = static_cast<size_t>(rng.Below(static_cast<int>(held.size())));
+                slot.MarkReleased(held[i].poolIdx);
+                held.erase(held.begin() + static_cast<std::ptrdiff_t>(i));
+            }
+
+            uint32_t expected = hasWaiting ? 1u << waiting.poolIdx : 0u;
+            for (const auto& frame : held) expected |= 1u << frame.poolIdx;
+            if (slot.InFlightMask() != expected) return fail(step, "in-flight mask does not match held frames");
+        }
+        result = {{"passed", true}, {"steps", args.steps}, {"frames", nextId - 1},
+                  {"ops", {{"push", counts[0]}, {"pop", counts[1]}, {"reset", counts[2]}, {"wake", counts[3]}, {"release", counts[4]}}}};
+        return true;
+    }
+
+    // Threaded: capture, encoder and a resetting control thread. Checks that every
+    // frame is released exactly once, the encoder sees ids in order, and no pool
+    // index is reused while the encoder still holds it.
+    bool RunThreadedStress(const Args& args, json& result) {
+        const size_t frames = static_cast<size_t>(args.frames);
+        std::vector<std::atomic<uint8_t>> releases(frames + 1);
+        std::array<std::atomic<uint64_t>, kPoolSize> owner{};
+        std::atomic<uint64_t> failures{0}, dropped{0}, resets{0};
+        MailboxSlot slot([&](const BenchFrame& f) {
+            releases[f.id].fetch_add(1, std::memory_order_relaxed);
+            dropped.fetch_add(1, std::memory_order_relaxed);
+        });
+        std::atomic<bool> producing{true};
+        uint64_t taken = 0;
+
+        std::thread consumer([&] {
+            Rng rng(args.seed * 3 + 1);
+            uint64_t lastId = 0;
+            BenchFrame frame;
+            for (;;) {
+                if (!slot.Pop(frame)) {
+                    if (!producing.load(std::memory_order_acquire)) break;
+                    continue;
+                }
+                if (frame.id <= lastId) failures.fetch_add(1);
+                lastId = frame.id;
+                if (owner[frame.poolIdx].load(std::memory_order_acquire) != frame.id) failures.fetch_add(1);
+                const int holdUs = rng.Below(50);
+                const auto until = Clock::now() + std::chrono::microseconds(holdUs);
+                while (Clock::now() < until) {}
+                if (owner[frame.poolIdx].load(std::memory_order_acquire) != frame.id) failures.fetch_add(1);
+                releases[frame.id].fetch_add(1, std::memory_order_relaxed);
+                slot.MarkReleased(frame.poolIdx);
+                taken++;
+                if (!producing.load(std::memory_order_acquire)) break;
+            }
+        });
+        std::thread resetter([&] {
+            Rng rng(args.seed * 5 + 2);
+            while (producing.load(std::memory_order_acquire)) {
+                std::this_thread::sleep_for(std::chrono::microseconds(rng.Below(200)));
+                slot.Reset();
+                resets.fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+
+        int next = 0;
+        for (uint64_t id = 1; id <= frames;) {
+            const int idx = FindFree(slot, next);
+            if (idx < 0) { std::this_thread::yield(); continue; }
+            owner[idx].store(id, std::memory_order_release);
+            slot.Push({id, 0, idx});
+            id++;
+        }
+        producing.store(false, std::memory_order_release);
+        resetter.join();
+        slot.Wake();
+        consumer.join();
+        slot.Reset();
+
+        uint64_t bad = 0;
+        for (size_t id = 1; id <= frames; id++) {
+            if (releases[id].load() != 1) bad++;
+        }
+        const bool passed = failures.load() == 0 && bad == 0 && slot.InFlightMask() == 0;
+        result = {{"passed", passed}, {"frames", frames}, {"taken", taken}, {"dropped", dropped.load()},
+                  {"resets", resets.load()}, {"orderOrReuseErrors", failures.load()}, {"releaseErrors", bad},
+                  {"inFlightLeft", slot.InFlightMask()}};
+        if (!passed) ERR("Mailbox: threaded stress failed (seed %llu)", static_cast<unsigned long long>(args.seed));
+        return passed;
+    }
+
+    void PrintUsage() {
+        fprintf(stderr,
+            "Usage: slipstream_mailbox [options]\n"
+            "  --mode NAME          bench, stress or all (default: bench)\n"
+            "  --impl LIST          mailbox,ring (default: both; bench only)\n"
+            "  --seconds N          bench duration per implementation (default: 2)\n"
+            "  --interval-us N      capture interval, 0 = flat out (default: 0)\n"
+            "  --hold-us N          encoder hold time per frame (default: 200)\n"
+            "  --queries N          threads polling IsInFlight (default: 1)\n"
+            "  --seed N             stress seed (default: 1)\n"
+            "  --steps N            model check steps (default: 1000000)\n"
+            "  --frames N           threaded stress frames (default: 200000)\n"
+            "  --output FILE        write JSON here instead of stdout\n");
+    }
+
+    bool ParseArgs(int argc, char* argv[], Args& args) {
+        for (int i = 1; i < argc; ++i) {
+            const std::string arg = argv[i];
+            if (arg == "--help" || arg == "-h") return false;
+            if (i + 1 >= argc) {
+                ERR("Missing value for %s", arg.c_str());
+                return false;
+            }
+            const std::string value = argv[++i];
+            if (arg == "--mode") {
+                if (value != "bench" && value != "stress" && value != "all") return false;
+                args.mode = value;
+            } else if (arg == "--impl") {
+                args.impls.clear();
+                std::stringstream ss(value);
+                for (std::string item; std::getline(ss, item, ',');) {
+                    if (item != "mailbox" && item != "ring") { ERR("Unknown implementation '%s'", item.c_str()); return false; }
+                    args.impls.push_back(item);
+                }
+            } else if (arg == "--seconds") {
+                args.seconds = std::clamp(atof(value.c_str()), 0.1, 600.0);
+            } else if (arg == "--interval-us") {
+                args.intervalUs = std::clamp(atoi(value.c_str()), 0, 1000000);
+            } else if (arg == "--hold-us") {
+                args.holdUs = std::clamp(atoi(value.c_str()), 0, 1000000);
+            } else if (arg == "--queries") {
+                args.queryThreads = std::clamp(atoi(value.c_str()), 0, 64);
+            } else if (arg == "--seed") {
+                args.seed = std::strtoull(value.c_str(), nullptr, 10);
+            } else if (arg == "--steps") {
+                args.steps = std::max(1, atoi(value.c_str()));
+            } else if (arg == "--frames") {
+                args.frames = std::max(1, atoi(value.c_str()));
+            } else if (arg == "--output") {
+                args.output = value;
+            } else {
+                ERR("Unknown option %s", arg.c_str());
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    Args args;
+    if (!ParseArgs(argc, argv, args)) {
+        PrintUsage();
+        return 2;
+    }
+
+    json report;
+    bool passed = true;
+    if (args.mode != "stress") {
+        for (const auto& impl : args.impls) {
+            LOG("Mailbox: bench %s for %.1fs", impl.c_str(), args.seconds);
+            report["bench"].push_back(impl == "ring" ? RunBench<RingSlot>(args, "ring") : RunBench<MailboxSlot>(args, "mailbox"));
+        }
+    }
+    if (args.mode != "bench") {
+        json model, threaded;
+        passed = RunModelCheck(args, model) && passed;
+        passed = RunThreadedStress(args, threaded) && passed;
+        report["stress"] = {{"seed", args.seed}, {"model", model}, {"threaded", threaded}};
+    }
+
+    const std::string text = report.dump(2);
+    if (args.output.empty()) {
+        std::cout << text << std::endl;
+    } else {
+        std::ofstream file(args.output);
+        if (!file) {
+            ERR("Mailbox: Cannot write %s", args.output.c_str());
+            return 1;
+        }
+        file << text << '\n';
+    }
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,262 @@
+// slipstream_pacing: deterministic simulation of the encoder thread's frame pacing.
+// Feeds FrameScheduler synthetic capture timestamp patterns on a VirtualClock,
+// with the mailbox's latest-wins handoff and a fixed encode time, and reports the
+// encoded cadence, deadline misses and latency. --check fails on regressions.
+
+#include "host/core/clock.hpp"
+#include "host/core/logging.hpp"
+#include "host/media/frame_scheduler.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using json = nlohmann::json;
+
+namespace {
+    struct Rng {
+        uint64_t state;
+        explicit Rng(uint64_t seed) : state(seed) {}
+        uint64_t Next() {
+            uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            return z ^ (z >> 31);
+        }
+        double Unit() { return static_cast<double>(Next() >> 11) / static_cast<double>(1ull << 53); }
+        int64_t Range(int64_t lo, int64_t hi) { return lo + static_cast<int64_t>(Unit() * static_cast<double>(hi - lo + 1)); }
+    };
+
+    struct Scenario {
+        const char* name;
+        const char* description;
+        double captureHz;       // compositor presentation rate
+        int refreshHint;        // what the host reports as display refresh (0 = unknown)
+        int targetFps;
+        int64_t jitterUs = 0;   // +/- uniform timestamp jitter
+        double vrrMinHz = 0.0;  // > 0: intervals uniform between 1/captureHz and 1/vrrMinHz
+        double skipShare = 0.0; // share of vsyncs with no new frame
+        // --check limits.
+        double maxMissShare = 0.02;
+        double minRateShare = 0.97;
+    };
+
+    const Scenario kScenarios[] = {
+        {"steady-60", "60 Hz capture, 60 fps target", 60.0, 60, 60},
+        {"jitter-60", "60 Hz capture with +/-2 ms compositor jitter", 60.0, 60, 60, 2000},
+        {"ntsc-59.94", "59.94 Hz capture reported as 60 Hz, 60 fps target", 59.94, 60, 60},
+        {"ntsc-60-on-59.94", "60 Hz capture reported as 59 Hz, 60 fps target", 60.0, 59, 60},
+        {"144-to-60", "144 Hz capture, 60 fps target", 144.0, 144, 60},
+        {"144-to-144", "144 Hz capture with +/-0.5 ms jitter, 144 fps target", 144.0, 144, 144, 500},
+        {"240-to-60", "240 Hz capture, 60 fps target", 240.0, 240, 60},
+        {"240-to-120", "240 Hz capture with +/-0.5 ms jitter, 120 fps target", 240.0, 240, 120, 500},
+        {"skips-60", "60 Hz capture, 10% of vsyncs without a new frame", 60.0, 60, 60, 0, 0.0, 0.10},
+        // Presentation off any grid: late encodes are inherent, the limit only catches regressions.
+        {"vrr-48-144", "Variable refresh between 48 and 144 Hz, 60 fps target", 144.0, 144, 60, 0, 48.0, 0.0, 0.2},
+    };
+
+    struct Args {
+        std::vector<std::string> only;
+        double seconds = 60.0;
+        int64_t encodeUs = 4000;
+        int64_t deliveryUs = 600;
+        uint64_t seed = 1;
+        bool check = false;
+        std::string output;
+    };
+
+    struct CaptureFrame {
+        int64_t ts = 0;
+        int64_t arrival = 0;
+    };
+
+    std::vector<CaptureFrame> GenerateCapture(const Scenario& sc, const Args& args, Rng& rng) {
+        std::vector<CaptureFrame> frames;
+        const double vsyncUs = 1e6 / sc.captureHz;
+        const int64_t endUs = static_cast<int64_t>(args.seconds * 1e6);
+        const int64_t startUs = 1'000'000;
+        double t = static_cast<double>(startUs);
+        while (t < static_cast<double>(startUs + endUs)) {
+            if (sc.vrrMinHz > 0.0) {
+                t += vsyncUs + rng.Unit() * (1e6 / sc.vrrMinHz - vsyncUs);
+            } else {
+                t += vsyncUs;
+                if (sc.skipShare > 0.0 && rng.Unit() < sc.skipShare) continue;
+            }
+            int64_t ts = static_cast<int64_t>(std::llround(t));
+            if (sc.jitterUs > 0) ts += rng.Range(-sc.jitterUs, sc.jitterUs);
+            if (!frames.empty() && ts <= frames.back().ts) ts = frames.back().ts + 1;
+            frames.push_back({ts, ts + args.deliveryUs});
+        }
+        return frames;
+    }
+
+    double Percentile(std::vector<double> values, double p) {
+        if (values.empty()) return 0.0;
+        std::sort(values.begin(), values.end());
+        const size_t index = std::min(values.size() - 1, static_cast<size_t>(p * (values.size() - 1) + 0.5));
+        return values[index];
+    }
+
+    // The encoder thread: Pop (latest wins while it was busy), Offer, Due, encode.
+    json Simulate(const Scenario& sc, const Args& args, const std::vector<CaptureFrame>& frames, int refreshHint) {
+        VirtualClock clock;
+        SetClock(&clock);
+        FrameScheduler scheduler;
+        scheduler.SetPeriod(1000000 / sc.targetFps);
+        scheduler.SetRefreshHint(refreshHint);
+
+        int64_t busyUntil = 0;
+        std::vector<double> intervals, latencies;
+        int64_t heldTs = 0, lastEncodedTs = 0;
+        uint64_t mailboxDrops = 0;
+
+        for (size_t i = 0; i < frames.size(); i++) {
+            // A frame that arrives while encoding is replaced if another arrives first.
+            const int64_t popAt = std::max(frames[i].arrival, busyUntil);
+            if (i + 1 < frames.size() && frames[i + 1].arrival <= popAt) {
+                mailboxDrops++;
+                continue;
+            }
+            clock.Set(popAt);
+            const int64_t now = GetTimestamp();
+            const FrameOffer offer = scheduler.Offer(frames[i].ts, now, false, 0);
+            if (offer == FrameOffer::Dropped) continue;
+            if (offer != FrameOffer::Superseded) heldTs = frames[i].ts;
+            if (scheduler.Due(now) != FrameDue::Encode) continue;
+            busyUntil = now + args.encodeUs;
+            latencies.push_back(static_cast<double>(now - heldTs) / 1000.0);
+            if (lastEncodedTs > 0) intervals.push_back(static_cast<double>(heldTs - lastEncodedTs) / 1000.0);
+            lastEncodedTs = heldTs;
+        }
+        SetClock(nullptr);
+
+        const auto& stats = scheduler.Stats();
+        const double spanS = frames.size() > 1 ? static_cast<double>(frames.back().ts - frames.front().ts) / 1e6 : 1.0;
+        const double captureFps = static_cast<double>(frames.size()) / spanS;
+        const double expectedFps = std::min(static_cast<double>(sc.targetFps), captureFps);
+        const double encodedFps = static_cast<double>(stats.encoded) / spanS;
+        double mean = 0.0, var = 0.0;
+        for (double v : intervals) mean += v;
+        if (!intervals.empty()) mean /= static_cast<double>(intervals.size());
+        for (double v : intervals) var += (v - mean) * (v - mean);
+        if (!intervals.empty()) var /= static_cast<double>(intervals.size());
+
+        return {
+            {"refreshHint", refreshHint},
+            {"aligned", stats.aligned},
+            {"captureFps", captureFps},
+            {"encodedFps", encodedFps},
+            {"rateShare", expectedFps > 0.0 ? encodedFps / expectedFps : 0.0},
+            {"deadlineMisses", stats.deadlineMisses},
+            {"missShare", stats.encoded > 0 ? static_cast<double>(stats.deadlineMisses) / static_cast<double>(stats.encoded) : 0.0},
+            {"stale", stats.stale},
+            {"tooOld", stats.tooOld},
+            {"superseded", stats.superseded},
+            {"mailboxDrops", mailboxDrops},
+            {"intervalMs", {{"mean", mean}, {"stddev", std::sqrt(var)}, {"p99", Percentile(intervals, 0.99)}}},
+            {"latencyMs", {{"p50", Percentile(latencies, 0.5)}, {"p99", Percentile(latencies, 0.99)}}},
+            {"jitterUs", stats.jitterUs},
+            {"driftUs", stats.driftUs}
+        };
+    }
+
+    void PrintUsage() {
+        fprintf(stderr,
+            "Usage: slipstream_pacing [options]\n"
+            "  --scenario LIST      scenarios to run (default: all)\n"
+            "  --list               print the scenarios and exit\n"
+            "  --seconds N          simulated seconds per scenario (default: 60)\n"
+            "  --encode-us N        encode time per frame (default: 4000)\n"
+            "  --delivery-us N      capture timestamp to encoder wake-up (default: 600)\n"
+            "  --seed N             jitter/VRR seed (default: 1)\n"
+            "  --check              exit non-zero if a scenario misses its limits\n"
+            "  --output FILE        write JSON here instead of stdout\n");
+    }
+
+    bool ParseArgs(int argc, char* argv[], Args& args) {
+        for (int i = 1; i < argc; ++i) {
+            const std::string arg = argv[i];
+            if (arg == "--help" || arg == "-h") return false;
+            if (arg == "--check") { args.check = true; continue; }
+            if (arg == "--list") {
+                for (const auto& sc : kScenarios) printf("%-18s %s\n", sc.name, sc.description);
+                exit(0);
+            }
+            if (i + 1 >= argc) {
+                ERR("Missing value for %s", arg.c_str());
+                return false;
+            }
+            const std::string value = argv[++i];
+            if (arg == "--scenario") {
+                std::stringstream ss(value);
+                for (std::string item; std::getline(ss, item, ',');) args.only.push_back(item);
+            } else if (arg == "--seconds") {
+                args.seconds = std::clamp(atof(value.c_str()), 1.0, 3600.0);
+            } else if (arg == "--encode-us") {
+                args.encodeUs = std::clamp<int64_t>(atoll(value.c_str()), 0, 1000000);
+            } else if (arg == "--delivery-us") {
+                args.deliveryUs = std::clamp<int64_t>(atoll(value.c_str()), 0, 1000000);
+            } else if (arg == "--seed") {
+                args.seed = std::strtoull(value.c_str(), nullptr, 10);
+            } else if (arg == "--output") {
+                args.output = value;
+            } else {
+                ERR("Unknown option %s", arg.c_str());
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    Args args;
+    if (!ParseArgs(argc, argv, args)) {
+        PrintUsage();
+        return 2;
+    }
+
+    json report = {{"seconds", args.seconds}, {"encodeUs", args.encodeUs}, {"deliveryUs", args.deliveryUs}, {"seed", args.seed}};
+    bool passed = true;
+    for (const auto& sc : kScenarios) {
+        if (!args.only.empty() && std::find(args.only.begin(), args.only.end(), sc.name) == args.only.end()) continue;
+        Rng rng(args.seed);
+        const auto frames = GenerateCapture(sc, args, rng);
+        json run = {{"scenario", sc.name}, {"description", sc.description}, {"targetFps", sc.targetFps},
+                    {"snapped", Simulate(sc, args, frames, sc.refreshHint)},
+                    {"unsnapped", Simulate(sc, args, frames, 0)}};
+        if (args.check) {
+            const auto& r = run["snapped"];
+            const bool ok = r["missShare"].get<double>() <= sc.maxMissShare && r["rateShare"].get<double>() >= sc.minRateShare;
+            run["passed"] = ok;
+            if (!ok) {
+                ERR("Pacing: %s missed its limits (misses %.3f > %.3f or rate %.3f < %.3f)", sc.name,
+                    r["missShare"].get<double>(), sc.maxMissShare, r["rateShare"].get<double>(), sc.minRateShare);
+                passed = false;
+            }
+        }
+        report["runs"].push_back(run);
+    }
+
+    const std::string text = report.dump(2);
+    if (args.output.empty()) {
+        std::cout << text << std::endl;
+    } else {
+        std::ofstream file(args.output);
+        if (!file) {
+            ERR("Pacing: Cannot write %s", args.output.c_str());
+            return 1;
+        }
+        file << text << '\n';
+    }
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,551 @@
+// slipstream_quality: encodes reference content across sizes, frame rates and
+// bitrates through the host's software path, decodes it again and measures
+// PSNR/SSIM (and VMAF when available). Emits rate-distortion curves and a fitted
+// bitrate_model.json that VideoEncoder loads in place of the built-in factors.
+// With --roi, every point is encoded a second time with a QP offset on a centred
+// box, and luma PSNR inside and outside that box is reported for both encodes.
+
+#include "../common/encode_session.hpp"
+#include "metrics.hpp"
+
+#include "host/core/logging.hpp"
+#include "host/media/capture_source.hpp"
+
+#include <nlohmann/json.hpp>
+
+extern "C" {
+#include <libavutil/log.h>
+#include <libswscale/swscale.h>
+}
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+using json = nlohmann::json;
+
+namespace {
+    enum class Metric { Psnr, Ssim, Vmaf };
+
+    struct ContentInput {
+        std::string label, path, pattern;
+    };
+
+    struct QualityArgs {
+        std::vector<ContentInput> inputs;
+        std::vector<std::pair<int, int>> sizes{{1280, 720}, {1920, 1080}, {2560, 1440}};
+        std::vector<int> fpsList{60};
+        std::vector<CodecType> codecs{CODEC_H264, CODEC_H265, CODEC_AV1};
+        std::vector<double> rates{0.25, 0.5, 0.75, 1.0, 1.5, 2.0};
+        std::string encoder, output, modelOut;
+        int frames = 120;
+        Metric metric = Metric::Psnr;
+        double target = 0.0;
+        ContentProfile profile = ContentProfile::Default;
+        // Fit each curve with both the default and the screen profile.
+        bool compareProfiles = false;
+        // 0 = no ROI comparison; otherwise AVRegionOfInterest::qoffset in hundredths.
+        int roiQOffset = 0;
+        int roiRadius = 160;
+    };
+
+    struct RdPoint {
+        int64_t requestedBps = 0;
+        double actualBps = 0.0, psnrY = 0.0, psnrYuv = 0.0, ssimY = 0.0, vmaf = -1.0;
+        double psnrRoiY = 0.0, psnrOutsideY = 0.0;
+        int decodedFrames = 0;
+    };
+
+    std::vector<std::string> SplitList(const std::string& value) {
+        std::vector<std::string> items;
+        std::stringstream ss(value);
+        for (std::string item; std::getline(ss, item, ',');) items.push_back(item);
+        return items;
+    }
+
+    const char* CodecKey(CodecType codec) {
+        return codec == CODEC_AV1 ? "av1" : codec == CODEC_H265 ? "h265" : "h264";
+    }
+
+    const char* MetricKey(Metric metric) {
+        return metric == Metric::Vmaf ? "vmaf" : metric == Metric::Ssim ? "ssim" : "psnr";
+    }
+
+    double DefaultTarget(Metric metric) {
+        return metric == Metric::Vmaf ? 93.0 : metric == Metric::Ssim ? 0.97 : 40.0;
+    }
+
+    void PrintUsage() {
+        fprintf(stderr,
+            "Usage: slipstream_quality [options]\n"
+            "  --input LABEL=FILE   reference clip (.y4m), repeatable; label e.g. desktop, game, video\n"
+            "  --synthetic LIST     synthetic content when no --input is given (default: static,scroll,gradient,noise)\n"
+            "  --sizes LIST         WxH list (default: 1280x720,1920x1080,2560x1440)\n"
+            "  --fps LIST           frame rates (default: 60)\n"
+            "  --codec LIST         h264,h265,av1 (default: all)\n"
+            "  --encoder NAME       software encoder to use (default: the host's choice per codec)\n"
+            "  --rates LIST         bitrate multipliers of CalcBitrate (default: 0.25,0.5,0.75,1,1.5,2)\n"
+            "  --frames N           frames per point (default: 120)\n"
+            "  --metric NAME        psnr, ssim or vmaf used for fitting (default: psnr)\n"
+            "  --target VALUE       quality to hit (default: psnr 40, ssim 0.97, vmaf 93)\n"
+            "  --profile NAME       default or screen\n"
+            "  --compare-profiles   fit every curve with the default and the screen profile\n"
+            "  --roi QOFFSET        also encode with this ROI offset (-100..100) on a centred box\n"
+            "  --roi-radius N       half-size of the ROI box in pixels (default: 160, the cursor box)\n"
+            "  --output FILE        JSON report (default: stdout)\n"
+            "  --model-out FILE     write the fitted bitrate_model.json\n");
+    }
+
+    bool ParseArgs(int argc, char* argv[], QualityArgs& args) {
+        std::vector<std::string> synthetic{"static", "scroll", "gradient", "noise"};
+        for (int i = 1; i < argc; ++i) {
+            const std::string arg = argv[i];
+            if (arg == "--help" || arg == "-h") return false;
+            if (arg == "--debug") { g_debugLogging = true; continue; }
+            if (arg == "--compare-profiles") { args.compareProfiles = true; continue; }
+            if (i + 1 >= argc) {
+                ERR("Missing value for %s", arg.c_str());
+                return false;
+            }
+            const std::string value = argv[++i];
+            if (arg == "--input") {
+                const size_t eq = value.find('=');
+                if (eq == std::string::npos) args.inputs.push_back({"clip", value, {}});
+                else args.inputs.push_back({value.substr(0, eq), value.substr(eq + 1), {}});
+            } else if (arg == "--synthetic") {
+                synthetic = SplitList(value);
+            } else if (arg == "--sizes") {
+                args.sizes.clear();
+                for (const auto& item : SplitList(value)) {
+                    int w = 0, h = 0;
+                    if (sscanf(item.c_str(), "%dx%d", &w, &h) != 2 || w <= 0 || h <= 0) return false;
+                    args.sizes.emplace_back(w, h);
+                }
+            } else if (arg == "--fps") {
+                args.fpsList.clear();
+                for (const auto& item : SplitList(value)) args.fpsList.push_back(std::clamp(atoi(item.c_str()), 1, 240));
+            } else if (arg == "--codec") {
+                args.codecs.clear();
+                for (const auto& item : SplitList(value)) {
+                    if (item == "h264") args.codecs.push_back(CODEC_H264);
+                    else if (item == "h265" || item == "hevc") args.codecs.push_back(CODEC_H265);
+                    else if (item == "av1") args.codecs.push_back(CODEC_AV1);
+                    else return false;
+                }
+            } else if (arg == "--encoder") {
+                args.encoder = value;
+            } else if (arg == "--rates") {
+                args.rates.clear();
+                for (const auto& item : SplitList(value)) args.rates.push_back(std::max(0.01, atof(item.c_str())));
+                std::sort(args.rates.begin(), args.rates.end());
+            } else if (arg == "--frames") {
+                args.frames = std::max(1, atoi(value.c_str()));
+            } else if (arg == "--metric") {
+                if (value == "psnr") args.metric = Metric::Psnr;
+                else if (value == "ssim") args.metric = Metric::Ssim;
+                else if (value == "vmaf") args.metric = Metric::Vmaf;
+                else return false;
+            } else if (arg == "--target") {
+                args.target = atof(value.c_str());
+            } else if (arg == "--profile") {
+                args.profile = value == "screen" ? ContentProfile::Screen : ContentProfile::Default;
+            } else if (arg == "--roi") {
+                args.roiQOffset = std::clamp(atoi(value.c_str()), -100, 100);
+            } else if (arg == "--roi-radius") {
+                args.roiRadius = std::clamp(atoi(value.c_str()), 16, 4096);
+            } else if (arg == "--output") {
+                args.output = value;
+            } else if (arg == "--model-out") {
+                args.modelOut = value;
+            } else {
+                ERR("Unknown option %s", arg.c_str());
+                return false;
+            }
+        }
+        if (args.inputs.empty()) {
+            for (const auto& pattern : synthetic) args.inputs.push_back({pattern, {}, pattern});
+        }
+        if (args.metric == Metric::Vmaf && !VmafScorer::Available()) {
+            ERR("Built without libvmaf; use --metric psnr or ssim");
+            return false;
+        }
+        if (args.target <= 0.0) args.target = DefaultTarget(args.metric);
+        return true;
+    }
+
+    const AVCodec* FindDecoder(CodecType codec) {
+        if (codec == CODEC_AV1) {
+            for (const char* name : {"libdav1d", "libaom-av1"}) {
+                if (const AVCodec* dec = avcodec_find_decoder_by_name(name)) return dec;
+            }
+        }
+        return avcodec_find_decoder(GetCodecId(codec));
+    }
+
+    // Produces source frames at the requested size, rescaling file input when needed.
+    class ScaledSource {
+        std::unique_ptr<CaptureSource> source;
+        SwsContext* resize = nullptr;
+        std::vector<uint8_t> native;
+        int w = 0, h = 0;
+
+    public:
+        ~ScaledSource() { sws_freeContext(resize); }
+
+        bool Open(const ContentInput& input, int width, int height) {
+            w = width;
+            h = height;
+            source = input.path.empty() ? CreateSyntheticSource(input.pattern, w, h) : OpenY4MSource(input.path);
+            if (!source) return false;
+            if (source->Width() != w || source->Height() != h) {
+                resize = sws_getContext(source->Width(), source->Height(), AV_PIX_FMT_BGRA, w, h, AV_PIX_FMT_BGRA,
+                                        SWS_BICUBIC, nullptr, nullptr, nullptr);
+                if (!resize) return false;
+            }
+            return true;
+        }
+
+        bool Read(std::vector<uint8_t>& bgra) {
+            if (!resize) return source->Read(bgra);
+            if (!source->Read(native)) return false;
+            bgra.resize(static_cast<size_t>(w) * h * 4);
+            const uint8_t* src[4] = {native.data(), nullptr, nullptr, nullptr};
+            const int srcStride[4] = {source->Width() * 4, 0, 0, 0};
+            uint8_t* dst[4] = {bgra.data(), nullptr, nullptr, nullptr};
+            const int dstStride[4] = {w * 4, 0, 0, 0};
+            return sws_scale(resize, src, srcStride, 0, source->Height(), dst, dstStride) == h;
+        }
+    };
+
+    class QualityPointRunner {
+        AVCodecContext* dec = nullptr;
+        AVFrame* decoded = nullptr;
+        SwsContext* toRef = nullptr;
+        SwsContext* toDist = nullptr;
+        AVPixelFormat distFormat = AV_PIX_FMT_NONE;
+        std::deque<Yuv420Image> pending;
+        Yuv420Image dist;
+        RdPoint sums;
+        int w = 0, h = 0;
+        VmafScorer* vmaf = nullptr;
+        const AVRegionOfInterest* region = nullptr;
+
+        static void ConvertInto(SwsContext* sws, const uint8_t* const src[], const int srcStride[], int height, Yuv420Image& out) {
+            uint8_t* dst[4] = {out.y.data(), out.u.data(), out.v.data(), nullptr};
+            const int dstStride[4] = {out.width, out.ChromaWidth(), out.ChromaWidth(), 0};
+            sws_scale(sws, src, srcStride, 0, height, dst, dstStride);
+        }
+
+        void Score() {
+            if (pending.empty()) return;
+            const FrameQuality q = CompareFrames(pending.front(), dist);
+            if (vmaf) vmaf->Add(pending.front(), dist);
+            if (region) {
+                const RegionQuality rq = CompareRegion(pending.front(), dist, region->left, region->top, region->right, region->bottom);
+                sums.psnrRoiY += rq.psnrInsideY;
+                sums.psnrOutsideY += rq.psnrOutsideY;
+            }
+            pending.pop_front();
+            sums.psnrY += q.psnrY;
+            sums.psnrYuv += q.psnrYuv;
+            sums.ssimY += q.ssimY;
+            sums.decodedFrames++;
+        }
+
+        void ReceiveFrames() {
+            while (avcodec_receive_frame(dec, decoded) == 0) {
+                const auto format = static_cast<AVPixelFormat>(decoded->format);
+                if (!toDist || format != distFormat) {
+                    sws_freeContext(toDist);
+                    toDist = sws_getContext(decoded->width, decoded->height, format, w, h, AV_PIX_FMT_YUV420P,
+                                            SWS_POINT, nullptr, nullptr, nullptr);
+                    distFormat = format;
+                }
+                if (toDist) {
+                    ConvertInto(toDist, decoded->data, decoded->linesize, decoded->height, dist);
+                    Score();
+                }
+                av_frame_unref(decoded);
+            }
+        }
+
+    public:
+        ~QualityPointRunner() {
+            sws_freeContext(toRef);
+            sws_freeContext(toDist);
+            av_frame_free(&decoded);
+            if (dec) avcodec_free_context(&dec);
+        }
+
+        // roi, when given, is scored separately and must outlive the runner.
+        bool Open(CodecType codec, int width, int height, VmafScorer* scorer, const AVRegionOfInterest* roi) {
+            w = width;
+            h = height;
+            vmaf = scorer;
+            region = roi;
+            const AVCodec* decoder = FindDecoder(codec);
+            if (!decoder || !(dec = avcodec_alloc_context3(decoder)) || avcodec_open2(dec, decoder, nullptr) < 0) {
+                ERR("Quality: No usable %s decoder", CodecKey(codec));
+                return false;
+            }
+            decoded = av_frame_alloc();
+            dist.Resize(w, h);
+            // Same conversion the encoder session applies, so the reference is the encoder's input.
+            toRef = sws_getContext(w, h, AV_PIX_FMT_BGRA, w, h, AV_PIX_FMT_YUV420P, SWS_BILINEAR, nullptr, nullptr, nullptr);
+            return decoded && toRef;
+        }
+
+        void AddReference(const std::vector<uint8_t>& bgra) {
+            Yuv420Image ref;
+            ref.Resize(w, h);
+            const uint8_t* src[4] = {bgra.data(), nullptr, nullptr, nullptr};
+            const int srcStride[4] = {w * 4, 0, 0, 0};
+            ConvertInto(toRef, src, srcStride, h, ref);
+            pending.push_back(std::move(ref));
+        }
+
+        void Decode(const EncodedFrame& frame) {
+            for (AVPacket* packet : frame.packets) {
+                if (avcodec_send_packet(dec, packet) < 0) continue;
+                ReceiveFrames();
+            }
+        }
+
+        RdPoint Finish() {
+            avcodec_send_packet(dec, nullptr);
+            ReceiveFrames();
+            RdPoint point = sums;
+            if (point.decodedFrames > 0) {
+                point.psnrY /= point.decodedFrames;
+                point.psnrYuv /= point.decodedFrames;
+                point.ssimY /= point.decodedFrames;
+                point.psnrRoiY /= point.decodedFrames;
+                point.psnrOutsideY /= point.decodedFrames;
+            }
+            return point;
+        }
+    };
+
+    // The box scored with --roi, centred like a cursor in the middle of the screen.
+    AVRegionOfInterest CentredRoi(const QualityArgs& args, int w, int h) {
+        AVRegionOfInterest region{};
+        region.self_size = sizeof(AVRegionOfInterest);
+        region.left = std::max(0, w / 2 - args.roiRadius);
+        region.right = std::min(w, w / 2 + args.roiRadius);
+        region.top = std::max(0, h / 2 - args.roiRadius);
+        region.bottom = std::min(h, h / 2 + args.roiRadius);
+        region.qoffset = {args.roiQOffset, 100};
+        return region;
+    }
+
+    // applyRoi attaches the --roi box as side data. Both encodes of a --roi run use
+    // the same encoder options, so only the side data differs between them.
+    bool RunPoint(const QualityArgs& args, const ContentInput& input, CodecType codec, int w, int h, int fps,
+                  int64_t bitrate, bool applyRoi, ContentProfile profile, RdPoint& point, std::string& encoderName) {
+        ScaledSource source;
+        if (!source.Open(input, w, h)) return false;
+
+        SoftwareEncoderOptions opts;
+        opts.profile = profile;
+        opts.roi = args.roiQOffset != 0;
+        EncodeSession session;
+        if (!session.Open(codec, args.encoder, w, h, fps, opts, bitrate)) return false;
+        encoderName = session.EncoderName();
+        const AVRegionOfInterest roi = CentredRoi(args, w, h);
+        if (applyRoi) session.SetRegionsOfInterest({roi});
+
+        std::unique_ptr<VmafScorer> vmaf;
+        if (VmafScorer::Available()) vmaf = std::make_unique<VmafScorer>(w, h);
+        QualityPointRunner runner;
+        if (!runner.Open(codec, w, h, vmaf.get(), opts.roi ? &roi : nullptr)) return false;
+
+        std::vector<uint8_t> bgra;
+        EncodedFrame out;
+        size_t totalBytes = 0;
+        int sourceFrames = 0;
+        for (int i = 0; i < args.frames; ++i) {
+            if (!source.Read(bgra)) break;
+            sourceFrames++;
+            out.Clear();
+            bool gotKey = false;
+            if (!session.Encode(bgra.data(), static_cast<size_t>(w) * 4, i == 0, out, gotKey)) return false;
+            runner.AddReference(bgra);
+            totalBytes += out.size;
+            runner.Decode(out);
+        }
+        out.Clear();
+        bool gotKey = false;
+        session.Flush(out, gotKey);
+        totalBytes += out.size;
+        runner.Decode(out);
+
+        point = runner.Finish();
+        point.requestedBps = bitrate;
+        point.actualBps = sourceFrames > 0 ? static_cast<double>(totalBytes) * 8.0 * fps / sourceFrames : 0.0;
+        if (vmaf) point.vmaf = vmaf->Finish();
+        return point.decodedFrames > 0;
+    }
+
+    double MetricValue(const RdPoint& point, Metric metric) {
+        return metric == Metric::Vmaf ? point.vmaf : metric == Metric::Ssim ? point.ssimY : point.psnrY;
+    }
+
+    // Bitrate at which the curve reaches target, interpolating quality against
+    // log(actual bitrate). Clamps to the measured range when the target is not bracketed.
+    double FitBitrate(const std::vector<RdPoint>& points, Metric metric, double target, bool& reached) {
+        reached = false;
+        std::vector<const RdPoint*> sorted;
+        for (const auto& p : points) if (p.actualBps > 0.0) sorted.push_back(&p);
+        if (sorted.empty()) return 0.0;
+        std::sort(sorted.begin(), sorted.end(), [](const RdPoint* a, const RdPoint* b) { return a->actualBps < b->actualBps; });
+
+        if (MetricValue(*sorted.front(), metric) >= target) {
+            reached = true;
+            return sorted.front()->actualBps;
+        }
+        for (size_t i = 1; i < sorted.size(); ++i) {
+            const double q0 = MetricValue(*sorted[i - 1], metric), q1 = MetricValue(*sorted[i], metric);
+            if (q1 < target || q1 <= q0) continue;
+            const double t = (target - q0) / (q1 - q0);
+            const double l0 = std::log(sorted[i - 1]->actualBps), l1 = std::log(sorted[i]->actualBps);
+            reached = true;
+            return std::exp(l0 + (l1 - l0) * t);
+        }
+        return sorted.back()->actualBps;
+    }
+
+    double Median(std::vector<double> values) {
+        if (values.empty()) return 0.0;
+        std::sort(values.begin(), values.end());
+        const size_t mid = values.size() / 2;
+        return values.size() % 2 ? values[mid] : (values[mid - 1] + values[mid]) / 2.0;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    QualityArgs args;
+    if (!ParseArgs(argc, argv, args)) {
+        PrintUsage();
+        return 2;
+    }
+    av_log_set_level(AV_LOG_ERROR);
+
+    json curves = json::array();
+    // codec -> pixel count -> fitted factors across content and frame rates
+    std::map<CodecType, std::map<int64_t, std::vector<double>>> fitted;
+
+    for (const auto& input : args.inputs) {
+        for (const auto& [w, h] : args.sizes) {
+            for (int fps : args.fpsList) {
+                for (CodecType codec : args.codecs) {
+                    const int64_t baseline = CalcBitrate(codec, w, h, fps);
+                    const ContentProfile profile = args.compareProfiles ? ContentProfile::Default : args.profile;
+                    std::vector<RdPoint> points, screenPoints;
+                    std::string encoderName;
+                    json curve = {{"content", input.label}, {"codec", CodecKey(codec)}, {"width", w}, {"height", h},
+                                  {"fps", fps}, {"baselineBps", baseline}, {"points", json::array()}};
+
+                    for (double rate : args.rates) {
+                        const auto bitrate = static_cast<int64_t>(static_cast<double>(baseline) * rate);
+                        LOG("Quality: %s %dx%d@%d %s at %.2f Mbps", input.label.c_str(), w, h, fps, CodecKey(codec), bitrate / 1e6);
+                        RdPoint point;
+                        if (!RunPoint(args, input, codec, w, h, fps, bitrate, false, profile, point, encoderName)) {
+                            WARN("Quality: Point failed (%s %s %dx%d)", input.label.c_str(), CodecKey(codec), w, h);
+                            continue;
+                        }
+                        points.push_back(point);
+                        json p = {{"rate", rate}, {"requestedBps", point.requestedBps}, {"actualBps", point.actualBps},
+                                  {"psnrY", point.psnrY}, {"psnrYuv", point.psnrYuv}, {"ssimY", point.ssimY}};
+                        if (point.vmaf >= 0.0) p["vmaf"] = point.vmaf;
+                        if (args.roiQOffset != 0) {
+                            p["psnrRoiY"] = point.psnrRoiY;
+                            p["psnrOutsideY"] = point.psnrOutsideY;
+                            RdPoint withRoi;
+                            if (RunPoint(args, input, codec, w, h, fps, bitrate, true, profile, withRoi, encoderName)) {
+                                p["withRoi"] = {{"actualBps", withRoi.actualBps}, {"psnrY", withRoi.psnrY},
+                                                {"psnrRoiY", withRoi.psnrRoiY}, {"psnrOutsideY", withRoi.psnrOutsideY}};
+                            }
+                        }
+                        if (args.compareProfiles) {
+                            RdPoint screen;
+                            if (RunPoint(args, input, codec, w, h, fps, bitrate, false, ContentProfile::Screen, screen, encoderName)) {
+                                screenPoints.push_back(screen);
+                                p["screen"] = {{"actualBps", screen.actualBps}, {"psnrY", screen.psnrY}, {"ssimY", screen.ssimY}};
+                                if (screen.vmaf >= 0.0) p["screen"]["vmaf"] = screen.vmaf;
+                            }
+                        }
+                        curve["points"].push_back(p);
+                    }
+                    curve["encoder"] = encoderName;
+                    if (args.roiQOffset != 0) {
+                        const AVRegionOfInterest roi = CentredRoi(args, w, h);
+                        const bool applied = SupportsRegionsOfInterest(encoderName);
+                        if (!applied) WARN("Quality: %s ignores ROI side data; withRoi matches the plain encode", encoderName.c_str());
+                        curve["roi"] = {{"qoffset", args.roiQOffset}, {"left", roi.left}, {"top", roi.top},
+                                        {"right", roi.right}, {"bottom", roi.bottom}, {"applied", applied}};
+                    }
+
+                    bool reached = false;
+                    const double bitrate = FitBitrate(points, args.metric, args.target, reached);
+                    if (bitrate > 0.0) {
+                        const double factor = bitrate / (static_cast<double>(w) * h * CalcEffectiveFps(fps));
+                        curve["fit"] = {{"bitrateBps", bitrate}, {"factor", factor}, {"reached", reached}};
+                        if (reached) fitted[codec][static_cast<int64_t>(w) * h].push_back(factor);
+                    }
+                    if (args.compareProfiles) {
+                        // Bitrate each profile needs for --target; the screen profile's saving at equal quality.
+                        bool defaultReached = false, screenReached = false;
+                        const double defaultBps = FitBitrate(points, args.metric, args.target, defaultReached);
+                        const double screenBps = FitBitrate(screenPoints, args.metric, args.target, screenReached);
+                        curve["profiles"] = {{"defaultBps", defaultBps}, {"screenBps", screenBps},
+                                             {"reached", defaultReached && screenReached},
+                                             {"screenSaving", defaultBps > 0.0 ? 1.0 - screenBps / defaultBps : 0.0}};
+                    }
+                    curves.push_back(curve);
+                }
+            }
+        }
+    }
+
+    json model = {{"version", 1}, {"metric", MetricKey(args.metric)}, {"target", args.target}, {"codecs", json::object()}};
+    json builtin = json::object();
+    for (CodecType codec : args.codecs) {
+        builtin[CodecKey(codec)] = CalcCodecBitrateFactor(codec);
+        json codecPoints = json::array();
+        for (const auto& [pixels, factors] : fitted[codec]) {
+            codecPoints.push_back({{"pixels", pixels}, {"factor", Median(factors)}, {"samples", factors.size()}});
+        }
+        if (!codecPoints.empty()) model["codecs"][CodecKey(codec)] = codecPoints;
+    }
+
+    json report = {{"tool", "slipstream_quality"}, {"frames", args.frames}, {"vmafAvailable", VmafScorer::Available()},
+                   {"builtinFactors", builtin}, {"curves", curves}, {"model", model}};
+
+    if (!args.modelOut.empty()) {
+        std::ofstream file(args.modelOut);
+        if (!file) {
+            ERR("Quality: Cannot write %s", args.modelOut.c_str());
+            return 1;
+        }
+        file << model.dump(2) << '\n';
+        LOG("Quality: Wrote bitrate model to %s", args.modelOut.c_str());
+    }
+
+    const std::string text = report.dump(2);
+    if (args.output.empty()) {
+        std::cout << text << std::endl;
+    } else {
+        std::ofstream file(args.output);
+        if (!file) {
+            ERR("Quality: Cannot write %s", args.output.c_str());
+            return 1;
+        }
+        file << text << '\n';
+    }
+    return 0;
+}
@@ -0,0 +1,189 @@
+#include "metrics.hpp"
+
+#include "host/core/logging.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#ifdef SLIPSTREAM_HAVE_LIBVMAF
+extern "C" {
+#include <libvmaf/libvmaf.h>
+}
+#endif
+
+namespace {
+    constexpr double kMaxPsnr = 100.0;
+
+    double PlaneMse(const uint8_t* a, const uint8_t* b, size_t count) {
+        uint64_t sum = 0;
+        for (size_t i = 0; i < count; ++i) {
+            const int d = static_cast<int>(a[i]) - static_cast<int>(b[i]);
+            sum += static_cast<uint64_t>(d * d);
+        }
+        return count ? static_cast<double>(sum) / static_cast<double>(count) : 0.0;
+    }
+
+    double MseToPsnr(double mse) {
+        return mse <= 0.0 ? kMaxPsnr : std::min(kMaxPsnr, 10.0 * std::log10(255.0 * 255.0 / mse));
+    }
+
+    // Mean SSIM over 8x8 windows placed every 4 pixels.
+    double PlaneSsim(const uint8_t* a, const uint8_t* b, int width, int height) {
+        constexpr int kWindow = 8;
+        constexpr int kStep = 4;
+        constexpr double c1 = (0.01 * 255) * (0.01 * 255);
+        constexpr double c2 = (0.03 * 255) * (0.03 * 255);
+        constexpr double n = kWindow * kWindow;
+        double total = 0.0;
+        int windows = 0;
+
+        for (int y = 0; y + kWindow <= height; y += kStep) {
+            for (int x = 0; x + kWindow <= width; x += kStep) {
+                uint32_t sa = 0, sb = 0;
+                uint64_t saa = 0, sbb = 0, sab = 0;
+                for (int wy = 0; wy < kWindow; ++wy) {
+                    const uint8_t* ra = a + static_cast<size_t>(y + wy) * width + x;
+                    const uint8_t* rb = b + static_cast<size_t>(y + wy) * width + x;
+                    for (int wx = 0; wx < kWindow; ++wx) {
+                        sa += ra[wx];
+                        sb += rb[wx];
+                        saa += ra[wx] * ra[wx];
+                        sbb += rb[wx] * rb[wx];
+                        sab += ra[wx] * rb[wx];
+                    }
+                }
+                const double ma = sa / n, mb = sb / n;
+                const double va = saa / n - ma * ma;
+                const double vb = sbb / n - mb * mb;
+                const double cov = sab / n - ma * mb;
+                total += ((2 * ma * mb + c1) * (2 * cov + c2)) / ((ma * ma + mb * mb + c1) * (va + vb + c2));
+                windows++;
+            }
+        }
+        return windows ? total / windows : 1.0;
+    }
+}
+
+void Yuv420Image::Resize(int w, int h) {
+    width = w;
+    height = h;
+    y.resize(static_cast<size_t>(w) * h);
+    u.resize(static_cast<size_t>(ChromaWidth()) * ChromaHeight());
+    v.resize(u.size());
+}
+
+FrameQuality CompareFrames(const Yuv420Image& ref, const Yuv420Image& dist) {
+    FrameQuality q;
+    if (ref.width != dist.width || ref.height != dist.height) return q;
+
+    const double mseY = PlaneMse(ref.y.data(), dist.y.data(), ref.y.size());
+    const double mseU = PlaneMse(ref.u.data(), dist.u.data(), ref.u.size());
+    const double mseV = PlaneMse(ref.v.data(), dist.v.data(), ref.v.size());
+    q.psnrY = MseToPsnr(mseY);
+    q.psnrYuv = (6.0 * q.psnrY + MseToPsnr(mseU) + MseToPsnr(mseV)) / 8.0;
+    q.ssimY = PlaneSsim(ref.y.data(), dist.y.data(), ref.width, ref.height);
+    return q;
+}
+
+RegionQuality CompareRegion(const Yuv420Image& ref, const Yuv420Image& dist, int left, int top, int right, int bottom) {
+    RegionQuality q;
+    if (ref.width != dist.width || ref.height != dist.height) return q;
+    left = std::clamp(left, 0, ref.width);
+    right = std::clamp(right, left, ref.width);
+    top = std::clamp(top, 0, ref.height);
+    bottom = std::clamp(bottom, top, ref.height);
+
+    uint64_t inside = 0, total = 0;
+    size_t insideCount = 0;
+    for (int y = 0; y < ref.height; ++y) {
+        const uint8_t* a = ref.y.data() + static_cast<size_t>(y) * ref.width;
+        const uint8_t* b = dist.y.data() + static_cast<size_t>(y) * ref.width;
+        for (int x = 0; x < ref.width; ++x) {
+            const int d = static_cast<int>(a[x]) - static_cast<int>(b[x]);
+            const auto sq = static_cast<uint64_t>(d * d);
+            total += sq;
+            if (y >= top && y < bottom && x >= left && x < right) {
+                inside += sq;
+                insideCount++;
+            }
+        }
+    }
+    const size_t outsideCount = ref.y.size() - insideCount;
+    q.psnrInsideY = MseToPsnr(insideCount ? static_cast<double>(inside) / static_cast<double>(insideCount) : 0.0);
+    q.psnrOutsideY = MseToPsnr(outsideCount ? static_cast<double>(total - inside) / static_cast<double>(outsideCount) : 0.0);
+    return q;
+}
+
+#ifdef SLIPSTREAM_HAVE_LIBVMAF
+struct VmafScorer::Impl {
+    VmafContext* vmaf = nullptr;
+    VmafModel* model = nullptr;
+    int width = 0, height = 0;
+    unsigned frames = 0;
+    bool ok = false;
+
+    bool Copy(VmafPicture& pic, const Yuv420Image& image) const {
+        if (vmaf_picture_alloc(&pic, VMAF_PIX_FMT_YUV420P, 8, width, height) != 0) return false;
+        const std::vector<uint8_t>* planes[3] = {&image.y, &image.u, &image.v};
+        for (int p = 0; p < 3; ++p) {
+            const size_t rowBytes = static_cast<size_t>(p == 0 ? image.width : image.ChromaWidth());
+            for (unsigned row = 0; row < pic.h[p]; ++row) {
+                memcpy(static_cast<uint8_t*>(pic.data[p]) + row * pic.stride[p],
+                       planes[p]->data() + row * rowBytes, rowBytes);
+            }
+        }
+        return true;
+    }
+};
+
+VmafScorer::VmafScorer(int width, int height) : impl(std::make_unique<Impl>()) {
+    impl->width = width;
+    impl->height = height;
+    VmafConfiguration cfg{};
+    cfg.log_level = VMAF_LOG_LEVEL_NONE;
+    VmafModelConfig modelCfg{};
+    modelCfg.name = "vmaf";
+    modelCfg.flags = VMAF_MODEL_FLAGS_DEFAULT;
+    impl->ok = vmaf_init(&impl->vmaf, cfg) == 0 &&
+               vmaf_model_load(&impl->model, &modelCfg, "vmaf_v0.6.1") == 0 &&
+               vmaf_use_features_from_model(impl->vmaf, impl->model) == 0;
+    if (!impl->ok) WARN("VmafScorer: libvmaf initialisation failed; VMAF disabled");
+}
+
+VmafScorer::~VmafScorer() {
+    if (impl->model) vmaf_model_destroy(impl->model);
+    if (impl->vmaf) vmaf_close(impl->vmaf);
+}
+
+bool VmafScorer::Available() { return true; }
+
+void VmafScorer::Add(const Yuv420Image& ref, const Yuv420Image& dist) {
+    if (!impl->ok) return;
+    VmafPicture refPic{}, distPic{};
+    if (!impl->Copy(refPic, ref) || !impl->Copy(distPic, dist) ||
+        vmaf_read_pictures(impl->vmaf, &refPic, &distPic, impl->frames) != 0) {
+        impl->ok = false;
+        return;
+    }
+    impl->frames++;
+}
+
+double VmafScorer::Finish() {
+    if (!impl->ok || impl->frames == 0) return -1.0;
+    double score = -1.0;
+    if (vmaf_read_pictures(impl->vmaf, nullptr, nullptr, 0) != 0 ||
+        vmaf_score_pooled(impl->vmaf, impl->model, VMAF_POOL_METHOD_MEAN, &score, 0, impl->frames - 1) != 0) {
+        return -1.0;
+    }
+    return score;
+}
+#else
+struct VmafScorer::Impl {};
+
+VmafScorer::VmafScorer(int, int) {}
+VmafScorer::~VmafScorer() = default;
+bool VmafScorer::Available() { return false; }
+void VmafScorer::Add(const Yuv420Image&, const Yuv420Image&) {}
+double VmafScorer::Finish() { return -1.0; }
+#endif
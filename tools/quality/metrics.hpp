@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Planar 8-bit 4:2:0 image; chroma planes are ceil(w/2) x ceil(h/2).
+struct Yuv420Image {
+    int width = 0, height = 0;
+    std::vector<uint8_t> y, u, v;
+
+    void Resize(int w, int h);
+    [[nodiscard]] int ChromaWidth() const { return (width + 1) / 2; }
+    [[nodiscard]] int ChromaHeight() const { return (height + 1) / 2; }
+};
+
+struct FrameQuality {
+    double psnrY = 0.0;
+    double psnrYuv = 0.0;   // 6:1:1 weighted luma/chroma PSNR
+    double ssimY = 0.0;
+};
+
+[[nodiscard]] FrameQuality CompareFrames(const Yuv420Image& ref, const Yuv420Image& dist);
+
+// Luma PSNR inside a pixel rectangle (right and bottom exclusive) and over the rest of the frame.
+struct RegionQuality {
+    double psnrInsideY = 0.0;
+    double psnrOutsideY = 0.0;
+};
+
+[[nodiscard]] RegionQuality CompareRegion(const Yuv420Image& ref, const Yuv420Image& dist,
+                                          int left, int top, int right, int bottom);
+
+// VMAF through libvmaf when the tools are built with SLIPSTREAM_HAVE_LIBVMAF;
+// otherwise Available() is false and Finish() returns a negative score.
+class VmafScorer {
+    struct Impl;
+    std::unique_ptr<Impl> impl;
+
+public:
+    VmafScorer(int width, int height);
+    ~VmafScorer();
+
+    [[nodiscard]] static bool Available();
+    void Add(const Yuv420Image& ref, const Yuv420Image& dist);
+    [[nodiscard]] double Finish();
+};
@@ -0,0 +1,360 @@
+// slipstream_samplering: checks and benchmarks the resampler output ring. "stress"
+// runs a writer and a reader thread over SampleRing with random span sizes and
+// verifies every sample, then drives SpeexResampler the way AudioCapture and
+// MicPlayback do and fails if steady state allocates. "bench" times that loop
+// against the previous growing vector with erase compaction.
+
+#include "host/core/audio_resampler.hpp"
+#include "host/core/logging.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+using json = nlohmann::json;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+    std::atomic<uint64_t> gAllocations{0};
+}
+
+// Counts every allocation so the steady-state runs can require none. GCC can't see
+// that the replaced delete pairs with this new.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void* operator new(size_t size) {
+    gAllocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+namespace {
+    constexpr int kOutRate = 48000;
+    constexpr int kFrameSamples = kOutRate / 100;
+
+    struct Args {
+        std::string mode = "stress";
+        int captureRate = 44100;
+        int deviceRate = 48000;
+        int deviceChannels = 6;
+        int seconds = 60;
+        int frames = 20'000'000;
+        uint64_t seed = 1;
+        std::string output;
+    };
+
+    // splitmix64.
+    struct Rng {
+        uint64_t state;
+        explicit Rng(uint64_t seed) : state(seed) {}
+        uint64_t Next() {
+            uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            return z ^ (z >> 31);
+        }
+        size_t Below(size_t n) { return static_cast<size_t>(Next() % n); }
+    };
+
+    // Sample values stay exact in a float below 2^24.
+    float Tag(uint64_t frame, int channel) { return static_cast<float>((frame * 2 + channel) & 0xFFFFFF); }
+
+    bool RunThreadedStress(const Args& args, json& out) {
+        constexpr int kChannels = 2;
+        SampleRing ring(kChannels, 1024);
+        const uint64_t total = static_cast<uint64_t>(args.frames);
+        std::atomic<uint64_t> errors{0};
+        uint64_t splitReads = 0, splitWrites = 0;
+
+        // Each side waits for its whole request, the way the encoder waits for a full
+        // frame, so positions drift across the wrap. Requests of up to half the ring
+        // can't both be waiting.
+        const size_t maxRequest = 512;
+        std::thread writer([&] {
+            Rng rng(args.seed * 2 + 1);
+            for (uint64_t written = 0; written < total;) {
+                const size_t want = static_cast<size_t>(std::min<uint64_t>(total - written, 1 + rng.Below(maxRequest)));
+                while (ring.Free() < want) std::this_thread::yield();
+                const SampleRing::Spans spans = ring.Writable(want);
+                if (spans.second.frames) splitWrites++;
+                uint64_t frame = written;
+                for (const SampleRing::Span& span : {spans.first, spans.second}) {
+                    for (size_t i = 0; i < span.frames; i++, frame++)
+                        for (int c = 0; c < kChannels; c++) span.data[i * kChannels + c] = Tag(frame, c);
+                }
+                ring.Commit(spans.Frames());
+                written += spans.Frames();
+            }
+        });
+
+        Rng rng(args.seed * 2 + 2);
+        for (uint64_t read = 0; read < total;) {
+            const size_t want = static_cast<size_t>(std::min<uint64_t>(total - read, 1 + rng.Below(maxRequest)));
+            while (ring.Size() < want) std::this_thread::yield();
+            const SampleRing::Spans spans = ring.Readable(want);
+            if (spans.second.frames) splitReads++;
+            uint64_t frame = read;
+            for (const SampleRing::Span& span : {spans.first, spans.second}) {
+                for (size_t i = 0; i < span.frames; i++, frame++)
+                    for (int c = 0; c < kChannels; c++)
+                        if (span.data[i * kChannels + c] != Tag(frame, c)) errors.fetch_add(1, std::memory_order_relaxed);
+            }
+            ring.Consume(spans.Frames());
+            read += spans.Frames();
+        }
+        writer.join();
+
+        out = {{"frames", total}, {"capacity", ring.Capacity()}, {"splitWrites", splitWrites},
+               {"splitReads", splitReads}, {"errors", errors.load()}, {"leftover", ring.Size()}};
+        // A run long enough to lap the ring must have exercised the split spans.
+        const bool wrapped = total < ring.Capacity() * 4 || (splitReads > 0 && splitWrites > 0);
+        const bool passed = errors.load() == 0 && ring.Size() == 0 && wrapped;
+        if (!passed) ERR("SampleRing: threaded stress failed (seed %llu)", static_cast<unsigned long long>(args.seed));
+        return passed;
+    }
+
+    // One 10 ms block of a 400 Hz tone, replayed every step so the loop measures
+    // only the resampler and the buffer.
+    std::vector<float> ToneBlock(int channels, int rate) {
+        std::vector<float> block(static_cast<size_t>(rate / 100) * channels);
+        for (size_t i = 0; i < block.size() / channels; i++) {
+            const float v = 0.25f * std::sin(static_cast<float>(i) * 6.2831853f * 400.0f / static_cast<float>(rate));
+            for (int c = 0; c < channels; c++) block[i * channels + c] = v;
+        }
+        return block;
+    }
+
+    // AudioCapture: 10 ms loopback blocks in, Opus-sized frames out as PCM16.
+    struct CaptureModel {
+        SpeexResampler resampler;
+        std::vector<float> block;
+        std::vector<int16_t> pcm;
+        uint64_t framesOut = 0;
+        int frameSamples;
+
+        CaptureModel(int rate, int frameSamples_)
+            : resampler(rate, kOutRate, 2, 2, 8192), block(ToneBlock(2, rate)),
+              pcm(static_cast<size_t>(kOutRate / 50) * 2), frameSamples(frameSamples_) {}
+
+        void Step() {
+            resampler.Process(block.data(), block.size() / 2);
+            SampleRing& ring = resampler.ring;
+            if (ring.Size() > static_cast<size_t>(kFrameSamples) * 6) ring.DropOldest(static_cast<size_t>(kFrameSamples) * 2);
+            while (ring.Size() >= static_cast<size_t>(frameSamples)) {
+                int16_t* out = pcm.data();
+                const SampleRing::Spans spans = ring.Readable(static_cast<size_t>(frameSamples));
+                for (const SampleRing::Span& span : {spans.first, spans.second})
+                    for (size_t i = 0; i < span.frames * 2; i++)
+                        *out++ = static_cast<int16_t>(std::clamp(span.data[i], -1.0f, 1.0f) * 32767.0f);
+                ring.Consume(static_cast<size_t>(frameSamples));
+                framesOut++;
+            }
+        }
+    };
+
+    // MicPlayback: 10 ms mono packets fanned out to the device, drained into a
+    // render buffer in device-period pieces.
+    struct MicModel {
+        SpeexResampler resampler;
+        std::vector<float> block, render;
+        uint64_t framesOut = 0;
+        int channels;
+
+        MicModel(int deviceRate, int channels_)
+            : resampler(kOutRate, deviceRate, 1, channels_, static_cast<size_t>(deviceRate) / 4 + kFrameSamples * 10),
+              block(ToneBlock(1, kOutRate)), render(static_cast<size_t>(deviceRate / 100) * channels_), channels(channels_) {}
+
+        void Step() {
+            resampler.ProcessMono(block.data(), block.size());
+            SampleRing& ring = resampler.ring;
+            const size_t period = render.size() / static_cast<size_t>(channels);
+            while (ring.Size() > 0) {
+                const SampleRing::Spans spans = ring.Readable(period);
+                float* out = render.data();
+                for (const SampleRing::Span& span : {spans.first, spans.second}) {
+                    std::memcpy(out, span.data, span.frames * channels * sizeof(float));
+                    out += span.frames * channels;
+                }
+                ring.Consume(spans.Frames());
+                framesOut += spans.Frames();
+            }
+        }
+    };
+
+    // The previous scheme: a growing vector with a read position, compacted by erase.
+    struct LegacyCaptureModel {
+        SpeexResamplerState* st = nullptr;
+        std::vector<float> buf, block;
+        std::vector<int16_t> pcm;
+        size_t readPos = 0;
+        uint64_t framesOut = 0;
+        int frameSamples, srcRate;
+
+        LegacyCaptureModel(int rate, int frameSamples_)
+            : block(ToneBlock(2, rate)), pcm(static_cast<size_t>(kOutRate / 50) * 2),
+              frameSamples(frameSamples_), srcRate(rate) {
+            int err;
+            st = speex_resampler_init(2, rate, kOutRate, 4, &err);
+            buf.reserve(480 * 2 * 8);
+        }
+        ~LegacyCaptureModel() { if (st) speex_resampler_destroy(st); }
+
+        void Step() {
+            spx_uint32_t inLen = static_cast<spx_uint32_t>(block.size() / 2);
+            spx_uint32_t outLen = static_cast<spx_uint32_t>(inLen * kOutRate / srcRate + 64);
+            const size_t pos = buf.size();
+            buf.resize(pos + outLen * 2);
+            speex_resampler_process_interleaved_float(st, block.data(), &inLen, buf.data() + pos, &outLen);
+            buf.resize(pos + outLen * 2);
+
+            const size_t frameValues = static_cast<size_t>(frameSamples) * 2;
+            while (buf.size() >= readPos + frameValues) {
+                const float* src = buf.data() + readPos;
+                for (size_t i = 0; i < frameValues; i++)
+                    pcm[i] = static_cast<int16_t>(std::clamp(src[i], -1.0f, 1.0f) * 32767.0f);
+                readPos += frameValues;
+                framesOut++;
+            }
+            if (readPos == 0 || (readPos < buf.size() && readPos < 8192)) return;
+            if (readPos < buf.size()) buf.erase(buf.begin(), buf.begin() + static_cast<std::ptrdiff_t>(readPos));
+            else buf.clear();
+            readPos = 0;
+        }
+    };
+
+    // Runs warmup seconds, then counts allocations and time over the measured ones.
+    template <typename Model>
+    json Measure(Model& model, int seconds) {
+        for (int i = 0; i < 100; i++) model.Step();
+        const uint64_t allocBefore = gAllocations.load(std::memory_order_relaxed);
+        const auto start = Clock::now();
+        const int steps = seconds * 100;
+        for (int i = 0; i < steps; i++) model.Step();
+        const auto elapsed = Clock::now() - start;
+        const uint64_t allocations = gAllocations.load(std::memory_order_relaxed) - allocBefore;
+        const double ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+        return {{"allocations", allocations}, {"nsPerBlock", ns / steps}, {"framesOut", model.framesOut}};
+    }
+
+    bool RunSteadyState(const Args& args, json& out) {
+        bool passed = true;
+        for (const int frameSamples : {kOutRate / 400, kOutRate / 200, kOutRate / 100, kOutRate / 50}) {
+            CaptureModel capture(args.captureRate, frameSamples);
+            json run = Measure(capture, args.seconds);
+            run["frameSamples"] = frameSamples;
+            if (run["allocations"].get<uint64_t>() != 0) {
+                ERR("SampleRing: capture path allocated %llu times at %d-sample frames",
+                    static_cast<unsigned long long>(run["allocations"].get<uint64_t>()), frameSamples);
+                passed = false;
+            }
+            out["capture"].push_back(run);
+        }
+        MicModel mic(args.deviceRate, args.deviceChannels);
+        json micRun = Measure(mic, args.seconds);
+        micRun["deviceRate"] = args.deviceRate;
+        micRun["deviceChannels"] = args.deviceChannels;
+        if (micRun["allocations"].get<uint64_t>() != 0) {
+            ERR("SampleRing: mic path allocated %llu times", static_cast<unsigned long long>(micRun["allocations"].get<uint64_t>()));
+            passed = false;
+        }
+        out["mic"] = micRun;
+        return passed;
+    }
+
+    void PrintUsage() {
+        fprintf(stderr,
+            "Usage: slipstream_samplering [options]\n"
+            "  --mode NAME          stress, bench or all (default: stress)\n"
+            "  --capture-rate N     loopback rate resampled to 48 kHz (default: 44100)\n"
+            "  --device-rate N      mic render device rate (default: 48000)\n"
+            "  --device-channels N  mic render device channels (default: 6)\n"
+            "  --seconds N          simulated seconds per steady-state run (default: 60)\n"
+            "  --frames N           threaded stress frames (default: 20000000)\n"
+            "  --seed N             stress seed (default: 1)\n"
+            "  --output FILE        write JSON here instead of stdout\n");
+    }
+
+    bool ParseArgs(int argc, char* argv[], Args& args) {
+        for (int i = 1; i < argc; ++i) {
+            const std::string arg = argv[i];
+            if (arg == "--help" || arg == "-h") return false;
+            if (i + 1 >= argc) {
+                ERR("Missing value for %s", arg.c_str());
+                return false;
+            }
+            const std::string value = argv[++i];
+            if (arg == "--mode") {
+                if (value != "bench" && value != "stress" && value != "all") return false;
+                args.mode = value;
+            } else if (arg == "--capture-rate") {
+                args.captureRate = std::clamp(atoi(value.c_str()), 8000, 384000);
+            } else if (arg == "--device-rate") {
+                args.deviceRate = std::clamp(atoi(value.c_str()), 8000, 384000);
+            } else if (arg == "--device-channels") {
+                args.deviceChannels = std::clamp(atoi(value.c_str()), 1, 8);
+            } else if (arg == "--seconds") {
+                args.seconds = std::clamp(atoi(value.c_str()), 1, 3600);
+            } else if (arg == "--frames") {
+                args.frames = std::max(1, atoi(value.c_str()));
+            } else if (arg == "--seed") {
+                args.seed = std::strtoull(value.c_str(), nullptr, 10);
+            } else if (arg == "--output") {
+                args.output = value;
+            } else {
+                ERR("Unknown option %s", arg.c_str());
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    Args args;
+    if (!ParseArgs(argc, argv, args)) {
+        PrintUsage();
+        return 2;
+    }
+
+    json report;
+    bool passed = true;
+    if (args.mode != "bench") {
+        json threaded, steady;
+        passed = RunThreadedStress(args, threaded) && passed;
+        passed = RunSteadyState(args, steady) && passed;
+        report["stress"] = {{"seed", args.seed}, {"threaded", threaded}, {"steady", steady}};
+    }
+    if (args.mode != "stress") {
+        CaptureModel ring(args.captureRate, kFrameSamples);
+        LegacyCaptureModel legacy(args.captureRate, kFrameSamples);
+        report["bench"] = {{"ring", Measure(ring, args.seconds)}, {"vector", Measure(legacy, args.seconds)}};
+    }
+
+    const std::string text = report.dump(2);
+    if (args.output.empty()) {
+        std::cout << text << std::endl;
+    } else {
+        std::ofstream file(args.output);
+        if (!file) {
+            ERR("SampleRing: Cannot write %s", args.output.c_str());
+            return 1;
+        }
+        file << text << '\n';
+    }
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,252 @@
+// slipstream_x11bench: capture throughput of the X11 source. A full-screen window is
+// redrawn with a fixed damage pattern each frame and Read is timed with XDamage
+// tracking and with whole-screen fetches. Run it on an otherwise idle display, e.g.
+// Xvfb :99 -screen 0 1920x1080x24 (or 3840x2160x24); no GPU needed.
+
+#include "host/core/clock.hpp"
+#include "host/core/logging.hpp"
+#include "host/media/x11_capture.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include <xcb/xcb.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using json = nlohmann::json;
+
+namespace {
+    struct Args {
+        std::string display, output;
+        std::vector<std::string> scenarios = {"idle", "cursor", "typing", "window", "video", "full"};
+        int frames = 300;
+        bool check = false;
+    };
+
+    void PrintUsage() {
+        fprintf(stderr,
+            "Usage: slipstream_x11bench [options]\n"
+            "  --display NAME       X display (default: $DISPLAY)\n"
+            "  --scenarios LIST     comma list of idle, cursor, typing, window, video, full\n"
+            "                       (default: all)\n"
+            "  --frames N           frames per scenario and mode (default: 300)\n"
+            "  --check              also grab each frame whole and compare it with the\n"
+            "                       damage-tracked frame; exit non-zero on a mismatch\n"
+            "  --output FILE        write JSON here instead of stdout\n"
+            "  --debug              verbose logging\n");
+    }
+
+    std::vector<std::string> SplitList(const std::string& value) {
+        std::vector<std::string> items;
+        std::stringstream stream(value);
+        for (std::string item; std::getline(stream, item, ',');) {
+            if (!item.empty()) items.push_back(item);
+        }
+        return items;
+    }
+
+    bool ParseArgs(int argc, char* argv[], Args& args) {
+        for (int i = 1; i < argc; ++i) {
+            const std::string arg = argv[i];
+            if (arg == "--debug") { g_debugLogging = true; continue; }
+            if (arg == "--check") { args.check = true; continue; }
+            if (arg == "--help" || arg == "-h") return false;
+            if (i + 1 >= argc) {
+                ERR("Missing value for %s", arg.c_str());
+                return false;
+            }
+            const std::string value = argv[++i];
+            if (arg == "--display") {
+                args.display = value;
+            } else if (arg == "--scenarios") {
+                args.scenarios = SplitList(value);
+            } else if (arg == "--frames") {
+                args.frames = std::clamp(atoi(value.c_str()), 10, 100000);
+            } else if (arg == "--output") {
+                args.output = value;
+            } else {
+                ERR("Unknown option %s", arg.c_str());
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // A window over the whole screen that each scenario draws into.
+    class Canvas {
+        xcb_connection_t* conn = nullptr;
+        xcb_window_t window = XCB_NONE;
+        xcb_gcontext_t gc = XCB_NONE;
+
+    public:
+        int width = 0, height = 0;
+
+        ~Canvas() {
+            if (conn) xcb_disconnect(conn);
+        }
+
+        bool Open(const std::string& display) {
+            int screenNum = 0;
+            conn = xcb_connect(display.empty() ? nullptr : display.c_str(), &screenNum);
+            if (xcb_connection_has_error(conn)) {
+                ERR("X11Bench: Cannot connect to the display");
+                return false;
+            }
+            xcb_screen_iterator_t it = xcb_setup_roots_iterator(xcb_get_setup(conn));
+            for (int i = 0; i < screenNum && it.rem > 0; ++i) xcb_screen_next(&it);
+            const xcb_screen_t* scr = it.data;
+            width = scr->width_in_pixels;
+            height = scr->height_in_pixels;
+
+            window = xcb_generate_id(conn);
+            const uint32_t values[] = {scr->black_pixel, 1};
+            xcb_create_window(conn, XCB_COPY_FROM_PARENT, window, scr->root, 0, 0,
+                static_cast<uint16_t>(width), static_cast<uint16_t>(height), 0, XCB_WINDOW_CLASS_INPUT_OUTPUT,
+                scr->root_visual, XCB_CW_BACK_PIXEL | XCB_CW_OVERRIDE_REDIRECT, values);
+            gc = xcb_generate_id(conn);
+            xcb_create_gc(conn, gc, window, 0, nullptr);
+            xcb_map_window(conn, window);
+            Sync();
+            return true;
+        }
+
+        void Fill(int x, int y, int w, int h, uint32_t color) {
+            xcb_change_gc(conn, gc, XCB_GC_FOREGROUND, &color);
+            const xcb_rectangle_t rect = {static_cast<int16_t>(x), static_cast<int16_t>(y),
+                                          static_cast<uint16_t>(w), static_cast<uint16_t>(h)};
+            xcb_poly_fill_rectangle(conn, window, gc, 1, &rect);
+        }
+
+        // Returns once the server has drawn everything sent so far.
+        void Sync() {
+            free(xcb_get_input_focus_reply(conn, xcb_get_input_focus(conn), nullptr));
+        }
+    };
+
+    uint32_t Color(int frame, int salt) {
+        uint32_t v = static_cast<uint32_t>(frame * 2654435761u + salt * 40503u);
+        return (v ^ (v >> 13)) & 0xFFFFFFu;
+    }
+
+    // Draws one frame of a scenario; the damaged area stays the same size while it moves.
+    bool DrawFrame(Canvas& canvas, const std::string& scenario, int frame) {
+        const int W = canvas.width, H = canvas.height;
+        if (scenario == "idle") {
+        } else if (scenario == "cursor") {
+            canvas.Fill((frame * 7) % (W - 32), (frame * 5) % (H - 32), 32, 32, Color(frame, 1));
+        } else if (scenario == "typing") {
+            for (int i = 0; i < 4; ++i) canvas.Fill(100 + ((frame + i) * 12) % (W / 2), 200 + i * 40, 12, 20, Color(frame, i));
+        } else if (scenario == "window") {
+            const int ww = std::min(W, 800), wh = std::min(H, 600);
+            canvas.Fill((frame * 9) % (W - ww + 1), (frame * 4) % (H - wh + 1), ww, wh, Color(frame, 2));
+        } else if (scenario == "video") {
+            const int vw = std::min(W, 1280), vh = std::min(H, 720);
+            canvas.Fill((W - vw) / 2, (H - vh) / 2, vw, vh, Color(frame, 3));
+        } else if (scenario == "full") {
+            canvas.Fill(0, 0, W, H, Color(frame, 4));
+        } else {
+            return false;
+        }
+        canvas.Sync();
+        return true;
+    }
+
+    double Percentile(std::vector<double> values, double p) {
+        if (values.empty()) return 0.0;
+        std::sort(values.begin(), values.end());
+        const size_t index = std::min(values.size() - 1, static_cast<size_t>(p * (values.size() - 1) + 0.5));
+        return values[index];
+    }
+
+    json RunScenario(const Args& args, Canvas& canvas, const std::string& scenario, bool trackDamage, uint64_t& mismatches) {
+        auto source = OpenX11Source(args.display, 60, trackDamage);
+        std::unique_ptr<CaptureSource> reference;
+        if (args.check && trackDamage) reference = OpenX11Source(args.display, 60, false);
+        if (!source || (args.check && trackDamage && !reference)) return nullptr;
+
+        std::vector<uint8_t> bgra, whole;
+        std::vector<double> readMs;
+        double changed = 0.0;
+        uint64_t staticFrames = 0, scenarioMismatches = 0;
+        canvas.Fill(0, 0, canvas.width, canvas.height, 0);
+        canvas.Sync();
+        if (!source->Read(bgra)) return nullptr;
+
+        for (int frame = 0; frame < args.frames; ++frame) {
+            if (!DrawFrame(canvas, scenario, frame)) return nullptr;
+            const int64_t t0 = GetTimestamp();
+            if (!source->Read(bgra)) return nullptr;
+            readMs.push_back(static_cast<double>(GetTimestamp() - t0) / 1000.0);
+            const FrameChangeInfo* info = source->Changes();
+            if (info && info->valid) {
+                changed += info->ChangedFraction();
+                if (info->IsStatic()) staticFrames++;
+            } else {
+                changed += 1.0;
+            }
+            if (reference) {
+                if (!reference->Read(whole)) return nullptr;
+                if (whole != bgra) scenarioMismatches++;
+            }
+        }
+        mismatches += scenarioMismatches;
+        const double p50 = Percentile(readMs, 0.50);
+        json result = {
+            {"scenario", scenario}, {"mode", trackDamage ? "damage" : "full"},
+            {"readMs", {{"p50", p50}, {"p95", Percentile(readMs, 0.95)}, {"max", Percentile(readMs, 1.0)}}},
+            {"maxFps", p50 > 0.0 ? 1000.0 / p50 : 0.0},
+            {"changedFraction", changed / args.frames},
+            {"staticFrames", staticFrames}
+        };
+        if (reference) result["mismatches"] = scenarioMismatches;
+        LOG("X11Bench: %-7s %-6s p50 %.3f ms", scenario.c_str(), trackDamage ? "damage" : "full", p50);
+        return result;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    Args args;
+    if (!ParseArgs(argc, argv, args)) {
+        PrintUsage();
+        return 2;
+    }
+    Canvas canvas;
+    if (!canvas.Open(args.display)) return 1;
+
+    json report = {{"tool", "slipstream_x11bench"}, {"width", canvas.width}, {"height", canvas.height}, {"frames", args.frames}};
+    uint64_t mismatches = 0;
+    for (const auto& scenario : args.scenarios) {
+        for (const bool trackDamage : {true, false}) {
+            json result = RunScenario(args, canvas, scenario, trackDamage, mismatches);
+            if (result.is_null()) {
+                ERR("X11Bench: Scenario %s failed", scenario.c_str());
+                return 1;
+            }
+            report["results"].push_back(result);
+        }
+    }
+    if (args.check) report["mismatches"] = mismatches;
+    const bool passed = mismatches == 0;
+    if (!passed) ERR("X11Bench: %llu damage-tracked frames differ from a whole grab", static_cast<unsigned long long>(mismatches));
+
+    const std::string text = report.dump(2);
+    if (args.output.empty()) {
+        std::cout << text << std::endl;
+    } else {
+        std::ofstream file(args.output);
+        if (!file) {
+            ERR("X11Bench: Cannot write %s", args.output.c_str());
+            return 1;
+        }
+        file << text << '\n';
+    }
+    return passed ? 0 : 1;
+}